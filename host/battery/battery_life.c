@@ -0,0 +1,204 @@
+/*
+    Projects battery life from the telemetry lines a TELEMETRY build sends over the USART (see src/util/telemetry.h),
+    weighting the firmware's own counts of time spent asleep, awake and in each radio mode by the same typical
+    currents host/sim's energy model uses.
+
+    The input is the raw byte stream from the transmitter - a serial capture, or the output of host/sim/replay -o - so
+    packets and telemetry can be mixed freely.  The first and last telemetry lines are compared, so the projection
+    covers whatever the device was doing in between; with a single line it covers everything since power on.
+
+    cc -O2 -I../sim/include -o battery_life battery_life.c
+    ./battery_life -c mAh [-u hours_in_use_per_day] [-t transmitter_uA] [capture.bin]
+
+    Timer2 stops in power-down, so the counters can't tell how long the device spent powered down - only how often.
+    Pass -u to project for a given number of hours of use per day, with the rest spent powered down.  -t adds the
+    433MHz transmitter on the USART, which draws the given current while it's sending.
+
+    Add -DTIMER2_ASYNC when the capture came from a firmware built with it, so ticks are converted at the crystal's rate.
+*/
+#include "../../src/avr_config.h"
+#include "../../src/util/timing.h"
+#include "../../src/util/avr_usart.h"
+#include "../../src/util/telemetry.h"
+#include "../sim/energy_model.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TICKS_TO_SECONDS(ticks) ((double) (ticks) * TIMER2_TICKS_PER_MS_DEN / TIMER2_TICKS_PER_MS_NUM / 1000.0)
+
+/* Seconds each byte takes on the USART - a start bit, 8 data bits and a stop bit. */
+#define USART_BYTE_SECONDS (10.0 / BAUD_RATE)
+
+/* Longest telemetry line worth looking at. */
+#define MAX_LINE_LENGTH 160
+
+struct Telemetry_Line {
+    uint32_t counters[TELEMETRY_NUM_COUNTERS];
+};
+
+static const char* const COUNTER_NAMES[TELEMETRY_NUM_COUNTERS] = {
+    [TELEMETRY_IDLE_TICKS] = "mcu idle",
+    [TELEMETRY_POWER_SAVE_TICKS] = "mcu power-save",
+    [TELEMETRY_RADIO_SLEEP_TICKS] = "radio sleep",
+    [TELEMETRY_RADIO_STANDBY_TICKS] = "radio standby",
+    [TELEMETRY_RADIO_SYNTH_TICKS] = "radio synth",
+    [TELEMETRY_RADIO_RX_TICKS] = "radio rx",
+    [TELEMETRY_RADIO_TX_TICKS] = "radio tx",
+};
+
+static bool parse_line(const char* text, struct Telemetry_Line* line)
+{
+    const char* cursor = text;
+
+    for(uint8_t i = 0; i < TELEMETRY_NUM_COUNTERS; i++) {
+        char* end;
+        unsigned long value = strtoul(cursor, &end, 10);
+        if(end == cursor || (i + 1 < TELEMETRY_NUM_COUNTERS && *end != ',')) {
+            return false;
+        }
+        line->counters[i] = (uint32_t) value;
+        cursor = end + 1;
+    }
+    return true;
+}
+
+/* Reads every telemetry line out of the capture, keeping the first and last.  Returns how many there were. */
+static unsigned read_lines(FILE* file, struct Telemetry_Line* first, struct Telemetry_Line* last)
+{
+    char text[MAX_LINE_LENGTH];
+    size_t length = 0;
+    unsigned count = 0;
+    int c;
+
+    // Lines start with "TEL " - anything else, including packets, is skipped a byte at a time.
+    while((c = fgetc(file)) != EOF) {
+        if(c == '\n' || c == '\r' || length == sizeof(text) - 1) {
+            text[length] = '\0';
+            char* start = strstr(text, "TEL ");
+            struct Telemetry_Line line;
+            if(start != NULL && parse_line(start + 4, &line)) {
+                if(count++ == 0) {
+                    *first = line;
+                }
+                *last = line;
+            }
+            length = 0;
+        } else if(c != '\0') {
+            text[length++] = (char) c;
+        }
+    }
+    return count;
+}
+
+static void usage(const char* program)
+{
+    fprintf(stderr, "usage: %s -c mAh [-u hours_in_use_per_day] [-t transmitter_uA] [capture.bin]\n", program);
+}
+
+int main(int argc, char** argv)
+{
+    double capacity_mah = 0;
+    double hours_in_use = -1;
+    double transmitter_ua = 0;
+    int option;
+
+    while((option = getopt(argc, argv, "c:u:t:")) != -1) {
+        switch(option) {
+            case 'c':
+                capacity_mah = atof(optarg);
+                break;
+            case 'u':
+                hours_in_use = atof(optarg);
+                break;
+            case 't':
+                transmitter_ua = atof(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    FILE* file = stdin;
+    if(capacity_mah <= 0 || hours_in_use > 24 || (optind < argc && (file = fopen(argv[optind], "rb")) == NULL)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    struct Telemetry_Line first = { { 0 } };
+    struct Telemetry_Line last = { { 0 } };
+    unsigned count = read_lines(file, &first, &last);
+    if(count == 0) {
+        fprintf(stderr, "no telemetry lines found\n");
+        return 1;
+    }
+
+    // Counters wrap, so work in differences.  One line is compared against power on, when they were all zero.
+    uint32_t delta[TELEMETRY_NUM_COUNTERS];
+    for(uint8_t i = 0; i < TELEMETRY_NUM_COUNTERS; i++) {
+        delta[i] = last.counters[i] - (count > 1 ? first.counters[i] : 0);
+    }
+
+    double seconds = TICKS_TO_SECONDS(delta[TELEMETRY_TICKS]);
+    if(seconds <= 0) {
+        fprintf(stderr, "telemetry covers no time\n");
+        return 1;
+    }
+
+    double mhz = F_CPU / 1e6;
+    double current_ua[TELEMETRY_NUM_COUNTERS] = {
+        [TELEMETRY_IDLE_TICKS] = ENERGY_MCU_IDLE_UA_PER_MHZ * mhz,
+        [TELEMETRY_POWER_SAVE_TICKS] = ENERGY_MCU_POWER_SAVE_UA,
+        [TELEMETRY_RADIO_SLEEP_TICKS] = ENERGY_RADIO_SLEEP_UA,
+        [TELEMETRY_RADIO_STANDBY_TICKS] = ENERGY_RADIO_STANDBY_UA,
+        [TELEMETRY_RADIO_SYNTH_TICKS] = ENERGY_RADIO_SYNTH_UA,
+        [TELEMETRY_RADIO_RX_TICKS] = ENERGY_RADIO_RX_UA,
+        [TELEMETRY_RADIO_TX_TICKS] = ENERGY_RADIO_TX_UA,
+    };
+
+    printf("telemetry lines:    %u, covering %.1f s of scheduler time and %" PRIu32 " power-downs\n", count, seconds,
+           delta[TELEMETRY_POWER_DOWNS]);
+    printf("supply voltage:     %" PRIu32 " mV -> %" PRIu32 " mV\n", first.counters[TELEMETRY_VCC_MV],
+           last.counters[TELEMETRY_VCC_MV]);
+
+    double asleep = TICKS_TO_SECONDS(delta[TELEMETRY_IDLE_TICKS] + delta[TELEMETRY_POWER_SAVE_TICKS]);
+    double awake = (seconds > asleep ? seconds - asleep : 0);
+    double charge_uas = awake * ENERGY_MCU_ACTIVE_UA_PER_MHZ * mhz;
+    printf("  %-16s %9.3f s  x %9.1f uA\n", "mcu active", awake, ENERGY_MCU_ACTIVE_UA_PER_MHZ * mhz);
+
+    for(uint8_t i = 0; i < TELEMETRY_NUM_COUNTERS; i++) {
+        if(COUNTER_NAMES[i] == NULL || delta[i] == 0) {
+            continue;
+        }
+        double state_seconds = TICKS_TO_SECONDS(delta[i]);
+        charge_uas += state_seconds * current_ua[i];
+        printf("  %-16s %9.3f s  x %9.1f uA\n", COUNTER_NAMES[i], state_seconds, current_ua[i]);
+    }
+
+    if(transmitter_ua > 0) {
+        double sending = delta[TELEMETRY_USART_BYTES] * USART_BYTE_SECONDS;
+        charge_uas += sending * transmitter_ua;
+        printf("  %-16s %9.3f s  x %9.1f uA\n", "433MHz tx", sending, transmitter_ua);
+    }
+
+    double average_ua = charge_uas / seconds;
+    printf("average while on:   %.2f uA\n", average_ua);
+
+    if(hours_in_use >= 0) {
+        double powered_down_ua = ENERGY_MCU_POWER_DOWN_UA + ENERGY_RADIO_SLEEP_UA;
+        average_ua = (average_ua * hours_in_use + powered_down_ua * (24 - hours_in_use)) / 24;
+        printf("average per day:    %.2f uA (%.1f h in use, the rest powered down)\n", average_ua, hours_in_use);
+    }
+
+    double hours = capacity_mah * 1000 / average_ua;
+    printf("battery life:       %.0f h (%.1f days) from %.0f mAh\n", hours, hours / 24, capacity_mah);
+
+    if(file != stdin) {
+        fclose(file);
+    }
+    return 0;
+}
@@ -0,0 +1,135 @@
+/*
+    Throughput benchmark for the streaming packet decoder.
+
+    Decodes a captured byte stream (e.g. `cat /dev/ttyUSB0 > capture.bin`) over and over, or a synthetic stream
+    of random packets with the occasional corrupted byte if no capture is given.
+
+    cc -O2 -o decoder_bench decoder_bench.c packet_decoder.c
+    ./decoder_bench [capture.bin] [passes]
+*/
+#include "packet_decoder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define SYNTHETIC_PACKETS 1000000
+
+/* Roughly one in every CORRUPTION_INTERVAL synthetic packets has a byte flipped, so the resync path gets exercised. */
+#define CORRUPTION_INTERVAL 1000
+
+#define OUTPUT_PACKETS 4096
+
+static uint32_t xorshift_state = 2463534242u;
+
+static uint32_t xorshift32(void)
+{
+    xorshift_state ^= xorshift_state << 13;
+    xorshift_state ^= xorshift_state >> 17;
+    xorshift_state ^= xorshift_state << 5;
+    return xorshift_state;
+}
+
+static uint8_t* synthesize_stream(size_t* num_bytes)
+{
+    uint8_t* stream = malloc((size_t) SYNTHETIC_PACKETS * (PACKET_FRAME_LENGTH + 1));
+    if(stream == NULL) {
+        return NULL;
+    }
+
+    size_t length = 0;
+    for(uint32_t p = 0; p < SYNTHETIC_PACKETS; p++) {
+        uint8_t data[PACKET_NUM_DATA_CHARS];
+        uint32_t random = xorshift32();
+        for(uint8_t i = 0; i < PACKET_NUM_DATA_CHARS; i++) {
+            data[i] = (uint8_t) (random >> (i * 8));
+        }
+        data[PACKET_MISC_BYTE_INDEX] &= 0x7F;
+
+        uint8_t* packet = &stream[length];
+        stream[length++] = PACKET_TRAINING_CHAR;
+        stream[length++] = PACKET_START_CHAR;
+        for(uint8_t i = 0; i < PACKET_NUM_DATA_CHARS; i++) {
+            stream[length++] = data[i];
+        }
+        stream[length++] = packet_checksum(data, PACKET_NUM_DATA_CHARS);
+
+        if(p % CORRUPTION_INTERVAL == CORRUPTION_INTERVAL - 1) {
+            packet[2 + xorshift32() % PACKET_NUM_DATA_CHARS] ^= 0x10;
+        }
+    }
+
+    *num_bytes = length;
+    return stream;
+}
+
+static uint8_t* read_capture(const char* path, size_t* num_bytes)
+{
+    FILE* file = fopen(path, "rb");
+    if(file == NULL) {
+        perror(path);
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+
+    uint8_t* stream = malloc(size > 0 ? (size_t) size : 1);
+    if(stream != NULL && fread(stream, 1, (size_t) size, file) != (size_t) size) {
+        free(stream);
+        stream = NULL;
+    }
+    fclose(file);
+
+    *num_bytes = (size_t) size;
+    return stream;
+}
+
+int main(int argc, char** argv)
+{
+    size_t num_bytes = 0;
+    uint8_t* stream = (argc > 1 ? read_capture(argv[1], &num_bytes) : synthesize_stream(&num_bytes));
+    unsigned passes = (argc > 2 ? (unsigned) strtoul(argv[2], NULL, 10) : 20);
+    if(stream == NULL || passes == 0) {
+        fprintf(stderr, "usage: %s [capture.bin] [passes]\n", argv[0]);
+        return 1;
+    }
+
+    static struct Decoded_Packet packets[OUTPUT_PACKETS];
+    struct Packet_Decoder decoder;
+    packet_decoder_init(&decoder);
+
+    // Fold the decoded values into a checksum so the compiler can't throw any of the work away.
+    uint32_t sink = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for(unsigned pass = 0; pass < passes; pass++) {
+        size_t offset = 0;
+        while(offset < num_bytes) {
+            size_t consumed;
+            size_t decoded = packet_decoder_feed_buffer(&decoder, stream + offset, num_bytes - offset, packets, OUTPUT_PACKETS, &consumed);
+            for(size_t i = 0; i < decoded; i++) {
+                sink += packets[i].analog_stick_x ^ packets[i].analog_stick_y ^ packets[i].button_byte;
+            }
+            offset += consumed;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    double megabytes = (double) num_bytes * passes / (1024.0 * 1024.0);
+
+    printf("bytes/pass:        %zu\n", num_bytes);
+    printf("passes:            %u\n", passes);
+    printf("packets ok:        %u\n", decoder.stats.packets_ok);
+    printf("checksum failures: %u\n", decoder.stats.checksum_failures);
+    printf("bytes skipped:     %u\n", decoder.stats.bytes_skipped);
+    printf("elapsed:           %.3f s\n", seconds);
+    printf("throughput:        %.2f Mpackets/s, %.1f MiB/s\n", decoder.stats.packets_ok / seconds / 1e6, megabytes / seconds);
+    printf("(sink %u)\n", sink);
+
+    free(stream);
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include "message_dispatch.h"
+
+#include <string.h>
+
+/* Names of the message types, indexed by enum Message_Type. */
+static const char* const MESSAGE_TYPE_NAMES[MESSAGE_NUM_TYPES] = { "input state", "event", "telemetry", "config" };
+
+/*
+    Starts a dispatcher off having seen no messages.
+
+    @param dispatcher - The dispatcher to start
+    @param handlers - What to do with each message type
+    @param context - Passed to every handler
+*/
+void message_dispatcher_init(struct Message_Dispatcher* dispatcher, const struct Message_Handlers* handlers,
+                             void* context)
+{
+    memset(dispatcher, 0, sizeof(*dispatcher));
+    dispatcher->handlers = handlers;
+    dispatcher->context = context;
+}
+
+/*
+    Checks a message against its type's schema, and hands it to that type's handler.
+
+    @param dispatcher - The dispatcher to work on
+    @param message - The type byte, then the body
+    @param length - Bytes in message
+    @return Message_Dispatch_Status - MESSAGE_DISPATCH_OK if it went to its handler (or would have, had there been one)
+*/
+enum Message_Dispatch_Status message_dispatch(struct Message_Dispatcher* dispatcher, const uint8_t* message,
+                                              uint8_t length)
+{
+    if(length == 0) {
+        dispatcher->stats.malformed++;
+        return MESSAGE_DISPATCH_MALFORMED;
+    }
+
+    uint8_t type = message[0];
+    const uint8_t* body = message + 1;
+    uint8_t body_length = message_length(type);
+    if(body_length == 0) {
+        dispatcher->stats.unknown++;
+        return MESSAGE_DISPATCH_UNKNOWN;
+    }
+    if(length - 1 < body_length) {
+        dispatcher->stats.malformed++;
+        return MESSAGE_DISPATCH_MALFORMED;
+    }
+
+    const struct Message_Handlers* handlers = dispatcher->handlers;
+    dispatcher->stats.messages[type]++;
+    switch(type) {
+        case MESSAGE_INPUT_STATE:
+            if(handlers->input_state != NULL) {
+                struct Decoded_Packet packet;
+                packet_unpack(body, &packet);
+                handlers->input_state(dispatcher->context, &packet);
+            }
+            break;
+
+        case MESSAGE_EVENT:
+            if(handlers->event != NULL) {
+                struct Decoded_Event event = { .code = body[MESSAGE_EVENT_CODE_INDEX],
+                                               .argument = body[MESSAGE_EVENT_ARGUMENT_INDEX] };
+                handlers->event(dispatcher->context, &event);
+            }
+            break;
+
+        case MESSAGE_TELEMETRY:
+            if(handlers->telemetry != NULL) {
+                struct Decoded_Telemetry telemetry;
+                for(uint8_t i = 0; i < MESSAGE_TELEMETRY_COUNTERS; i++) {
+                    telemetry.counters[i] = message_read_u32(&body[4 * i]);
+                }
+                handlers->telemetry(dispatcher->context, &telemetry);
+            }
+            break;
+
+        case MESSAGE_CONFIG:
+            if(handlers->config != NULL) {
+                struct Decoded_Config config = { .version = body[MESSAGE_CONFIG_VERSION_INDEX],
+                                                 .packet_rate_hz = body[MESSAGE_CONFIG_PACKET_RATE_INDEX],
+                                                 .bitrate_bps = message_read_u32(&body[MESSAGE_CONFIG_BITRATE_INDEX]),
+                                                 .power_dbm = (int8_t) body[MESSAGE_CONFIG_POWER_INDEX] };
+                handlers->config(dispatcher->context, &config);
+            }
+            break;
+    }
+    return MESSAGE_DISPATCH_OK;
+}
+
+/*
+    @param type - An enum Message_Type
+    @return const char* - Its name, or "unknown" if it isn't one this build knows
+*/
+const char* message_type_name(uint8_t type)
+{
+    return type < MESSAGE_NUM_TYPES ? MESSAGE_TYPE_NAMES[type] : "unknown";
+}
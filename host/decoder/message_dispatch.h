@@ -0,0 +1,67 @@
+#ifndef MESSAGE_DISPATCH_H_
+#define MESSAGE_DISPATCH_H_
+
+#include "packet_decoder.h"
+#include "../../src/types/message.h"
+
+#include <stdint.h>
+
+/*
+   Unpacks the messages an RFM69_MESSAGES link carries (see src/types/message.h) and hands each one to the handler for
+   its type.  Feed it what's left of each packet once the length byte and header are off - the type byte and body.
+
+   A message shorter than its type's body is malformed, and one of a type this build doesn't know - from a transmitter
+   newer than it - is unknown; neither reaches a handler, and both are only counted.  A body longer than its type's
+   is fine, since newer transmitters add fields on the end - only the fields known here are unpacked.
+*/
+
+/* The fully unpacked contents of each message type but MESSAGE_INPUT_STATE, which unpacks to a Decoded_Packet. */
+struct Decoded_Event {
+    uint8_t code;                                   // an enum Message_Event_Code
+    uint8_t argument;
+};
+
+struct Decoded_Telemetry {
+    uint32_t counters[MESSAGE_TELEMETRY_COUNTERS];  // in the order of enum Telemetry_Counter
+};
+
+struct Decoded_Config {
+    uint8_t version;                                // the transmitter's MESSAGE_SET_VERSION
+    uint8_t packet_rate_hz;
+    uint32_t bitrate_bps;
+    int8_t power_dbm;
+};
+
+/* What to do with each message type - any left NULL are dropped once they've been counted. */
+struct Message_Handlers {
+    void (*input_state)(void* context, const struct Decoded_Packet* packet);
+    void (*event)(void* context, const struct Decoded_Event* event);
+    void (*telemetry)(void* context, const struct Decoded_Telemetry* telemetry);
+    void (*config)(void* context, const struct Decoded_Config* config);
+};
+
+enum Message_Dispatch_Status {
+    MESSAGE_DISPATCH_OK,
+    MESSAGE_DISPATCH_UNKNOWN,
+    MESSAGE_DISPATCH_MALFORMED
+};
+
+struct Message_Dispatch_Stats {
+    uint32_t messages[MESSAGE_NUM_TYPES];           // dispatched, by type
+    uint32_t unknown;
+    uint32_t malformed;
+};
+
+struct Message_Dispatcher {
+    const struct Message_Handlers* handlers;
+    void* context;                                  // passed to every handler
+    struct Message_Dispatch_Stats stats;
+};
+
+void message_dispatcher_init(struct Message_Dispatcher* dispatcher, const struct Message_Handlers* handlers,
+                             void* context);
+enum Message_Dispatch_Status message_dispatch(struct Message_Dispatcher* dispatcher, const uint8_t* message,
+                                              uint8_t length);
+const char* message_type_name(uint8_t type);
+
+#endif /* MESSAGE_DISPATCH_H_ */
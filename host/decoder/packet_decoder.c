@@ -0,0 +1,162 @@
+#include "packet_decoder.h"
+
+#include <string.h>
+
+#define BIT_IS_SET(target, bit_pos) (((target) & (1UL << (bit_pos))) ? 1 : 0)
+
+/*
+    Drops the start char at the front of a frame that failed validation, and slides the frame forward to the next
+    start char we already have buffered (if any).  The bytes following a false start char may well contain the real
+    one, so throwing them all away would cost us a second packet every time we lose sync.
+
+    @param decoder - The decoder to work on
+*/
+static void resynchronize(struct Packet_Decoder* decoder)
+{
+    uint8_t next_start = 1;
+    while(next_start < decoder->frame_length && decoder->frame[next_start] != PACKET_START_CHAR) {
+        next_start++;
+    }
+
+    decoder->stats.bytes_skipped += next_start;
+    decoder->frame_length -= next_start;
+    memmove(decoder->frame, decoder->frame + next_start, decoder->frame_length);
+}
+
+void packet_decoder_init(struct Packet_Decoder* decoder)
+{
+    memset(decoder, 0, sizeof(*decoder));
+}
+
+/*
+    Feeds a single received byte into the decoder.
+
+    A frame that checks out is taken as it is, start chars in its data and all, so a clean stream never produces a
+    packet that wasn't sent.  Only a frame that fails its checksum is searched for a start char to try again from.
+    The one thing no decoder can get right is a run of identical packets where a shifted copy also checks out (a data
+    byte equal to the start char, and a checksum that happens to line up) - the shifted and true framings look the
+    same byte for byte, so once the decoder has slipped onto the shifted one it stays there until the packets change.
+
+    @param decoder - The decoder to work on
+    @param byte - The byte that was just received
+    @param packet - Filled in with the decoded packet when PACKET_DECODE_OK is returned, untouched otherwise
+    @return Packet_Decode_Status - PACKET_DECODE_OK if this byte completed a valid packet, PACKET_DECODE_NEED_MORE otherwise
+*/
+enum Packet_Decode_Status packet_decoder_feed(struct Packet_Decoder* decoder, uint8_t byte, struct Decoded_Packet* packet)
+{
+    // Training chars and line noise between packets are simply skipped until we see a start char.
+    if(decoder->frame_length == 0 && byte != PACKET_START_CHAR) {
+        decoder->stats.bytes_skipped++;
+        return PACKET_DECODE_NEED_MORE;
+    }
+
+    decoder->frame[decoder->frame_length++] = byte;
+    if(decoder->frame_length < PACKET_FRAME_LENGTH) {
+        return PACKET_DECODE_NEED_MORE;
+    }
+
+    const uint8_t* data = &decoder->frame[1];
+    if(packet_checksum(data, PACKET_NUM_DATA_CHARS) != decoder->frame[PACKET_FRAME_LENGTH - 1]) {
+        decoder->stats.checksum_failures++;
+        resynchronize(decoder);
+        return PACKET_DECODE_NEED_MORE;
+    }
+
+    packet_unpack(data, packet);
+    decoder->frame_length = 0;
+    decoder->stats.packets_ok++;
+    return PACKET_DECODE_OK;
+}
+
+/*
+    Feeds a whole buffer of received bytes into the decoder, stopping early if the output array fills up.  Any
+    partial packet at the end of the buffer is kept by the decoder and finished off by the next call.  Decodes
+    exactly the same packets as feeding the bytes one at a time through packet_decoder_feed().
+
+    @param decoder - The decoder to work on
+    @param bytes - The received bytes
+    @param num_bytes - The number of received bytes
+    @param packets - Array to store decoded packets in
+    @param max_packets - Capacity of the packets array
+    @param bytes_consumed - If not NULL, set to the number of bytes processed.  Less than num_bytes only when the packets array filled up.
+    @return size_t - The number of packets written to the packets array
+*/
+size_t packet_decoder_feed_buffer(struct Packet_Decoder* decoder, const uint8_t* bytes, size_t num_bytes, struct Decoded_Packet* packets, size_t max_packets, size_t* bytes_consumed)
+{
+    size_t num_packets = 0;
+    size_t i = 0;
+
+    while(i < num_bytes && num_packets < max_packets) {
+        // Fast path - skip straight to the next start char rather than going through the state machine byte-by-byte.
+        if(decoder->frame_length == 0) {
+            const uint8_t* start = memchr(bytes + i, PACKET_START_CHAR, num_bytes - i);
+            size_t skipped = (start == NULL ? num_bytes : (size_t) (start - bytes)) - i;
+            decoder->stats.bytes_skipped += skipped;
+            i += skipped;
+            if(start == NULL) {
+                break;
+            }
+        }
+
+        if(packet_decoder_feed(decoder, bytes[i++], &packets[num_packets]) == PACKET_DECODE_OK) {
+            num_packets++;
+        }
+    }
+
+    if(bytes_consumed != NULL) {
+        *bytes_consumed = i;
+    }
+    return num_packets;
+}
+
+/*
+    Unpacks the data bytes of a packet (everything between the start char and checksum char) into individual
+    button states and full 10-bit analog stick values.
+
+    @param data - The PACKET_NUM_DATA_CHARS data bytes of the packet
+    @param packet - Where to store the unpacked values
+*/
+void packet_unpack(const uint8_t* data, struct Decoded_Packet* packet)
+{
+    uint8_t button_byte = data[PACKET_BUTTON_BYTE_INDEX];
+    uint8_t misc_byte = data[PACKET_MISC_BYTE_INDEX];
+
+    packet->button_byte = button_byte;
+    packet->misc_byte = misc_byte;
+
+    packet->purple1_btn_pressed = BIT_IS_SET(button_byte, PURPLE1_BTN_BYTE_POS);
+    packet->purple2_btn_pressed = BIT_IS_SET(button_byte, PURPLE2_BTN_BYTE_POS);
+    packet->purple3_btn_pressed = BIT_IS_SET(button_byte, PURPLE3_BTN_BYTE_POS);
+    packet->brown1_btn_pressed = BIT_IS_SET(button_byte, BROWN1_BTN_BYTE_POS);
+    packet->brown2_btn_pressed = BIT_IS_SET(button_byte, BROWN2_BTN_BYTE_POS);
+    packet->brown3_btn_pressed = BIT_IS_SET(button_byte, BROWN3_BTN_BYTE_POS);
+    packet->blue1_btn_pressed = BIT_IS_SET(button_byte, BLUE1_BTN_BYTE_POS);
+    packet->blue2_btn_pressed = BIT_IS_SET(button_byte, BLUE2_BTN_BYTE_POS);
+
+    packet->left_shoulder_btn_pressed = BIT_IS_SET(misc_byte, LEFT_SHOULDER_BTN_BYTE_POS);
+    packet->right_shoulder_btn_pressed = BIT_IS_SET(misc_byte, RIGHT_SHOULDER_BTN_BYTE_POS);
+    packet->analog_stick_btn_pressed = BIT_IS_SET(misc_byte, ANALOG_STICK_BTN_BYTE_POS);
+
+    packet->analog_stick_x = data[PACKET_LSB_ANALOG_STICK_X_BYTE_INDEX]
+                             | (BIT_IS_SET(misc_byte, ANALOG_STICK_X_BIT_8_POS) << 8)
+                             | (BIT_IS_SET(misc_byte, ANALOG_STICK_X_BIT_9_POS) << 9);
+    packet->analog_stick_y = data[PACKET_LSB_ANALOG_STICK_Y_BYTE_INDEX]
+                             | (BIT_IS_SET(misc_byte, ANALOG_STICK_Y_BIT_8_POS) << 8)
+                             | (BIT_IS_SET(misc_byte, ANALOG_STICK_Y_BIT_9_POS) << 9);
+}
+
+/*
+    Calculates the checksum the same way the transmitter does - adding up the data bytes and ignoring any overflow.
+
+    @param data - The data bytes to sum
+    @param num_data_chars - The number of data bytes
+    @return uint8_t - The checksum
+*/
+uint8_t packet_checksum(const uint8_t* data, uint8_t num_data_chars)
+{
+    uint8_t checksum = 0;
+    for(uint8_t i = 0; i < num_data_chars; i++) {
+        checksum += data[i];
+    }
+    return checksum;
+}
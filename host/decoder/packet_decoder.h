@@ -0,0 +1,67 @@
+#ifndef PACKET_DECODER_H_
+#define PACKET_DECODER_H_
+
+#include "../../src/types/packet.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* The fully unpacked contents of a single valid packet. */
+struct Decoded_Packet {
+    /* Raw data bytes, exactly as they were received. */
+    uint8_t button_byte;
+    uint8_t misc_byte;
+
+    bool analog_stick_btn_pressed;
+
+    bool purple1_btn_pressed;
+    bool purple2_btn_pressed;
+    bool purple3_btn_pressed;
+
+    bool brown1_btn_pressed;
+    bool brown2_btn_pressed;
+    bool brown3_btn_pressed;
+
+    bool blue1_btn_pressed;
+    bool blue2_btn_pressed;
+
+    bool left_shoulder_btn_pressed;
+    bool right_shoulder_btn_pressed;
+
+    /* Full 10-bit analog stick values, with the MSBs from the misc_byte put back in their place. */
+    uint16_t analog_stick_x;
+    uint16_t analog_stick_y;
+};
+
+enum Packet_Decode_Status {
+    PACKET_DECODE_NEED_MORE,
+    PACKET_DECODE_OK
+};
+
+/* Running totals kept by the decoder, mostly useful for judging link quality. */
+struct Packet_Decoder_Stats {
+    uint32_t packets_ok;
+    uint32_t checksum_failures;
+    /* Bytes thrown away while hunting for a start char, including training chars.  Bytes of a frame that was
+       already checked (good or bad) are not counted again. */
+    uint32_t bytes_skipped;
+};
+
+/*
+   Streaming decoder state.  Holds at most one frame worth of bytes starting at a start char, so no allocation is
+   ever necessary - declare one per byte stream and call packet_decoder_init() on it.
+*/
+struct Packet_Decoder {
+    uint8_t frame[PACKET_FRAME_LENGTH];
+    uint8_t frame_length;
+    struct Packet_Decoder_Stats stats;
+};
+
+void packet_decoder_init(struct Packet_Decoder* decoder);
+enum Packet_Decode_Status packet_decoder_feed(struct Packet_Decoder* decoder, uint8_t byte, struct Decoded_Packet* packet);
+size_t packet_decoder_feed_buffer(struct Packet_Decoder* decoder, const uint8_t* bytes, size_t num_bytes, struct Decoded_Packet* packets, size_t max_packets, size_t* bytes_consumed);
+void packet_unpack(const uint8_t* data, struct Decoded_Packet* packet);
+uint8_t packet_checksum(const uint8_t* data, uint8_t num_data_chars);
+
+#endif /* PACKET_DECODER_H_ */
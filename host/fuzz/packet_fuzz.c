@@ -0,0 +1,234 @@
+/*
+    Fuzz harness for the packet encoder/decoder round trip.
+
+    Each input is split into an input state (11 buttons, two 10-bit analog stick values, and whatever was left in the
+    button/misc bytes from the previous packet) followed by an arbitrary byte stream.  The input state is packed
+    exactly the way the firmware ISRs pack it, run through construct_and_store_packet(), and decoded again - every
+    button and both stick values must survive the trip, and a clean run of the packet must decode to exactly that many
+    packets.  The arbitrary byte stream is then pushed through the decoder followed by the same run, and whatever state
+    the garbage left the decoder in, it may lose no more than the first packet of it.
+
+    libFuzzer:
+        clang -g -O1 -fsanitize=fuzzer,address,undefined -DPACKET_FUZZ_LIBFUZZER -o packet_fuzz \
+            packet_fuzz.c ../decoder/packet_decoder.c ../../src/types/packet.c ../../src/types/ring_buffer.c ../../src/util/general_util.c
+        ./packet_fuzz
+
+    AFL (or replaying a single crash), reading the input from stdin:
+        afl-clang-fast -g -o packet_fuzz packet_fuzz.c ../decoder/packet_decoder.c ../../src/types/packet.c ../../src/types/ring_buffer.c ../../src/util/general_util.c
+        afl-fuzz -i seeds -o findings ./packet_fuzz
+*/
+#include "../decoder/packet_decoder.h"
+#include "../../src/types/general_types.h"
+#include "../../src/types/packet.h"
+#include "../../src/types/ring_buffer.h"
+#include "../../src/util/general_util.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Number of leading input bytes used to build the input state - the rest is treated as a raw byte stream. */
+#define INPUT_STATE_BYTES 8
+
+/* Copies of the packet sent back to back, both clean and after the garbage. */
+#define CLEAN_RUN_PACKETS 3
+
+#define FUZZ_ASSERT(condition) \
+    do { \
+        if(!(condition)) { \
+            fprintf(stderr, "%s:%d: assertion failed: %s\n", __FILE__, __LINE__, #condition); \
+            abort(); \
+        } \
+    } while(0)
+
+struct Fuzz_Input_State {
+    struct Digital_Input_Status buttons;
+    uint16_t analog_stick_x;
+    uint16_t analog_stick_y;
+};
+
+static void read_input_state(const uint8_t* bytes, struct Fuzz_Input_State* state, uint8_t* button_byte, uint8_t* misc_byte)
+{
+    uint16_t button_bits = bytes[0] | (bytes[1] << 8);
+
+    state->buttons.blue1_btn_pressed = BIT_IS_SET(button_bits, 0);
+    state->buttons.blue2_btn_pressed = BIT_IS_SET(button_bits, 1);
+    state->buttons.purple1_btn_pressed = BIT_IS_SET(button_bits, 2);
+    state->buttons.purple2_btn_pressed = BIT_IS_SET(button_bits, 3);
+    state->buttons.purple3_btn_pressed = BIT_IS_SET(button_bits, 4);
+    state->buttons.brown1_btn_pressed = BIT_IS_SET(button_bits, 5);
+    state->buttons.brown2_btn_pressed = BIT_IS_SET(button_bits, 6);
+    state->buttons.brown3_btn_pressed = BIT_IS_SET(button_bits, 7);
+    state->buttons.left_shoulder_btn_pressed = BIT_IS_SET(button_bits, 8);
+    state->buttons.right_shoulder_btn_pressed = BIT_IS_SET(button_bits, 9);
+    state->buttons.analog_stick_btn_pressed = BIT_IS_SET(button_bits, 10);
+
+    // The ADC only ever produces 10 bits.
+    state->analog_stick_x = (bytes[2] | (bytes[3] << 8)) & 0x3FF;
+    state->analog_stick_y = (bytes[4] | (bytes[5] << 8)) & 0x3FF;
+
+    // Whatever the previous packet left behind - every bit we care about must be overwritten.
+    *button_byte = bytes[6];
+    *misc_byte = bytes[7];
+}
+
+/*
+    Packs the input state into data bytes the same way sample_inputs() and ISR(ADC_vect) do in src/transmitter.c.
+*/
+static void pack_input_state(const struct Fuzz_Input_State* state, uint8_t button_byte, uint8_t misc_byte, char* data)
+{
+    set_or_clear(state->buttons.analog_stick_btn_pressed, &misc_byte, ANALOG_STICK_BTN_BYTE_POS);
+    set_or_clear(state->buttons.left_shoulder_btn_pressed, &misc_byte, LEFT_SHOULDER_BTN_BYTE_POS);
+    set_or_clear(state->buttons.right_shoulder_btn_pressed, &misc_byte, RIGHT_SHOULDER_BTN_BYTE_POS);
+
+    set_or_clear(state->buttons.purple1_btn_pressed, &button_byte, PURPLE1_BTN_BYTE_POS);
+    set_or_clear(state->buttons.purple2_btn_pressed, &button_byte, PURPLE2_BTN_BYTE_POS);
+    set_or_clear(state->buttons.purple3_btn_pressed, &button_byte, PURPLE3_BTN_BYTE_POS);
+    set_or_clear(state->buttons.brown1_btn_pressed, &button_byte, BROWN1_BTN_BYTE_POS);
+    set_or_clear(state->buttons.brown2_btn_pressed, &button_byte, BROWN2_BTN_BYTE_POS);
+    set_or_clear(state->buttons.brown3_btn_pressed, &button_byte, BROWN3_BTN_BYTE_POS);
+    set_or_clear(state->buttons.blue1_btn_pressed, &button_byte, BLUE1_BTN_BYTE_POS);
+    set_or_clear(state->buttons.blue2_btn_pressed, &button_byte, BLUE2_BTN_BYTE_POS);
+
+    check_set_or_clear(state->analog_stick_y, 8, &misc_byte, ANALOG_STICK_Y_BIT_8_POS);
+    check_set_or_clear(state->analog_stick_y, 9, &misc_byte, ANALOG_STICK_Y_BIT_9_POS);
+    check_set_or_clear(state->analog_stick_x, 8, &misc_byte, ANALOG_STICK_X_BIT_8_POS);
+    check_set_or_clear(state->analog_stick_x, 9, &misc_byte, ANALOG_STICK_X_BIT_9_POS);
+
+    data[PACKET_BUTTON_BYTE_INDEX] = button_byte;
+    data[PACKET_MISC_BYTE_INDEX] = misc_byte;
+    data[PACKET_LSB_ANALOG_STICK_X_BYTE_INDEX] = state->analog_stick_x & 0xFF;
+    data[PACKET_LSB_ANALOG_STICK_Y_BYTE_INDEX] = state->analog_stick_y & 0xFF;
+}
+
+/*
+    Encodes a packet with the firmware's construct_and_store_packet() and copies the bytes out of the ring buffer.
+
+    @return size_t - The number of bytes in the encoded packet
+*/
+static size_t encode_packet(const char* data, uint8_t* encoded)
+{
+    static struct Ring_Buffer buffer;
+    const char training_chars[] = { PACKET_TRAINING_CHAR };
+
+    memset(&buffer, 0, sizeof(buffer));
+    FUZZ_ASSERT(construct_and_store_packet(&buffer, training_chars, PACKET_START_CHAR, sizeof(training_chars), data, PACKET_NUM_DATA_CHARS, false) == BUFFER_OK);
+
+    size_t length = 0;
+    uint8_t byte;
+    while(ring_buffer_read(&buffer, &byte) == BUFFER_OK) {
+        encoded[length++] = byte;
+    }
+
+    FUZZ_ASSERT(length == PACKET_FRAME_LENGTH + sizeof(training_chars));
+    return length;
+}
+
+static void assert_matches_input(const struct Decoded_Packet* packet, const struct Fuzz_Input_State* state)
+{
+    FUZZ_ASSERT(packet->blue1_btn_pressed == state->buttons.blue1_btn_pressed);
+    FUZZ_ASSERT(packet->blue2_btn_pressed == state->buttons.blue2_btn_pressed);
+    FUZZ_ASSERT(packet->purple1_btn_pressed == state->buttons.purple1_btn_pressed);
+    FUZZ_ASSERT(packet->purple2_btn_pressed == state->buttons.purple2_btn_pressed);
+    FUZZ_ASSERT(packet->purple3_btn_pressed == state->buttons.purple3_btn_pressed);
+    FUZZ_ASSERT(packet->brown1_btn_pressed == state->buttons.brown1_btn_pressed);
+    FUZZ_ASSERT(packet->brown2_btn_pressed == state->buttons.brown2_btn_pressed);
+    FUZZ_ASSERT(packet->brown3_btn_pressed == state->buttons.brown3_btn_pressed);
+    FUZZ_ASSERT(packet->left_shoulder_btn_pressed == state->buttons.left_shoulder_btn_pressed);
+    FUZZ_ASSERT(packet->right_shoulder_btn_pressed == state->buttons.right_shoulder_btn_pressed);
+    FUZZ_ASSERT(packet->analog_stick_btn_pressed == state->buttons.analog_stick_btn_pressed);
+    FUZZ_ASSERT(packet->analog_stick_x == state->analog_stick_x);
+    FUZZ_ASSERT(packet->analog_stick_y == state->analog_stick_y);
+}
+
+/*
+    Checks whether a run of copies of a packet can also be framed at some other start char - one in its data or
+    checksum, with the bytes after it wrapping round into the next copy, making a frame whose checksum checks out.
+
+    @return bool - true if so
+*/
+static bool has_shifted_frame(const uint8_t* encoded, size_t encoded_length)
+{
+    size_t true_start = encoded_length - PACKET_FRAME_LENGTH;
+    for(size_t start = 0; start < encoded_length; start++) {
+        if(start == true_start || encoded[start] != PACKET_START_CHAR) {
+            continue;
+        }
+        uint8_t frame[PACKET_FRAME_LENGTH];
+        for(size_t i = 0; i < PACKET_FRAME_LENGTH; i++) {
+            frame[i] = encoded[(start + i) % encoded_length];
+        }
+        if(packet_checksum(&frame[1], PACKET_NUM_DATA_CHARS) == frame[PACKET_FRAME_LENGTH - 1]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t* input, size_t size)
+{
+    uint8_t state_bytes[INPUT_STATE_BYTES] = { 0 };
+    memcpy(state_bytes, input, size < INPUT_STATE_BYTES ? size : INPUT_STATE_BYTES);
+    const uint8_t* stream = (size > INPUT_STATE_BYTES ? input + INPUT_STATE_BYTES : NULL);
+    size_t stream_length = (size > INPUT_STATE_BYTES ? size - INPUT_STATE_BYTES : 0);
+
+    struct Fuzz_Input_State state;
+    uint8_t button_byte, misc_byte;
+    read_input_state(state_bytes, &state, &button_byte, &misc_byte);
+
+    char data[PACKET_NUM_DATA_CHARS];
+    pack_input_state(&state, button_byte, misc_byte, data);
+
+    uint8_t encoded[PACKET_FRAME_LENGTH + 1];
+    size_t encoded_length = encode_packet(data, encoded);
+
+    // A clean run of packets must decode losslessly, each only on its final byte - never a packet that wasn't sent.
+    struct Packet_Decoder decoder;
+    struct Decoded_Packet packet;
+    packet_decoder_init(&decoder);
+    for(uint8_t repeat = 0; repeat < CLEAN_RUN_PACKETS; repeat++) {
+        for(size_t i = 0; i < encoded_length; i++) {
+            enum Packet_Decode_Status status = packet_decoder_feed(&decoder, encoded[i], &packet);
+            FUZZ_ASSERT(status == (i == encoded_length - 1 ? PACKET_DECODE_OK : PACKET_DECODE_NEED_MORE));
+        }
+        assert_matches_input(&packet, &state);
+    }
+    FUZZ_ASSERT(decoder.stats.packets_ok == CLEAN_RUN_PACKETS && decoder.stats.checksum_failures == 0);
+
+    // Garbage followed by real packets.  The garbage may cost us bogus packets and the first real one, but from the
+    // second on every packet must come out intact, each on its own final byte and with nothing in between - unless
+    // a shifted copy of the packet checks out too, when no decoder could tell which framing is the real one.
+    struct Decoded_Packet packets[PACKET_FRAME_LENGTH];
+    size_t max_packets = sizeof(packets) / sizeof(packets[0]);
+    size_t consumed;
+
+    packet_decoder_init(&decoder);
+    for(size_t offset = 0; offset < stream_length; offset += consumed) {
+        packet_decoder_feed_buffer(&decoder, stream + offset, stream_length - offset, packets, max_packets, &consumed);
+    }
+
+    bool ambiguous = has_shifted_frame(encoded, encoded_length);
+    for(uint8_t repeat = 0; repeat < CLEAN_RUN_PACKETS; repeat++) {
+        for(size_t i = 0; i < encoded_length; i++) {
+            enum Packet_Decode_Status status = packet_decoder_feed(&decoder, encoded[i], &packet);
+            if(repeat > 0 && !ambiguous) {
+                FUZZ_ASSERT(status == (i == encoded_length - 1 ? PACKET_DECODE_OK : PACKET_DECODE_NEED_MORE));
+            }
+        }
+        if(repeat > 0 && !ambiguous) {
+            assert_matches_input(&packet, &state);
+        }
+    }
+
+    return 0;
+}
+
+#ifndef PACKET_FUZZ_LIBFUZZER
+int main(void)
+{
+    static uint8_t input[1 << 16];
+    size_t size = fread(input, 1, sizeof(input), stdin);
+    return LLVMFuzzerTestOneInput(input, size);
+}
+#endif
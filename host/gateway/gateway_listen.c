@@ -0,0 +1,190 @@
+/*
+    A consumer for gatewayd - connects to its socket, and prints each record it gets, or with -q only counts them.
+
+    cc -O2 -o gateway_listen gateway_listen.c latency_histogram.c
+    ./gateway_listen [-s socket_path] [-q]
+
+    Runs until gatewayd goes away, or SIGINT, then sums up the records from each transmitter, how many it missed going
+    by the gaps in their sequence, and the latency from gatewayd reading each packet to it getting here.
+*/
+#define _GNU_SOURCE
+#include "gateway_record.h"
+#include "latency_histogram.h"
+#include "../../src/types/packet.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_TRANSMITTERS 256
+
+/* Records taken from the socket at a time. */
+#define RECEIVE_BATCH 256
+
+struct Transmitter {
+    bool heard;
+    uint32_t next_sequence;
+    uint64_t records;
+    uint64_t missed;
+};
+
+static struct Transmitter transmitters[MAX_TRANSMITTERS];
+static struct Latency_Histogram latency;
+static volatile sig_atomic_t stopping = 0;
+
+static void stop(int signal)
+{
+    (void) signal;
+    stopping = 1;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+static void print_record(const struct Gateway_Record* record)
+{
+    static const char* const BUTTON_NAMES[8] = {
+        [BLUE1_BTN_BYTE_POS] = "blue1", [BLUE2_BTN_BYTE_POS] = "blue2", [PURPLE1_BTN_BYTE_POS] = "purple1",
+        [PURPLE2_BTN_BYTE_POS] = "purple2", [PURPLE3_BTN_BYTE_POS] = "purple3", [BROWN1_BTN_BYTE_POS] = "brown1",
+        [BROWN2_BTN_BYTE_POS] = "brown2", [BROWN3_BTN_BYTE_POS] = "brown3"
+    };
+    static const char* const MISC_NAMES[3] = {
+        [LEFT_SHOULDER_BTN_BYTE_POS] = "left", [RIGHT_SHOULDER_BTN_BYTE_POS] = "right",
+        [ANALOG_STICK_BTN_BYTE_POS] = "stick"
+    };
+
+    printf("%-3u %-8" PRIu32 " x %4u  y %4u ", record->transmitter, record->sequence, record->analog_stick_x,
+           record->analog_stick_y);
+    for(uint8_t bit = 0; bit < 8; bit++) {
+        if(record->button_byte & (1 << bit)) {
+            printf(" %s", BUTTON_NAMES[bit]);
+        }
+    }
+    for(uint8_t bit = 0; bit < 3; bit++) {
+        if(record->misc_byte & (1 << bit)) {
+            printf(" %s", MISC_NAMES[bit]);
+        }
+    }
+    printf("\n");
+}
+
+static void usage(const char* program)
+{
+    fprintf(stderr, "usage: %s [-s socket_path] [-q]\n", program);
+}
+
+int main(int argc, char** argv)
+{
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    const char* socket_path = GATEWAY_SOCKET_PATH;
+    bool quiet = false;
+    int option;
+
+    while((option = getopt(argc, argv, "s:q")) != -1) {
+        switch(option) {
+            case 's':
+                socket_path = optarg;
+                break;
+            case 'q':
+                quiet = true;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if(optind != argc || strlen(socket_path) >= sizeof(address.sun_path)) {
+        usage(argv[0]);
+        return 1;
+    }
+    strcpy(address.sun_path, socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if(fd < 0 || connect(fd, (struct sockaddr*) &address, sizeof(address)) < 0) {
+        perror(socket_path);
+        return 1;
+    }
+
+    // No SA_RESTART, so that a SIGINT gets the recvmmsg() below out.
+    struct sigaction action = { .sa_handler = stop };
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    latency_histogram_init(&latency);
+    uint64_t started_ns = now_ns();
+    uint64_t records = 0;
+
+    static struct Gateway_Record batch[RECEIVE_BATCH];
+    static struct mmsghdr messages[RECEIVE_BATCH];
+    static struct iovec vectors[RECEIVE_BATCH];
+    for(unsigned i = 0; i < RECEIVE_BATCH; i++) {
+        vectors[i] = (struct iovec) { .iov_base = &batch[i], .iov_len = sizeof(batch[i]) };
+        messages[i] = (struct mmsghdr) { .msg_hdr = { .msg_iov = &vectors[i], .msg_iovlen = 1 } };
+    }
+
+    // Blocks for the first record, then takes whatever else is already waiting along with it.
+    bool ended = false;
+    while(!stopping && !ended) {
+        int count = recvmmsg(fd, messages, RECEIVE_BATCH, MSG_WAITFORONE, NULL);
+        if(count < 0 && errno == EINTR) {
+            continue;
+        }
+        ended = (count <= 0);
+        uint64_t received_ns = now_ns();
+
+        for(int i = 0; i < count && !ended; i++) {
+            const struct Gateway_Record* record = &batch[i];
+            if(messages[i].msg_len == 0) {
+                ended = true;
+                break;
+            }
+            if(messages[i].msg_len != sizeof(*record)) {
+                fprintf(stderr, "a record of %u bytes - gatewayd built from another gateway_record.h?\n",
+                        messages[i].msg_len);
+                ended = true;
+                break;
+            }
+
+            latency_histogram_add(&latency, received_ns - record->decoded_ns, 1);
+            records++;
+
+            struct Transmitter* transmitter = &transmitters[record->transmitter];
+            if(transmitter->heard) {
+                transmitter->missed += record->sequence - transmitter->next_sequence;
+            }
+            transmitter->heard = true;
+            transmitter->next_sequence = record->sequence + 1;
+            transmitter->records++;
+
+            if(!quiet) {
+                print_record(record);
+            }
+        }
+    }
+
+    double seconds = (now_ns() - started_ns) / 1e9;
+    printf("listened for:       %.3f s\n", seconds);
+    for(unsigned t = 0; t < MAX_TRANSMITTERS; t++) {
+        if(transmitters[t].heard) {
+            printf("transmitter %-3u     %" PRIu64 " records, %" PRIu64 " missed\n", t, transmitters[t].records,
+                   transmitters[t].missed);
+        }
+    }
+    printf("received:           %" PRIu64 " records, %.0f/s\n", records, records / seconds);
+    printf("decode to receive:  ");
+    latency_histogram_print(&latency);
+
+    close(fd);
+    return 0;
+}
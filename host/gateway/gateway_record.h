@@ -0,0 +1,36 @@
+#ifndef GATEWAY_RECORD_H_
+#define GATEWAY_RECORD_H_
+
+#include <stdint.h>
+
+/*
+   What gatewayd publishes.  Every application connected to its Unix domain socket - a SOCK_SEQPACKET one, so each
+   read hands back exactly one record - gets a struct Gateway_Record for every packet any transmitter gets through,
+   in the order the gateway decoded them.  Consumers run on the same machine, so records are in its byte order.
+
+   The button and misc bytes are passed on exactly as they came, to be picked apart with the *_BTN_BYTE_POS bits in
+   src/types/packet.h, or packet_unpack() in host/decoder/packet_decoder.h.  The stick values already have their
+   MSBs back from the misc byte.
+
+   decoded_ns is CLOCK_MONOTONIC when the gateway read the packet's last byte, so a consumer on the same machine can
+   tell how long a record took to get to it.  sequence counts a transmitter's records from 0 - the gateway drops a
+   record for a consumer whose socket is full rather than wait for it, and a gap in sequence is how it finds out.
+*/
+
+/* Where gatewayd listens, unless it's told otherwise with -s. */
+#define GATEWAY_SOCKET_PATH "/tmp/gatewayd.sock"
+
+struct Gateway_Record {
+    uint64_t decoded_ns;            // CLOCK_MONOTONIC the packet was read at
+    uint32_t sequence;              // this transmitter's records so far
+    uint16_t analog_stick_x;        // full 10 bits
+    uint16_t analog_stick_y;
+    uint8_t transmitter;            // which of gatewayd's sources, in the order they were given
+    uint8_t button_byte;
+    uint8_t misc_byte;
+    uint8_t reserved[5];
+};
+
+_Static_assert(sizeof(struct Gateway_Record) == 24, "records go between programs - keep the layout fixed");
+
+#endif /* GATEWAY_RECORD_H_ */
@@ -0,0 +1,512 @@
+/*
+    Gateway daemon - bridges the packets from any number of transmitters to applications on the same machine.
+
+    Each source is one transmitter's byte stream: a serial device, like the 433MHz receiver on /dev/ttyUSB0 (set to
+    raw at BAUD_RATE), a pipe, or a capture file - `cat /dev/ttyUSB0 > capture.bin`, or host/sim/replay -o.  Captures
+    are played at the USART's byte rate times -x, or as fast as they'll go with -x 0, -l times over (0 for good), so a
+    handful of replayed transmitters make a sustained load.  Every source is decoded with host/decoder's streaming
+    decoder, and each packet is published to every application connected to a Unix domain socket as a struct
+    Gateway_Record (gateway_record.h) - gateway_listen.c is one.
+
+    cc -O2 -I../sim/include -o gatewayd gatewayd.c latency_histogram.c ../decoder/packet_decoder.c
+    ./gatewayd [-s socket_path] [-x speed] [-l passes] source...
+
+    Everything runs on one thread, from one epoll loop: the listening socket, the consumers, the sources that can be
+    polled, a timerfd pacing the captures and a signalfd for SIGINT and SIGTERM.  The packets out of each read() go to
+    each consumer in a single sendmmsg(), without blocking - a consumer that can't keep up has records dropped, and
+    counted, rather than holding up the rest.  The latency from the read() to the last consumer's send is measured for
+    every record, and summed up with the rest of the counts once every source has ended, or on a signal.
+*/
+#define _GNU_SOURCE
+#include "gateway_record.h"
+#include "latency_histogram.h"
+#include "../decoder/packet_decoder.h"
+#include "../../src/util/avr_usart.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_SOURCES 16
+#define MAX_CLIENTS 32
+#define MAX_EVENTS 64
+
+/* Bytes taken from a source at a time, and the most packets that many can hold. */
+#define READ_CHUNK 4096
+#define PUBLISH_BATCH (READ_CHUNK / PACKET_FRAME_LENGTH + 1)
+
+/* How often paced captures are topped up, and the most chunks each gets a go, so that one that's fallen behind
+   doesn't starve everything else. */
+#define PACE_PERIOD_NS 1000000
+#define PACE_MAX_CHUNKS 16
+
+#define USART_BYTES_PER_SECOND (BAUD_RATE / 10.0)
+
+_Static_assert(MAX_SOURCES <= 256, "the transmitter's a byte in a record");
+_Static_assert(MAX_CLIENTS <= 1 << 16, "a client's index is the bottom 16 bits of its epoll data");
+
+/* What an epoll event is for - the top half of its data, with the source or client index in the bottom 16 bits and,
+   for a client, the slot's generation above that. */
+enum Event_Kind {
+    EVENT_LISTENER,
+    EVENT_SIGNAL,
+    EVENT_PACER,
+    EVENT_SOURCE,
+    EVENT_CLIENT
+};
+
+struct Source {
+    const char* path;
+    int fd;
+    bool capture;                   // a regular file, read when its turn comes rather than when epoll says so
+    bool ended;
+    unsigned passes_left;           // 0 for good
+    uint64_t started_ns;
+    uint64_t bytes;
+    uint32_t sequence;
+    struct Packet_Decoder decoder;
+};
+
+static struct Source sources[MAX_SOURCES];
+static unsigned num_sources = 0;
+static int clients[MAX_CLIENTS];   // -1 while the slot's free
+
+/* Bumped each time a client's slot is freed, so that an event epoll_wait() returned for the client that had it before
+   - one that publish() closed partway through a batch, say - can't be taken for one that's been given it since. */
+static uint16_t client_generations[MAX_CLIENTS];
+
+static int epoll_fd;
+static double speed = 1;
+
+static uint64_t published = 0;
+static uint64_t dropped = 0;
+static uint64_t clients_served = 0;
+static struct Latency_Histogram latency;
+
+static uint64_t now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+static int watch(int fd, uint32_t events, enum Event_Kind kind, unsigned index)
+{
+    struct epoll_event event = { .events = events, .data.u64 = (uint64_t) kind << 32 | index };
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+}
+
+static int listen_on(const char* path)
+{
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if(strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "%s: path too long for a socket\n", path);
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    unlink(path);
+    if(fd < 0 || bind(fd, (struct sockaddr*) &address, sizeof(address)) < 0 || listen(fd, MAX_CLIENTS) < 0) {
+        perror(path);
+        return -1;
+    }
+    return fd;
+}
+
+/*
+    Opens a source, setting a serial device to raw at BAUD_RATE on the way.
+
+    @return bool - false if it couldn't be
+*/
+static bool open_source(struct Source* source, const char* path, unsigned passes)
+{
+    memset(source, 0, sizeof(*source));
+    source->path = path;
+    source->passes_left = passes;
+    packet_decoder_init(&source->decoder);
+
+    source->fd = open(path, O_RDONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    struct stat status;
+    if(source->fd < 0 || fstat(source->fd, &status) < 0) {
+        perror(path);
+        return false;
+    }
+    source->capture = S_ISREG(status.st_mode);
+
+    if(isatty(source->fd)) {
+        struct termios settings;
+        if(tcgetattr(source->fd, &settings) < 0) {
+            perror(path);
+            return false;
+        }
+        cfmakeraw(&settings);
+        settings.c_cflag |= CLOCAL | CREAD;
+        settings.c_cc[VMIN] = 1;
+        settings.c_cc[VTIME] = 0;
+        if(cfsetispeed(&settings, B2400) < 0 || tcsetattr(source->fd, TCSANOW, &settings) < 0) {
+            perror(path);
+            return false;
+        }
+        _Static_assert(BAUD_RATE == 2400, "B2400 is set above - change it along with BAUD_RATE");
+    }
+    return true;
+}
+
+static void close_client(unsigned index)
+{
+    close(clients[index]);
+    clients[index] = -1;
+    client_generations[index]++;
+}
+
+static void accept_clients(int listener)
+{
+    int fd;
+    while((fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        unsigned index = 0;
+        while(index < MAX_CLIENTS && clients[index] >= 0) {
+            index++;
+        }
+        if(index == MAX_CLIENTS ||
+           watch(fd, EPOLLIN | EPOLLRDHUP, EVENT_CLIENT, (uint32_t) client_generations[index] << 16 | index) < 0) {
+            fprintf(stderr, "turning a consumer away - already serving %d\n", MAX_CLIENTS);
+            close(fd);
+            continue;
+        }
+        clients[index] = fd;
+        clients_served++;
+    }
+}
+
+/*
+    Sends a batch of records to every consumer, dropping whatever won't fit in a consumer's socket.
+
+    @param records - The records
+    @param count - How many
+    @param read_ns - When the bytes they were decoded from were read
+*/
+static void publish(const struct Gateway_Record* records, unsigned count, uint64_t read_ns)
+{
+    static struct mmsghdr messages[PUBLISH_BATCH];
+    static struct iovec vectors[PUBLISH_BATCH];
+    for(unsigned i = 0; i < count; i++) {
+        vectors[i] = (struct iovec) { .iov_base = (void*) &records[i], .iov_len = sizeof(records[i]) };
+        messages[i] = (struct mmsghdr) { .msg_hdr = { .msg_iov = &vectors[i], .msg_iovlen = 1 } };
+    }
+
+    for(unsigned c = 0; c < MAX_CLIENTS; c++) {
+        if(clients[c] < 0) {
+            continue;
+        }
+        int sent = sendmmsg(clients[c], messages, count, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if(sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            close_client(c);
+            continue;
+        }
+        dropped += count - (unsigned) (sent < 0 ? 0 : sent);
+    }
+
+    published += count;
+    latency_histogram_add(&latency, now_ns() - read_ns, count);
+}
+
+/*
+    Decodes bytes just read from a source, and publishes the packets in them.
+*/
+static void take_bytes(struct Source* source, const uint8_t* bytes, size_t length, uint64_t read_ns)
+{
+    static struct Decoded_Packet packets[PUBLISH_BATCH];
+    static struct Gateway_Record records[PUBLISH_BATCH];
+
+    source->bytes += length;
+    for(size_t offset = 0; offset < length;) {
+        size_t consumed;
+        size_t decoded = packet_decoder_feed_buffer(&source->decoder, bytes + offset, length - offset, packets,
+                                                    PUBLISH_BATCH, &consumed);
+        offset += consumed;
+        if(decoded == 0) {
+            continue;
+        }
+
+        for(size_t i = 0; i < decoded; i++) {
+            records[i] = (struct Gateway_Record) {
+                .decoded_ns = read_ns,
+                .sequence = source->sequence++,
+                .analog_stick_x = packets[i].analog_stick_x,
+                .analog_stick_y = packets[i].analog_stick_y,
+                .transmitter = (uint8_t) (source - sources),
+                .button_byte = packets[i].button_byte,
+                .misc_byte = packets[i].misc_byte
+            };
+        }
+        publish(records, (unsigned) decoded, read_ns);
+    }
+}
+
+/*
+    Reads a chunk of a capture, starting it over at its end if it has passes left.
+
+    @param most - The most bytes to read
+    @return size_t - Bytes read - 0 once it's ended
+*/
+static size_t read_capture(struct Source* source, size_t most)
+{
+    uint8_t bytes[READ_CHUNK];
+    most = (most < READ_CHUNK ? most : READ_CHUNK);
+    for(;;) {
+        ssize_t length = read(source->fd, bytes, most);
+        if(length > 0) {
+            take_bytes(source, bytes, (size_t) length, now_ns());
+            return (size_t) length;
+        }
+        if(length == 0 && source->passes_left != 1 && source->bytes > 0 && lseek(source->fd, 0, SEEK_SET) == 0) {
+            source->passes_left -= (source->passes_left != 0);
+            continue;
+        }
+        if(length < 0) {
+            perror(source->path);
+        }
+        source->ended = true;
+        return 0;
+    }
+}
+
+/*
+    Reads whatever a serial device or pipe has for us.
+*/
+static void read_stream(struct Source* source)
+{
+    uint8_t bytes[READ_CHUNK];
+    ssize_t length;
+    while((length = read(source->fd, bytes, sizeof(bytes))) > 0) {
+        take_bytes(source, bytes, (size_t) length, now_ns());
+    }
+    if(length == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+        if(length < 0) {
+            perror(source->path);
+        }
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, source->fd, NULL);
+        source->ended = true;
+    }
+}
+
+/*
+    Tops each capture up to where the USART would have got to by now, at speed.
+*/
+static void pace_captures(void)
+{
+    uint64_t now = now_ns();
+    for(unsigned s = 0; s < num_sources; s++) {
+        struct Source* source = &sources[s];
+        if(!source->capture || source->ended) {
+            continue;
+        }
+        uint64_t due = (uint64_t) ((now - source->started_ns) / 1e9 * USART_BYTES_PER_SECOND * speed);
+        for(unsigned chunk = 0; chunk < PACE_MAX_CHUNKS && source->bytes < due; chunk++) {
+            if(read_capture(source, due - source->bytes) == 0) {
+                break;
+            }
+        }
+    }
+}
+
+/*
+    Gives every capture played flat out a chunk.
+
+    @return bool - true if any of them has more to come
+*/
+static bool flood_captures(void)
+{
+    bool more = false;
+    for(unsigned s = 0; s < num_sources; s++) {
+        if(sources[s].capture && !sources[s].ended && read_capture(&sources[s], READ_CHUNK) > 0) {
+            more = true;
+        }
+    }
+    return more;
+}
+
+static bool all_ended(void)
+{
+    for(unsigned s = 0; s < num_sources; s++) {
+        if(!sources[s].ended) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void print_summary(uint64_t started_ns)
+{
+    double seconds = (now_ns() - started_ns) / 1e9;
+
+    printf("ran for:            %.3f s\n", seconds);
+    for(unsigned s = 0; s < num_sources; s++) {
+        const struct Source* source = &sources[s];
+        printf("transmitter %-3u     %" PRIu32 " packets, %" PRIu32 " checksum failures, %" PRIu32
+               " bytes skipped, %.0f bytes/s (%s)\n", s, source->decoder.stats.packets_ok,
+               source->decoder.stats.checksum_failures, source->decoder.stats.bytes_skipped,
+               source->bytes / seconds, source->path);
+    }
+    printf("published:          %" PRIu64 " records, %.0f/s, to %" PRIu64 " consumers\n", published,
+           published / seconds, clients_served);
+    printf("dropped:            %" PRIu64 " records to consumers that fell behind\n", dropped);
+    printf("decode to publish:  ");
+    latency_histogram_print(&latency);
+}
+
+static void usage(const char* program)
+{
+    fprintf(stderr, "usage: %s [-s socket_path] [-x speed] [-l passes] source...\n", program);
+}
+
+int main(int argc, char** argv)
+{
+    const char* socket_path = GATEWAY_SOCKET_PATH;
+    unsigned passes = 1;
+    int option;
+
+    while((option = getopt(argc, argv, "s:x:l:")) != -1) {
+        switch(option) {
+            case 's':
+                socket_path = optarg;
+                break;
+            case 'x':
+                speed = atof(optarg);
+                break;
+            case 'l':
+                passes = (unsigned) strtoul(optarg, NULL, 10);
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if(optind == argc || argc - optind > MAX_SOURCES || speed < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    for(unsigned c = 0; c < MAX_CLIENTS; c++) {
+        clients[c] = -1;
+    }
+    latency_histogram_init(&latency);
+
+    // SIGINT and SIGTERM come in through the loop like everything else.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signals, NULL);
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    int signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    int pacer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    int listener = listen_on(socket_path);
+    if(epoll_fd < 0 || signal_fd < 0 || pacer_fd < 0 || listener < 0) {
+        perror("gatewayd");
+        return 1;
+    }
+    watch(listener, EPOLLIN, EVENT_LISTENER, 0);
+    watch(signal_fd, EPOLLIN, EVENT_SIGNAL, 0);
+
+    bool paced = false;
+    uint64_t started_ns = now_ns();
+    for(; optind < argc; optind++) {
+        struct Source* source = &sources[num_sources];
+        if(!open_source(source, argv[optind], passes)) {
+            return 1;
+        }
+        source->started_ns = started_ns;
+        if(!source->capture && watch(source->fd, EPOLLIN, EVENT_SOURCE, num_sources) < 0) {
+            perror(source->path);
+            return 1;
+        }
+        paced |= (source->capture && speed > 0);
+        num_sources++;
+    }
+
+    if(paced) {
+        struct itimerspec period = {
+            .it_interval = { .tv_nsec = PACE_PERIOD_NS },
+            .it_value = { .tv_nsec = PACE_PERIOD_NS }
+        };
+        timerfd_settime(pacer_fd, 0, &period, NULL);
+        watch(pacer_fd, EPOLLIN, EVENT_PACER, 0);
+    }
+
+    bool flooding = (speed == 0);
+    bool stopping = false;
+    while(!stopping && !all_ended()) {
+        struct epoll_event events[MAX_EVENTS];
+        int count = epoll_wait(epoll_fd, events, MAX_EVENTS, flooding ? 0 : -1);
+        if(count < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            break;
+        }
+
+        for(int e = 0; e < count; e++) {
+            unsigned index = (uint16_t) events[e].data.u64;
+            switch((enum Event_Kind) (events[e].data.u64 >> 32)) {
+                case EVENT_LISTENER:
+                    accept_clients(listener);
+                    break;
+                case EVENT_SIGNAL:
+                    stopping = true;
+                    break;
+                case EVENT_PACER: {
+                    uint64_t expirations;
+                    if(read(pacer_fd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+                        pace_captures();
+                    }
+                    break;
+                }
+                case EVENT_SOURCE:
+                    read_stream(&sources[index]);
+                    break;
+                case EVENT_CLIENT: {
+                    // Consumers have nothing to say, so this is one going away - anything else it sends is ignored.
+                    char discard[64];
+                    if((uint16_t) (events[e].data.u64 >> 16) != client_generations[index]) {
+                        break;
+                    }
+                    if((events[e].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) ||
+                       recv(clients[index], discard, sizeof(discard), MSG_DONTWAIT) == 0) {
+                        close_client(index);
+                    }
+                    break;
+                }
+            }
+        }
+
+        if(flooding) {
+            flooding = flood_captures();
+        }
+    }
+
+    print_summary(started_ns);
+
+    for(unsigned c = 0; c < MAX_CLIENTS; c++) {
+        if(clients[c] >= 0) {
+            close_client(c);
+        }
+    }
+    close(listener);
+    unlink(socket_path);
+    return 0;
+}
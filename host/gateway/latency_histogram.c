@@ -0,0 +1,63 @@
+#include "latency_histogram.h"
+
+#include <stdio.h>
+#include <string.h>
+
+void latency_histogram_init(struct Latency_Histogram* histogram)
+{
+    memset(histogram, 0, sizeof(*histogram));
+}
+
+/*
+    @param histogram - The histogram
+    @param ns - The latency
+    @param count - How many samples had it - a batch sent together all have the same one
+*/
+void latency_histogram_add(struct Latency_Histogram* histogram, uint64_t ns, uint32_t count)
+{
+    uint64_t us = ns / 1000;
+    if(us < LATENCY_BUCKETS) {
+        histogram->buckets[us] += count;
+    } else {
+        histogram->over += count;
+    }
+    histogram->count += count;
+    histogram->total_ns += ns * count;
+    if(ns > histogram->max_ns) {
+        histogram->max_ns = ns;
+    }
+}
+
+/*
+    @param histogram - The histogram
+    @param fraction - Of the samples, from 0 to 1
+    @return double - The latency, in us, that at least that fraction of the samples were no longer than - the top of
+                     the bucket it's in, or the longest seen if it's past the last one
+*/
+double latency_histogram_percentile(const struct Latency_Histogram* histogram, double fraction)
+{
+    uint64_t wanted = (uint64_t) (fraction * histogram->count + 0.5);
+    uint64_t seen = 0;
+    for(uint32_t us = 0; us < LATENCY_BUCKETS; us++) {
+        seen += histogram->buckets[us];
+        if(seen >= wanted && seen > 0) {
+            return us + 1;
+        }
+    }
+    return histogram->max_ns / 1e3;
+}
+
+/*
+    Prints the mean, p50, p99, p99.9 and longest, in us, on the rest of a line.
+*/
+void latency_histogram_print(const struct Latency_Histogram* histogram)
+{
+    if(histogram->count == 0) {
+        printf("none\n");
+        return;
+    }
+    printf("mean %.1f us, p50 %.0f us, p99 %.0f us, p99.9 %.0f us, max %.1f us\n",
+           histogram->total_ns / 1e3 / histogram->count, latency_histogram_percentile(histogram, 0.5),
+           latency_histogram_percentile(histogram, 0.99), latency_histogram_percentile(histogram, 0.999),
+           histogram->max_ns / 1e3);
+}
@@ -0,0 +1,26 @@
+#ifndef LATENCY_HISTOGRAM_H_
+#define LATENCY_HISTOGRAM_H_
+
+#include <stdint.h>
+
+/*
+   Latencies counted into 1us buckets, for percentiles that don't need every sample kept.  Anything past the last
+   bucket is only counted, and reported as the longest seen.
+*/
+
+#define LATENCY_BUCKETS 10000
+
+struct Latency_Histogram {
+    uint32_t buckets[LATENCY_BUCKETS];
+    uint64_t count;
+    uint64_t over;                  // past the last bucket
+    uint64_t total_ns;
+    uint64_t max_ns;
+};
+
+void latency_histogram_init(struct Latency_Histogram* histogram);
+void latency_histogram_add(struct Latency_Histogram* histogram, uint64_t ns, uint32_t count);
+double latency_histogram_percentile(const struct Latency_Histogram* histogram, double fraction);
+void latency_histogram_print(const struct Latency_Histogram* histogram);
+
+#endif /* LATENCY_HISTOGRAM_H_ */
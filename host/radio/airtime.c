@@ -0,0 +1,92 @@
+/*
+    Prints what each RFM69 radio profile (see src/lib/rfm69/rfm69_profile.h) trades off - the registers the firmware
+    works out for it, how long a packet takes to send, the fastest packet rate radio_power can keep up with, and the
+    sensitivity gained or lost against the profile rfm69_init() starts with, going by the receiver bandwidth.
+
+    cc -O2 -I../sim/include -o airtime airtime.c ../../src/lib/rfm69/rfm69_profile.c -lm
+    ./airtime [-p payload_bytes] [-b bits_per_second -f deviation_hz [-g shaping]]
+
+    -b and -f work out a profile of your own instead of listing the ready made ones, with -g picking the pulse shaping
+    (0 for none, 1 to 3 for Gaussian BT = 1.0, 0.5 and 0.3).  Add -DTIMER2_ASYNC, and -DRFM69_LINK with
+    -DRFM69_AUTOMODES or -DRFM69_ACK, to match the firmware's build when working out packet rates - RFM69_ACK also adds
+    its header to the default payload, and -DRFM69_AES pads it out the way the radio's encryption does.
+*/
+#include "../../src/avr_config.h"
+#include "../../src/lib/rfm69/rfm69_profile.h"
+#include "../../src/util/radio_power.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static void print_header(uint8_t payload_length, const struct Rfm69_Profile* initial)
+{
+    printf("%u byte payload, margin against %lu bps\n", payload_length, (unsigned long) initial->bitrate_bps);
+    printf("%9s %9s %9s %8s %8s %11s %11s %9s\n", "bit rate", "fdev", "rx bw", "restart", "shaping", "airtime",
+           "max rate", "margin");
+}
+
+static void print_profile(const struct Rfm69_Profile* profile, const struct Rfm69_Profile* initial,
+                          uint8_t payload_length)
+{
+    uint32_t airtime_us = rfm69_profile_airtime_us(profile, payload_length);
+    uint32_t packet_us = TIMER2_TICKS_TO_US(RADIO_POWER_PACKET_TICKS(airtime_us) + 1);
+    double margin_db = 10 * log10((double) RFM69_RXBW_HZ(initial->rxbw) / RFM69_RXBW_HZ(profile->rxbw));
+
+    printf("%9lu %9lu %8.1fk %5u bit %8u %8.3f ms %7.1f Hz %+6.1f dB\n", (unsigned long) profile->bitrate_bps,
+           (unsigned long) profile->fdev_hz, RFM69_RXBW_HZ(profile->rxbw) / 1000.0,
+           1u << (profile->rx_restart_delay >> 4), profile->shaping, airtime_us / 1000.0, 1e6 / packet_us, margin_db);
+}
+
+int main(int argc, char** argv)
+{
+    uint8_t payload_length = RFM69_AIR_BYTES(RFM69_FRAME_LENGTH);
+    unsigned long bitrate_bps = 0;
+    unsigned long fdev_hz = 0;
+    uint8_t shaping = 0;
+    int option;
+
+    while((option = getopt(argc, argv, "p:b:f:g:")) != -1) {
+        switch(option) {
+            case 'p':
+                payload_length = (uint8_t) atoi(optarg);
+                break;
+            case 'b':
+                bitrate_bps = strtoul(optarg, NULL, 10);
+                break;
+            case 'f':
+                fdev_hz = strtoul(optarg, NULL, 10);
+                break;
+            case 'g':
+                shaping = (uint8_t) atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-p payload_bytes] [-b bits_per_second -f deviation_hz [-g shaping]]\n",
+                        argv[0]);
+                return 1;
+        }
+    }
+
+    struct Rfm69_Profile initial;
+    rfm69_profile_get(RFM69_INIT_PROFILE, &initial);
+
+    if(bitrate_bps != 0 || fdev_hz != 0) {
+        struct Rfm69_Profile profile;
+        if(!rfm69_profile_compute(bitrate_bps, fdev_hz, shaping, &profile)) {
+            fprintf(stderr, "the RFM69 can't do %lu bps with %lu Hz deviation\n", bitrate_bps, fdev_hz);
+            return 1;
+        }
+        print_header(payload_length, &initial);
+        print_profile(&profile, &initial, payload_length);
+        return 0;
+    }
+
+    print_header(payload_length, &initial);
+    for(uint8_t id = 0; id < RFM69_NUM_PROFILES; id++) {
+        struct Rfm69_Profile profile;
+        rfm69_profile_get(id, &profile);
+        print_profile(&profile, &initial, payload_length);
+    }
+    return 0;
+}
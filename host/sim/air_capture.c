@@ -0,0 +1,81 @@
+#include "air_capture.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* A full FIFO's worth of bytes, at three characters each, and the rest of the line. */
+#define AIR_CAPTURE_MAX_LINE 320
+
+/*
+    Reads the next packet from a capture, skipping comments and blank lines.
+
+    @param file - The capture to read from
+    @param packet - Where to store the packet
+    @param line_number - Running line count, used for error messages.  Start it at 0.
+    @return Air_Capture_Status - AIR_CAPTURE_END at the end of the file, AIR_CAPTURE_ERROR on a malformed line,
+                                 AIR_CAPTURE_OK otherwise
+*/
+enum Air_Capture_Status air_capture_read_packet(FILE* file, struct Air_Capture_Packet* packet, unsigned* line_number)
+{
+    char line[AIR_CAPTURE_MAX_LINE];
+
+    while(fgets(line, sizeof(line), file) != NULL) {
+        (*line_number)++;
+
+        char* comment = strchr(line, '#');
+        if(comment != NULL) {
+            *comment = '\0';
+        }
+        if(strspn(line, " \t\r\n") == strlen(line)) {
+            continue;
+        }
+
+        uint32_t frf;
+        int rssi_dbm;
+        int consumed;
+        if(sscanf(line, "%" SCNu64 " %" SCNu64 " %" SCNx32 " %d%n", &packet->start_cycle, &packet->end_cycle, &frf,
+                  &rssi_dbm, &consumed) != 4 || packet->end_cycle < packet->start_cycle || rssi_dbm < INT16_MIN ||
+           rssi_dbm > INT16_MAX) {
+            return AIR_CAPTURE_ERROR;
+        }
+        packet->frf = frf;
+        packet->rssi_dbm = (int16_t) rssi_dbm;
+
+        packet->length = 0;
+        const char* bytes = line + consumed;
+        for(;;) {
+            char* end;
+            unsigned long byte = strtoul(bytes, &end, 16);
+            if(end == bytes) {
+                break;
+            }
+            if(byte > 0xFF || packet->length == AIR_CAPTURE_MAX_BYTES) {
+                return AIR_CAPTURE_ERROR;
+            }
+            packet->bytes[packet->length++] = (uint8_t) byte;
+            bytes = end;
+        }
+        if(packet->length == 0 || strspn(bytes, " \t\r\n") != strlen(bytes)) {
+            return AIR_CAPTURE_ERROR;
+        }
+        return AIR_CAPTURE_OK;
+    }
+
+    return AIR_CAPTURE_END;
+}
+
+void air_capture_write_header(FILE* file)
+{
+    fprintf(file, "# start_cycle  end_cycle  frf       rssi_dbm  bytes\n");
+}
+
+void air_capture_write_packet(FILE* file, const struct Air_Capture_Packet* packet)
+{
+    fprintf(file, "%-14" PRIu64 " %-10" PRIu64 " 0x%06" PRIx32 "  %-9d", packet->start_cycle, packet->end_cycle,
+            packet->frf, packet->rssi_dbm);
+    for(uint8_t i = 0; i < packet->length; i++) {
+        fprintf(file, " %02x", packet->bytes[i]);
+    }
+    fprintf(file, "\n");
+}
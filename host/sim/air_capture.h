@@ -0,0 +1,41 @@
+#ifndef AIR_CAPTURE_H_
+#define AIR_CAPTURE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+   Air captures record the radio packets a receiver heard, as replay's -c writes them - when each one was on air, on
+   which channel, how strongly it arrived, and the bytes it put in the receiver's FIFO.  Like input traces (see
+   input_trace.h) they're plain text, one packet per line, so they can be diffed, trimmed or written by hand:
+
+       # start_cycle  end_cycle  frf       rssi_dbm  bytes
+       40213          78551      0x6c4000  -72       02 01 80 ...
+
+   The cycles are at F_CPU, from the start of the run.  Blank lines and anything after a '#' are ignored.  Packets
+   mustn't overlap, or go backwards.
+*/
+
+/* Most bytes a packet can hold - the RFM69's FIFO. */
+#define AIR_CAPTURE_MAX_BYTES 66
+
+struct Air_Capture_Packet {
+    uint64_t start_cycle;       // its first preamble bit
+    uint64_t end_cycle;         // its last CRC bit
+    uint32_t frf;
+    int16_t rssi_dbm;
+    uint8_t length;
+    uint8_t bytes[AIR_CAPTURE_MAX_BYTES];
+};
+
+enum Air_Capture_Status {
+    AIR_CAPTURE_OK,
+    AIR_CAPTURE_END,
+    AIR_CAPTURE_ERROR
+};
+
+enum Air_Capture_Status air_capture_read_packet(FILE* file, struct Air_Capture_Packet* packet, unsigned* line_number);
+void air_capture_write_header(FILE* file);
+void air_capture_write_packet(FILE* file, const struct Air_Capture_Packet* packet);
+
+#endif /* AIR_CAPTURE_H_ */
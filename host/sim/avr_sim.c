@@ -0,0 +1,849 @@
+#include "avr_sim.h"
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/sleep.h>
+
+#include <stddef.h>
+#include <string.h>
+
+/* The I/O registers declared in include/avr/io.h. */
+volatile uint8_t PINB, DDRB, PORTB, PINC, DDRC, PORTC, PIND, DDRD, PORTD;
+volatile uint8_t TIFR0, TIFR1, TIFR2, PCIFR, EIFR, EIMSK, GPIOR0, EECR, EEDR, EEARL, EEARH, GTCCR;
+volatile uint8_t TCCR0A, TCCR0B, TCNT0, OCR0A, OCR0B, GPIOR1, GPIOR2, SPCR, SPSR, SPDR, ACSR, SMCR, MCUSR, MCUCR, SPMCSR;
+volatile uint8_t WDTCSR, CLKPR, PRR, OSCCAL, PCICR, EICRA, PCMSK0, PCMSK1, PCMSK2, TIMSK0, TIMSK1, TIMSK2;
+volatile uint8_t ADCSRA, ADCSRB, ADMUX, DIDR0, DIDR1, TCCR1A, TCCR1B, TCCR1C;
+volatile uint8_t TCCR2A, TCCR2B, OCR2A, OCR2B, ASSR, TWBR, TWSR, TWAR, TWDR, TWCR, TWAMR;
+volatile uint8_t UCSR0A, UCSR0B, UCSR0C, UBRR0L, UBRR0H;
+volatile uint8_t SREG;
+volatile uint16_t ADC, EEAR, OCR1A, OCR1B, ICR1;
+
+/* Backing stores for TCNT1 and TCNT2, which the firmware reaches through sim_timer1_counter_register() and
+   sim_timer2_counter_register(). */
+static volatile uint16_t tcnt1_storage;
+static volatile uint8_t tcnt2_storage;
+
+/* Whichever of these the firmware defines with ISR() get called - the rest stay NULL. */
+void INT0_vect(void) __attribute__((weak));
+void PCINT0_vect(void) __attribute__((weak));
+void PCINT1_vect(void) __attribute__((weak));
+void PCINT2_vect(void) __attribute__((weak));
+void TIMER2_COMPA_vect(void) __attribute__((weak));
+void TIMER2_COMPB_vect(void) __attribute__((weak));
+void TIMER2_OVF_vect(void) __attribute__((weak));
+void TIMER1_OVF_vect(void) __attribute__((weak));
+void USART_TX_vect(void) __attribute__((weak));
+void ADC_vect(void) __attribute__((weak));
+
+/* Clock selects 6 and 7 count edges on the T1 pin, which isn't modeled - they leave Timer1 stopped. */
+static const uint16_t TIMER1_PRESCALERS[] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+static const uint16_t TIMER2_PRESCALERS[] = { 0, 1, 8, 32, 64, 128, 256, 1024 };
+static const uint8_t ADC_PRESCALERS[] = { 2, 2, 4, 8, 16, 32, 64, 128 };
+
+/* ADC clock cycles per conversion - the first one after enabling the ADC takes longer while the analog circuitry settles. */
+#define ADC_FIRST_CONVERSION_CLOCKS 25
+#define ADC_CONVERSION_CLOCKS 13
+
+/* How many times the main loop is allowed to run back-to-back after a single event without sleeping. */
+#define MAX_MAIN_LOOP_PASSES 8
+
+static struct {
+    uint64_t cycles;
+    bool finished;
+
+    bool sleeping;
+    bool woken;
+
+    struct Sim_Inputs inputs;
+    Sim_Input_Source input_source;
+    void* input_context;
+    bool input_pending;
+    uint64_t input_cycle;
+    struct Sim_Inputs next_inputs;
+
+    Sim_Usart_Sink usart_sink;
+    void* usart_context;
+    Sim_Wake_Sink wake_sink;
+    void* wake_context;
+    uint64_t alarm_cycle;
+    Sim_Alarm alarm;
+    void* alarm_context;
+    void (*main_loop)(void);
+    uint32_t main_loop_cycles;
+
+    uint32_t cpu_hz;
+
+    /* Timer1 - it counts once every timer1_prescaler cycles (never while that's 0), from the cycle TCNT1 last read zero
+       on.  Also the TCNT1 value the firmware last saw. */
+    uint64_t timer1_prescaler;
+    uint64_t timer1_base;
+    uint64_t timer1_next_overflow;
+    uint16_t timer1_reported_count;
+
+    /* Timer2 - it counts once every timer2_count_num / timer2_count_den cycles (never while timer2_count_num is 0),
+       from the cycle TCNT2 last read zero on.  Also the TCNT2 value the firmware last saw. */
+    uint64_t timer2_count_num;
+    uint64_t timer2_count_den;
+    uint64_t timer2_base;
+    uint64_t timer2_next_overflow;
+    uint8_t timer2_reported_count;
+    uint64_t timer2_next_compare_a;
+    uint8_t timer2_ocr2a;
+
+    /* Number of ISRs run so far, so sleep can tell whether a wake-up interrupt was already pending. */
+    uint32_t isr_calls;
+
+    uint64_t adc_done;
+    bool adc_enabled;
+
+    bool usart_write_pending;
+    uint8_t usart_write_slot;
+    bool usart_data_full;
+    uint8_t usart_data;
+    bool usart_shifting;
+    uint8_t usart_shift;
+    uint64_t usart_shift_done;
+
+    /* Cycle the next rising edge on INT0's pin comes on. */
+    uint64_t int0_edge;
+
+    /* The cycle the current sim_run_until() call stops at. */
+    uint64_t run_until;
+
+    struct Sim_Stats stats;
+} sim;
+
+static void run_events(uint64_t until, bool stop_when_woken);
+
+static uint64_t min_cycle(uint64_t a, uint64_t b)
+{
+    return a < b ? a : b;
+}
+
+static bool io_clock_running(void)
+{
+    uint8_t mode = SMCR & ((1 << SM0) | (1 << SM1) | (1 << SM2));
+    return !sim.sleeping || mode == SLEEP_MODE_IDLE || mode == SLEEP_MODE_ADC;
+}
+
+/* Off the I/O clock Timer2 stops along with it, but clocked from the 32.768kHz crystal it only stops in power-down
+   and standby. */
+static bool timer2_clock_running(void)
+{
+    uint8_t mode = SMCR & ((1 << SM0) | (1 << SM1) | (1 << SM2));
+    if(ASSR & (1 << AS2)) {
+        return !sim.sleeping || (mode != SLEEP_MODE_PWR_DOWN && mode != SLEEP_MODE_STANDBY);
+    }
+    return io_clock_running();
+}
+
+static void call_isr(void (*vector)(void))
+{
+    if(vector == NULL) {
+        return;
+    }
+
+    // The AVR clears the global interrupt flag on entry to an ISR, and RETI sets it again on the way out.
+    SREG &= ~(1 << SREG_I);
+    vector();
+    SREG |= (1 << SREG_I);
+    sim.woken = true;
+    sim.isr_calls++;
+}
+
+static void sync_peripherals(void);
+
+static void service_interrupts(void)
+{
+    // Checked in interrupt vector order, which is also the AVR's interrupt priority order.
+    while((SREG & (1 << SREG_I)) && !sim.finished) {
+        if((EIFR & (1 << INTF0)) && (EIMSK & (1 << INT0))) {
+            EIFR &= ~(1 << INTF0);
+            call_isr(INT0_vect);
+        } else if((PCIFR & (1 << PCIF0)) && (PCICR & (1 << PCIE0))) {
+            PCIFR &= ~(1 << PCIF0);
+            call_isr(PCINT0_vect);
+        } else if((PCIFR & (1 << PCIF1)) && (PCICR & (1 << PCIE1))) {
+            PCIFR &= ~(1 << PCIF1);
+            call_isr(PCINT1_vect);
+        } else if((PCIFR & (1 << PCIF2)) && (PCICR & (1 << PCIE2))) {
+            PCIFR &= ~(1 << PCIF2);
+            call_isr(PCINT2_vect);
+        } else if((TIFR2 & (1 << OCF2A)) && (TIMSK2 & (1 << OCIE2A))) {
+            TIFR2 &= ~(1 << OCF2A);
+            call_isr(TIMER2_COMPA_vect);
+        } else if((TIFR2 & (1 << OCF2B)) && (TIMSK2 & (1 << OCIE2B))) {
+            TIFR2 &= ~(1 << OCF2B);
+            call_isr(TIMER2_COMPB_vect);
+        } else if((TIFR2 & (1 << TOV2)) && (TIMSK2 & (1 << TOIE2))) {
+            TIFR2 &= ~(1 << TOV2);
+            call_isr(TIMER2_OVF_vect);
+        } else if((TIFR1 & (1 << TOV1)) && (TIMSK1 & (1 << TOIE1))) {
+            TIFR1 &= ~(1 << TOV1);
+            call_isr(TIMER1_OVF_vect);
+        } else if((UCSR0A & (1 << TXC0)) && (UCSR0B & (1 << TXCIE0))) {
+            UCSR0A &= ~(1 << TXC0);
+            call_isr(USART_TX_vect);
+        } else if((ADCSRA & (1 << ADIF)) && (ADCSRA & (1 << ADIE))) {
+            ADCSRA &= ~(1 << ADIF);
+            call_isr(ADC_vect);
+        } else {
+            break;
+        }
+        sync_peripherals();
+    }
+}
+
+/*
+    The instruction after SEI always runs before any pending interrupt, which is what makes "cli(); check for work;
+    sleep_enable(); sei(); sleep_cpu();" race free.  Rather than model that one instruction, a sei() made with sleep
+    already enabled leaves pending interrupts for the sleep_cpu() that follows it.
+*/
+void sim_sei(void)
+{
+    SREG |= (1 << SREG_I);
+    if(SMCR & (1 << SE)) {
+        return;
+    }
+    sync_peripherals();
+    service_interrupts();
+}
+
+void sim_cli(void)
+{
+    SREG &= ~(1 << SREG_I);
+}
+
+/*
+    ---- Timer1 ----
+*/
+
+static uint16_t timer1_count(void)
+{
+    return (uint16_t) ((sim.cycles - sim.timer1_base) / sim.timer1_prescaler);
+}
+
+static void timer1_overflow(void)
+{
+    sim.timer1_base = sim.timer1_next_overflow;
+    sim.timer1_next_overflow = sim.timer1_base + 65536 * sim.timer1_prescaler;
+    TIFR1 |= (1 << TOV1);
+}
+
+static void timer1_sync(void)
+{
+    // Overflows the clock ran past while the firmware was busy, as long as it hasn't been frozen by sleep since.
+    while(io_clock_running() && sim.timer1_next_overflow <= sim.cycles) {
+        timer1_overflow();
+    }
+
+    uint64_t prescaler = TIMER1_PRESCALERS[TCCR1B & ((1 << CS12) | (1 << CS11) | (1 << CS10))];
+    if(PRR & (1 << PRTIM1)) {
+        prescaler = 0;
+    }
+
+    // A write to TCNT1 shows up as a value different from the one we last handed out.
+    uint16_t count = tcnt1_storage;
+    if(prescaler == sim.timer1_prescaler && count == sim.timer1_reported_count) {
+        return;
+    }
+    if(count == sim.timer1_reported_count && sim.timer1_prescaler != 0) {
+        count = timer1_count();
+    }
+
+    sim.timer1_prescaler = prescaler;
+    sim.timer1_reported_count = count;
+    tcnt1_storage = count;
+    if(prescaler == 0) {
+        sim.timer1_next_overflow = SIM_NEVER;
+    } else {
+        sim.timer1_base = sim.cycles - count * prescaler;
+        sim.timer1_next_overflow = sim.timer1_base + 65536 * prescaler;
+    }
+}
+
+volatile uint16_t* sim_timer1_counter_register(void)
+{
+    timer1_sync();
+    if(sim.timer1_prescaler != 0) {
+        sim.timer1_reported_count = timer1_count();
+        tcnt1_storage = sim.timer1_reported_count;
+    }
+    return &tcnt1_storage;
+}
+
+/*
+    ---- Timer2 ----
+*/
+
+/* Cycles after timer2_base until Timer2 has counted the given number of times - rounded up, since the crystal's edges
+   don't line up with the CPU clock's. */
+static uint64_t timer2_count_cycles(uint64_t counts)
+{
+    return (counts * sim.timer2_count_num + sim.timer2_count_den - 1) / sim.timer2_count_den;
+}
+
+/* The first cycle after the current one on which TCNT2 counts up to OCR2A. */
+static void timer2_schedule_compare_a(void)
+{
+    if(sim.timer2_count_num == 0) {
+        sim.timer2_next_compare_a = SIM_NEVER;
+        return;
+    }
+
+    uint64_t count = sim.timer2_ocr2a;
+    uint64_t compare = sim.timer2_base + timer2_count_cycles(count);
+    while(compare <= sim.cycles) {
+        count += 256;
+        compare = sim.timer2_base + timer2_count_cycles(count);
+    }
+    sim.timer2_next_compare_a = compare;
+}
+
+static void timer2_sync(void)
+{
+    uint64_t num = TIMER2_PRESCALERS[TCCR2B & ((1 << CS22) | (1 << CS21) | (1 << CS20))];
+    uint64_t den = 1;
+    if(PRR & (1 << PRTIM2)) {
+        num = 0;
+    }
+    if(ASSR & (1 << AS2)) {
+        num *= sim.cpu_hz;
+        den = SIM_TOSC_HZ;
+    }
+
+    // A write to TCNT2 shows up as a value different from the one we last handed out.
+    uint8_t count = tcnt2_storage;
+
+    if(num != sim.timer2_count_num || den != sim.timer2_count_den || count != sim.timer2_reported_count) {
+        sim.timer2_count_num = num;
+        sim.timer2_count_den = den;
+        sim.timer2_reported_count = count;
+        tcnt2_storage = count;
+        if(num == 0) {
+            sim.timer2_next_overflow = SIM_NEVER;
+        } else {
+            sim.timer2_base = sim.cycles - timer2_count_cycles(count);
+            sim.timer2_next_overflow = sim.timer2_base + timer2_count_cycles(256);
+        }
+        sim.timer2_ocr2a = OCR2A;
+        timer2_schedule_compare_a();
+    } else if(OCR2A != sim.timer2_ocr2a) {
+        sim.timer2_ocr2a = OCR2A;
+        timer2_schedule_compare_a();
+    }
+}
+
+static void timer2_compare_a(void)
+{
+    sim.stats.timer2_compare_matches++;
+    timer2_schedule_compare_a();
+    TIFR2 |= (1 << OCF2A);
+}
+
+static void timer2_overflow(void)
+{
+    sim.stats.timer2_overflows++;
+    sim.timer2_base = sim.timer2_next_overflow;
+    sim.timer2_next_overflow = sim.timer2_base + timer2_count_cycles(256);
+    sim.timer2_reported_count = 0;
+    tcnt2_storage = 0;
+    TIFR2 |= (1 << TOV2);
+}
+
+volatile uint8_t* sim_timer2_counter_register(void)
+{
+    timer2_sync();
+    if(sim.timer2_count_num != 0) {
+        sim.timer2_reported_count = (uint8_t) ((sim.cycles - sim.timer2_base) * sim.timer2_count_den / sim.timer2_count_num);
+        tcnt2_storage = sim.timer2_reported_count;
+    }
+    return &tcnt2_storage;
+}
+
+/*
+    ---- ADC ----
+*/
+
+static void adc_sync(void)
+{
+    bool enabled = (ADCSRA & (1 << ADEN)) && !(PRR & (1 << PRADC));
+    if(!enabled) {
+        sim.adc_done = SIM_NEVER;
+    } else if((ADCSRA & (1 << ADSC)) && sim.adc_done == SIM_NEVER) {
+        uint8_t clocks = (sim.adc_enabled ? ADC_CONVERSION_CLOCKS : ADC_FIRST_CONVERSION_CLOCKS);
+        sim.adc_done = sim.cycles + (uint64_t) clocks * ADC_PRESCALERS[ADCSRA & ((1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0))];
+    }
+    sim.adc_enabled = enabled;
+}
+
+static void adc_conversion_complete(void)
+{
+    sim.stats.adc_conversions++;
+    sim.adc_done = SIM_NEVER;
+    ADC = sim.inputs.adc[ADMUX & ((1 << MUX3) | (1 << MUX2) | (1 << MUX1) | (1 << MUX0))] & 0x3FF;
+    ADCSRA = (ADCSRA & ~(1 << ADSC)) | (1 << ADIF);
+}
+
+/*
+    ---- USART0 transmitter ----
+*/
+
+static uint64_t usart_frame_cycles(void)
+{
+    uint16_t ubrr = ((UBRR0H & 0x0F) << 8) | UBRR0L;
+    uint8_t data_bits = 5 + ((UCSR0C >> UCSZ00) & 0x03);
+    uint8_t bits = 1 + data_bits + ((UCSR0C & (1 << UPM01)) ? 1 : 0) + ((UCSR0C & (1 << USBS0)) ? 2 : 1);
+    return (uint64_t) bits * ((UCSR0A & (1 << U2X0)) ? 8 : 16) * (ubrr + 1);
+}
+
+static void usart_start_shift(uint8_t byte)
+{
+    sim.usart_shifting = true;
+    sim.usart_shift = byte;
+    sim.usart_shift_done = sim.cycles + usart_frame_cycles();
+    UCSR0A = (UCSR0A | (1 << UDRE0)) & ~(1 << TXC0);
+}
+
+static void usart_commit_write(void)
+{
+    if(!sim.usart_write_pending) {
+        return;
+    }
+    sim.usart_write_pending = false;
+
+    if(!(UCSR0B & (1 << TXEN0)) || (PRR & (1 << PRUSART0))) {
+        return;
+    }
+
+    if(!sim.usart_shifting) {
+        usart_start_shift(sim.usart_write_slot);
+    } else {
+        sim.usart_data_full = true;
+        sim.usart_data = sim.usart_write_slot;
+        UCSR0A &= ~(1 << UDRE0);
+    }
+}
+
+static void usart_shift_complete(void)
+{
+    sim.stats.usart_bytes++;
+    if(sim.usart_sink != NULL) {
+        sim.usart_sink(sim.usart_context, sim.cycles, sim.usart_shift);
+    }
+
+    if(sim.usart_data_full) {
+        sim.usart_data_full = false;
+        usart_start_shift(sim.usart_data);
+    } else {
+        sim.usart_shifting = false;
+        sim.usart_shift_done = SIM_NEVER;
+        UCSR0A |= (1 << TXC0);
+    }
+}
+
+/*
+    The firmware only ever writes UDR0, and each write evaluates this function once.  The written value lands in a
+    slot that is committed to the transmitter the next time the simulator looks at the peripherals (or at the next
+    write, whichever comes first).  UDRE0 is updated straight away, since the firmware may check it again before then.
+*/
+volatile uint8_t* sim_usart_data_register(void)
+{
+    usart_commit_write();
+    sim.usart_write_pending = true;
+    if(sim.usart_shifting) {
+        UCSR0A &= ~(1 << UDRE0);
+    }
+    return &sim.usart_write_slot;
+}
+
+/*
+    ---- Pin changes ----
+*/
+
+static void apply_inputs(const struct Sim_Inputs* inputs)
+{
+    uint8_t changed_b = (PINB ^ inputs->pinb) & PCMSK0;
+    uint8_t changed_c = (PINC ^ inputs->pinc) & PCMSK1;
+    uint8_t changed_d = (PIND ^ inputs->pind) & PCMSK2;
+
+    sim.inputs = *inputs;
+    PINB = inputs->pinb;
+    PINC = inputs->pinc;
+    PIND = inputs->pind;
+
+    if(changed_b && (PCICR & (1 << PCIE0))) {
+        PCIFR |= (1 << PCIF0);
+    }
+    if(changed_c && (PCICR & (1 << PCIE1))) {
+        PCIFR |= (1 << PCIF1);
+    }
+    if(changed_d && (PCICR & (1 << PCIE2))) {
+        PCIFR |= (1 << PCIF2);
+    }
+    if(changed_b || changed_c || changed_d) {
+        sim.stats.pin_changes++;
+    }
+}
+
+static void fetch_next_input(void)
+{
+    if(sim.input_pending || sim.input_source == NULL) {
+        return;
+    }
+
+    if(sim.input_source(sim.input_context, &sim.input_cycle, &sim.next_inputs)) {
+        sim.input_pending = true;
+    } else {
+        sim.input_source = NULL;
+    }
+}
+
+/*
+    ---- External interrupt 0 ----
+*/
+
+/* Only rising edges are modeled, and they're only caught with the I/O clock running - the AVR needs it to detect an
+   edge, unlike a low level. */
+static void int0_edge(void)
+{
+    sim.int0_edge = SIM_NEVER;
+    if((EICRA & ((1 << ISC01) | (1 << ISC00))) == ((1 << ISC01) | (1 << ISC00))) {
+        EIFR |= (1 << INTF0);
+    }
+}
+
+/*
+    ---- Sleep ----
+*/
+
+void sim_sleep_cpu(void)
+{
+    if(!(SMCR & (1 << SE)) || sim.finished) {
+        return;
+    }
+
+    // An interrupt that was already pending wakes the CPU straight back up.
+    sync_peripherals();
+    uint32_t isr_calls = sim.isr_calls;
+    service_interrupts();
+    if(sim.isr_calls != isr_calls) {
+        return;
+    }
+
+    uint8_t mode = SMCR & ((1 << SM0) | (1 << SM1) | (1 << SM2));
+    uint64_t start = sim.cycles;
+
+    sim.stats.sleeps++;
+    sim.sleeping = true;
+    sim.woken = false;
+
+    bool clock_stopped = !io_clock_running();
+    bool timer2_stopped = !timer2_clock_running();
+    run_events(SIM_NEVER, true);
+
+    sim.sleeping = false;
+    uint64_t slept = sim.cycles - start;
+    sim.stats.sleep_cycles[mode >> 1] += slept;
+    sim.stats.sleep_counts[mode >> 1]++;
+
+    // Peripherals whose clock was stopped were frozen while we slept - pick up where they left off.
+    if(timer2_stopped) {
+        if(sim.timer2_next_overflow != SIM_NEVER) {
+            sim.timer2_base += slept;
+            sim.timer2_next_overflow += slept;
+        }
+        if(sim.timer2_next_compare_a != SIM_NEVER) {
+            sim.timer2_next_compare_a += slept;
+        }
+    }
+    if(clock_stopped) {
+        if(sim.timer1_next_overflow != SIM_NEVER) {
+            sim.timer1_base += slept;
+            sim.timer1_next_overflow += slept;
+        }
+        if(sim.adc_done != SIM_NEVER) {
+            sim.adc_done += slept;
+        }
+        if(sim.usart_shift_done != SIM_NEVER) {
+            sim.usart_shift_done += slept;
+        }
+        // An edge that came and went with the clock stopped was never seen.
+        if(sim.int0_edge <= sim.cycles) {
+            sim.int0_edge = SIM_NEVER;
+        }
+    }
+
+    if(sim.wake_sink != NULL) {
+        sim.wake_sink(sim.wake_context, sim.cycles, mode);
+    }
+}
+
+/*
+    ---- Event loop ----
+*/
+
+static void sync_peripherals(void)
+{
+    usart_commit_write();
+    timer1_sync();
+    timer2_sync();
+    adc_sync();
+}
+
+static void run_main_loop(void)
+{
+    if(sim.main_loop == NULL) {
+        return;
+    }
+
+    /*
+        The real main loop spins forever, so keep running it for as long as a pass could have left it with more to do:
+        after it sleeps and is woken (unless this run is over), and after any pass that doesn't sleep, up to a limit -
+        the firmware only stays awake with something left to do, like a timer's callback waiting to run, or an
+        interrupt that came in just as it was about to sleep.
+    */
+    uint8_t busy_passes = 0;
+    while(!sim.finished) {
+        uint32_t sleeps = sim.stats.sleeps;
+
+        sim.cycles += sim.main_loop_cycles;
+        sim.main_loop();
+        sync_peripherals();
+        service_interrupts();
+
+        if(sim.stats.sleeps != sleeps) {
+            busy_passes = 0;
+            if(sim.cycles >= sim.run_until) {
+                break;
+            }
+        } else if(++busy_passes >= MAX_MAIN_LOOP_PASSES) {
+            break;
+        }
+    }
+}
+
+static void run_events(uint64_t until, bool stop_when_woken)
+{
+    while(!sim.finished && !(stop_when_woken && sim.woken)) {
+        fetch_next_input();
+
+        bool clocked = io_clock_running();
+        bool timer2_clocked = timer2_clock_running();
+        uint64_t input_at = (sim.input_pending ? sim.input_cycle : SIM_NEVER);
+        uint64_t timer1_at = (clocked ? sim.timer1_next_overflow : SIM_NEVER);
+        uint64_t timer2_at = (timer2_clocked ? sim.timer2_next_overflow : SIM_NEVER);
+        uint64_t compare_a_at = (timer2_clocked ? sim.timer2_next_compare_a : SIM_NEVER);
+        uint64_t adc_at = (clocked ? sim.adc_done : SIM_NEVER);
+        uint64_t usart_at = (clocked ? sim.usart_shift_done : SIM_NEVER);
+        uint64_t int0_at = (clocked && (EIMSK & (1 << INT0)) ? sim.int0_edge : SIM_NEVER);
+        uint64_t alarm_at = sim.alarm_cycle;
+        uint64_t next = min_cycle(min_cycle(min_cycle(input_at, timer2_at), min_cycle(adc_at, usart_at)),
+                                  min_cycle(min_cycle(compare_a_at, int0_at), min_cycle(timer1_at, alarm_at)));
+
+        if(next > until) {
+            // A sleep inside the main loop may already have carried us past the end of this run.
+            if(until != SIM_NEVER && until > sim.cycles) {
+                sim.cycles = until;
+            }
+            // Nothing left that could ever wake us up.
+            if(next == SIM_NEVER && stop_when_woken) {
+                sim.finished = true;
+            }
+            break;
+        }
+
+        if(next > sim.cycles) {
+            sim.cycles = next;
+        }
+
+        if(alarm_at == next) {
+            // Before anything else due now, since it may set an INT0 edge for this same cycle.
+            sim.alarm_cycle = SIM_NEVER;
+            sim.alarm(sim.alarm_context, next);
+            int0_at = (clocked && (EIMSK & (1 << INT0)) ? sim.int0_edge : SIM_NEVER);
+        }
+        if(input_at == next) {
+            sim.input_pending = false;
+            apply_inputs(&sim.next_inputs);
+        }
+        if(usart_at == next) {
+            usart_shift_complete();
+        }
+        if(adc_at == next) {
+            adc_conversion_complete();
+        }
+        if(timer1_at == next) {
+            timer1_overflow();
+        }
+        if(timer2_at == next) {
+            timer2_overflow();
+        }
+        if(compare_a_at == next) {
+            timer2_compare_a();
+        }
+        if(int0_at == next) {
+            int0_edge();
+        }
+
+        service_interrupts();
+        if(!sim.sleeping) {
+            run_main_loop();
+        }
+    }
+}
+
+/*
+    ---- Public interface ----
+*/
+
+/*
+    Puts every register back to its power-on value and clears the simulated clock.  Call before running the
+    firmware's initialization code.
+*/
+void sim_reset(void)
+{
+    memset(&sim, 0, sizeof(sim));
+    sim.cpu_hz = SIM_DEFAULT_CPU_HZ;
+    sim.timer1_next_overflow = SIM_NEVER;
+    sim.timer2_next_overflow = SIM_NEVER;
+    sim.timer2_next_compare_a = SIM_NEVER;
+    sim.adc_done = SIM_NEVER;
+    sim.usart_shift_done = SIM_NEVER;
+    sim.int0_edge = SIM_NEVER;
+    sim.alarm_cycle = SIM_NEVER;
+
+    SREG = 0;
+    PINB = DDRB = PORTB = PINC = DDRC = PORTC = PIND = DDRD = PORTD = 0;
+    EIFR = EIMSK = EICRA = 0;
+    TIFR2 = PCIFR = SMCR = PRR = PCICR = PCMSK0 = PCMSK1 = PCMSK2 = TIMSK2 = 0;
+    ADCSRA = ADCSRB = ADMUX = 0;
+    TIFR1 = TIMSK1 = TCCR1A = TCCR1B = 0;
+    TCCR2A = TCCR2B = OCR2A = OCR2B = ASSR = 0;
+    SPCR = SPSR = SPDR = 0;
+    UCSR0A = (1 << UDRE0);
+    UCSR0B = 0;
+    UCSR0C = (1 << UCSZ01) | (1 << UCSZ00);
+    UBRR0L = UBRR0H = 0;
+    ADC = 0;
+    tcnt1_storage = 0;
+    tcnt2_storage = 0;
+}
+
+/*
+    Sets the system clock frequency, which only matters to Timer2 once it's clocked from the 32.768kHz crystal - the
+    simulated clock counts CPU cycles either way.  Call after sim_reset(), before running the firmware.
+*/
+void sim_set_cpu_hz(uint32_t hz)
+{
+    sim.cpu_hz = hz;
+}
+
+uint32_t sim_cpu_hz(void)
+{
+    return sim.cpu_hz;
+}
+
+/*
+    Sets the inputs immediately, without waiting for the input source.  Handy for the power-on state.
+*/
+void sim_set_inputs(const struct Sim_Inputs* inputs)
+{
+    apply_inputs(inputs);
+}
+
+void sim_set_input_source(Sim_Input_Source source, void* context)
+{
+    sim.input_source = source;
+    sim.input_context = context;
+    sim.input_pending = false;
+}
+
+void sim_set_usart_sink(Sim_Usart_Sink sink, void* context)
+{
+    sim.usart_sink = sink;
+    sim.usart_context = context;
+}
+
+void sim_set_wake_sink(Sim_Wake_Sink sink, void* context)
+{
+    sim.wake_sink = sink;
+    sim.wake_context = context;
+}
+
+/*
+    Calls alarm on the given cycle, once, replacing any alarm set before - set another from the alarm itself to keep
+    them coming.  SIM_NEVER cancels it.
+*/
+void sim_set_alarm(uint64_t cycle, Sim_Alarm alarm, void* context)
+{
+    sim.alarm_cycle = cycle;
+    sim.alarm = alarm;
+    sim.alarm_context = context;
+}
+
+/*
+    Sets the function standing in for one pass of the firmware's while(1) loop.  It is run after every event, since on
+    real hardware the main loop is always spinning whenever the CPU isn't asleep.
+*/
+void sim_set_main_loop(void (*main_loop)(void))
+{
+    sim.main_loop = main_loop;
+}
+
+/*
+    Charges each pass of the main loop the given number of cycles, standing in for the time the firmware's code takes
+    to run - so that a timer the firmware reads to see how long it's been awake gets somewhere.  0, as after
+    sim_reset(), runs it in zero time.
+*/
+void sim_set_main_loop_cycles(uint32_t cycles)
+{
+    sim.main_loop_cycles = cycles;
+}
+
+/*
+    Runs the firmware until the simulated clock reaches the given cycle, or until the firmware goes to sleep with
+    nothing left in the input source that could wake it.
+*/
+void sim_run_until(uint64_t cycle)
+{
+    sim.run_until = cycle;
+    sync_peripherals();
+    service_interrupts();
+    run_main_loop();
+    run_events(cycle, false);
+}
+
+/*
+    Moves the simulated clock forward while firmware code is running, for emulated hardware whose accesses take long
+    enough to matter - a busy wait polling a peripheral over SPI would otherwise spin forever in zero time.  Peripheral
+    events that fall due in the meantime are handled late, once the firmware next gives the event loop a look in.
+*/
+void sim_consume_cycles(uint32_t cycles)
+{
+    sim.cycles += cycles;
+}
+
+/*
+    Schedules a rising edge on INT0's pin - PD2 - for emulated hardware driving it, replacing any edge scheduled
+    before.  SIM_NEVER cancels it.
+*/
+void sim_set_int0_edge(uint64_t cycle)
+{
+    sim.int0_edge = cycle;
+}
+
+uint64_t sim_cycles(void)
+{
+    return sim.cycles;
+}
+
+bool sim_finished(void)
+{
+    return sim.finished;
+}
+
+const struct Sim_Stats* sim_stats(void)
+{
+    return &sim.stats;
+}
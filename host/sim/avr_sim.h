@@ -0,0 +1,81 @@
+#ifndef AVR_SIM_H_
+#define AVR_SIM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+   A small cycle-counting model of the ATmega328P peripherals this firmware uses - Timer1 (counting off the I/O clock),
+   Timer2 (clocked from the system clock or, with AS2 set in ASSR, a 32.768kHz crystal), the ADC, USART0 transmit, pin
+   change interrupts, rising edges on INT0 and sleep modes - so the unmodified firmware sources can be built and run on
+   a PC against the register stand-ins in host/sim/include.
+
+   The model is event driven rather than instruction accurate: firmware code runs in zero simulated time, and the
+   clock only moves forward between peripheral events - or when emulated hardware charges for a slow access with
+   sim_consume_cycles(), or each pass of the main loop is charged a flat sim_set_main_loop_cycles().  That is plenty to reproduce packet timing, debouncing and
+   sleep behaviour, which are all governed by Timer2 ticks and 2400 baud byte times rather than by instruction counts.
+*/
+
+/* One ADC input per ADMUX channel selection, so the internal channels (temp sensor, bandgap, GND) can be driven too. */
+#define SIM_NUM_ADC_INPUTS 16
+
+#define SIM_NEVER UINT64_MAX
+
+/* Frequency of the watch crystal on TOSC1/TOSC2, and the system clock assumed until sim_set_cpu_hz() says otherwise. */
+#define SIM_TOSC_HZ 32768
+#define SIM_DEFAULT_CPU_HZ 4000000
+
+/* Number of distinct sleep modes selectable through the SM bits in SMCR. */
+#define SIM_NUM_SLEEP_MODES 8
+
+/* Everything outside the MCU that the firmware can observe. */
+struct Sim_Inputs {
+    uint8_t pinb;
+    uint8_t pinc;
+    uint8_t pind;
+    uint16_t adc[SIM_NUM_ADC_INPUTS];
+};
+
+/* Supplies the next change to the simulated inputs, and the cycle it happens on.  Returns false once there are no more. */
+typedef bool (*Sim_Input_Source)(void* context, uint64_t* cycle, struct Sim_Inputs* inputs);
+
+/* Called with every byte once its stop bit has left the USART. */
+typedef void (*Sim_Usart_Sink)(void* context, uint64_t cycle, uint8_t byte);
+
+/* Called whenever the CPU wakes up, with the SLEEP_MODE_x it was in. */
+typedef void (*Sim_Wake_Sink)(void* context, uint64_t cycle, uint8_t sleep_mode);
+
+/* Called on the cycle given to sim_set_alarm(), asleep or not - for things outside the MCU that happen on a schedule of
+   their own, like a radio packet coming in. */
+typedef void (*Sim_Alarm)(void* context, uint64_t cycle);
+
+struct Sim_Stats {
+    /* Cycles spent asleep, indexed by the SM bits of SMCR (SLEEP_MODE_x >> 1). */
+    uint64_t sleep_cycles[SIM_NUM_SLEEP_MODES];
+    uint32_t sleep_counts[SIM_NUM_SLEEP_MODES];
+    uint32_t sleeps;
+    uint32_t timer2_overflows;
+    uint32_t timer2_compare_matches;
+    uint32_t adc_conversions;
+    uint32_t usart_bytes;
+    uint32_t pin_changes;
+};
+
+void sim_reset(void);
+void sim_set_cpu_hz(uint32_t hz);
+uint32_t sim_cpu_hz(void);
+void sim_set_inputs(const struct Sim_Inputs* inputs);
+void sim_set_input_source(Sim_Input_Source source, void* context);
+void sim_set_usart_sink(Sim_Usart_Sink sink, void* context);
+void sim_set_wake_sink(Sim_Wake_Sink sink, void* context);
+void sim_set_alarm(uint64_t cycle, Sim_Alarm alarm, void* context);
+void sim_set_main_loop(void (*main_loop)(void));
+void sim_set_main_loop_cycles(uint32_t cycles);
+void sim_run_until(uint64_t cycle);
+void sim_consume_cycles(uint32_t cycles);
+void sim_set_int0_edge(uint64_t cycle);
+uint64_t sim_cycles(void);
+bool sim_finished(void);
+const struct Sim_Stats* sim_stats(void);
+
+#endif /* AVR_SIM_H_ */
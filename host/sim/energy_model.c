@@ -0,0 +1,144 @@
+#include "energy_model.h"
+
+#include <avr/sleep.h>
+
+/* Sleep modes the firmware never uses, whose draw depends on the main oscillator and isn't modeled. */
+#define NOT_MODELED -1.0
+
+/* RegOpMode mode of TX. */
+#define RADIO_MODE_TX 3
+
+/* Indexed by RegOpMode mode. */
+static const double RADIO_MODE_UA[RFM69_EMU_NUM_MODES] = { ENERGY_RADIO_SLEEP_UA, ENERGY_RADIO_STANDBY_UA,
+                                                            ENERGY_RADIO_SYNTH_UA, ENERGY_RADIO_TX_UA,
+                                                            ENERGY_RADIO_RX_UA, NOT_MODELED, NOT_MODELED,
+                                                            NOT_MODELED };
+
+/* TX current at output powers across the RFM69W and RFM69HW's range, in dBm and microamps, off the datasheets' curves -
+   in between, it's interpolated, and below the bottom one it stays put, since the PA's bias doesn't come down any
+   further. */
+static const struct {
+    int8_t dbm;
+    double current_ua;
+} TX_CURRENT[] = { { -1, 16000.0 }, { 0, 20000.0 }, { 10, 33000.0 }, { 13, ENERGY_RADIO_TX_UA }, { 17, 95000.0 },
+                   { 20, 130000.0 } };
+
+#define NUM_TX_CURRENTS (sizeof(TX_CURRENT) / sizeof(TX_CURRENT[0]))
+
+static const char* const RADIO_MODE_NAMES[RFM69_EMU_NUM_MODES] = { "radio sleep", "radio standby", "radio synth",
+                                                                   "radio tx", "radio rx", "radio reserved",
+                                                                   "radio reserved", "radio reserved" };
+
+/* Indexed by the SM bits of SMCR, like Sim_Stats.sleep_cycles. */
+static const char* const SLEEP_MODE_NAMES[SIM_NUM_SLEEP_MODES] = { "mcu idle", "mcu adc sleep", "mcu power-down",
+                                                                   "mcu power-save", "mcu reserved", "mcu reserved",
+                                                                   "mcu standby", "mcu ext standby" };
+
+/* Typical TX current at an output power. */
+static double tx_current_ua(int8_t dbm)
+{
+    if(dbm <= TX_CURRENT[0].dbm) {
+        return TX_CURRENT[0].current_ua;
+    }
+    for(uint8_t i = 1; i < NUM_TX_CURRENTS; i++) {
+        if(dbm <= TX_CURRENT[i].dbm) {
+            double fraction = (dbm - TX_CURRENT[i - 1].dbm) / (double) (TX_CURRENT[i].dbm - TX_CURRENT[i - 1].dbm);
+            return TX_CURRENT[i - 1].current_ua + fraction * (TX_CURRENT[i].current_ua - TX_CURRENT[i - 1].current_ua);
+        }
+    }
+    return TX_CURRENT[NUM_TX_CURRENTS - 1].current_ua;
+}
+
+static void add_component(struct Energy_Estimate* estimate, const char* name, uint64_t cycles, uint32_t cpu_hz,
+                          double current_ua)
+{
+    if(cycles == 0) {
+        return;
+    }
+
+    struct Energy_Component* component = &estimate->components[estimate->num_components++];
+    component->name = name;
+    component->seconds = cycles / (double) cpu_hz;
+    component->current_ua = current_ua;
+}
+
+/*
+    Works out the average current for everything simulated since sim_reset().
+
+    @param cpu_hz - The system clock the firmware was simulated at, which scales the MCU's awake and idle currents
+    @param estimate - Filled in with the breakdown and the average.  States that aren't modeled count as drawing
+                      nothing, and energy_model_print() flags them.
+*/
+void energy_model_estimate(uint32_t cpu_hz, struct Energy_Estimate* estimate)
+{
+    const struct Sim_Stats* stats = sim_stats();
+    uint64_t cycles = sim_cycles();
+    double mhz = cpu_hz / 1e6;
+
+    estimate->num_components = 0;
+    estimate->seconds = cycles / (double) cpu_hz;
+
+    uint64_t awake = cycles;
+    for(uint8_t i = 0; i < SIM_NUM_SLEEP_MODES; i++) {
+        awake -= stats->sleep_cycles[i];
+    }
+    add_component(estimate, "mcu active", awake, cpu_hz, ENERGY_MCU_ACTIVE_UA_PER_MHZ * mhz);
+
+    for(uint8_t i = 0; i < SIM_NUM_SLEEP_MODES; i++) {
+        double current_ua;
+        switch(i << 1) {
+            case SLEEP_MODE_IDLE:
+            case SLEEP_MODE_ADC:
+                current_ua = ENERGY_MCU_IDLE_UA_PER_MHZ * mhz;
+                break;
+            case SLEEP_MODE_PWR_DOWN:
+                current_ua = ENERGY_MCU_POWER_DOWN_UA;
+                break;
+            case SLEEP_MODE_PWR_SAVE:
+                current_ua = ENERGY_MCU_POWER_SAVE_UA;
+                break;
+            default:
+                current_ua = NOT_MODELED;
+                break;
+        }
+        add_component(estimate, SLEEP_MODE_NAMES[i], stats->sleep_cycles[i], cpu_hz, current_ua);
+    }
+
+    // TX gets a line for each output power it was used at, from the top down.
+    static char tx_names[RFM69_EMU_NUM_POWER_LEVELS][sizeof("radio tx +20dBm")];
+    for(uint8_t mode = 0; mode < RFM69_EMU_NUM_MODES; mode++) {
+        if(mode == RADIO_MODE_TX) {
+            for(uint8_t i = RFM69_EMU_NUM_POWER_LEVELS; i-- > 0;) {
+                int8_t dbm = (int8_t) (i + RFM69_EMU_MIN_POWER_DBM);
+                snprintf(tx_names[i], sizeof(tx_names[i]), "radio tx %+ddBm", dbm);
+                add_component(estimate, tx_names[i], rfm69_emu_tx_power_cycles(dbm), cpu_hz, tx_current_ua(dbm));
+            }
+        } else {
+            add_component(estimate, RADIO_MODE_NAMES[mode], rfm69_emu_mode_cycles(mode), cpu_hz, RADIO_MODE_UA[mode]);
+        }
+    }
+
+    double charge_uas = 0;
+    for(uint8_t i = 0; i < estimate->num_components; i++) {
+        if(estimate->components[i].current_ua != NOT_MODELED) {
+            charge_uas += estimate->components[i].seconds * estimate->components[i].current_ua;
+        }
+    }
+    estimate->average_ua = (estimate->seconds > 0 ? charge_uas / estimate->seconds : 0);
+}
+
+void energy_model_print(FILE* file, const struct Energy_Estimate* estimate)
+{
+    fprintf(file, "energy model (typical currents at 3V):\n");
+    for(uint8_t i = 0; i < estimate->num_components; i++) {
+        const struct Energy_Component* component = &estimate->components[i];
+        if(component->current_ua == NOT_MODELED) {
+            fprintf(file, "  %-16s %9.3f s   (current not modeled)\n", component->name, component->seconds);
+        } else {
+            fprintf(file, "  %-16s %9.3f s  x %9.1f uA = %9.2f uA average\n", component->name, component->seconds,
+                    component->current_ua, component->seconds * component->current_ua / estimate->seconds);
+        }
+    }
+    fprintf(file, "average current:    %.2f uA (%.2f mAh per day)\n", estimate->average_ua,
+            estimate->average_ua * 24 / 1000);
+}
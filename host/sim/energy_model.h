@@ -0,0 +1,63 @@
+#ifndef ENERGY_MODEL_H_
+#define ENERGY_MODEL_H_
+
+#include "avr_sim.h"
+#include "rfm69_emu.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+   Estimates the transmitter's average supply current over a simulation run, from how long the MCU spent awake and in
+   each sleep mode (sim_stats()) and how long the RFM69 spent in each of its modes (rfm69_emu_mode_cycles()), weighted
+   by typical currents from the ATmega328P and RFM69W datasheets, below.  Time in TX is broken down by output power
+   (rfm69_emu_tx_power_cycles()), since that's most of what TX draws.  host/battery/battery_life uses the same
+   figures on the firmware's own telemetry counters.
+
+   The figures are typicals at 3V and room temperature, so treat the absolute numbers as ballpark - the model is meant
+   for comparing firmware changes against each other on the same input trace.  The 433MHz transmitter hanging off the
+   USART isn't included, since its draw depends entirely on which module is fitted.
+*/
+
+/* The simulator runs firmware code in zero time, so replay.c charges each pass of the main loop this many cycles
+   instead (sim_set_main_loop_cycles()) - about what a scheduler tick with a task or two to run costs.  The MCU's time
+   awake is whatever's left of the run outside its sleeps. */
+#define ENERGY_MAIN_LOOP_CYCLES 300
+
+/* Microamps per MHz of system clock while the CPU runs, and while it idles with the I/O clock still going - both
+   read off the supply current vs. frequency curves in the ATmega328P datasheet at 3V, where they're close to linear. */
+#define ENERGY_MCU_ACTIVE_UA_PER_MHZ 425.0
+#define ENERGY_MCU_IDLE_UA_PER_MHZ 110.0
+
+/* Every clock stopped, watchdog off. */
+#define ENERGY_MCU_POWER_DOWN_UA 0.1
+
+/* Power-down plus the 32.768kHz crystal oscillator and Timer2. */
+#define ENERGY_MCU_POWER_SAVE_UA 0.8
+
+/* RFM69W supply currents by mode, at +13dBm for transmit - energy_model.c scales TX to other output powers. */
+#define ENERGY_RADIO_SLEEP_UA 0.1
+#define ENERGY_RADIO_STANDBY_UA 1250.0
+#define ENERGY_RADIO_SYNTH_UA 9000.0
+#define ENERGY_RADIO_TX_UA 45000.0
+#define ENERGY_RADIO_RX_UA 16000.0
+
+#define ENERGY_MODEL_MAX_COMPONENTS (1 + SIM_NUM_SLEEP_MODES + RFM69_EMU_NUM_MODES + RFM69_EMU_NUM_POWER_LEVELS)
+
+struct Energy_Component {
+    const char* name;
+    double seconds;             // time spent in this state
+    double current_ua;          // typical draw while in it
+};
+
+struct Energy_Estimate {
+    double seconds;
+    double average_ua;
+    uint8_t num_components;     // only the states that were actually visited are listed
+    struct Energy_Component components[ENERGY_MODEL_MAX_COMPONENTS];
+};
+
+void energy_model_estimate(uint32_t cpu_hz, struct Energy_Estimate* estimate);
+void energy_model_print(FILE* file, const struct Energy_Estimate* estimate);
+
+#endif /* ENERGY_MODEL_H_ */
@@ -0,0 +1,111 @@
+#include "gateway.h"
+
+#include "../../src/avr_config.h"
+#include "../../src/lib/rfm69/rfm69.h"
+
+#include <string.h>
+
+/*
+    Starts the gateway off having heard nothing.
+*/
+void gateway_init(struct Gateway* gateway)
+{
+    memset(gateway, 0, sizeof(*gateway));
+}
+
+/* Scores a try of the latest event that got through. */
+static void deliver_event(struct Gateway* gateway, uint64_t end)
+{
+    uint64_t added_latency = end - gateway->event_first_end;
+
+    gateway->event_delivered = true;
+    gateway->stats.events_delivered++;
+    gateway->stats.events_delivered_on_retry += (added_latency != 0);
+    gateway->stats.added_latency_cycles += added_latency;
+    if(added_latency > gateway->stats.max_added_latency_cycles) {
+        gateway->stats.max_added_latency_cycles = added_latency;
+    }
+}
+
+/*
+    Hands the gateway a packet the firmware sent.
+
+    @param end - Cycle its last bit went on air
+    @param frame - The packet, header first - behind its length byte, with RFM69_MESSAGES
+    @param length - Bytes in frame
+    @param heard - Whether it got through to the gateway
+    @param rssi_dbm - Signal strength it was heard at
+    @param ack - Filled in with RFM69_ACK_LENGTH bytes of ACK to send back, when it wants one
+    @return bool - true if the gateway answers it with the ACK
+*/
+bool gateway_packet(struct Gateway* gateway, uint64_t end, const uint8_t* frame, uint8_t length, bool heard,
+                    int16_t rssi_dbm, uint8_t* ack)
+{
+#ifdef RFM69_MESSAGES
+    // Messages other than input state can be shorter than a controller packet - but not than the header and type.
+    uint8_t shortest = RFM69_FRAME_BYTES(0);
+#else
+    uint8_t shortest = RFM69_FRAME_LENGTH;
+#endif
+    if(length < shortest) {
+        return false;
+    }
+
+    uint8_t sequence = frame[RFM69_HEADER_CONTROL] & RFM69_CONTROL_SEQUENCE_MASK;
+    bool wants_ack = (frame[RFM69_HEADER_CONTROL] & RFM69_CONTROL_ACK_REQUEST) != 0;
+
+    // Retries repeat the sequence number, so a different one is the next event.
+    if(wants_ack && (!gateway->event_open || sequence != gateway->event_sequence)) {
+        gateway->stats.events++;
+        gateway->event_open = true;
+        gateway->event_sequence = sequence;
+        gateway->event_first_end = end;
+        gateway->event_delivered = false;
+    }
+
+    if(!heard || frame[RFM69_HEADER_DESTINATION] != RFM69W_GATEWAY_ADDRESS) {
+        return false;
+    }
+
+    if(gateway->have_sequence && sequence == gateway->last_sequence) {
+        gateway->stats.duplicates++;
+    } else {
+        gateway->stats.packets_delivered++;
+        gateway->have_sequence = true;
+        gateway->last_sequence = sequence;
+        if(wants_ack && !gateway->event_delivered) {
+            deliver_event(gateway, end);
+        }
+    }
+
+    if(!wants_ack) {
+        return false;
+    }
+
+    memset(ack, 0, RFM69_ACK_LENGTH);
+#ifdef RFM69_MESSAGES
+    ack[0] = RFM69_ACK_LENGTH - RFM69_LENGTH_BYTES;
+#endif
+    ack[RFM69_HEADER_DESTINATION] = frame[RFM69_HEADER_SOURCE];
+    ack[RFM69_HEADER_SOURCE] = RFM69W_GATEWAY_ADDRESS;
+    ack[RFM69_HEADER_CONTROL] = RFM69_CONTROL_ACK | sequence;
+
+    // RegRssiValue's encoding, -2 x dBm, as far as a byte goes.
+    int16_t rssi_value = -2 * rssi_dbm;
+    ack[RFM69_ACK_RSSI] = (uint8_t) (rssi_value < 0 ? 0 : rssi_value > UINT8_MAX ? UINT8_MAX : rssi_value);
+    gateway->stats.acks_sent++;
+    return true;
+}
+
+/*
+    Makes the beacon that ends a superframe - for every node, from the gateway.
+
+    @param beacon - Filled in with RFM69_FRAME_LENGTH bytes of beacon to send
+*/
+void gateway_beacon(struct Gateway* gateway, uint8_t* beacon)
+{
+    memset(beacon, 0, RFM69_FRAME_LENGTH);
+    beacon[RFM69_HEADER_DESTINATION] = RFM69_BROADCAST_ADDRESS;
+    beacon[RFM69_HEADER_SOURCE] = RFM69W_GATEWAY_ADDRESS;
+    gateway->stats.beacons_sent++;
+}
@@ -0,0 +1,54 @@
+#ifndef GATEWAY_H_
+#define GATEWAY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+   The receiving node at the other end of an RFM69_ACK link (see util/radio_power.h), at the level of whole packets -
+   it hears whatever rf_link.h lets through, drops the retransmissions it has already heard by their sequence number,
+   and answers every packet that asks for an ACK with one, duplicates included, since it's their ACK that was lost.
+
+   It's also told about the packets it didn't hear, so it can score the firmware's button events - the packets sent
+   with radio_power_transmit_acked(), each one counted once however many times it went out.  An event is delivered if
+   any of its tries got through, and the latency its retries added is from the end of its first try to the end of the
+   one that got through.  With RFM69_POWER_CONTROL, the packets the firmware asks for an ACK just to probe the link
+   count as events too.
+
+   Each ACK carries the signal strength the gateway heard the packet at (RFM69_ACK_RSSI), for RFM69_POWER_CONTROL, and
+   goes out at GATEWAY_POWER_DBM.  So do the beacons gateway_beacon() makes for RFM69_TDMA, once a superframe.
+*/
+
+/* Output power the gateway sends its ACKs at - an RFM69W at full power. */
+#define GATEWAY_POWER_DBM 13
+
+struct Gateway_Stats {
+    uint32_t packets_delivered;         // heard, without the duplicates
+    uint32_t duplicates;                // retransmissions of a packet it had already heard
+    uint32_t acks_sent;
+    uint32_t beacons_sent;
+    uint32_t events;                    // packets that asked for an ACK, however many times each was sent
+    uint32_t events_delivered;
+    uint32_t events_delivered_on_retry;
+    uint64_t added_latency_cycles;      // total over the delivered events
+    uint64_t max_added_latency_cycles;
+};
+
+struct Gateway {
+    bool have_sequence;
+    uint8_t last_sequence;              // sequence number of the last packet it heard
+
+    bool event_open;
+    uint8_t event_sequence;             // the latest event's sequence number
+    uint64_t event_first_end;           // cycle its first try's last bit went on air
+    bool event_delivered;
+
+    struct Gateway_Stats stats;
+};
+
+void gateway_init(struct Gateway* gateway);
+bool gateway_packet(struct Gateway* gateway, uint64_t end, const uint8_t* frame, uint8_t length, bool heard,
+                    int16_t rssi_dbm, uint8_t* ack);
+void gateway_beacon(struct Gateway* gateway, uint8_t* beacon);
+
+#endif /* GATEWAY_H_ */
@@ -0,0 +1,47 @@
+/*
+    Host stand-in for avr-libc's <avr/eeprom.h>.  EEMEM variables are ordinary variables, which start out holding
+    what the EEPROM image would have, and the accessors copy in and out of them - writes take no simulated time.
+*/
+#ifndef SIM_AVR_EEPROM_H_
+#define SIM_AVR_EEPROM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define EEMEM
+
+#define eeprom_is_ready() 1
+#define eeprom_busy_wait()
+
+static inline uint8_t eeprom_read_byte(const uint8_t* address)
+{
+    return *address;
+}
+
+static inline void eeprom_update_byte(uint8_t* address, uint8_t value)
+{
+    *address = value;
+}
+
+static inline uint32_t eeprom_read_dword(const uint32_t* address)
+{
+    return *address;
+}
+
+static inline void eeprom_update_dword(uint32_t* address, uint32_t value)
+{
+    *address = value;
+}
+
+static inline void eeprom_read_block(void* destination, const void* source, size_t length)
+{
+    memcpy(destination, source, length);
+}
+
+static inline void eeprom_update_block(const void* source, void* destination, size_t length)
+{
+    memcpy(destination, source, length);
+}
+
+#endif /* SIM_AVR_EEPROM_H_ */
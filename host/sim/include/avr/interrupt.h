@@ -0,0 +1,22 @@
+/*
+    Host stand-in for avr-libc's <avr/interrupt.h>.  ISRs become ordinary functions named after their vector, which
+    the simulator in avr_sim.c calls when the matching peripheral event fires and interrupts are enabled.
+*/
+#ifndef SIM_AVR_INTERRUPT_H_
+#define SIM_AVR_INTERRUPT_H_
+
+#include <avr/io.h>
+
+void sim_sei(void);
+void sim_cli(void);
+
+#define sei() sim_sei()
+#define cli() sim_cli()
+
+#define ISR(vector, ...) void vector(void) __VA_ARGS__
+#define ISR_ALIASOF(target) __attribute__((alias(#target)))
+#define ISR_BLOCK
+#define ISR_NOBLOCK
+#define ISR_NAKED
+
+#endif /* SIM_AVR_INTERRUPT_H_ */
@@ -0,0 +1,337 @@
+/*
+    Host stand-in for avr-libc's <avr/io.h>, used by the simulator in host/sim to build the firmware on a PC.
+
+    Every ATmega328P I/O register the firmware touches is a plain global, defined in avr_sim.c.  The few registers
+    where reading or writing has a side effect on real hardware (UDR0, TCNT2) go through a function so the simulator
+    can see the access happen.  Only the registers and bit names this project uses (plus their obvious neighbours)
+    are provided - add more here as the firmware grows.
+*/
+#ifndef SIM_AVR_IO_H_
+#define SIM_AVR_IO_H_
+
+#include <stdint.h>
+
+/* 8-bit I/O registers. */
+extern volatile uint8_t PINB;
+extern volatile uint8_t DDRB;
+extern volatile uint8_t PORTB;
+extern volatile uint8_t PINC;
+extern volatile uint8_t DDRC;
+extern volatile uint8_t PORTC;
+extern volatile uint8_t PIND;
+extern volatile uint8_t DDRD;
+extern volatile uint8_t PORTD;
+extern volatile uint8_t TIFR0;
+extern volatile uint8_t TIFR1;
+extern volatile uint8_t TIFR2;
+extern volatile uint8_t PCIFR;
+extern volatile uint8_t EIFR;
+extern volatile uint8_t EIMSK;
+extern volatile uint8_t GPIOR0;
+extern volatile uint8_t EECR;
+extern volatile uint8_t EEDR;
+extern volatile uint8_t EEARL;
+extern volatile uint8_t EEARH;
+extern volatile uint8_t GTCCR;
+extern volatile uint8_t TCCR0A;
+extern volatile uint8_t TCCR0B;
+extern volatile uint8_t TCNT0;
+extern volatile uint8_t OCR0A;
+extern volatile uint8_t OCR0B;
+extern volatile uint8_t GPIOR1;
+extern volatile uint8_t GPIOR2;
+extern volatile uint8_t SPCR;
+extern volatile uint8_t SPSR;
+extern volatile uint8_t SPDR;
+extern volatile uint8_t ACSR;
+extern volatile uint8_t SMCR;
+extern volatile uint8_t MCUSR;
+extern volatile uint8_t MCUCR;
+extern volatile uint8_t SPMCSR;
+extern volatile uint8_t WDTCSR;
+extern volatile uint8_t CLKPR;
+extern volatile uint8_t PRR;
+extern volatile uint8_t OSCCAL;
+extern volatile uint8_t PCICR;
+extern volatile uint8_t EICRA;
+extern volatile uint8_t PCMSK0;
+extern volatile uint8_t PCMSK1;
+extern volatile uint8_t PCMSK2;
+extern volatile uint8_t TIMSK0;
+extern volatile uint8_t TIMSK1;
+extern volatile uint8_t TIMSK2;
+extern volatile uint8_t ADCSRA;
+extern volatile uint8_t ADCSRB;
+extern volatile uint8_t ADMUX;
+extern volatile uint8_t DIDR0;
+extern volatile uint8_t DIDR1;
+extern volatile uint8_t TCCR1A;
+extern volatile uint8_t TCCR1B;
+extern volatile uint8_t TCCR1C;
+extern volatile uint8_t TCCR2A;
+extern volatile uint8_t TCCR2B;
+extern volatile uint8_t OCR2A;
+extern volatile uint8_t OCR2B;
+extern volatile uint8_t ASSR;
+extern volatile uint8_t TWBR;
+extern volatile uint8_t TWSR;
+extern volatile uint8_t TWAR;
+extern volatile uint8_t TWDR;
+extern volatile uint8_t TWCR;
+extern volatile uint8_t TWAMR;
+extern volatile uint8_t UCSR0A;
+extern volatile uint8_t UCSR0B;
+extern volatile uint8_t UCSR0C;
+extern volatile uint8_t UBRR0L;
+extern volatile uint8_t UBRR0H;
+extern volatile uint8_t SREG;
+
+/* 16-bit I/O registers. */
+extern volatile uint16_t ADC;
+#define ADCW ADC
+extern volatile uint16_t EEAR;
+extern volatile uint16_t OCR1A;
+extern volatile uint16_t OCR1B;
+extern volatile uint16_t ICR1;
+
+/* Registers whose accesses the simulator needs to observe. */
+volatile uint8_t* sim_usart_data_register(void);
+volatile uint16_t* sim_timer1_counter_register(void);
+volatile uint8_t* sim_timer2_counter_register(void);
+#define UDR0 (*sim_usart_data_register())
+#define TCNT1 (*sim_timer1_counter_register())
+#define TCNT2 (*sim_timer2_counter_register())
+
+/* Status register - only the global interrupt flag means anything to the simulator. */
+#define SREG_I 7
+
+/* Port pin bits. */
+#define PINB0 0
+#define DDB0 0
+#define PORTB0 0
+#define PINB1 1
+#define DDB1 1
+#define PORTB1 1
+#define PINB2 2
+#define DDB2 2
+#define PORTB2 2
+#define PINB3 3
+#define DDB3 3
+#define PORTB3 3
+#define PINB4 4
+#define DDB4 4
+#define PORTB4 4
+#define PINB5 5
+#define DDB5 5
+#define PORTB5 5
+#define PINB6 6
+#define DDB6 6
+#define PORTB6 6
+#define PINB7 7
+#define DDB7 7
+#define PORTB7 7
+#define PINC0 0
+#define DDC0 0
+#define PORTC0 0
+#define PINC1 1
+#define DDC1 1
+#define PORTC1 1
+#define PINC2 2
+#define DDC2 2
+#define PORTC2 2
+#define PINC3 3
+#define DDC3 3
+#define PORTC3 3
+#define PINC4 4
+#define DDC4 4
+#define PORTC4 4
+#define PINC5 5
+#define DDC5 5
+#define PORTC5 5
+#define PINC6 6
+#define DDC6 6
+#define PORTC6 6
+#define PIND0 0
+#define DDD0 0
+#define PORTD0 0
+#define PIND1 1
+#define DDD1 1
+#define PORTD1 1
+#define PIND2 2
+#define DDD2 2
+#define PORTD2 2
+#define PIND3 3
+#define DDD3 3
+#define PORTD3 3
+#define PIND4 4
+#define DDD4 4
+#define PORTD4 4
+#define PIND5 5
+#define DDD5 5
+#define PORTD5 5
+#define PIND6 6
+#define DDD6 6
+#define PORTD6 6
+#define PIND7 7
+#define DDD7 7
+#define PORTD7 7
+
+/* Pin change interrupts. */
+#define PCIE0 0
+#define PCIE1 1
+#define PCIE2 2
+#define PCIF0 0
+#define PCIF1 1
+#define PCIF2 2
+#define PCINT0 0
+#define PCINT1 1
+#define PCINT2 2
+#define PCINT3 3
+#define PCINT4 4
+#define PCINT5 5
+#define PCINT6 6
+#define PCINT7 7
+#define PCINT8 0
+#define PCINT9 1
+#define PCINT10 2
+#define PCINT11 3
+#define PCINT12 4
+#define PCINT13 5
+#define PCINT14 6
+#define PCINT16 0
+#define PCINT17 1
+#define PCINT18 2
+#define PCINT19 3
+#define PCINT20 4
+#define PCINT21 5
+#define PCINT22 6
+#define PCINT23 7
+
+/* External interrupts. */
+#define ISC00 0
+#define ISC01 1
+#define ISC10 2
+#define ISC11 3
+#define INT0 0
+#define INT1 1
+#define INTF0 0
+#define INTF1 1
+
+/* Timer1 - the simulator only models it counting up in normal mode, off the I/O clock. */
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define TOIE1 0
+#define TOV1 0
+
+/* Timer2. */
+#define WGM20 0
+#define WGM21 1
+#define COM2B0 4
+#define COM2B1 5
+#define COM2A0 6
+#define COM2A1 7
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define WGM22 3
+#define FOC2B 6
+#define FOC2A 7
+#define TOIE2 0
+#define OCIE2A 1
+#define OCIE2B 2
+#define TOV2 0
+#define OCF2A 1
+#define OCF2B 2
+#define TCR2BUB 0
+#define TCR2AUB 1
+#define OCR2BUB 2
+#define OCR2AUB 3
+#define TCN2UB 4
+#define AS2 5
+#define EXCLK 6
+#define PSRSYNC 0
+#define PSRASY 1
+#define TSM 7
+
+/* ADC. */
+#define MUX0 0
+#define MUX1 1
+#define MUX2 2
+#define MUX3 3
+#define ADLAR 5
+#define REFS0 6
+#define REFS1 7
+#define ADPS0 0
+#define ADPS1 1
+#define ADPS2 2
+#define ADIE 3
+#define ADIF 4
+#define ADATE 5
+#define ADSC 6
+#define ADEN 7
+
+/* USART0. */
+#define MPCM0 0
+#define U2X0 1
+#define UPE0 2
+#define DOR0 3
+#define FE0 4
+#define UDRE0 5
+#define TXC0 6
+#define RXC0 7
+#define TXB80 0
+#define RXB80 1
+#define UCSZ02 2
+#define TXEN0 3
+#define RXEN0 4
+#define UDRIE0 5
+#define TXCIE0 6
+#define RXCIE0 7
+#define UCPOL0 0
+#define UCSZ00 1
+#define UCSZ01 2
+#define USBS0 3
+#define UPM00 4
+#define UPM01 5
+#define UMSEL00 6
+#define UMSEL01 7
+
+/* SPI. */
+#define SPR0 0
+#define SPR1 1
+#define CPHA 2
+#define CPOL 3
+#define MSTR 4
+#define DORD 5
+#define SPE 6
+#define SPIE 7
+#define SPI2X 0
+#define WCOL 6
+#define SPIF 7
+
+/* Sleep mode and power reduction. */
+#define SE 0
+#define SM0 1
+#define SM1 2
+#define SM2 3
+#define PRADC 0
+#define PRUSART0 1
+#define PRSPI 2
+#define PRTIM1 3
+#define PRTIM0 5
+#define PRTIM2 6
+#define PRTWI 7
+
+/* EEPROM. */
+#define EERE 0
+#define EEPE 1
+#define EEMPE 2
+#define EERIE 3
+#define EEPM0 4
+#define EEPM1 5
+
+#define RAMEND 0x08FF
+#define E2END 0x03FF
+
+#endif /* SIM_AVR_IO_H_ */
@@ -0,0 +1,40 @@
+/*
+    Host stand-in for avr-libc's <avr/power.h>.  The simulator honours the PRR bits, so a powered down peripheral
+    stops producing events until it is powered back up.
+*/
+#ifndef SIM_AVR_POWER_H_
+#define SIM_AVR_POWER_H_
+
+#include <avr/io.h>
+
+#define power_adc_enable() (PRR &= (uint8_t) ~(1 << PRADC))
+#define power_adc_disable() (PRR |= (uint8_t) (1 << PRADC))
+#define power_usart0_enable() (PRR &= (uint8_t) ~(1 << PRUSART0))
+#define power_usart0_disable() (PRR |= (uint8_t) (1 << PRUSART0))
+#define power_spi_enable() (PRR &= (uint8_t) ~(1 << PRSPI))
+#define power_spi_disable() (PRR |= (uint8_t) (1 << PRSPI))
+#define power_timer0_enable() (PRR &= (uint8_t) ~(1 << PRTIM0))
+#define power_timer0_disable() (PRR |= (uint8_t) (1 << PRTIM0))
+#define power_timer1_enable() (PRR &= (uint8_t) ~(1 << PRTIM1))
+#define power_timer1_disable() (PRR |= (uint8_t) (1 << PRTIM1))
+#define power_timer2_enable() (PRR &= (uint8_t) ~(1 << PRTIM2))
+#define power_timer2_disable() (PRR |= (uint8_t) (1 << PRTIM2))
+#define power_twi_enable() (PRR &= (uint8_t) ~(1 << PRTWI))
+#define power_twi_disable() (PRR |= (uint8_t) (1 << PRTWI))
+
+typedef enum {
+    clock_div_1 = 0,
+    clock_div_2 = 1,
+    clock_div_4 = 2,
+    clock_div_8 = 3,
+    clock_div_16 = 4,
+    clock_div_32 = 5,
+    clock_div_64 = 6,
+    clock_div_128 = 7,
+    clock_div_256 = 8
+} clock_div_t;
+
+/* The simulator runs at whatever F_CPU the firmware was built for, so the divider is only recorded in CLKPR. */
+#define clock_prescale_set(div) (CLKPR = (uint8_t) (div))
+
+#endif /* SIM_AVR_POWER_H_ */
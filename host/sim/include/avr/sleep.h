@@ -0,0 +1,30 @@
+/*
+    Host stand-in for avr-libc's <avr/sleep.h>.  Executing SLEEP hands control to the simulator, which runs the
+    peripherals that are still clocked in the selected sleep mode until one of them raises a wake-up interrupt.
+*/
+#ifndef SIM_AVR_SLEEP_H_
+#define SIM_AVR_SLEEP_H_
+
+#include <avr/io.h>
+
+#define SLEEP_MODE_IDLE (0)
+#define SLEEP_MODE_ADC (1 << SM0)
+#define SLEEP_MODE_PWR_DOWN (1 << SM1)
+#define SLEEP_MODE_PWR_SAVE ((1 << SM0) | (1 << SM1))
+#define SLEEP_MODE_STANDBY ((1 << SM1) | (1 << SM2))
+#define SLEEP_MODE_EXT_STANDBY ((1 << SM0) | (1 << SM1) | (1 << SM2))
+
+void sim_sleep_cpu(void);
+
+#define set_sleep_mode(mode) (SMCR = (SMCR & ~((1 << SM0) | (1 << SM1) | (1 << SM2))) | (mode))
+#define sleep_enable() (SMCR |= (1 << SE))
+#define sleep_disable() (SMCR &= ~(1 << SE))
+#define sleep_cpu() sim_sleep_cpu()
+#define sleep_mode() \
+    do { \
+        sleep_enable(); \
+        sleep_cpu(); \
+        sleep_disable(); \
+    } while(0)
+
+#endif /* SIM_AVR_SLEEP_H_ */
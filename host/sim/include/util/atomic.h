@@ -0,0 +1,31 @@
+/*
+    Host stand-in for avr-libc's <util/atomic.h>, built on the simulated SREG the same way the real one is.
+*/
+#ifndef SIM_UTIL_ATOMIC_H_
+#define SIM_UTIL_ATOMIC_H_
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+static inline uint8_t sim_atomic_cli(void)
+{
+    cli();
+    return 1;
+}
+
+static inline void sim_atomic_restore(const uint8_t* sreg_save)
+{
+    SREG = *sreg_save;
+}
+
+static inline void sim_atomic_force_on(const uint8_t* unused)
+{
+    (void) unused;
+    sei();
+}
+
+#define ATOMIC_BLOCK(type) for(type, sim_atomic_todo = sim_atomic_cli(); sim_atomic_todo; sim_atomic_todo = 0)
+#define ATOMIC_RESTORESTATE uint8_t sreg_save __attribute__((__cleanup__(sim_atomic_restore))) = SREG
+#define ATOMIC_FORCEON uint8_t sreg_save __attribute__((__cleanup__(sim_atomic_force_on))) = 0
+
+#endif /* SIM_UTIL_ATOMIC_H_ */
@@ -0,0 +1,11 @@
+/*
+    Host stand-in for avr-libc's <util/delay.h>.  Firmware code runs in zero simulated time, so busy waits don't
+    take any - and the only thing the firmware waits out with them, the 32.768kHz crystal starting up, isn't modeled.
+*/
+#ifndef SIM_UTIL_DELAY_H_
+#define SIM_UTIL_DELAY_H_
+
+#define _delay_ms(ms) ((void) (ms))
+#define _delay_us(us) ((void) (us))
+
+#endif /* SIM_UTIL_DELAY_H_ */
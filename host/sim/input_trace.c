@@ -0,0 +1,66 @@
+#include "input_trace.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+#define INPUT_TRACE_MAX_LINE 256
+
+/*
+    Reads the next snapshot from a trace, skipping comments and blank lines.
+
+    @param file - The trace to read from
+    @param event - Where to store the snapshot
+    @param line_number - Running line count, used for error messages.  Start it at 0.
+    @return Input_Trace_Status - INPUT_TRACE_END at the end of the file, INPUT_TRACE_ERROR on a malformed line, INPUT_TRACE_OK otherwise
+*/
+enum Input_Trace_Status input_trace_read_event(FILE* file, struct Input_Trace_Event* event, unsigned* line_number)
+{
+    char line[INPUT_TRACE_MAX_LINE];
+
+    while(fgets(line, sizeof(line), file) != NULL) {
+        (*line_number)++;
+
+        char* comment = strchr(line, '#');
+        if(comment != NULL) {
+            *comment = '\0';
+        }
+        if(strspn(line, " \t\r\n") == strlen(line)) {
+            continue;
+        }
+
+        unsigned pinb, pinc, pind;
+        unsigned adc[INPUT_TRACE_NUM_ADC_CHANNELS];
+        int fields = sscanf(line, "%" SCNu64 " %x %x %x %u %u %u %u %u %u", &event->time_us, &pinb, &pinc, &pind,
+                            &adc[0], &adc[1], &adc[2], &adc[3], &adc[4], &adc[5]);
+        if(fields != 4 + INPUT_TRACE_NUM_ADC_CHANNELS || pinb > 0xFF || pinc > 0xFF || pind > 0xFF) {
+            return INPUT_TRACE_ERROR;
+        }
+
+        event->pinb = pinb;
+        event->pinc = pinc;
+        event->pind = pind;
+        for(uint8_t i = 0; i < INPUT_TRACE_NUM_ADC_CHANNELS; i++) {
+            if(adc[i] > 0x3FF) {
+                return INPUT_TRACE_ERROR;
+            }
+            event->adc[i] = adc[i];
+        }
+        return INPUT_TRACE_OK;
+    }
+
+    return INPUT_TRACE_END;
+}
+
+void input_trace_write_header(FILE* file)
+{
+    fprintf(file, "# time_us  PINB  PINC  PIND  ADC0 ADC1 ADC2 ADC3 ADC4 ADC5\n");
+}
+
+void input_trace_write_event(FILE* file, const struct Input_Trace_Event* event)
+{
+    fprintf(file, "%-10" PRIu64 " 0x%02x  0x%02x  0x%02x ", event->time_us, event->pinb, event->pinc, event->pind);
+    for(uint8_t i = 0; i < INPUT_TRACE_NUM_ADC_CHANNELS; i++) {
+        fprintf(file, " %-4u", event->adc[i]);
+    }
+    fprintf(file, "\n");
+}
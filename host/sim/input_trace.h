@@ -0,0 +1,38 @@
+#ifndef INPUT_TRACE_H_
+#define INPUT_TRACE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+   Input traces capture what the buttons and analog stick did, as a series of timestamped snapshots of the three
+   pin registers and the six ADC inputs.  Each snapshot holds from its timestamp until the next one.  Traces are plain
+   text, one snapshot per line, so they can be written by hand, exported from a logic analyzer, or diffed:
+
+       # time_us  PINB  PINC  PIND  ADC0 ADC1 ADC2 ADC3 ADC4 ADC5
+       0          0x07  0x3c  0xec  512  512  0    0    0    0
+
+   Blank lines and anything after a '#' are ignored.  Timestamps must not go backwards.
+*/
+
+#define INPUT_TRACE_NUM_ADC_CHANNELS 6
+
+struct Input_Trace_Event {
+    uint64_t time_us;
+    uint8_t pinb;
+    uint8_t pinc;
+    uint8_t pind;
+    uint16_t adc[INPUT_TRACE_NUM_ADC_CHANNELS];
+};
+
+enum Input_Trace_Status {
+    INPUT_TRACE_OK,
+    INPUT_TRACE_END,
+    INPUT_TRACE_ERROR
+};
+
+enum Input_Trace_Status input_trace_read_event(FILE* file, struct Input_Trace_Event* event, unsigned* line_number);
+void input_trace_write_header(FILE* file);
+void input_trace_write_event(FILE* file, const struct Input_Trace_Event* event);
+
+#endif /* INPUT_TRACE_H_ */
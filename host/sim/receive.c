@@ -0,0 +1,341 @@
+/*
+    Plays an air capture (see air_capture.h) - replay's -c, or one written by hand - to the firmware's receive pipeline
+    (lib/rfm69/rfm69_rx.h), built for the host against the emulated RFM69 in rfm69_emu.c, and checks that every packet
+    comes out of the pool just as it went on air, at the signal strength it was heard at.  The summary shows how many
+    the radio heard, how many the pool dropped, and how long each one waited from its last bit on air to the main loop
+    taking it.  Together with replay, that's both ends of the link running the firmware's own code.
+
+    S=../../src
+    cc -O2 -Iinclude -DRFM69_RECEIVER -o receive receive.c avr_sim.c rfm69_emu.c air_capture.c $S/util/power.c \
+        $S/util/scheduler.c $S/util/timeout.c $S/lib/rfm69/rfm69.c $S/lib/rfm69/rfm69_rx.c \
+        $S/lib/rfm69/rfm69_profile.c $S/lib/rfm69/rfm69_power.c -lm
+    ./receive [-g gap_us] [-d work_us] air.txt
+
+    Build it with the flags replay was built with, but -DRFM69_RECEIVER in place of -DRFM69_LINK - the ones that set
+    the packet format, like -DRFM69_MESSAGES and -DRFM69_ACK, have to match for the packets to be heard at all.  The
+    receiver sits on RFM69W_CHANNEL, so with -DRFM69_HOPPING it only hears the packets sent there.
+    Add $S/util/radio_key.c as well with -DRFM69_AES, to set the radio's key from the EEPROM, and with
+    -DRFM69_FRESHNESS $S/lib/rfm69/rfm69_freshness.c, to have the main loop check each packet's counter and MAC as a
+    gateway would - the summary then shows how many it turned away.
+    -g plays the packets back to back rather than when they were captured, each starting that many microseconds after
+    the one before ended, and -d keeps the main loop busy for that long with each packet it takes, with the ISR still
+    free to fill the pool - together they show how far the pool stretches when the main loop falls behind.
+*/
+#include "air_capture.h"
+#include "avr_sim.h"
+#include "rfm69_emu.h"
+#include "../../src/avr_config.h"
+#include "../../src/lib/rfm69/rfm69.h"
+#include "../../src/lib/rfm69/rfm69_rx.h"
+#include "../../src/util/power.h"
+#include "../../src/util/radio_key.h"
+#include "../../src/util/scheduler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <avr/interrupt.h>
+
+#define CYCLES_TO_US(cycles) ((cycles) * 1000000 / F_CPU)
+#define US_TO_CYCLES(us) ((us) * F_CPU / 1000000)
+
+/* How long the radio gets to start listening before the first packet, if the capture starts sooner. */
+#define START_UP_US 2000
+
+/* Shortest -g - long enough for the radio to decrypt a packet with RFM69_AES before the next one starts. */
+#define MIN_GAP_US 100
+
+/* Packets heard but not yet taken - room for the pool's worth and the one on its way in, rounded up to a power of
+   two so the indices wrap cleanly. */
+#define EXPECTED_PACKETS (2 * RFM69_RX_POOL_PACKETS)
+
+#define USAGE "usage: %s [-g gap_us] [-d work_us] air.txt\n"
+
+struct Receive {
+    FILE* capture;
+    unsigned line_number;
+    bool capture_error;
+
+    /* The next packet to go on air, and when - SIM_NEVER once the capture's run out.  Capture cycles are moved on by
+       offset_cycles, so the radio's listening in time for the first one. */
+    struct Air_Capture_Packet next;
+    uint64_t next_start;
+    uint64_t offset_cycles;
+    uint64_t gap_cycles;        // with -g, from the end of one packet to the start of the next - otherwise 0
+    uint64_t last_end;
+
+    /* The packet last sent to the radio, until it's known what became of it, and the counts it's checked against. */
+    bool pending;
+    struct Air_Capture_Packet sent;
+    uint32_t sent_received;
+    uint32_t sent_dropped;
+    uint32_t sent_missed;
+
+    /* Packets the ISR put in the pool, in order, for checking against what the main loop takes. */
+    struct Air_Capture_Packet expected[EXPECTED_PACKETS];
+    uint8_t expected_head;
+    uint8_t expected_tail;
+
+    /* With -d, how long the main loop spends on each packet, and when it's done with the one it's on - SIM_NEVER while
+       it isn't on one. */
+    uint64_t work_cycles;
+    uint64_t busy_until;
+
+    uint32_t packets_sent;
+    uint32_t packets_taken;
+    uint32_t corrupted;         // bytes or RSSI not as they went on air
+    uint64_t latency_total_cycles;
+    uint64_t latency_max_cycles;
+
+#ifdef RFM69_FRESHNESS
+    struct Rfm69_Freshness_Key mac_key;
+    struct Rfm69_Freshness_Window freshness;
+#endif
+};
+
+static struct Receive receive;
+
+/* Works out what became of the packet last sent to the radio, if it's known yet - put in the pool, dropped from it,
+   or never heard. */
+static void settle(struct Receive* state)
+{
+    if(!state->pending) {
+        return;
+    }
+
+    const struct Rfm69_Emu_Stats* emu = rfm69_emu_stats();
+    if(rfm69_rx_stats.received != state->sent_received) {
+        state->expected[state->expected_head++ % EXPECTED_PACKETS] = state->sent;
+    } else if(rfm69_rx_stats.dropped == state->sent_dropped && emu->packets_missed == state->sent_missed) {
+        return;
+    }
+    state->pending = false;
+}
+
+static void read_next(struct Receive* state)
+{
+    enum Air_Capture_Status status = air_capture_read_packet(state->capture, &state->next, &state->line_number);
+    if(status != AIR_CAPTURE_OK) {
+        state->capture_error = (status == AIR_CAPTURE_ERROR);
+        state->next_start = SIM_NEVER;
+        return;
+    }
+
+    uint64_t length = state->next.end_cycle - state->next.start_cycle;
+    if(state->gap_cycles > 0 && state->packets_sent > 0) {
+        state->next.start_cycle = state->last_end + state->gap_cycles;
+    } else {
+        state->next.start_cycle += state->offset_cycles;
+    }
+    state->next.end_cycle = state->next.start_cycle + length;
+    if(state->packets_sent > 0 && state->next.start_cycle < state->last_end) {
+        state->capture_error = true;
+        state->next_start = SIM_NEVER;
+        return;
+    }
+    state->next_start = state->next.start_cycle;
+}
+
+static void set_alarm(struct Receive* state);
+
+/* Sim alarm - sends the capture's next packet to the radio as its first bit arrives, or finishes the main loop's work
+   on the packet it's taken, whichever's due. */
+static void radio_alarm(void* context, uint64_t cycle)
+{
+    struct Receive* state = context;
+
+    if(cycle >= state->busy_until) {
+        state->busy_until = SIM_NEVER;
+        rfm69_rx_release(rfm69_rx_take());
+    }
+    if(cycle >= state->next_start) {
+        // One that's still not settled by the time the next starts never will be - the radio can't have heard it.
+        settle(state);
+
+        const struct Rfm69_Emu_Stats* emu = rfm69_emu_stats();
+        state->sent = state->next;
+        state->sent_received = rfm69_rx_stats.received;
+        state->sent_dropped = rfm69_rx_stats.dropped;
+        state->sent_missed = emu->packets_missed;
+        state->pending = true;
+        state->packets_sent++;
+        state->last_end = state->next.end_cycle;
+        rfm69_emu_receive(state->next.start_cycle, state->next.end_cycle, state->next.frf, state->next.bytes,
+                          state->next.length, state->next.rssi_dbm);
+        read_next(state);
+    }
+    set_alarm(state);
+}
+
+static void set_alarm(struct Receive* state)
+{
+    uint64_t next = (state->busy_until < state->next_start ? state->busy_until : state->next_start);
+    if(next != SIM_NEVER) {
+        sim_set_alarm(next, radio_alarm, state);
+    }
+}
+
+/* Checks a packet the main loop's taken against the one the ISR should have put in the pool. */
+static void check_packet(struct Receive* state, const struct Rfm69_Rx_Packet* packet)
+{
+    settle(state);
+    if(state->expected_tail == state->expected_head) {
+        state->corrupted++;
+        return;
+    }
+    const struct Air_Capture_Packet* expected = &state->expected[state->expected_tail++ % EXPECTED_PACKETS];
+
+    int16_t rssi = -2 * expected->rssi_dbm;
+    uint8_t rssi_value = (uint8_t) (rssi < 0 ? 0 : rssi > 0xFF ? 0xFF : rssi);
+    if(packet->length != expected->length || memcmp(packet->data, expected->bytes, packet->length) != 0 ||
+       packet->rssi != rssi_value) {
+        state->corrupted++;
+    }
+
+    uint64_t latency = sim_cycles() - expected->end_cycle;
+    state->latency_total_cycles += latency;
+    if(latency > state->latency_max_cycles) {
+        state->latency_max_cycles = latency;
+    }
+    state->packets_taken++;
+
+#ifdef RFM69_FRESHNESS
+    // The gateway's check - on the packet where it sits in the pool.
+    rfm69_freshness_check(&state->freshness, &state->mac_key, packet->data, packet->length);
+#endif
+}
+
+/* The receiver's main loop - takes each packet the ISR's pooled, and sleeps once there are none left. */
+static void receiver_poll(void)
+{
+    scheduler_run_ready();
+
+    if(receive.busy_until != SIM_NEVER) {
+        // Still working on the last packet - the main loop would be spinning, not sleeping.
+        return;
+    }
+
+    const struct Rfm69_Rx_Packet* packet;
+    while((packet = rfm69_rx_take()) != NULL) {
+        check_packet(&receive, packet);
+        if(receive.work_cycles > 0) {
+            receive.busy_until = sim_cycles() + receive.work_cycles;
+            set_alarm(&receive);
+            return;
+        }
+        rfm69_rx_release(packet);
+    }
+
+    scheduler_idle();
+}
+
+static void receiver_init(void)
+{
+    power_init();
+    scheduler_init();
+    rfm69_init(RFM69_CHANNEL_FRF(RFM69W_BASE_FREQUENCY_HZ, RFM69W_CHANNEL_SPACING_HZ, RFM69W_CHANNEL),
+               RFM69W_NETWORK_ID);
+#ifdef RFM69_AES
+    uint8_t key[RFM69_AES_KEY_LENGTH];
+    if(radio_key_load(key)) {
+        rfm69_set_encryption(key);
+    }
+#endif
+#ifdef RFM69_FRESHNESS
+    uint8_t mac_key[RFM69_FRESHNESS_KEY_LENGTH];
+    if(radio_key_load_mac(mac_key)) {
+        rfm69_freshness_key_init(&receive.mac_key, mac_key);
+    }
+    rfm69_freshness_window_init(&receive.freshness);
+#endif
+    rfm69_rx_start();
+    sei();
+}
+
+static void print_summary(const struct Receive* state)
+{
+    const struct Rfm69_Emu_Stats* emu = rfm69_emu_stats();
+
+    printf("simulated time:      %.3f s\n", sim_cycles() / (double) F_CPU);
+    printf("packets on air:      %u\n", state->packets_sent);
+    printf("heard by the radio:  %u (%u missed - another channel, filtered out, or the FIFO still full)\n",
+           emu->packets_received, state->packets_sent - emu->packets_received);
+    printf("put in the pool:     %u\n", rfm69_rx_stats.received);
+    printf("dropped, pool full:  %u\n", rfm69_rx_stats.dropped);
+    printf("most in the pool:    %u of %u\n", rfm69_rx_stats.max_queued, RFM69_RX_POOL_PACKETS);
+    printf("taken by main loop:  %u (%u not as they went on air)\n", state->packets_taken, state->corrupted);
+    if(emu->packets_received > 0) {
+        printf("spi per packet:      %.1f bytes, %.0f us\n", emu->spi_bytes / (double) emu->packets_received,
+               CYCLES_TO_US(emu->spi_bytes * (double) RFM69_EMU_SPI_BYTE_CYCLES) / emu->packets_received);
+    }
+    if(state->packets_taken > 0) {
+        printf("air to main loop:    avg %.0f us, max %.0f us\n",
+               CYCLES_TO_US((double) state->latency_total_cycles) / state->packets_taken,
+               CYCLES_TO_US((double) state->latency_max_cycles));
+    }
+#ifdef RFM69_FRESHNESS
+    const struct Rfm69_Freshness_Stats* freshness = &state->freshness.stats;
+    printf("freshness:           %u fresh, %u repeated, %u replayed, %u forged\n", freshness->fresh,
+           freshness->repeated, freshness->replayed, freshness->forged);
+#endif
+}
+
+int main(int argc, char** argv)
+{
+    unsigned gap_us = 0;
+    unsigned work_us = 0;
+    int option;
+
+    while((option = getopt(argc, argv, "g:d:")) != -1) {
+        switch(option) {
+            case 'g':
+                gap_us = (unsigned) strtoul(optarg, NULL, 10);
+                break;
+            case 'd':
+                work_us = (unsigned) strtoul(optarg, NULL, 10);
+                break;
+            default:
+                fprintf(stderr, USAGE, argv[0]);
+                return 1;
+        }
+    }
+    if(optind >= argc || (receive.capture = fopen(argv[optind], "r")) == NULL ||
+       (gap_us != 0 && gap_us < MIN_GAP_US)) {
+        fprintf(stderr, USAGE, argv[0]);
+        return 1;
+    }
+    receive.gap_cycles = US_TO_CYCLES((uint64_t) gap_us);
+    receive.work_cycles = US_TO_CYCLES((uint64_t) work_us);
+    receive.busy_until = SIM_NEVER;
+
+    sim_reset();
+    sim_set_cpu_hz(F_CPU);
+    rfm69_emu_reset();
+    sim_set_main_loop(receiver_poll);
+    receiver_init();
+
+    uint64_t listening = sim_cycles() + US_TO_CYCLES((uint64_t) START_UP_US);
+    read_next(&receive);
+    if(receive.next_start != SIM_NEVER && receive.next_start < listening) {
+        receive.offset_cycles = listening - receive.next_start;
+        receive.next.start_cycle += receive.offset_cycles;
+        receive.next.end_cycle += receive.offset_cycles;
+        receive.next_start = receive.next.start_cycle;
+    }
+    set_alarm(&receive);
+
+    // Run until the last packet's been taken and dealt with.
+    while(!sim_finished() && (receive.next_start != SIM_NEVER || receive.busy_until != SIM_NEVER)) {
+        sim_run_until(sim_cycles() + F_CPU / 10);
+    }
+    sim_run_until(sim_cycles() + F_CPU / 10);
+
+    if(receive.capture_error) {
+        fprintf(stderr, "%s:%u: malformed or overlapping packet\n", argv[optind], receive.line_number);
+    }
+    print_summary(&receive);
+
+    fclose(receive.capture);
+    return receive.capture_error ? 1 : 0;
+}
@@ -0,0 +1,273 @@
+/*
+    Records an input trace (see input_trace.h) from a transmitter's packets, so that what a real device's buttons and
+    stick did can be replayed through the firmware on a host.  Every packet carries all 11 buttons and both 10-bit
+    stick values, so each packet that changes any of them becomes a snapshot, with the pins set the way avr_config.h
+    wires the buttons and the stick on the ADC channels it names.
+
+    cc -O2 -Iinclude -o record record.c input_trace.c ../decoder/packet_decoder.c
+    ./record [-o trace.txt] [-t bytes.csv | byte_stream]
+
+    The byte stream is read live - a serial device, like the 433MHz receiver on /dev/ttyUSB0 (set to raw at
+    BAUD_RATE), a pipe, or stdin if none is given - and each packet is timestamped as it comes in, counting from the
+    first byte.  -t reads a capture that has its timestamps already, in the cycle,time_us,byte columns replay -t writes.
+    Recording ends with the stream, or on SIGINT.
+
+    A packet goes out a while after the inputs in it were sampled, so the trace runs behind the real inputs by about a
+    packet period plus the packet's time on air, and anything shorter than a packet period can go missing between
+    packets.  Everything not pressed reads high from transmitter.c's pull-ups - but for the analog stick button, which
+    drives its pin high when pressed.
+*/
+#include "input_trace.h"
+#include "../decoder/packet_decoder.h"
+#include "../../src/avr_config.h"
+#include "../../src/util/avr_usart.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define READ_CHUNK 256
+#define MAX_LINE 128
+
+/* The ADC reading of a stick at rest, before the first packet says otherwise. */
+#define STICK_CENTRE 512
+
+/* The pin registers avr_config.h names the buttons by - record fills them in itself rather than linking avr_sim.c. */
+volatile uint8_t PINB;
+volatile uint8_t PINC;
+volatile uint8_t PIND;
+
+/* What the pins read with nothing pressed - the pull-ups transmitter.c turns on. */
+#define IDLE_PINB ((1 << PINB0) | (1 << PINB1) | (1 << PINB2))
+#define IDLE_PINC ((1 << PINC2) | (1 << PINC3) | (1 << PINC4) | (1 << PINC5))
+#define IDLE_PIND ((1 << PIND2) | (1 << PIND3) | (1 << PIND5) | (1 << PIND6) | (1 << PIND7))
+
+static volatile sig_atomic_t stopping = 0;
+
+static void stop(int signal)
+{
+    (void) signal;
+    stopping = 1;
+}
+
+static uint64_t now_us(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000u + (uint64_t) now.tv_nsec / 1000u;
+}
+
+static void set_pin(volatile uint8_t* pin_reg, uint8_t pin, bool high)
+{
+    if(high) {
+        *pin_reg |= (1 << pin);
+    } else {
+        *pin_reg &= ~(1 << pin);
+    }
+}
+
+/*
+    Works out what the pins and ADC inputs were from a packet - the reverse of ISR(TIMER2_OVF_vect) and
+    ISR(ADC_vect) in transmitter.c.
+*/
+static void packet_to_inputs(const struct Decoded_Packet* packet, struct Input_Trace_Event* event)
+{
+    PINB = IDLE_PINB;
+    PINC = IDLE_PINC;
+    PIND = IDLE_PIND;
+
+    set_pin(&ANALOG_STICK_BTN_PIN_REG, ANALOG_STICK_BTN_PIN, packet->analog_stick_btn_pressed);
+    set_pin(&LEFT_SHOULDER_BTN_PIN_REG, LEFT_SHOULDER_BTN_PIN, !packet->left_shoulder_btn_pressed);
+    set_pin(&RIGHT_SHOULDER_BTN_PIN_REG, RIGHT_SHOULDER_BTN_PIN, !packet->right_shoulder_btn_pressed);
+    set_pin(&PURPLE1_BTN_PIN_REG, PURPLE1_BTN_PIN, !packet->purple1_btn_pressed);
+    set_pin(&PURPLE2_BTN_PIN_REG, PURPLE2_BTN_PIN, !packet->purple2_btn_pressed);
+    set_pin(&PURPLE3_BTN_PIN_REG, PURPLE3_BTN_PIN, !packet->purple3_btn_pressed);
+    set_pin(&BROWN1_BTN_PIN_REG, BROWN1_BTN_PIN, !packet->brown1_btn_pressed);
+    set_pin(&BROWN2_BTN_PIN_REG, BROWN2_BTN_PIN, !packet->brown2_btn_pressed);
+    set_pin(&BROWN3_BTN_PIN_REG, BROWN3_BTN_PIN, !packet->brown3_btn_pressed);
+    set_pin(&BLUE1_BTN_PIN_REG, BLUE1_BTN_PIN, !packet->blue1_btn_pressed);
+    set_pin(&BLUE2_BTN_PIN_REG, BLUE2_BTN_PIN, !packet->blue2_btn_pressed);
+
+    event->pinb = PINB;
+    event->pinc = PINC;
+    event->pind = PIND;
+    event->adc[ANALOG_STICK_X] = packet->analog_stick_x;
+    event->adc[ANALOG_STICK_Y] = packet->analog_stick_y;
+}
+
+struct Recorder {
+    FILE* out;
+    struct Packet_Decoder decoder;
+    struct Input_Trace_Event last;      // the snapshot written last
+    unsigned snapshots;
+};
+
+/*
+    Feeds a byte to the decoder, and writes a snapshot if it finishes a packet whose inputs differ from the last one.
+
+    @param time_us - When the byte came in
+*/
+static void take_byte(struct Recorder* recorder, uint8_t byte, uint64_t time_us)
+{
+    struct Decoded_Packet packet;
+    if(packet_decoder_feed(&recorder->decoder, byte, &packet) != PACKET_DECODE_OK) {
+        return;
+    }
+
+    struct Input_Trace_Event event = recorder->last;
+    packet_to_inputs(&packet, &event);
+    event.time_us = (time_us > recorder->last.time_us ? time_us : recorder->last.time_us);
+    if(memcmp(event.adc, recorder->last.adc, sizeof(event.adc)) != 0 || event.pinb != recorder->last.pinb ||
+       event.pinc != recorder->last.pinc || event.pind != recorder->last.pind) {
+        input_trace_write_event(recorder->out, &event);
+        recorder->last = event;
+        recorder->snapshots++;
+    }
+}
+
+/*
+    Reads a capture in replay -t's columns - a header line, then cycle,time_us,byte for each byte.
+
+    @return bool - false if a line wasn't in them
+*/
+static bool record_csv(struct Recorder* recorder, FILE* file)
+{
+    char line[MAX_LINE];
+    unsigned line_number = 0;
+
+    while(!stopping && fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        uint64_t cycle, time_us;
+        unsigned byte;
+        if(sscanf(line, "%" SCNu64 ",%" SCNu64 ",%x", &cycle, &time_us, &byte) != 3 || byte > 0xFF) {
+            if(line_number == 1) {
+                continue;
+            }
+            fprintf(stderr, "line %u: expected cycle,time_us,byte\n", line_number);
+            return false;
+        }
+        take_byte(recorder, (uint8_t) byte, time_us);
+    }
+    return true;
+}
+
+/*
+    Reads a byte stream as it comes, setting a serial device to raw at BAUD_RATE first.
+
+    @return bool - false if it couldn't be read
+*/
+static bool record_stream(struct Recorder* recorder, int fd)
+{
+    if(isatty(fd)) {
+        struct termios settings;
+        if(tcgetattr(fd, &settings) < 0) {
+            return false;
+        }
+        cfmakeraw(&settings);
+        settings.c_cflag |= CLOCAL | CREAD;
+        settings.c_cc[VMIN] = 1;
+        settings.c_cc[VTIME] = 0;
+        _Static_assert(BAUD_RATE == 2400, "B2400 is set below - change it along with BAUD_RATE");
+        if(cfsetispeed(&settings, B2400) < 0 || tcsetattr(fd, TCSANOW, &settings) < 0) {
+            return false;
+        }
+    }
+
+    uint8_t bytes[READ_CHUNK];
+    uint64_t started_us = 0;
+    ssize_t length = 0;
+    while(!stopping && ((length = read(fd, bytes, sizeof(bytes))) > 0 || (length < 0 && errno == EINTR))) {
+        uint64_t time_us = now_us();
+        if(started_us == 0) {
+            started_us = time_us;
+        }
+        for(ssize_t i = 0; i < length; i++) {
+            take_byte(recorder, bytes[i], time_us - started_us);
+        }
+    }
+    return stopping || length == 0;
+}
+
+static void usage(const char* program)
+{
+    fprintf(stderr, "usage: %s [-o trace.txt] [-t bytes.csv | byte_stream]\n", program);
+}
+
+int main(int argc, char** argv)
+{
+    const char* csv_path = NULL;
+    const char* out_path = NULL;
+    int option;
+
+    while((option = getopt(argc, argv, "o:t:")) != -1) {
+        switch(option) {
+            case 'o':
+                out_path = optarg;
+                break;
+            case 't':
+                csv_path = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if(argc - optind > (csv_path == NULL ? 1 : 0)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    struct Recorder recorder = { .out = stdout };
+    if(out_path != NULL && (recorder.out = fopen(out_path, "w")) == NULL) {
+        perror(out_path);
+        return 1;
+    }
+    packet_decoder_init(&recorder.decoder);
+
+    // No SA_RESTART, so that a SIGINT gets a blocked read() out.
+    struct sigaction action = { .sa_handler = stop };
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    // Nothing pressed and the stick centred, until the first packet says otherwise.
+    recorder.last = (struct Input_Trace_Event) {
+        .pinb = IDLE_PINB, .pinc = IDLE_PINC, .pind = IDLE_PIND,
+        .adc = { [ANALOG_STICK_X] = STICK_CENTRE, [ANALOG_STICK_Y] = STICK_CENTRE }
+    };
+    fprintf(recorder.out, "# Recorded from %s\n", csv_path != NULL ? csv_path : optind < argc ? argv[optind] : "stdin");
+    input_trace_write_header(recorder.out);
+    input_trace_write_event(recorder.out, &recorder.last);
+
+    bool ok;
+    if(csv_path != NULL) {
+        FILE* file = fopen(csv_path, "r");
+        if(file == NULL) {
+            perror(csv_path);
+            return 1;
+        }
+        ok = record_csv(&recorder, file);
+        fclose(file);
+    } else {
+        const char* path = (optind < argc ? argv[optind] : NULL);
+        int fd = (path != NULL ? open(path, O_RDONLY | O_NOCTTY) : STDIN_FILENO);
+        ok = (fd >= 0 && record_stream(&recorder, fd));
+        if(!ok) {
+            perror(path != NULL ? path : "stdin");
+        }
+    }
+
+    fprintf(stderr, "packets:   %" PRIu32 " (%" PRIu32 " checksum failures)\n", recorder.decoder.stats.packets_ok,
+            recorder.decoder.stats.checksum_failures);
+    fprintf(stderr, "snapshots: %u\n", recorder.snapshots + 1);
+    if(recorder.out != stdout) {
+        fclose(recorder.out);
+    }
+    return ok ? 0 : 1;
+}
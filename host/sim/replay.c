@@ -0,0 +1,849 @@
+/*
+    Replays an input trace through the firmware, built for the host against the simulated registers in avr_sim.c, and
+    writes out the exact byte stream the transmitter would have sent over the USART.
+
+    Everything is driven by the simulated clock, so a given trace always produces the same bytes at the same cycle
+    counts - handy for benchmarking changes to debouncing, packet rate and sleep behaviour.
+
+    S=../../src
+    cc -O2 -Iinclude -o replay replay.c avr_sim.c rfm69_emu.c rf_link.c gateway.c input_trace.c air_capture.c \
+        energy_model.c ../decoder/packet_decoder.c ../decoder/message_dispatch.c $S/transmitter.c $S/types/message.c \
+        $S/types/packet.c $S/types/ring_buffer.c $S/util/avr_adc.c $S/util/avr_usart.c $S/util/avr_util.c \
+        $S/util/general_util.c $S/util/governor.c $S/util/power.c $S/util/radio_power.c $S/util/scheduler.c \
+        $S/util/timeout.c $S/lib/rfm69/rfm69.c $S/lib/rfm69/rfm69_profile.c $S/lib/rfm69/rfm69_hop.c \
+        $S/lib/rfm69/rfm69_power.c $S/lib/rfm69/rfm69_tdma.c $S/lib/rfm69/rfm69_freshness.c -lm
+    ./replay [-o bytes.bin] [-t bytes.csv] [-c air.txt] [-e extra_seconds] [-j jammer_hz [-w jammer_width_hz]]
+        [-n neighbours [-r neighbour_rate_hz]] [-l path_loss_db] [-p ppm] [-k key_hex] [-x replay_lag] trace.txt
+
+    Add -DLATENCY_PROBE and $S/util/latency_probe.c to also print the firmware's own input-to-air latency histograms.
+    Add -DTIMER2_ASYNC to run the scheduler from the 32.768kHz crystal and sleep in power-save between frames - the
+    energy model at the end of the summary shows what that's worth.
+    Add -DRFM69_LINK to also send every packet over the RFM69 - the summary then shows how long each packet waited for
+    the radio to start up, and how long the first one after waking from power-down took to get on air.  -c writes
+    every packet the receiver at the other end hears to an air capture (see air_capture.h), which receive.c plays
+    back to the firmware's own receive pipeline.
+    Add -DRFM69_AUTOMODES as well to let the radio's AutoModes wake it for each packet and put it back to sleep.
+    Add -DTELEMETRY and $S/util/telemetry.c to have the firmware send its energy counters - the -o capture can then
+    be fed to host/battery/battery_life.
+    Add -DRFM69_HOPPING as well as -DRFM69_LINK to hop each packet onto the next channel of the firmware's hop sequence.
+    -j parks a narrowband jammer on the given frequency in Hz, taking out -w Hz around it (25kHz by default), and the
+    summary shows how many radio packets a receiver at the other end got through it (see rf_link.h).
+    -n shares the channel with that many other transmitters, each sending -r packets a second (1 by default) without
+    listening first.  Add -DRFM69_CSMA as well as -DRFM69_LINK to listen before each packet and back off while the
+    channel's busy - the summary then shows how often it was, and how many packets were dropped for waiting too long.
+    Add -DRFM69_ACK as well as -DRFM69_LINK to have a gateway at the other end (see gateway.h) ACK the packets that
+    carry button edges, and the firmware send them again when the ACK doesn't come back - the summary then shows how
+    many button events got through, and how much latency the retries added.  -j and -n take out ACKs too.
+    -l sets the path loss to the receiver in dB (RF_LINK_DEFAULT_PATH_LOSS_DB by default), and the summary shows how
+    many packets faded out on the way.  Add -DRFM69_POWER_CONTROL as well as -DRFM69_ACK to have the firmware turn its
+    output power down as far as the gateway's ACKs say it can - the energy model breaks TX down by output power.
+    Add -DRFM69_TDMA as well as -DRFM69_LINK to have the gateway send a beacon every superframe, and the firmware send
+    its packets in its own slot of it - -n then fills that many of the other slots with transmitters (up to
+    RFM69_TDMA_SLOTS - 1), -p stretches the gateway's superframes by that many ppm, as if its crystal were that far out
+    from the firmware's, and the summary shows how many beacons the firmware heard and how close to the start of its
+    slot its packets went on air.
+    Add -DRFM69_MESSAGES as well as -DRFM69_LINK to send variable length packets carrying the messages in
+    types/message.h - the summary then shows how many of each type the receiver heard, through
+    host/decoder/message_dispatch.h, and the latest config and telemetry.  Add -DTELEMETRY as well for telemetry
+    messages.
+    Add -DRFM69_AES and $S/util/radio_key.c as well as -DRFM69_LINK to encrypt every packet with the key in the
+    firmware's EEPROM - the summary then shows how much longer each packet took on air than it would have in the
+    clear, and how long the radio took to encrypt it, which the tx start times include.  Build the same thing without
+    -DRFM69_AES to compare the rest.  The receiver at the other end only hears packets sent with RFM69W_AES_KEY, and -k
+    stores another key, as 32 hex digits, in the firmware's EEPROM before it starts.
+    Add -DRFM69_FRESHNESS and $S/util/radio_counter.c as well as -DRFM69_AES to end every packet with a counter and a
+    MAC - the receiver then turns away packets it's heard before or that don't check out, and the summary shows how
+    many, and which counters the firmware used.  -x plays an attacker who records every packet the receiver hears and
+    sends each one again that many packets later (up to RECORDED_PACKETS), along with a copy of each with its counter
+    moved on.  The MAC takes no simulated time, so the firmware's max_seal_cycles only means anything on hardware.
+*/
+#include "air_capture.h"
+#include "avr_sim.h"
+#include "energy_model.h"
+#include "gateway.h"
+#include "input_trace.h"
+#include "rf_link.h"
+#include "rfm69_emu.h"
+#include "../decoder/message_dispatch.h"
+#include "../decoder/packet_decoder.h"
+#include "../../src/avr_config.h"
+#include "../../src/lib/rfm69/rfm69.h"
+#include "../../src/transmitter.h"
+#include "../../src/util/governor.h"
+#include "../../src/util/radio_counter.h"
+#include "../../src/util/radio_key.h"
+#include "../../src/util/radio_power.h"
+#include "../../src/util/scheduler.h"
+#include "../../src/util/latency_probe.h"
+#include "../../src/util/telemetry.h"
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <avr/sleep.h>
+
+/* ADMUX channel numbers of the internal ADC inputs, which traces don't record. */
+#define ADMUX_TEMP_SENSOR 8
+#define ADMUX_BANDGAP 14
+
+/* What the internal channels read with AVCC at 3.3V and the chip at room temperature. */
+#define DEFAULT_TEMP_SENSOR_READING 352
+#define DEFAULT_BANDGAP_READING 341
+
+/* Simulated time to keep running after the last trace entry, so the final packets make it out. */
+#define DEFAULT_EXTRA_SECONDS 1
+
+/* How far to run the simulation between checks for the end of the trace. */
+#define RUN_CHUNK_CYCLES (F_CPU / 10)
+
+#define CYCLES_TO_US(cycles) ((cycles) * 1000000 / F_CPU)
+#define US_TO_CYCLES(us) ((us) * F_CPU / 1000000)
+
+/* Ticks and cycles between radio packets at the full packet rate - the transmitter's PACKET_PERIOD_TICKS, which the
+   receiver at the other end of the link knows as well as it knows the channel plan. */
+#define PACKET_PERIOD_TICKS (2 * TIMER2_US_TO_TICKS(US_IN_SEC / (2 * PACKET_RATE_HZ)))
+#define PACKET_PERIOD_CYCLES US_TO_CYCLES((uint64_t) TIMER2_TICKS_TO_US(PACKET_PERIOD_TICKS))
+
+/* Cycles in a Timer2 tick - not a whole number of them with TIMER2_ASYNC. */
+#define CYCLES_PER_TICK ((double) F_CPU * TIMER2_TICKS_PER_MS_DEN / (1000.0 * TIMER2_TICKS_PER_MS_NUM))
+
+/* Band a jammer takes out when -w doesn't say. */
+#define DEFAULT_JAMMER_WIDTH_HZ 25000
+
+/* How often each neighbour sends when -r doesn't say. */
+#define DEFAULT_NEIGHBOUR_RATE_HZ 1
+
+#define USAGE "usage: %s [-o bytes.bin] [-t bytes.csv] [-c air.txt] [-e extra_seconds] " \
+              "[-j jammer_hz [-w jammer_width_hz]] [-n neighbours [-r neighbour_rate_hz]] [-l path_loss_db] [-p ppm] " \
+              "[-k key_hex] [-x replay_lag] trace.txt\n"
+
+/* Packets the -x attacker keeps a recording of. */
+#define RECORDED_PACKETS 64
+
+struct Replay {
+    FILE* trace;
+    unsigned line_number;
+    bool have_first_event;
+    struct Input_Trace_Event first_event;
+    uint64_t last_time_us;
+    bool trace_done;
+    bool trace_error;
+
+    FILE* bytes_out;
+    FILE* times_out;
+    FILE* air_out;
+
+    struct Packet_Decoder decoder;
+    uint64_t first_packet_cycle;
+    uint64_t last_packet_cycle;
+
+    /* Cycle the CPU last woke from power-down on, until the radio gets a packet on air - SIM_NEVER otherwise. */
+    uint64_t power_down_wake_cycle;
+    uint32_t wake_to_radio_count;
+    uint64_t wake_to_radio_total_cycles;
+    uint64_t wake_to_radio_max_cycles;
+
+    /* The radio link to a receiver, and the hop sequence it follows. */
+    struct Rfm69_Hop_Plan hop_plan;
+    struct Rf_Link link;
+
+    /* The node at the other end of the link, for RFM69_ACK. */
+    struct Gateway gateway;
+
+    /* With RFM69_MESSAGES, the messages heard over the link, the tier changes among them, and the latest telemetry and
+       config heard. */
+    struct Message_Dispatcher messages;
+    uint32_t tier_events;
+    bool have_telemetry;
+    struct Decoded_Telemetry telemetry;
+    bool have_config;
+    struct Decoded_Config config;
+
+    /* Output power the radio's packets went out at, in dBm, added up. */
+    int64_t tx_dbm_total;
+
+    /* With RFM69_AES, packets the receiver couldn't decrypt - sent in the clear, or with another key. */
+    uint32_t undecryptable;
+
+    /* With RFM69_FRESHNESS, the receiver's window on the firmware's counters, and the MAC key it checks them with. */
+    struct Rfm69_Freshness_Window freshness;
+    struct Rfm69_Freshness_Key mac_key;
+
+    /* The -x attacker - how many packets after recording one it sends it again, the last RECORDED_PACKETS packets
+       recorded, and the packets it's sent and the receiver accepted. */
+    unsigned attack_lag;
+    uint8_t recorded[RECORDED_PACKETS][RFM69_FIFO_LENGTH];
+    uint8_t recorded_lengths[RECORDED_PACKETS];
+    uint32_t recorded_count;
+    uint32_t replays_sent;
+    uint32_t forgeries_sent;
+    uint32_t attacks_accepted;
+
+    /* RFM69_TDMA's superframes, on the gateway's clock - the cycles in a tick and a superframe, the cycle the first
+       beacon's last bit went on air, and the cycle the next beacon's first bit goes on air. */
+    double tick_cycles;
+    uint64_t superframe_cycles;
+    uint64_t first_beacon_end;
+    uint64_t next_beacon_start;
+
+    /* How far from the start of its slot each of the firmware's packets went on air, in cycles - the earliest and the
+       latest. */
+    bool have_slot_offset;
+    int64_t min_slot_offset_cycles;
+    int64_t max_slot_offset_cycles;
+};
+
+static void to_sim_inputs(const struct Input_Trace_Event* event, struct Sim_Inputs* inputs)
+{
+    *inputs = (struct Sim_Inputs) { .pinb = event->pinb, .pinc = event->pinc, .pind = event->pind };
+    for(uint8_t i = 0; i < INPUT_TRACE_NUM_ADC_CHANNELS; i++) {
+        inputs->adc[i] = event->adc[i];
+    }
+    inputs->adc[ADMUX_TEMP_SENSOR] = DEFAULT_TEMP_SENSOR_READING;
+    inputs->adc[ADMUX_BANDGAP] = DEFAULT_BANDGAP_READING;
+}
+
+static bool next_trace_input(void* context, uint64_t* cycle, struct Sim_Inputs* inputs)
+{
+    struct Replay* replay = context;
+    struct Input_Trace_Event event;
+
+    if(replay->have_first_event) {
+        replay->have_first_event = false;
+        event = replay->first_event;
+    } else {
+        enum Input_Trace_Status status = input_trace_read_event(replay->trace, &event, &replay->line_number);
+        if(status != INPUT_TRACE_OK || event.time_us < replay->last_time_us) {
+            replay->trace_error = (status == INPUT_TRACE_ERROR || status == INPUT_TRACE_OK);
+            replay->trace_done = true;
+            return false;
+        }
+    }
+
+    replay->last_time_us = event.time_us;
+    *cycle = US_TO_CYCLES(event.time_us);
+    to_sim_inputs(&event, inputs);
+    return true;
+}
+
+static void usart_byte_sent(void* context, uint64_t cycle, uint8_t byte)
+{
+    struct Replay* replay = context;
+
+    if(replay->bytes_out != NULL) {
+        fputc(byte, replay->bytes_out);
+    }
+    if(replay->times_out != NULL) {
+        fprintf(replay->times_out, "%" PRIu64 ",%" PRIu64 ",0x%02x\n", cycle, CYCLES_TO_US(cycle), byte);
+    }
+
+    struct Decoded_Packet packet;
+    if(packet_decoder_feed(&replay->decoder, byte, &packet) == PACKET_DECODE_OK) {
+        if(replay->decoder.stats.packets_ok == 1) {
+            replay->first_packet_cycle = cycle;
+        }
+        replay->last_packet_cycle = cycle;
+    }
+}
+
+static void cpu_woken(void* context, uint64_t cycle, uint8_t sleep_mode)
+{
+    struct Replay* replay = context;
+
+    if(sleep_mode == SLEEP_MODE_PWR_DOWN) {
+        replay->power_down_wake_cycle = cycle;
+    }
+}
+
+#ifdef RFM69_MESSAGES
+static void event_heard(void* context, const struct Decoded_Event* event)
+{
+    struct Replay* replay = context;
+    replay->tier_events += (event->code == MESSAGE_EVENT_TIER);
+}
+
+static void telemetry_heard(void* context, const struct Decoded_Telemetry* telemetry)
+{
+    struct Replay* replay = context;
+    replay->telemetry = *telemetry;
+    replay->have_telemetry = true;
+}
+
+static void config_heard(void* context, const struct Decoded_Config* config)
+{
+    struct Replay* replay = context;
+    replay->config = *config;
+    replay->have_config = true;
+}
+
+static const struct Message_Handlers MESSAGE_HANDLERS = { .event = event_heard, .telemetry = telemetry_heard,
+                                                          .config = config_heard };
+#endif
+
+#ifdef RFM69_AES
+/* Whether the radio's encrypting with the key the receiver has. */
+static bool receiver_has_key(void)
+{
+    static const uint8_t RECEIVER_KEY[RFM69_AES_KEY_LENGTH] = RFM69W_AES_KEY;
+
+    if(!(rfm69_emu_reg(REG_PACKETCONFIG2) & RF_PACKET2_AES_ON)) {
+        return false;
+    }
+    for(uint8_t i = 0; i < RFM69_AES_KEY_LENGTH; i++) {
+        if(rfm69_emu_reg(REG_AESKEY1 + i) != RECEIVER_KEY[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+#endif
+
+#ifdef RFM69_FRESHNESS
+/*
+    Plays the -x attacker, who hears a packet as the receiver does - recording it, sending the receiver the one
+    recorded -x packets before, and a copy of this one with its counter moved on to the next, as if that could be done
+    to a packet without the key.  They go straight to the receiver, so they take no airtime from the firmware's.
+*/
+static void attack(struct Replay* replay, const uint8_t* frame, uint8_t length)
+{
+    if(replay->attack_lag == 0) {
+        return;
+    }
+
+    uint32_t latest = replay->recorded_count++ % RECORDED_PACKETS;
+    memcpy(replay->recorded[latest], frame, length);
+    replay->recorded_lengths[latest] = length;
+    if(replay->recorded_count > replay->attack_lag) {
+        uint32_t old = (replay->recorded_count - 1 - replay->attack_lag) % RECORDED_PACKETS;
+        replay->attacks_accepted += rfm69_freshness_check(&replay->freshness, &replay->mac_key, replay->recorded[old],
+                                                          replay->recorded_lengths[old]) != RFM69_FRESHNESS_REPLAYED;
+        replay->replays_sent++;
+    }
+
+    uint8_t forged[RFM69_FIFO_LENGTH];
+    memcpy(forged, frame, length);
+    message_write_u32(forged + length - RFM69_FRESHNESS_LENGTH, rfm69_freshness_counter(frame, length) + 1);
+    replay->attacks_accepted += rfm69_freshness_check(&replay->freshness, &replay->mac_key, forged, length) !=
+                                RFM69_FRESHNESS_FORGED;
+    replay->forgeries_sent++;
+}
+#endif
+
+#ifdef RFM69_TDMA
+/* Cycles from the start of a superframe to a packet in the given slot going on air, on the gateway's clock - switching
+   to TX a guard into the slot, and then the transmitter starting up. */
+static uint64_t slot_start_cycles(const struct Replay* replay, uint8_t slot)
+{
+    uint16_t ticks = slot * RADIO_POWER_TDMA_SLOT_TICKS(RFM69_PACKET_AIRTIME_US) + RFM69_TDMA_GUARD_TICKS;
+    return (uint64_t) llround(ticks * replay->tick_cycles) + US_TO_CYCLES((uint64_t) RFM69_TX_WAKE_US);
+}
+#endif
+
+static void radio_packet_sent(void* context, uint64_t requested, uint64_t start, uint64_t end, uint32_t frf,
+                              const uint8_t* payload, uint8_t length)
+{
+    struct Replay* replay = context;
+    (void) requested;
+
+    int8_t tx_dbm = rfm69_emu_tx_power_dbm();
+    bool heard = rf_link_packet(&replay->link, start, end, frf, RFM69_RXBW_HZ(rfm69_profile.rxbw), tx_dbm);
+    replay->tx_dbm_total += tx_dbm;
+#ifdef RFM69_AES
+    // It still gets through the CRC, which is worked out over the encrypted bytes, but it decrypts to garbage.
+    if(heard && !receiver_has_key()) {
+        replay->undecryptable++;
+        heard = false;
+    }
+#endif
+    // The capture's what the receiver's radio puts in its FIFO, so it takes anything that gets that far - replays too.
+    if(heard && replay->air_out != NULL) {
+        struct Air_Capture_Packet packet = { .start_cycle = start, .end_cycle = end, .frf = frf,
+                                             .rssi_dbm = replay->link.last_rssi_dbm, .length = length };
+        memcpy(packet.bytes, payload, length);
+        air_capture_write_packet(replay->air_out, &packet);
+    }
+#ifdef RFM69_FRESHNESS
+    // The receiver turns away what it's heard before and what doesn't check out, and only hears a retransmission of
+    // the latest packet to ACK it again.
+    enum Rfm69_Freshness_Status freshness = RFM69_FRESHNESS_FORGED;
+    if(heard) {
+        freshness = rfm69_freshness_check(&replay->freshness, &replay->mac_key, payload, length);
+        heard = (freshness == RFM69_FRESHNESS_FRESH || freshness == RFM69_FRESHNESS_REPEATED);
+        attack(replay, payload, length);
+    }
+#endif
+
+#ifdef RFM69_ACK
+    // The gateway turns its ACK around on the same channel, at the bit rate the packet came in at.
+    uint8_t ack[RFM69_ACK_LENGTH];
+    if(gateway_packet(&replay->gateway, end, payload, length, heard, replay->link.last_rssi_dbm, ack)) {
+        uint64_t ack_start = end + US_TO_CYCLES((uint64_t) RFM69_ACK_TURNAROUND_US);
+        uint32_t ack_us = rfm69_profile_airtime_us(&rfm69_profile, RFM69_AIR_BYTES(RFM69_ACK_LENGTH));
+        uint64_t ack_end = ack_start + US_TO_CYCLES((uint64_t) ack_us);
+        if(rf_link_reply(&replay->link, ack_start, ack_end, frf, RFM69_RXBW_HZ(rfm69_profile.rxbw),
+                         GATEWAY_POWER_DBM)) {
+            rfm69_emu_receive(ack_start, ack_end, frf, ack, RFM69_ACK_LENGTH, replay->link.last_reply_dbm);
+        }
+    }
+#elif !defined(RFM69_MESSAGES)
+    (void) heard;
+    (void) payload;
+    (void) length;
+#endif
+
+#ifdef RFM69_MESSAGES
+    // Retransmissions are heard again, so with RFM69_ACK the counts include duplicates - unless RFM69_FRESHNESS says
+    // which they are.
+#ifdef RFM69_FRESHNESS
+    heard = heard && freshness == RFM69_FRESHNESS_FRESH;
+#endif
+    if(heard && length > RFM69_MESSAGE_TYPE + RFM69_TRAILER_LENGTH) {
+        message_dispatch(&replay->messages, payload + RFM69_MESSAGE_TYPE,
+                         length - RFM69_MESSAGE_TYPE - RFM69_TRAILER_LENGTH);
+    }
+#endif
+
+#ifdef RFM69_TDMA
+    int64_t into_superframe = (int64_t) ((start - replay->first_beacon_end) % replay->superframe_cycles);
+    int64_t slot_offset = into_superframe - (int64_t) slot_start_cycles(replay, RFM69_TDMA_SLOT(RFM69W_NODE_ADDRESS));
+    if(!replay->have_slot_offset || slot_offset < replay->min_slot_offset_cycles) {
+        replay->min_slot_offset_cycles = slot_offset;
+    }
+    if(!replay->have_slot_offset || slot_offset > replay->max_slot_offset_cycles) {
+        replay->max_slot_offset_cycles = slot_offset;
+    }
+    replay->have_slot_offset = true;
+#endif
+
+    if(replay->power_down_wake_cycle != SIM_NEVER && start >= replay->power_down_wake_cycle) {
+        uint64_t latency = start - replay->power_down_wake_cycle;
+        replay->wake_to_radio_count++;
+        replay->wake_to_radio_total_cycles += latency;
+        if(latency > replay->wake_to_radio_max_cycles) {
+            replay->wake_to_radio_max_cycles = latency;
+        }
+        replay->power_down_wake_cycle = SIM_NEVER;
+    }
+}
+
+#ifdef RFM69_TDMA
+/* Sim alarm - sends the gateway's next beacon as its first bit goes on air, through the link's interference, and lines
+   up the one after. */
+static void send_beacon(void* context, uint64_t cycle)
+{
+    struct Replay* replay = context;
+    (void) cycle;
+    uint8_t beacon[RFM69_FRAME_LENGTH];
+    uint64_t start = replay->next_beacon_start;
+    uint64_t end = start + US_TO_CYCLES((uint64_t) RFM69_PACKET_AIRTIME_US);
+    uint32_t frf = RFM69_FRF(RFM69W_FREQUENCY_HZ);
+
+    gateway_beacon(&replay->gateway, beacon);
+    if(rf_link_reply(&replay->link, start, end, frf, RFM69_RXBW_HZ(rfm69_profile.rxbw), GATEWAY_POWER_DBM)) {
+        rfm69_emu_receive(start, end, frf, beacon, RFM69_FRAME_LENGTH, replay->link.last_reply_dbm);
+    }
+    replay->next_beacon_start += replay->superframe_cycles;
+    sim_set_alarm(replay->next_beacon_start, send_beacon, replay);
+}
+#endif
+
+static int16_t radio_rssi(void* context, uint64_t start, uint64_t end, uint32_t frf)
+{
+    struct Replay* replay = context;
+    return rf_link_rssi(&replay->link, start, end, frf, RFM69_RXBW_HZ(rfm69_profile.rxbw));
+}
+
+/* Names of the sleep modes, indexed by the SM bits of SMCR. */
+static const char* const SLEEP_MODE_NAMES[SIM_NUM_SLEEP_MODES] = { "idle", "adc noise reduction", "power-down",
+                                                                    "power-save", "reserved", "reserved", "standby",
+                                                                    "extended standby" };
+
+static void print_summary(const struct Replay* replay)
+{
+    const struct Sim_Stats* stats = sim_stats();
+    uint64_t cycles = sim_cycles();
+
+    printf("simulated time:     %.3f s\n", cycles / (double) F_CPU);
+    printf("bytes sent:         %u\n", stats->usart_bytes);
+    printf("packets decoded:    %u\n", replay->decoder.stats.packets_ok);
+    if(replay->decoder.stats.packets_ok > 1) {
+        double interval = (replay->last_packet_cycle - replay->first_packet_cycle) / (double) (replay->decoder.stats.packets_ok - 1);
+        printf("packet interval:    %.2f ms\n", interval * 1000.0 / F_CPU);
+    }
+    printf("checksum failures:  %u\n", replay->decoder.stats.checksum_failures);
+    printf("pin changes:        %u\n", stats->pin_changes);
+    printf("timer2 overflows:   %u\n", stats->timer2_overflows);
+    printf("timer2 compares:    %u\n", stats->timer2_compare_matches);
+    printf("missed deadlines:   %u\n", scheduler_stats.missed_deadlines);
+    printf("task overruns:      %u\n", scheduler_stats.overruns);
+    printf("adc conversions:    %u\n", stats->adc_conversions);
+    printf("sleeps:             %u\n", stats->sleeps);
+    printf("governor:           %u idle, %u deep sleep\n", governor_stats.idle_entries, governor_stats.sleep_entries);
+    for(uint8_t i = 0; i < SIM_NUM_SLEEP_MODES; i++) {
+        if(stats->sleep_cycles[i] != 0) {
+            printf("time in %-11s %.3f s (%.1f%%)\n", SLEEP_MODE_NAMES[i], stats->sleep_cycles[i] / (double) F_CPU,
+                   100.0 * stats->sleep_cycles[i] / cycles);
+        }
+    }
+}
+
+static void print_radio_summary(const struct Replay* replay)
+{
+    const struct Rfm69_Emu_Stats* stats = rfm69_emu_stats();
+
+    uint32_t frf = (uint32_t) rfm69_emu_reg(REG_FRFMSB) << 16 | (uint16_t) rfm69_emu_reg(REG_FRFMID) << 8 |
+                   rfm69_emu_reg(REG_FRFLSB);
+
+    printf("radio carrier:      %.6f MHz\n", RFM69_FRF_TO_HZ(frf) / 1e6);
+    printf("radio packets:      %u sent, %u aborted\n", stats->packets_sent, stats->packets_aborted);
+    if(stats->packets_sent > 0) {
+        printf("radio spi:          %.1f bytes per packet\n", stats->spi_bytes / (double) stats->packets_sent);
+        printf("radio tx start:     avg %.3f ms, max %.3f ms after switching to tx\n",
+               stats->tx_start_delay_cycles * 1000.0 / stats->packets_sent / F_CPU,
+               stats->max_tx_start_delay_cycles * 1000.0 / F_CPU);
+    }
+    const struct Rf_Link_Stats* link = &replay->link.stats;
+    if(link->packets_sent > 0) {
+        printf("radio delivery:     %u of %u (%.1f%%), %u jammed, %u collided, %u on another channel, %u faded\n",
+               link->packets_received, link->packets_sent, 100.0 * link->packets_received / link->packets_sent,
+               link->packets_jammed, link->packets_collided, link->packets_elsewhere, link->packets_faded);
+        printf("radio power:        %+d dBm at the end, avg %+.1f dBm\n", rfm69_emu_tx_power_dbm(),
+               replay->tx_dbm_total / (double) link->packets_sent);
+    }
+    if(link->full_rate_sent > 0) {
+        printf("  at full rate:     %u of %u (%.1f%%)\n", link->full_rate_received, link->full_rate_sent,
+               100.0 * link->full_rate_received / link->full_rate_sent);
+    }
+#ifdef RFM69_CSMA
+    printf("radio csma:         %u busy channels, %u stale drops, %u rssi measurements\n",
+           radio_power_stats.busy_channels, radio_power_stats.stale_drops, stats->rssi_measurements);
+#endif
+#ifdef RFM69_ACK
+    const struct Gateway_Stats* gateway = &replay->gateway.stats;
+    printf("radio acks:         %u sent, %u lost on the way back, %u heard, %u retries, %u given up on\n",
+           gateway->acks_sent, link->replies_lost, stats->packets_received, radio_power_stats.ack_retries,
+           radio_power_stats.ack_failures);
+#ifdef RFM69_POWER_CONTROL
+    printf("power control:      %u changes\n", radio_power_stats.power_changes);
+#endif
+    printf("gateway:            %u packets delivered, %u duplicates dropped\n", gateway->packets_delivered,
+           gateway->duplicates);
+    if(gateway->events > 0) {
+        printf("button events:      %u of %u delivered (%.1f%%), %u on a retry\n", gateway->events_delivered,
+               gateway->events, 100.0 * gateway->events_delivered / gateway->events,
+               gateway->events_delivered_on_retry);
+    }
+    if(gateway->events_delivered > 0) {
+        printf("  added latency:    avg %.3f ms, max %.3f ms\n",
+               gateway->added_latency_cycles * 1000.0 / gateway->events_delivered / F_CPU,
+               gateway->max_added_latency_cycles * 1000.0 / F_CPU);
+    }
+#endif
+#ifdef RFM69_MESSAGES
+    const struct Message_Dispatch_Stats* messages = &replay->messages.stats;
+    printf("radio messages:     %u posted ones sent, %u replaced before they went out\n",
+           radio_power_stats.messages_sent, radio_power_stats.messages_replaced);
+    printf("  heard:           ");
+    for(uint8_t type = 0; type < MESSAGE_NUM_TYPES; type++) {
+        printf(" %u %s,", messages->messages[type], message_type_name(type));
+    }
+    printf(" %u unknown, %u malformed - %u tier changes\n", messages->unknown, messages->malformed,
+           replay->tier_events);
+    if(replay->have_config) {
+        printf("  last config:      message set v%u, %u Hz, %u bps, %+d dBm\n", replay->config.version,
+               replay->config.packet_rate_hz, replay->config.bitrate_bps, replay->config.power_dbm);
+    }
+    if(replay->have_telemetry) {
+        printf("  last telemetry:   %u mV at tick %u\n", replay->telemetry.counters[TELEMETRY_VCC_MV],
+               replay->telemetry.counters[TELEMETRY_TICKS]);
+    }
+#endif
+#ifdef RFM69_AES
+    if(stats->packets_sent > 0) {
+        printf("radio aes:          %u of %u packets encrypted, %u the receiver couldn't decrypt, %u dropped unkeyed\n",
+               stats->packets_encrypted, stats->packets_sent, replay->undecryptable, radio_power_stats.unkeyed_drops);
+        printf("  airtime:          avg %.3f ms, %.3f ms in the clear (%+.1f%%), +%.1f us encrypting\n",
+               stats->air_cycles * 1000.0 / stats->packets_sent / F_CPU,
+               stats->clear_air_cycles * 1000.0 / stats->packets_sent / F_CPU,
+               100.0 * ((double) stats->air_cycles / stats->clear_air_cycles - 1),
+               stats->aes_cycles * 1e6 / stats->packets_sent / F_CPU);
+    } else {
+        printf("radio aes:          nothing sent, %u dropped unkeyed\n", radio_power_stats.unkeyed_drops);
+    }
+#endif
+#ifdef RFM69_FRESHNESS
+    const struct Rfm69_Freshness_Stats* freshness = &replay->freshness.stats;
+    printf("radio freshness:    %u fresh, %u repeats ACKed again, %u replayed, %u forged\n", freshness->fresh,
+           freshness->repeated, freshness->replayed, freshness->forged);
+    printf("  counters:         %u to %u, %u reservations written, %u packets dropped waiting on one\n",
+           radio_counter_stats.first, replay->freshness.highest, radio_counter_stats.reservations,
+           radio_power_stats.counter_drops);
+    if(replay->attack_lag > 0) {
+        printf("  attacker:         %u replays %u packets late and %u forgeries sent, %u accepted\n",
+               replay->replays_sent, replay->attack_lag, replay->forgeries_sent, replay->attacks_accepted);
+    }
+#endif
+#ifdef RFM69_TDMA
+    printf("radio tdma:         %u beacons sent, %u heard, %u missed, %u syncs, %u packets dropped out of sync\n",
+           replay->gateway.stats.beacons_sent, radio_power_stats.beacons_heard, radio_power_stats.beacons_missed,
+           radio_power_stats.syncs, radio_power_stats.unsynced_drops);
+    if(replay->have_slot_offset) {
+        printf("  slot timing:      packets on air %+.0f to %+.0f us from the start of their slot\n",
+               replay->min_slot_offset_cycles * 1e6 / F_CPU, replay->max_slot_offset_cycles * 1e6 / F_CPU);
+    }
+#endif
+    if(replay->wake_to_radio_count > 0) {
+        printf("wake to radio tx:   n=%u avg %.2f ms, max %.2f ms\n", replay->wake_to_radio_count,
+               replay->wake_to_radio_total_cycles * 1000.0 / replay->wake_to_radio_count / F_CPU,
+               replay->wake_to_radio_max_cycles * 1000.0 / F_CPU);
+    }
+}
+
+#ifdef LATENCY_PROBE
+/* Upper edge, in ms, of the histogram bucket holding the given fraction of a stage's samples. */
+static double latency_percentile(enum Latency_Probe_Stage stage, uint32_t total, double fraction)
+{
+    uint32_t seen = 0;
+    for(uint8_t i = 0; i < LATENCY_PROBE_NUM_BUCKETS; i++) {
+        seen += latency_probe_histograms[stage][i];
+        if(seen >= total * fraction) {
+            return TIMER2_TICKS_TO_US((i + 1) << LATENCY_PROBE_BUCKET_SHIFT) / 1000.0;
+        }
+    }
+    return INFINITY;
+}
+
+static void print_latency_summary(void)
+{
+    static const char* const stage_names[LATENCY_NUM_STAGES] = { "input to packet", "packet to first byte",
+                                                                 "first byte to done", "end to end" };
+
+    for(uint8_t stage = 0; stage < LATENCY_NUM_STAGES; stage++) {
+        uint32_t total = 0;
+        for(uint8_t i = 0; i < LATENCY_PROBE_NUM_BUCKETS; i++) {
+            total += latency_probe_histograms[stage][i];
+        }
+        if(total == 0) {
+            continue;
+        }
+        printf("%-20s n=%-5u p50 <= %.1f ms, p99 <= %.1f ms\n", stage_names[stage], total,
+               latency_percentile(stage, total, 0.50), latency_percentile(stage, total, 0.99));
+    }
+}
+#endif /* LATENCY_PROBE */
+
+int main(int argc, char** argv)
+{
+    struct Replay replay = { 0 };
+    double extra_seconds = DEFAULT_EXTRA_SECONDS;
+    uint32_t jammer_hz = 0;
+    uint32_t jammer_width_hz = DEFAULT_JAMMER_WIDTH_HZ;
+    unsigned neighbours = 0;
+    double neighbour_rate_hz = DEFAULT_NEIGHBOUR_RATE_HZ;
+    unsigned path_loss_db = RF_LINK_DEFAULT_PATH_LOSS_DB;
+    double ppm = 0;
+    const char* key_hex = NULL;
+    int option;
+
+    while((option = getopt(argc, argv, "o:t:c:e:j:w:n:r:l:p:k:x:")) != -1) {
+        switch(option) {
+            case 'o':
+                replay.bytes_out = fopen(optarg, "wb");
+                break;
+            case 't':
+                replay.times_out = fopen(optarg, "w");
+                break;
+            case 'c':
+                replay.air_out = fopen(optarg, "w");
+                break;
+            case 'e':
+                extra_seconds = atof(optarg);
+                break;
+            case 'j':
+                jammer_hz = (uint32_t) strtoul(optarg, NULL, 10);
+                break;
+            case 'w':
+                jammer_width_hz = (uint32_t) strtoul(optarg, NULL, 10);
+                break;
+            case 'n':
+                neighbours = (unsigned) strtoul(optarg, NULL, 10);
+                break;
+            case 'r':
+                neighbour_rate_hz = atof(optarg);
+                break;
+            case 'l':
+                path_loss_db = (unsigned) strtoul(optarg, NULL, 10);
+                break;
+            case 'p':
+                ppm = atof(optarg);
+                break;
+            case 'k':
+                key_hex = optarg;
+                break;
+            case 'x':
+                replay.attack_lag = (unsigned) strtoul(optarg, NULL, 10);
+                break;
+            default:
+                fprintf(stderr, USAGE, argv[0]);
+                return 1;
+        }
+    }
+
+    if(optind >= argc || (replay.trace = fopen(argv[optind], "r")) == NULL) {
+        fprintf(stderr, USAGE, argv[0]);
+        return 1;
+    }
+    if(replay.times_out != NULL) {
+        fprintf(replay.times_out, "cycle,time_us,byte\n");
+    }
+    if(replay.air_out != NULL) {
+        air_capture_write_header(replay.air_out);
+    }
+
+    if(input_trace_read_event(replay.trace, &replay.first_event, &replay.line_number) != INPUT_TRACE_OK) {
+        fprintf(stderr, "%s:%u: expected an input snapshot\n", argv[optind], replay.line_number);
+        return 1;
+    }
+    replay.have_first_event = true;
+    replay.power_down_wake_cycle = SIM_NEVER;
+    packet_decoder_init(&replay.decoder);
+    gateway_init(&replay.gateway);
+#ifdef RFM69_MESSAGES
+    message_dispatcher_init(&replay.messages, &MESSAGE_HANDLERS, &replay);
+#endif
+#ifdef RFM69_FRESHNESS
+    static const uint8_t RECEIVER_MAC_KEY[RFM69_FRESHNESS_KEY_LENGTH] = RFM69W_MAC_KEY;
+    rfm69_freshness_window_init(&replay.freshness);
+    rfm69_freshness_key_init(&replay.mac_key, RECEIVER_MAC_KEY);
+    if(replay.attack_lag > RECORDED_PACKETS) {
+        fprintf(stderr, USAGE, argv[0]);
+        return 1;
+    }
+#else
+    if(replay.attack_lag > 0) {
+        fprintf(stderr, "-x needs -DRFM69_FRESHNESS\n");
+        return 1;
+    }
+#endif
+
+    sim_reset();
+    sim_set_cpu_hz(F_CPU);
+    rfm69_emu_reset();
+    rfm69_emu_set_packet_sink(radio_packet_sent, &replay);
+
+#ifdef RFM69_HOPPING
+    rfm69_hop_plan_init(&replay.hop_plan, RFM69W_NETWORK_ID, RFM69W_BASE_FREQUENCY_HZ, RFM69W_CHANNEL_SPACING_HZ);
+    rf_link_init(&replay.link, &replay.hop_plan, 0, PACKET_PERIOD_CYCLES);
+#else
+    rf_link_init(&replay.link, NULL, RFM69_FRF(RFM69W_FREQUENCY_HZ), PACKET_PERIOD_CYCLES);
+#endif
+    if(jammer_hz != 0) {
+        rf_link_set_jammer(&replay.link, jammer_hz, jammer_width_hz);
+    }
+    if(neighbours > RF_LINK_MAX_NEIGHBOURS || neighbour_rate_hz <= 0 || path_loss_db > UINT8_MAX) {
+        fprintf(stderr, USAGE, argv[0]);
+        return 1;
+    }
+    rf_link_set_path_loss(&replay.link, (uint8_t) path_loss_db);
+#ifdef RFM69_TDMA
+    // The gateway's superframes needn't line up with anything the firmware does, so the first beacon goes out a third
+    // of the way into the run's first one.  The other transmitters take the slots the firmware doesn't, in order.
+    if(neighbours > RFM69_TDMA_SLOTS - 1 || ppm <= -1e6) {
+        fprintf(stderr, USAGE, argv[0]);
+        return 1;
+    }
+    replay.tick_cycles = CYCLES_PER_TICK * (1 + ppm / 1e6);
+    replay.superframe_cycles = (uint64_t) llround(PACKET_PERIOD_TICKS * replay.tick_cycles);
+    replay.next_beacon_start = replay.superframe_cycles / 3;
+    replay.first_beacon_end = replay.next_beacon_start + US_TO_CYCLES((uint64_t) RFM69_PACKET_AIRTIME_US);
+    for(uint8_t slot = 0; slot < RFM69_TDMA_SLOTS && neighbours > 0; slot++) {
+        if(slot != RFM69_TDMA_SLOT(RFM69W_NODE_ADDRESS)) {
+            rf_link_add_slotted_neighbour(&replay.link, replay.first_beacon_end + slot_start_cycles(&replay, slot),
+                                          replay.superframe_cycles,
+                                          US_TO_CYCLES((uint64_t) RFM69_PACKET_AIRTIME_US));
+            neighbours--;
+        }
+    }
+#else
+    (void) ppm;
+#endif
+    if(neighbours > 0) {
+        // They send packets like the firmware's, at the bit rate it starts out with.
+        struct Rfm69_Profile profile;
+        rfm69_profile_get(RFM69_INIT_PROFILE, &profile);
+        rf_link_add_neighbours(&replay.link, (uint8_t) neighbours, (uint64_t) (F_CPU / neighbour_rate_hz),
+                               US_TO_CYCLES((uint64_t) rfm69_profile_airtime_us(&profile,
+                                                                                RFM69_AIR_BYTES(RFM69_FRAME_LENGTH))));
+    }
+    rfm69_emu_set_rssi_source(radio_rssi, &replay);
+
+    // The pins already read whatever the first snapshot says by the time the firmware starts up.
+    struct Sim_Inputs initial_inputs;
+    to_sim_inputs(&replay.first_event, &initial_inputs);
+    sim_set_inputs(&initial_inputs);
+
+    sim_set_input_source(next_trace_input, &replay);
+    sim_set_usart_sink(usart_byte_sent, &replay);
+    sim_set_wake_sink(cpu_woken, &replay);
+#ifdef RFM69_TDMA
+    sim_set_alarm(replay.next_beacon_start, send_beacon, &replay);
+#endif
+    sim_set_main_loop(transmitter_poll);
+    sim_set_main_loop_cycles(ENERGY_MAIN_LOOP_CYCLES);
+
+    if(key_hex != NULL) {
+#ifdef RFM69_AES
+        uint8_t key[RFM69_AES_KEY_LENGTH];
+        for(uint8_t i = 0; i < RFM69_AES_KEY_LENGTH; i++) {
+            if(sscanf(&key_hex[2 * i], "%2hhx", &key[i]) != 1) {
+                fprintf(stderr, USAGE, argv[0]);
+                return 1;
+            }
+        }
+        radio_key_store(key);
+#else
+        fprintf(stderr, "-k needs -DRFM69_AES\n");
+        return 1;
+#endif
+    }
+
+    transmitter_init();
+
+    uint64_t extra_cycles = (uint64_t) (extra_seconds * F_CPU);
+    while(!sim_finished()) {
+        uint64_t end = (replay.trace_done ? US_TO_CYCLES(replay.last_time_us) + extra_cycles : SIM_NEVER);
+        if(sim_cycles() >= end) {
+            break;
+        }
+        uint64_t chunk_end = sim_cycles() + RUN_CHUNK_CYCLES;
+        sim_run_until(chunk_end < end ? chunk_end : end);
+    }
+
+    if(replay.trace_error) {
+        fprintf(stderr, "%s:%u: malformed or out of order input snapshot\n", argv[optind], replay.line_number);
+    }
+    print_summary(&replay);
+    print_radio_summary(&replay);
+
+    struct Energy_Estimate energy;
+    energy_model_estimate(F_CPU, &energy);
+    energy_model_print(stdout, &energy);
+#ifdef LATENCY_PROBE
+    print_latency_summary();
+#endif
+
+    if(replay.bytes_out != NULL) {
+        fclose(replay.bytes_out);
+    }
+    if(replay.times_out != NULL) {
+        fclose(replay.times_out);
+    }
+    if(replay.air_out != NULL) {
+        fclose(replay.air_out);
+    }
+    fclose(replay.trace);
+    return replay.trace_error ? 1 : 0;
+}
@@ -0,0 +1,254 @@
+#include "rf_link.h"
+
+#include "../../src/lib/rfm69/rfm69_frequency.h"
+
+#include <math.h>
+#include <string.h>
+
+/*
+    Starts the receiver listening, parked on the hop plan's home channel or sitting on a fixed one.
+
+    @param link - The link to start
+    @param plan - Hop sequence the transmitter follows, or NULL if it doesn't hop
+    @param fixed_frf - RegFrf of the channel to sit on without a hop plan
+    @param slot_cycles - Simulated cycles between packets at the transmitter's full packet rate
+*/
+void rf_link_init(struct Rf_Link* link, const struct Rfm69_Hop_Plan* plan, uint32_t fixed_frf, uint64_t slot_cycles)
+{
+    memset(link, 0, sizeof(*link));
+    link->hopping = (plan != NULL);
+    if(link->hopping) {
+        rfm69_hop_rx_init(&link->receiver, plan);
+    }
+    link->fixed_frf = fixed_frf;
+    link->slot_cycles = slot_cycles;
+    link->slot_deadline = slot_cycles + slot_cycles / 2;
+    link->path_loss_db = RF_LINK_DEFAULT_PATH_LOSS_DB;
+    link->fade_random = 0x6C078965;
+}
+
+/*
+    Puts the two ends further apart, or closer together.
+
+    @param path_loss_db - dB lost between the transmitter's antenna and the receiver's
+*/
+void rf_link_set_path_loss(struct Rf_Link* link, uint8_t path_loss_db)
+{
+    link->path_loss_db = path_loss_db;
+}
+
+/*
+    Parks a jammer on a frequency for the rest of the run.
+
+    @param center_hz - The jammer's carrier
+    @param width_hz - How wide a band it takes out, centered on its carrier
+*/
+void rf_link_set_jammer(struct Rf_Link* link, uint32_t center_hz, uint32_t width_hz)
+{
+    link->jammed = true;
+    link->jammer_hz = center_hz;
+    link->jammer_width_hz = width_hz;
+}
+
+/*
+    Shares the channel with transmitters that don't listen before sending - each on a period a little longer than the
+    one before it, starting from a pseudo-random point in its first period, so that they drift past each other and the
+    firmware's packets rather than colliding in lockstep.
+
+    @param count - Transmitters to add, up to RF_LINK_MAX_NEIGHBOURS in all
+    @param period_cycles - Simulated cycles between the first one's packets
+    @param airtime_cycles - Simulated cycles each of their packets is on air for
+*/
+void rf_link_add_neighbours(struct Rf_Link* link, uint8_t count, uint64_t period_cycles, uint64_t airtime_cycles)
+{
+    // A fixed seed, so that a run is as repeatable as the rest of the simulation.
+    uint32_t random = 0x2545F491;
+
+    link->neighbour_frf = (link->hopping ? link->receiver.plan->frf[0] : link->fixed_frf);
+    link->neighbour_airtime_cycles = airtime_cycles;
+
+    while(count-- > 0 && link->neighbour_count < RF_LINK_MAX_NEIGHBOURS) {
+        struct Rf_Link_Neighbour* neighbour = &link->neighbours[link->neighbour_count];
+        neighbour->period_cycles = period_cycles + period_cycles * link->neighbour_count / 64;
+        random = random * 1664525 + 1013904223;
+        neighbour->first_cycle = (uint64_t) random * neighbour->period_cycles >> 32;
+        link->neighbour_count++;
+    }
+}
+
+/*
+    Shares the channel with a transmitter that sends in a TDMA slot, once every superframe.
+
+    @param first_cycle - Cycle its first packet goes on air
+    @param superframe_cycles - Simulated cycles between its packets
+    @param airtime_cycles - Simulated cycles each of its packets is on air for
+*/
+void rf_link_add_slotted_neighbour(struct Rf_Link* link, uint64_t first_cycle, uint64_t superframe_cycles,
+                                   uint64_t airtime_cycles)
+{
+    if(link->neighbour_count >= RF_LINK_MAX_NEIGHBOURS) {
+        return;
+    }
+
+    link->neighbour_frf = (link->hopping ? link->receiver.plan->frf[0] : link->fixed_frf);
+    link->neighbour_airtime_cycles = airtime_cycles;
+    link->neighbours[link->neighbour_count++] = (struct Rf_Link_Neighbour) { .period_cycles = superframe_cycles,
+                                                                              .first_cycle = first_cycle };
+}
+
+/* Whether any neighbour has a packet on air at some point between the given cycles. */
+static bool neighbour_on_air(const struct Rf_Link* link, uint64_t start, uint64_t end)
+{
+    for(uint8_t i = 0; i < link->neighbour_count; i++) {
+        const struct Rf_Link_Neighbour* neighbour = &link->neighbours[i];
+        if(end < neighbour->first_cycle) {
+            continue;
+        }
+
+        // The last of its packets to go on air before the end only misses the start if it's over by then.
+        uint64_t since_first = end - neighbour->first_cycle;
+        uint64_t last_start = end - since_first % neighbour->period_cycles;
+        if(last_start + link->neighbour_airtime_cycles > start) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Whether the jammer lands within the receiver's bandwidth of a channel. */
+static bool jammed(const struct Rf_Link* link, uint32_t frf, uint32_t rx_bandwidth_hz)
+{
+    if(!link->jammed) {
+        return false;
+    }
+
+    uint32_t carrier_hz = RFM69_FRF_TO_HZ(frf);
+    uint32_t distance_hz = (carrier_hz > link->jammer_hz ? carrier_hz - link->jammer_hz :
+                                                           link->jammer_hz - carrier_hz);
+    return distance_hz < rx_bandwidth_hz + link->jammer_width_hz / 2;
+}
+
+/*
+    Measures the strongest signal on a channel while the transmitter listens to it - a neighbour's packet or the jammer,
+    or else the noise floor.
+
+    @param start - Cycle the measurement started on
+    @param end - Cycle it finished on
+    @param frf - RegFrf the transmitter is tuned to
+    @param rx_bandwidth_hz - Single side bandwidth of its channel filter
+    @return int16_t - Signal strength in dBm
+*/
+int16_t rf_link_rssi(const struct Rf_Link* link, uint64_t start, uint64_t end, uint32_t frf, uint32_t rx_bandwidth_hz)
+{
+    if(jammed(link, frf, rx_bandwidth_hz)) {
+        return RF_LINK_JAMMER_DBM;
+    }
+    if(frf == link->neighbour_frf && neighbour_on_air(link, start, end)) {
+        return RF_LINK_NEIGHBOUR_DBM;
+    }
+    return RF_LINK_NOISE_FLOOR_DBM;
+}
+
+/* Signal strength a packet sent at the given output power arrives at, faded by the next step of the sequence. */
+static int16_t arriving_dbm(struct Rf_Link* link, int8_t tx_dbm)
+{
+    link->fade_random = link->fade_random * 1664525 + 1013904223;
+    int16_t fade_db = (int16_t) ((uint64_t) link->fade_random * (2 * RF_LINK_FADE_DB + 1) >> 32) - RF_LINK_FADE_DB;
+    return tx_dbm - link->path_loss_db + fade_db;
+}
+
+/* Weakest signal a receiver with the given channel filter can make out, in dBm. */
+static int16_t sensitivity_dbm(uint32_t rx_bandwidth_hz)
+{
+    return (int16_t) lround(-174.0 + 10.0 * log10(2.0 * rx_bandwidth_hz)) + RF_LINK_NOISE_FIGURE_DB +
+           RF_LINK_REQUIRED_SNR_DB;
+}
+
+/* Runs the receiver through every slot it gives up on before the given cycle. */
+static void miss_slots(struct Rf_Link* link, uint64_t until)
+{
+    while(until >= link->slot_deadline) {
+        if(link->hopping) {
+            rfm69_hop_rx_missed(&link->receiver);
+        }
+        link->slot_deadline += link->slot_cycles;
+    }
+}
+
+/*
+    Sends a packet across the link.
+
+    @param start - Cycle its first bit went on air
+    @param end - Cycle its last bit went on air
+    @param frf - RegFrf it went out on
+    @param rx_bandwidth_hz - Single side bandwidth of the receiver's channel filter
+    @param tx_dbm - Output power it went out at
+    @return bool - true if the receiver heard it, with the signal strength it heard it at left in last_rssi_dbm
+*/
+bool rf_link_packet(struct Rf_Link* link, uint64_t start, uint64_t end, uint32_t frf, uint32_t rx_bandwidth_hz,
+                    int8_t tx_dbm)
+{
+    uint64_t since_last = start - link->last_sent;
+    bool full_rate = (link->stats.packets_sent > 0 && since_last <= link->slot_cycles + link->slot_cycles / 2);
+
+    link->stats.packets_sent++;
+    link->stats.full_rate_sent += full_rate;
+    link->last_sent = start;
+    miss_slots(link, start);
+
+    uint32_t listening_frf = (link->hopping ? rfm69_hop_rx_frf(&link->receiver) : link->fixed_frf);
+    if(frf != listening_frf) {
+        link->stats.packets_elsewhere++;
+        return false;
+    }
+
+    if(jammed(link, frf, rx_bandwidth_hz)) {
+        link->stats.packets_jammed++;
+        return false;
+    }
+    if(frf == link->neighbour_frf && neighbour_on_air(link, start, end)) {
+        link->stats.packets_collided++;
+        return false;
+    }
+    link->last_rssi_dbm = arriving_dbm(link, tx_dbm);
+    if(link->last_rssi_dbm < sensitivity_dbm(rx_bandwidth_hz)) {
+        link->stats.packets_faded++;
+        return false;
+    }
+
+    link->stats.packets_received++;
+    link->stats.full_rate_received += full_rate;
+    if(link->hopping) {
+        rfm69_hop_rx_heard(&link->receiver);
+    }
+    link->slot_deadline = start + link->slot_cycles + link->slot_cycles / 2;
+    return true;
+}
+
+/*
+    Sends a reply the other way across the link, from the receiver back to the transmitter - lost to the jammer, a
+    neighbour or fading just like a packet.  Where the transmitter's listening isn't the link's business.
+
+    @param start - Cycle its first bit went on air
+    @param end - Cycle its last bit went on air
+    @param frf - RegFrf it went out on
+    @param rx_bandwidth_hz - Single side bandwidth of the transmitter's channel filter
+    @param tx_dbm - Output power the receiver sent it at
+    @return bool - true if it made it to the transmitter's antenna, with the signal strength it got there at left in
+                   last_reply_dbm
+*/
+bool rf_link_reply(struct Rf_Link* link, uint64_t start, uint64_t end, uint32_t frf, uint32_t rx_bandwidth_hz,
+                   int8_t tx_dbm)
+{
+    link->stats.replies_sent++;
+    if(jammed(link, frf, rx_bandwidth_hz) || (frf == link->neighbour_frf && neighbour_on_air(link, start, end))) {
+        link->stats.replies_lost++;
+        return false;
+    }
+    link->last_reply_dbm = arriving_dbm(link, tx_dbm);
+    if(link->last_reply_dbm < sensitivity_dbm(rx_bandwidth_hz)) {
+        link->stats.replies_lost++;
+        return false;
+    }
+    return true;
+}
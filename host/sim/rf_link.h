@@ -0,0 +1,112 @@
+#ifndef RF_LINK_H_
+#define RF_LINK_H_
+
+#include "../../src/lib/rfm69/rfm69_hop.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+   The air between the emulated RFM69 and a receiver at the other end of the link, for seeing how many packets get
+   through interference.  Each packet the emulator sends (see rfm69_emu.h's packet sink) is lost if a narrowband
+   jammer - a carrier parked on one frequency - lands within the receiver's bandwidth of it, or if the receiver is
+   listening on a different channel at the time.
+
+   Given a hop plan, the receiver runs the firmware's own hop receiver (lib/rfm69/rfm69_hop.h); otherwise it sits on
+   one channel.  It doesn't know when packets are sent, only how often they're due at full rate, so it counts a slot as
+   missed once half a slot has gone by past when the next packet was expected - from the last one it heard, or the
+   last slot it missed.
+
+   rf_link_add_neighbours() shares the channel with other transmitters - on the fixed channel, or the home channel of a
+   hop plan - each sending packets as long as the firmware's on a fixed period of its own, without listening first.  A
+   packet that overlaps one of theirs is lost to the collision, and rf_link_rssi() tells the emulated RFM69 what it
+   hears when it listens (see rfm69_emu_set_rssi_source()), so listen-before-talk can be measured against them.
+
+   rf_link_add_slotted_neighbour() adds one that sends in a TDMA slot instead (see lib/rfm69/rfm69_tdma.h) - at a
+   fixed point in every superframe, kept there by the receiver's beacons, so it never drifts past anything.
+
+   rf_link_reply() sends something back the other way - an ACK or a beacon - through the same interference.
+
+   Every packet also has to make it across the path loss between the two ends (see rf_link_set_path_loss()), with a
+   fade of up to RF_LINK_FADE_DB either way on top, pseudo-random but the same from run to run.  It's lost if what's
+   left of the output power it went out at is below the receiver's sensitivity, which goes by its channel filter's
+   bandwidth.
+*/
+
+/* Most transmitters rf_link_add_neighbours() can share the channel with. */
+#define RF_LINK_MAX_NEIGHBOURS 16
+
+/* Signal strengths at the transmitter's antenna, in dBm - nothing but noise, a neighbour's packet and the jammer. */
+#define RF_LINK_NOISE_FLOOR_DBM -120
+#define RF_LINK_NEIGHBOUR_DBM -70
+#define RF_LINK_JAMMER_DBM -60
+
+/* Path loss between the two ends when rf_link_set_path_loss() doesn't say - a room or two away, which leaves plenty of
+   margin at full power. */
+#define RF_LINK_DEFAULT_PATH_LOSS_DB 80
+
+/* Most a packet fades by, in dB, either way. */
+#define RF_LINK_FADE_DB 8
+
+/* The receiver's noise figure, and the signal to noise ratio its demodulator needs, in dB - its sensitivity is
+   thermal noise across its channel filter's bandwidth plus both. */
+#define RF_LINK_NOISE_FIGURE_DB 7
+#define RF_LINK_REQUIRED_SNR_DB 9
+
+struct Rf_Link_Stats {
+    uint32_t packets_sent;
+    uint32_t packets_received;
+    uint32_t packets_jammed;        // lost to the jammer
+    uint32_t packets_elsewhere;     // sent on a channel the receiver wasn't listening on
+    uint32_t packets_collided;      // on air at the same time as a neighbour's
+    uint32_t packets_faded;         // too weak by the time they got to the receiver
+    uint32_t full_rate_sent;        // sent within a slot of the one before - while the transmitter is hopping
+    uint32_t full_rate_received;
+    uint32_t replies_sent;          // from the receiver back to the transmitter, with rf_link_reply()
+    uint32_t replies_lost;          // to the jammer, a neighbour or fading
+};
+
+struct Rf_Link_Neighbour {
+    uint64_t period_cycles;
+    uint64_t first_cycle;           // cycle its first packet goes on air
+};
+
+struct Rf_Link {
+    bool hopping;
+    struct Rfm69_Hop_Receiver receiver;
+    uint32_t fixed_frf;             // RegFrf the receiver sits on when it isn't hopping
+
+    bool jammed;
+    uint32_t jammer_hz;
+    uint32_t jammer_width_hz;
+
+    struct Rf_Link_Neighbour neighbours[RF_LINK_MAX_NEIGHBOURS];
+    uint8_t neighbour_count;
+    uint32_t neighbour_frf;
+    uint64_t neighbour_airtime_cycles;
+
+    uint8_t path_loss_db;
+    uint32_t fade_random;           // state of the fade's pseudo-random sequence
+    int16_t last_rssi_dbm;          // signal strength the receiver heard the last packet at
+    int16_t last_reply_dbm;         // and the transmitter heard the last reply at
+
+    uint64_t slot_cycles;
+    uint64_t last_sent;             // cycle the last packet went on air
+    uint64_t slot_deadline;         // cycle the receiver gives up on the packet it's waiting for
+
+    struct Rf_Link_Stats stats;
+};
+
+void rf_link_init(struct Rf_Link* link, const struct Rfm69_Hop_Plan* plan, uint32_t fixed_frf, uint64_t slot_cycles);
+void rf_link_set_jammer(struct Rf_Link* link, uint32_t center_hz, uint32_t width_hz);
+void rf_link_add_neighbours(struct Rf_Link* link, uint8_t count, uint64_t period_cycles, uint64_t airtime_cycles);
+void rf_link_add_slotted_neighbour(struct Rf_Link* link, uint64_t first_cycle, uint64_t superframe_cycles,
+                                   uint64_t airtime_cycles);
+void rf_link_set_path_loss(struct Rf_Link* link, uint8_t path_loss_db);
+int16_t rf_link_rssi(const struct Rf_Link* link, uint64_t start, uint64_t end, uint32_t frf, uint32_t rx_bandwidth_hz);
+bool rf_link_packet(struct Rf_Link* link, uint64_t start, uint64_t end, uint32_t frf, uint32_t rx_bandwidth_hz,
+                    int8_t tx_dbm);
+bool rf_link_reply(struct Rf_Link* link, uint64_t start, uint64_t end, uint32_t frf, uint32_t rx_bandwidth_hz,
+                   int8_t tx_dbm);
+
+#endif /* RF_LINK_H_ */
@@ -0,0 +1,726 @@
+#include "rfm69_emu.h"
+#include "avr_sim.h"
+
+#include "../../src/lib/rfm69/rfm69_registers.h"
+#include "../../src/util/avr_spi.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#define RFM69_EMU_NUM_REGS 0x80
+
+/* The Mode bits of RegOpMode. */
+#define OPMODE_MODE_SHIFT 2
+#define OPMODE_MODE_MASK (RFM69_EMU_NUM_MODES - 1)
+
+#define MODE_SLEEP (RF_OPMODE_SLEEP >> OPMODE_MODE_SHIFT)
+#define MODE_STANDBY (RF_OPMODE_STANDBY >> OPMODE_MODE_SHIFT)
+#define MODE_SYNTH (RF_OPMODE_SYNTHESIZER >> OPMODE_MODE_SHIFT)
+#define MODE_TX (RF_OPMODE_TRANSMITTER >> OPMODE_MODE_SHIFT)
+#define MODE_RX (RF_OPMODE_RECEIVER >> OPMODE_MODE_SHIFT)
+
+/* The AddressFiltering field of RegPacketConfig1, and the DIO0 field of RegDioMapping1. */
+#define PACKET1_ADRSFILTERING_MASK 0x06
+#define DIOMAPPING1_DIO0_MASK 0xC0
+
+/* The enter, exit and intermediate mode fields of RegAutoModes. */
+#define AUTOMODES_ENTER_MASK 0xE0
+#define AUTOMODES_EXIT_MASK 0x1C
+#define AUTOMODES_INTERMEDIATE_MASK 0x03
+
+#define FIFO_SIZE 66
+
+/* The SX1231's crystal oscillator, which the bit rate divider runs off. */
+#define FXOSC_HZ 32000000
+
+/* What the module hears with nothing but noise on the channel, when there's no RSSI source. */
+#define NOISE_FLOOR_DBM -120
+
+/* RegTestPa1 and RegTestPa2 with the RFM69HW's high power settings on. */
+#define TESTPA1_HIGH_POWER 0x5D
+#define TESTPA2_HIGH_POWER 0x7C
+
+/* Microseconds to climb each step from sleep up to transmitting - the crystal oscillator starting (sleep to standby),
+   the synthesizer locking (standby to FS), and the transmitter and PA ramping up (FS to TX or RX).  Typicals from the
+   SX1231 datasheet.  Dropping back down takes no time. */
+static const uint16_t WAKE_STEP_US[] = { 0, 250, 80, 55 };
+
+/* With AES on, the radio encrypts and decrypts in blocks of this many bytes, taking about this long over each - from
+   the SX1231 datasheet. */
+#define AES_BLOCK_BYTES 16
+#define AES_BLOCK_US 7
+
+static struct {
+    uint8_t regs[RFM69_EMU_NUM_REGS];
+    bool selected;
+    bool have_address;
+    bool writing;
+    uint8_t address;
+
+    /* Whether AutoModes has the module in its intermediate mode, rather than the one RegOpMode asks for. */
+    bool intermediate;
+
+    /* Simulated cycles spent in each mode, up to mode_since - the cycle the current mode was entered on. */
+    uint64_t mode_cycles[RFM69_EMU_NUM_MODES];
+    uint64_t mode_since;
+
+    /* Simulated cycles spent in TX at each output power, up to mode_since, and the output power TX was entered at. */
+    uint64_t tx_power_cycles[RFM69_EMU_NUM_POWER_LEVELS];
+    int8_t tx_dbm;
+
+    /* Cycle the current mode is up and running on, when ModeReady comes up. */
+    uint64_t mode_ready_at;
+
+    uint8_t fifo[FIFO_SIZE];
+    uint8_t fifo_length;
+
+    /* The packet being transmitted - it goes on air once TX mode is ready and there's something in the FIFO. */
+    uint64_t tx_requested;
+    uint64_t tx_start;
+    uint64_t tx_end;
+
+    /* RegFrf when the packet went on air - retuning partway through one isn't modeled. */
+    uint32_t tx_frf;
+
+    /* Whether the packet was encrypted, and cycles it took to encrypt. */
+    bool tx_encrypted;
+    uint64_t tx_aes_cycles;
+
+    /* Cycle RX mode is up and listening from - SIM_NEVER outside RX.  A packet is only heard if the module was
+       listening from its first bit. */
+    uint64_t rx_ready_from;
+
+    /* The packet on its way in from rfm69_emu_receive() - SIM_NEVER when there isn't one. */
+    uint64_t rx_start;
+    uint64_t rx_end;
+    uint32_t rx_frf;
+    uint8_t rx_packet[FIFO_SIZE];
+    uint8_t rx_length;
+    int16_t rx_dbm;
+
+    /* The RSSI measurement under way - SIM_NEVER when there isn't one. */
+    uint64_t rssi_start;
+    uint64_t rssi_done_at;
+
+    Rfm69_Emu_Packet_Sink packet_sink;
+    void* packet_context;
+    Rfm69_Emu_Rssi_Source rssi_source;
+    void* rssi_context;
+
+    struct Rfm69_Emu_Stats stats;
+} rfm69;
+
+/* The mode the module is actually in - RegOpMode's, or AutoModes' intermediate mode while it's in that. */
+static uint8_t current_mode(void)
+{
+    static const uint8_t INTERMEDIATE_MODES[] = { MODE_SLEEP, MODE_STANDBY, MODE_RX, MODE_TX };
+
+    if(rfm69.intermediate) {
+        return INTERMEDIATE_MODES[rfm69.regs[REG_AUTOMODES] & AUTOMODES_INTERMEDIATE_MASK];
+    }
+    return (rfm69.regs[REG_OPMODE] >> OPMODE_MODE_SHIFT) & OPMODE_MODE_MASK;
+}
+
+static uint64_t us_to_cycles(uint32_t us)
+{
+    return (uint64_t) us * sim_cpu_hz() / 1000000;
+}
+
+/* How far up the sleep, standby, FS, TX/RX ladder a mode is. */
+static uint8_t wake_level(uint8_t mode)
+{
+    switch(mode) {
+        case MODE_SLEEP:
+            return 0;
+        case MODE_STANDBY:
+            return 1;
+        case MODE_SYNTH:
+            return 2;
+        default:
+            return 3;
+    }
+}
+
+/* Cycles a bit takes on air at the rate RegBitrate is set to. */
+static uint64_t bit_cycles(void)
+{
+    uint32_t bitrate_divider = ((uint32_t) rfm69.regs[REG_BITRATEMSB] << 8) | rfm69.regs[REG_BITRATELSB];
+    return (uint64_t) bitrate_divider * sim_cpu_hz() / FXOSC_HZ;
+}
+
+/* RegFrf as the firmware last wrote it. */
+static uint32_t frf(void)
+{
+    return (uint32_t) rfm69.regs[REG_FRFMSB] << 16 | (uint32_t) rfm69.regs[REG_FRFMID] << 8 | rfm69.regs[REG_FRFLSB];
+}
+
+static bool aes_on(void)
+{
+    return (rfm69.regs[REG_PACKETCONFIG2] & RF_PACKET2_AES_ON) != 0;
+}
+
+/* Bytes at the start of every packet that AES leaves in the clear - the length byte, if the packet format has one, and
+   the address, with address filtering on. */
+static uint8_t aes_clear_bytes(void)
+{
+    uint8_t bytes = (rfm69.regs[REG_PACKETCONFIG1] & RF_PACKET1_FORMAT_VARIABLE ? 1 : 0);
+    if((rfm69.regs[REG_PACKETCONFIG1] & PACKET1_ADRSFILTERING_MASK) != RF_PACKET1_ADRSFILTERING_OFF) {
+        bytes++;
+    }
+    return bytes;
+}
+
+/* Bytes between the sync word and the CRC of a packet, going by the packet format registers - the length byte
+   included, and with encrypted set, the padding out to whole AES blocks. */
+static uint32_t packet_bytes(const uint8_t* packet, bool encrypted)
+{
+    uint32_t bytes;
+    if(rfm69.regs[REG_PACKETCONFIG1] & RF_PACKET1_FORMAT_VARIABLE) {
+        bytes = 1 + packet[0];
+    } else {
+        bytes = rfm69.regs[REG_PAYLOADLENGTH];
+    }
+
+    uint8_t clear = aes_clear_bytes();
+    if(encrypted && bytes > clear) {
+        bytes = clear + (bytes - clear + AES_BLOCK_BYTES - 1) / AES_BLOCK_BYTES * AES_BLOCK_BYTES;
+    }
+    return bytes;
+}
+
+/* Cycles the radio takes to encrypt or decrypt a packet, with AES on. */
+static uint64_t aes_cycles(const uint8_t* packet)
+{
+    uint32_t blocks = (packet_bytes(packet, true) - aes_clear_bytes()) / AES_BLOCK_BYTES;
+    return us_to_cycles(blocks * AES_BLOCK_US);
+}
+
+/* Cycles from the first preamble bit to the last CRC bit of a packet, going by the bit rate and packet format
+   registers. */
+static uint64_t packet_airtime_cycles(const uint8_t* packet, bool encrypted)
+{
+    uint32_t bitrate_divider = ((uint32_t) rfm69.regs[REG_BITRATEMSB] << 8) | rfm69.regs[REG_BITRATELSB];
+    uint32_t bytes = ((uint32_t) rfm69.regs[REG_PREAMBLEMSB] << 8) | rfm69.regs[REG_PREAMBLELSB];
+
+    if(rfm69.regs[REG_SYNCCONFIG] & RF_SYNC_ON) {
+        bytes += ((rfm69.regs[REG_SYNCCONFIG] >> 3) & 0x07) + 1;
+    }
+    bytes += packet_bytes(packet, encrypted);
+    if(rfm69.regs[REG_PACKETCONFIG1] & RF_PACKET1_CRC_ON) {
+        bytes += 2;
+    }
+
+    // Bit time is RegBitrate periods of the crystal.
+    return (uint64_t) bytes * 8 * bitrate_divider * sim_cpu_hz() / FXOSC_HZ;
+}
+
+/* Puts the packet in the FIFO on air, once TX mode is ready, if it isn't already. */
+static void start_transmission(void)
+{
+    if(current_mode() != MODE_TX || rfm69.fifo_length == 0 || rfm69.tx_end != SIM_NEVER) {
+        return;
+    }
+
+    // With AES on, the whole packet is encrypted before its first bit goes out.
+    rfm69.tx_encrypted = aes_on();
+    rfm69.tx_aes_cycles = (rfm69.tx_encrypted ? aes_cycles(rfm69.fifo) : 0);
+    rfm69.tx_start = (rfm69.mode_ready_at > sim_cycles() ? rfm69.mode_ready_at : sim_cycles()) + rfm69.tx_aes_cycles;
+    rfm69.tx_end = rfm69.tx_start + packet_airtime_cycles(rfm69.fifo, rfm69.tx_encrypted);
+    rfm69.tx_frf = frf();
+}
+
+/* Starts measuring RSSI, once RX mode is ready - RegRssiConfig's RssiStart does nothing in any other mode. */
+static void start_rssi(void)
+{
+    if(current_mode() != MODE_RX) {
+        return;
+    }
+
+    rfm69.rssi_start = (rfm69.mode_ready_at > sim_cycles() ? rfm69.mode_ready_at : sim_cycles());
+    rfm69.rssi_done_at = rfm69.rssi_start + RFM69_EMU_RSSI_BITS * bit_cycles();
+    rfm69.regs[REG_RSSICONFIG] &= ~RF_RSSI_DONE;
+    rfm69.stats.rssi_measurements++;
+}
+
+/* Puts a signal strength in RegRssiValue, which is -2 * dBm, saturating at both ends. */
+static void set_rssi_value(int16_t dbm)
+{
+    int16_t value = -2 * dbm;
+    rfm69.regs[REG_RSSIVALUE] = (uint8_t) (value < 0 ? 0 : value > 0xFF ? 0xFF : value);
+}
+
+/* Finishes the RSSI measurement under way, putting what was heard in RegRssiValue. */
+static void finish_rssi(void)
+{
+    int16_t dbm = NOISE_FLOOR_DBM;
+    if(rfm69.rssi_source != NULL) {
+        dbm = rfm69.rssi_source(rfm69.rssi_context, rfm69.rssi_start, rfm69.rssi_done_at, frf());
+    }
+
+    set_rssi_value(dbm);
+    rfm69.regs[REG_RSSICONFIG] |= RF_RSSI_DONE;
+    rfm69.rssi_done_at = SIM_NEVER;
+}
+
+/* Output power going by RegPaLevel and the high power settings - PA0 or PA1 alone from -18dBm, PA1 and PA2 together
+   from -14dBm, or from -11dBm with the high power settings, in 1dB steps of OutputPower. */
+static int8_t tx_power_dbm(void)
+{
+    uint8_t pa_level = rfm69.regs[REG_PALEVEL];
+    int8_t output_power = pa_level & 0x1F;
+
+    if(!(pa_level & RF_PALEVEL_PA2_ON)) {
+        return output_power - 18;
+    }
+    if(rfm69.regs[REG_TESTPA1] == TESTPA1_HIGH_POWER && rfm69.regs[REG_TESTPA2] == TESTPA2_HIGH_POWER) {
+        return output_power - 11;
+    }
+    return output_power - 14;
+}
+
+/* Accounts for the switch from one mode to whatever current_mode() now says, on the given cycle. */
+static void switch_mode(uint8_t from, uint64_t when)
+{
+    uint8_t to = current_mode();
+
+    rfm69.mode_cycles[from] += when - rfm69.mode_since;
+    if(from == MODE_TX) {
+        rfm69.tx_power_cycles[rfm69.tx_dbm - RFM69_EMU_MIN_POWER_DBM] += when - rfm69.mode_since;
+    }
+    rfm69.mode_since = when;
+
+    if(to == from) {
+        return;
+    }
+
+    // Anything on air is cut off, and PacketSent only lasts as long as TX mode does.
+    if(from == MODE_TX) {
+        if(rfm69.tx_end != SIM_NEVER) {
+            rfm69.stats.packets_aborted++;
+            rfm69.tx_end = SIM_NEVER;
+            rfm69.fifo_length = 0;
+        }
+        rfm69.regs[REG_IRQFLAGS2] &= ~RF_IRQFLAGS2_PACKETSENT;
+    }
+
+    // Leaving RX abandons a measurement - RegRssiValue keeps the last one.
+    if(from == MODE_RX && rfm69.rssi_done_at != SIM_NEVER) {
+        rfm69.rssi_done_at = SIM_NEVER;
+        rfm69.regs[REG_RSSICONFIG] |= RF_RSSI_DONE;
+    }
+
+    // Climbing picks up from wherever the last climb has got to - dropping down is immediate.
+    if(wake_level(to) > wake_level(from)) {
+        uint32_t us = 0;
+        for(uint8_t level = wake_level(from) + 1; level <= wake_level(to); level++) {
+            us += WAKE_STEP_US[level];
+        }
+        rfm69.mode_ready_at = (rfm69.mode_ready_at > when ? rfm69.mode_ready_at : when) + us_to_cycles(us);
+    } else {
+        rfm69.mode_ready_at = when;
+    }
+    rfm69.rx_ready_from = (to == MODE_RX ? rfm69.mode_ready_at : SIM_NEVER);
+
+    if(to == MODE_TX) {
+        rfm69.tx_requested = when;
+        rfm69.tx_dbm = tx_power_dbm();
+        start_transmission();
+    }
+}
+
+static void change_mode(uint8_t value)
+{
+    uint8_t from = current_mode();
+
+    // Asking for a mode takes the module out of AutoModes' intermediate mode.
+    rfm69.regs[REG_OPMODE] = value;
+    rfm69.intermediate = false;
+    switch_mode(from, sim_cycles());
+}
+
+/* Moves into or out of AutoModes' intermediate mode on the given cycle, when the condition it's waiting on comes up. */
+static void auto_mode_condition(uint8_t enter, uint8_t exit, uint64_t when)
+{
+    uint8_t auto_modes = rfm69.regs[REG_AUTOMODES];
+    uint8_t from = current_mode();
+
+    if(!rfm69.intermediate && (auto_modes & AUTOMODES_ENTER_MASK) == enter && enter != RF_AUTOMODES_ENTER_OFF) {
+        rfm69.intermediate = true;
+        switch_mode(from, when);
+    } else if(rfm69.intermediate && (auto_modes & AUTOMODES_EXIT_MASK) == exit && exit != RF_AUTOMODES_EXIT_OFF) {
+        rfm69.intermediate = false;
+        switch_mode(from, when);
+    }
+}
+
+/* Whether the module would hear the packet on its way in - listening since its first bit on the channel it's on, and
+   let through by address filtering. */
+static bool hearing_packet(void)
+{
+    if(rfm69.rx_end == SIM_NEVER || current_mode() != MODE_RX || rfm69.rx_ready_from > rfm69.rx_start ||
+       frf() != rfm69.rx_frf) {
+        return false;
+    }
+
+    uint8_t filtering = rfm69.regs[REG_PACKETCONFIG1] & PACKET1_ADRSFILTERING_MASK;
+    if(filtering == RF_PACKET1_ADRSFILTERING_OFF) {
+        return true;
+    }
+
+    // The address comes straight after the length byte, if there is one.
+    uint8_t offset = (rfm69.regs[REG_PACKETCONFIG1] & RF_PACKET1_FORMAT_VARIABLE ? 1 : 0);
+    if(rfm69.rx_length <= offset) {
+        return false;
+    }
+    uint8_t address = rfm69.rx_packet[offset];
+    return address == rfm69.regs[REG_NODEADRS] ||
+           (filtering == RF_PACKET1_ADRSFILTERING_NODEBROADCAST && address == rfm69.regs[REG_BROADCASTADRS]);
+}
+
+/* Puts the packet that's just come in in the FIFO, if the module heard it, and the signal strength it was heard at in
+   RegRssiValue - the SX1231 measures it as the preamble comes in, and it stays there until the next measurement. */
+static void finish_reception(void)
+{
+    if(hearing_packet() && rfm69.fifo_length == 0) {
+        memcpy(rfm69.fifo, rfm69.rx_packet, rfm69.rx_length);
+        rfm69.fifo_length = rfm69.rx_length;
+        set_rssi_value(rfm69.rx_dbm);
+        rfm69.regs[REG_IRQFLAGS2] |= RF_IRQFLAGS2_PAYLOADREADY | RF_IRQFLAGS2_CRCOK;
+        rfm69.stats.packets_received++;
+    } else {
+        rfm69.stats.packets_missed++;
+    }
+    rfm69.rx_end = SIM_NEVER;
+}
+
+/* Points INT0 at DIO0's next rising edge - PacketSent in TX with mapping 00, or PayloadReady (01) or CrcOk (00) in
+   RX, which come up together. */
+static void update_dio0(void)
+{
+    uint8_t mapping = rfm69.regs[REG_DIOMAPPING1] & DIOMAPPING1_DIO0_MASK;
+    uint64_t edge = SIM_NEVER;
+
+    if(current_mode() == MODE_TX && mapping == RF_DIOMAPPING1_DIO0_00) {
+        edge = rfm69.tx_end;
+    } else if((mapping == RF_DIOMAPPING1_DIO0_00 || mapping == RF_DIOMAPPING1_DIO0_01) && hearing_packet()) {
+        edge = rfm69.rx_end;
+    }
+    sim_set_int0_edge(edge);
+}
+
+/* Brings the flags up to date with the simulated clock, finishing the packet on air if its time is up. */
+static void update(void)
+{
+    uint64_t now = sim_cycles();
+
+    if(rfm69.tx_end != SIM_NEVER && now >= rfm69.tx_end) {
+        rfm69.stats.packets_sent++;
+        uint64_t delay = rfm69.tx_start - rfm69.tx_requested;
+        rfm69.stats.tx_start_delay_cycles += delay;
+        if(delay > rfm69.stats.max_tx_start_delay_cycles) {
+            rfm69.stats.max_tx_start_delay_cycles = delay;
+        }
+        rfm69.stats.air_cycles += rfm69.tx_end - rfm69.tx_start;
+        rfm69.stats.clear_air_cycles += packet_airtime_cycles(rfm69.fifo, false);
+        if(rfm69.tx_encrypted) {
+            rfm69.stats.packets_encrypted++;
+            rfm69.stats.aes_cycles += rfm69.tx_aes_cycles;
+        }
+        if(rfm69.packet_sink != NULL) {
+            rfm69.packet_sink(rfm69.packet_context, rfm69.tx_requested, rfm69.tx_start, rfm69.tx_end, rfm69.tx_frf,
+                              rfm69.fifo, rfm69.fifo_length);
+        }
+        uint64_t sent_at = rfm69.tx_end;
+        rfm69.fifo_length = 0;
+        rfm69.tx_end = SIM_NEVER;
+        rfm69.regs[REG_IRQFLAGS2] |= RF_IRQFLAGS2_PACKETSENT;
+        auto_mode_condition(RF_AUTOMODES_ENTER_PACKETSENT, RF_AUTOMODES_EXIT_PACKETSENT, sent_at);
+    }
+
+    if(rfm69.rx_end != SIM_NEVER && now >= rfm69.rx_end) {
+        finish_reception();
+    }
+
+    if(rfm69.rssi_done_at != SIM_NEVER && now >= rfm69.rssi_done_at) {
+        finish_rssi();
+    }
+
+    if(now >= rfm69.mode_ready_at) {
+        rfm69.regs[REG_IRQFLAGS1] |= RF_IRQFLAGS1_MODEREADY;
+    } else {
+        rfm69.regs[REG_IRQFLAGS1] &= ~RF_IRQFLAGS1_MODEREADY;
+    }
+    if(rfm69.intermediate) {
+        rfm69.regs[REG_IRQFLAGS1] |= RF_IRQFLAGS1_AUTOMODE;
+    } else {
+        rfm69.regs[REG_IRQFLAGS1] &= ~RF_IRQFLAGS1_AUTOMODE;
+    }
+
+    if(rfm69.fifo_length > 0) {
+        rfm69.regs[REG_IRQFLAGS2] |= RF_IRQFLAGS2_FIFONOTEMPTY;
+    } else {
+        rfm69.regs[REG_IRQFLAGS2] &= ~RF_IRQFLAGS2_FIFONOTEMPTY;
+    }
+}
+
+static void write_fifo(uint8_t value)
+{
+    // After switching to sleep, the FIFO can't be used until ModeReady comes up.
+    if(current_mode() == MODE_SLEEP && sim_cycles() < rfm69.mode_ready_at) {
+        rfm69.stats.fifo_writes_dropped++;
+        return;
+    }
+    if(rfm69.fifo_length == FIFO_SIZE) {
+        rfm69.regs[REG_IRQFLAGS2] |= RF_IRQFLAGS2_FIFOOVERRUN;
+        return;
+    }
+
+    rfm69.fifo[rfm69.fifo_length++] = value;
+    auto_mode_condition(RF_AUTOMODES_ENTER_FIFONOTEMPTY, RF_AUTOMODES_EXIT_OFF, sim_cycles());
+    start_transmission();
+}
+
+static uint8_t read_fifo(void)
+{
+    if(rfm69.fifo_length == 0 || rfm69.tx_end != SIM_NEVER) {
+        return 0;
+    }
+
+    uint8_t value = rfm69.fifo[0];
+    memmove(rfm69.fifo, rfm69.fifo + 1, --rfm69.fifo_length);
+    if(rfm69.fifo_length == 0) {
+        rfm69.regs[REG_IRQFLAGS2] &= ~(RF_IRQFLAGS2_PAYLOADREADY | RF_IRQFLAGS2_CRCOK);
+    }
+    return value;
+}
+
+/*
+    Puts the emulated module into its power-on state - standby, with the register defaults from the SX1231 datasheet
+    that the driver relies on.  The packet sink and RSSI source are cleared too.
+*/
+void rfm69_emu_reset(void)
+{
+    memset(&rfm69, 0, sizeof(rfm69));
+    rfm69.regs[REG_OPMODE] = RF_OPMODE_SEQUENCER_ON | RF_OPMODE_LISTEN_OFF | RF_OPMODE_STANDBY;
+    rfm69.regs[REG_BITRATEMSB] = RF_BITRATEMSB_4800;
+    rfm69.regs[REG_BITRATELSB] = RF_BITRATELSB_4800;
+    rfm69.regs[REG_VERSION] = 0x24;
+    rfm69.regs[REG_PALEVEL] = RF_PALEVEL_PA0_ON | RF_PALEVEL_OUTPUTPOWER_11111;
+    rfm69.regs[REG_TESTPA1] = 0x55;
+    rfm69.regs[REG_TESTPA2] = 0x70;
+    rfm69.regs[REG_IRQFLAGS1] = RF_IRQFLAGS1_MODEREADY;
+    rfm69.regs[REG_RSSICONFIG] = RF_RSSI_DONE;
+    rfm69.regs[REG_RSSIVALUE] = 0xFF;
+    rfm69.regs[REG_RSSITHRESH] = 0xE4;
+    rfm69.regs[REG_PREAMBLELSB] = RF_PREAMBLESIZE_LSB_VALUE;
+    rfm69.regs[REG_SYNCCONFIG] = RF_SYNC_ON | RF_SYNC_SIZE_4;
+    rfm69.regs[REG_SYNCVALUE1] = 0x01;
+    rfm69.regs[REG_PACKETCONFIG1] = RF_PACKET1_CRC_ON;
+    rfm69.regs[REG_PAYLOADLENGTH] = RF_PAYLOADLENGTH_VALUE;
+    rfm69.mode_since = sim_cycles();
+    rfm69.mode_ready_at = sim_cycles();
+    rfm69.tx_end = SIM_NEVER;
+    rfm69.rx_ready_from = SIM_NEVER;
+    rfm69.rx_end = SIM_NEVER;
+    rfm69.rssi_done_at = SIM_NEVER;
+    sim_set_int0_edge(SIM_NEVER);
+}
+
+void rfm69_emu_set_packet_sink(Rfm69_Emu_Packet_Sink sink, void* context)
+{
+    rfm69.packet_sink = sink;
+    rfm69.packet_context = context;
+}
+
+/* Without a source, every RSSI measurement hears the noise floor. */
+void rfm69_emu_set_rssi_source(Rfm69_Emu_Rssi_Source source, void* context)
+{
+    rfm69.rssi_source = source;
+    rfm69.rssi_context = context;
+}
+
+/*
+    Sends the module a packet over the air.  It's heard if the module is in RX by its first bit and stays there until
+    its last, on the same channel, and address filtering lets it through - PayloadReady and CrcOk then come up, and
+    DIO0 with them from the firmware's next SPI transaction on.  Only one packet can be on its way at a time.
+
+    @param start - Cycle its first preamble bit arrives on
+    @param end - Cycle its last CRC bit arrives on
+    @param frf - RegFrf of the channel it's sent on
+    @param packet - What ends up in the FIFO - the length byte, if the packet format has one, then the payload
+    @param length - Bytes in packet, up to the FIFO's 66
+    @param rssi_dbm - Signal strength it arrives at, which RegRssiValue holds once it's heard
+*/
+void rfm69_emu_receive(uint64_t start, uint64_t end, uint32_t frf, const uint8_t* packet, uint8_t length,
+                       int16_t rssi_dbm)
+{
+    if(length > FIFO_SIZE) {
+        length = FIFO_SIZE;
+    }
+    memcpy(rfm69.rx_packet, packet, length);
+    rfm69.rx_length = length;
+    rfm69.rx_start = start;
+    // With AES on, PayloadReady waits for the packet to be decrypted.
+    rfm69.rx_end = end + (aes_on() ? aes_cycles(packet) : 0);
+    rfm69.rx_frf = frf;
+    rfm69.rx_dbm = rssi_dbm;
+
+    // Already listening, it's DIO0 that tells the firmware it's heard it - otherwise the firmware will be touching the
+    // module to start listening anyway.
+    if(current_mode() == MODE_RX) {
+        update_dio0();
+    }
+}
+
+/*
+    @return const struct Rfm69_Emu_Stats* - Counts since rfm69_emu_reset(), up to now.  A packet that has finished
+                                            since the firmware last touched the module goes to the packet sink first.
+*/
+const struct Rfm69_Emu_Stats* rfm69_emu_stats(void)
+{
+    update();
+    return &rfm69.stats;
+}
+
+uint8_t rfm69_emu_reg(uint8_t reg_addr)
+{
+    return rfm69.regs[reg_addr & (RFM69_EMU_NUM_REGS - 1)];
+}
+
+/*
+    @return int8_t - Output power, in dBm, the module transmits at with its registers as they stand
+*/
+int8_t rfm69_emu_tx_power_dbm(void)
+{
+    return tx_power_dbm();
+}
+
+/*
+    @param dbm - Output power, from RFM69_EMU_MIN_POWER_DBM up
+    @return uint64_t - Simulated cycles the module has spent transmitting at that power since rfm69_emu_reset(), up
+                       to now
+*/
+uint64_t rfm69_emu_tx_power_cycles(int8_t dbm)
+{
+    update();
+
+    uint8_t index = (uint8_t) (dbm - RFM69_EMU_MIN_POWER_DBM);
+    if(index >= RFM69_EMU_NUM_POWER_LEVELS) {
+        return 0;
+    }
+    uint64_t cycles = rfm69.tx_power_cycles[index];
+    if(current_mode() == MODE_TX && dbm == rfm69.tx_dbm) {
+        cycles += sim_cycles() - rfm69.mode_since;
+    }
+    return cycles;
+}
+
+/*
+    @param mode - One of the RF_OPMODE_x mode values, shifted down - 0 for sleep through 4 for receive
+    @return uint64_t - Simulated cycles the module has spent in that mode since rfm69_emu_reset(), up to now
+*/
+uint64_t rfm69_emu_mode_cycles(uint8_t mode)
+{
+    // AutoModes may have left a mode since the firmware last looked.
+    update();
+
+    uint64_t cycles = rfm69.mode_cycles[mode & OPMODE_MODE_MASK];
+    if((mode & OPMODE_MODE_MASK) == current_mode()) {
+        cycles += sim_cycles() - rfm69.mode_since;
+    }
+    return cycles;
+}
+
+static void write_reg(uint8_t reg_addr, uint8_t value)
+{
+    switch(reg_addr) {
+        case REG_IRQFLAGS2:
+            // Writing FifoOverrun clears the FIFO and the flags that go with it - the rest are read only.
+            if(value & RF_IRQFLAGS2_FIFOOVERRUN) {
+                rfm69.regs[REG_IRQFLAGS2] = 0;
+                rfm69.fifo_length = 0;
+            }
+            break;
+
+        case REG_IRQFLAGS1:
+            break;
+
+        case REG_OPMODE:
+            change_mode(value);
+            break;
+
+        case REG_RSSICONFIG:
+            if(value & RF_RSSI_START) {
+                start_rssi();
+            }
+            break;
+
+        case REG_RSSIVALUE:
+            break;
+
+        case REG_FIFO:
+            write_fifo(value);
+            break;
+
+        default:
+            rfm69.regs[reg_addr] = value;
+            break;
+    }
+}
+
+void master_spi_init()
+{
+}
+
+void select_slave(uint8_t avr_port, uint8_t avr_pin)
+{
+    (void) avr_port;
+    (void) avr_pin;
+    rfm69.selected = true;
+    rfm69.have_address = false;
+}
+
+uint8_t spi_transceieve(uint8_t data)
+{
+    sim_consume_cycles(RFM69_EMU_SPI_BYTE_CYCLES);
+    if(!rfm69.selected) {
+        return 0xFF;
+    }
+    rfm69.stats.spi_bytes++;
+    update();
+
+    // The first byte of every transaction is the register address, with the MSB set for a write.
+    if(!rfm69.have_address) {
+        rfm69.have_address = true;
+        rfm69.writing = (data & 0x80) != 0;
+        rfm69.address = data & 0x7F;
+        return 0;
+    }
+
+    // The AES key registers are write only.
+    uint8_t value;
+    if(rfm69.address == REG_FIFO && !rfm69.writing) {
+        value = read_fifo();
+    } else if(rfm69.address >= REG_AESKEY1 && rfm69.address <= REG_AESKEY16) {
+        value = 0;
+    } else {
+        value = rfm69.regs[rfm69.address];
+    }
+    if(rfm69.writing) {
+        write_reg(rfm69.address, data);
+    }
+
+    // Burst accesses walk through consecutive registers, except for the FIFO which stays put.
+    if(rfm69.address != REG_FIFO) {
+        rfm69.address = (rfm69.address + 1) & (RFM69_EMU_NUM_REGS - 1);
+    }
+    return value;
+}
+
+void unselect_slave(uint8_t avr_port, uint8_t avr_pin)
+{
+    (void) avr_port;
+    (void) avr_pin;
+    rfm69.selected = false;
+    update_dio0();
+}
@@ -0,0 +1,79 @@
+#ifndef RFM69_EMU_H_
+#define RFM69_EMU_H_
+
+#include <stdint.h>
+
+/*
+   A register-level stand-in for an RFM69 module on the other end of the SPI bus.  It replaces util/avr_spi.c in
+   simulator builds, implementing the same functions, so the firmware's RFM69 driver runs unmodified against it.
+
+   Mode changes take as long as the SX1231 datasheet says they do, with ModeReady coming up once they're done, and a
+   packet written to the FIFO in TX mode goes on air once the transmitter is ready and takes as long as the bit rate
+   and packet format registers say it should.  Every byte over SPI costs RFM69_EMU_SPI_BYTE_CYCLES of simulated time,
+   so the firmware's busy waits on the module's flags see time pass.  AutoModes are modeled for the enter and exit
+   conditions the firmware uses - FifoNotEmpty and PacketSent.  An RSSI measurement started in RX mode finishes
+   RFM69_EMU_RSSI_BITS bit periods later with whatever the RSSI source says is on the channel.
+
+   rfm69_emu_receive() plays the other end of the link, sending the module a packet that it hears if it's listening -
+   address filtering included, and leaves the signal strength it came in at in RegRssiValue.  DIO0 drives INT0 (see
+   avr_sim.h) with PacketSent in TX, and with PayloadReady or CrcOk in RX, going by RegDioMapping1.  Time in TX is also
+   kept by output power, going by RegPaLevel and the RFM69HW's high power settings, since TX current depends on it.
+   With AES on in RegPacketConfig2 each packet is padded out to whole 16 byte blocks on air, going by the packet
+   format registers, and takes a few microseconds per block to encrypt before it goes out and to decrypt before
+   PayloadReady - the FIFO holds the plaintext either way, and it's up to the other end of the link to check it has
+   the same key.
+*/
+
+/* Number of values the Mode bits of RegOpMode can take - sleep, standby, synthesizer, transmit, receive and three
+   reserved ones. */
+#define RFM69_EMU_NUM_MODES 8
+
+/* Output powers the module can transmit at, in dBm, from -18dBm (PA0 or PA1 alone, at the bottom of RegPaLevel) up to
+   +20dBm (PA1 and PA2 with the high power settings, at the top). */
+#define RFM69_EMU_MIN_POWER_DBM -18
+#define RFM69_EMU_NUM_POWER_LEVELS 39
+
+/* CPU cycles per byte over SPI - 8 bits at F_CPU/2 (SPI2X), plus a couple for the SPIF polling loop. */
+#define RFM69_EMU_SPI_BYTE_CYCLES 18
+
+/* Called with every packet once its last bit is on air - the cycle TX mode was entered on, the cycles its first
+   preamble bit and last CRC bit went out on, the RegFrf it went out on, and the FIFO contents it was sent from. */
+typedef void (*Rfm69_Emu_Packet_Sink)(void* context, uint64_t requested, uint64_t start, uint64_t end, uint32_t frf,
+                                      const uint8_t* payload, uint8_t length);
+
+/* Bit periods an RSSI measurement takes - the datasheet ties it to the receiver bandwidth, which comes out at about
+   this for the bandwidths the firmware's profiles use. */
+#define RFM69_EMU_RSSI_BITS 2
+
+/* Signal strength, in dBm, on the channel the module's tuned to while it measures RSSI - the cycles it starts and
+   finishes on, and RegFrf. */
+typedef int16_t (*Rfm69_Emu_Rssi_Source)(void* context, uint64_t start, uint64_t end, uint32_t frf);
+
+struct Rfm69_Emu_Stats {
+    uint32_t packets_sent;
+    uint32_t packets_aborted;                   // cut off by leaving TX mode before they were all on air
+    uint32_t spi_bytes;                         // bytes the firmware has clocked over SPI to the module
+    uint32_t fifo_writes_dropped;               // written after switching to sleep, before ModeReady came up
+    uint32_t rssi_measurements;
+    uint32_t packets_received;                  // from rfm69_emu_receive(), heard and put in the FIFO
+    uint32_t packets_missed;                    // from rfm69_emu_receive(), but not listening, or filtered out
+    uint64_t tx_start_delay_cycles;             // total of each sent packet's start cycle minus its requested cycle
+    uint64_t max_tx_start_delay_cycles;
+    uint64_t air_cycles;                        // total of each sent packet's end cycle minus its start cycle
+    uint64_t clear_air_cycles;                  // and what it would have been without AES
+    uint32_t packets_encrypted;
+    uint64_t aes_cycles;                        // spent encrypting sent packets, before they went on air
+};
+
+void rfm69_emu_reset(void);
+void rfm69_emu_set_packet_sink(Rfm69_Emu_Packet_Sink sink, void* context);
+void rfm69_emu_set_rssi_source(Rfm69_Emu_Rssi_Source source, void* context);
+void rfm69_emu_receive(uint64_t start, uint64_t end, uint32_t frf, const uint8_t* packet, uint8_t length,
+                       int16_t rssi_dbm);
+uint8_t rfm69_emu_reg(uint8_t reg_addr);
+uint64_t rfm69_emu_mode_cycles(uint8_t mode);
+int8_t rfm69_emu_tx_power_dbm(void);
+uint64_t rfm69_emu_tx_power_cycles(int8_t dbm);
+const struct Rfm69_Emu_Stats* rfm69_emu_stats(void);
+
+#endif /* RFM69_EMU_H_ */
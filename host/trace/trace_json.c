@@ -0,0 +1,236 @@
+/*
+    Turns the trace dumps a TRACE build sends over the USART (see src/util/trace.h) into Chrome trace event JSON,
+    which chrome://tracing and https://ui.perfetto.dev both open as a timeline.
+
+    The input is the raw byte stream from the transmitter - a serial capture, or the output of host/sim/replay -o -
+    so packets and dumps can be mixed freely; everything that isn't a dump line is skipped.
+
+    cc -O2 -o trace_json trace_json.c
+    ./trace_json [capture.bin] > trace.json
+
+    Add -DTIMER2_ASYNC when the capture came from a firmware built with it, so ticks are converted at the crystal's rate.
+*/
+#include "../../src/avr_config.h"
+#include "../../src/util/timing.h"
+#include "../../src/util/trace.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Longest line worth looking at - dump lines are well under this, anything longer is packet data. */
+#define MAX_LINE_LENGTH 256
+
+/* Deepest nesting of begin/end pairs - main loop, an ISR, and sleep inside the Timer2 ISR with an ISR waking it. */
+#define MAX_DEPTH 8
+
+#define TICKS_TO_US(ticks) ((double) (ticks) * US_IN_MS * TIMER2_TICKS_PER_MS_DEN / TIMER2_TICKS_PER_MS_NUM)
+
+enum Event_Kind {
+    EVENT_BEGIN,
+    EVENT_END,
+    EVENT_INSTANT
+};
+
+struct Event_Info {
+    const char* name;
+    enum Event_Kind kind;
+    const char* arg_name;
+};
+
+static const struct Event_Info EVENT_INFO[TRACE_NUM_EVENTS] = {
+    [TRACE_SCHEDULER_BEGIN] = { "TIMER2_COMPA", EVENT_BEGIN, NULL },
+    [TRACE_SCHEDULER_END] = { "TIMER2_COMPA", EVENT_END, NULL },
+    [TRACE_ADC_BEGIN] = { "ADC", EVENT_BEGIN, "channel" },
+    [TRACE_ADC_END] = { "ADC", EVENT_END, NULL },
+    [TRACE_USART_TX_BEGIN] = { "USART_TX", EVENT_BEGIN, NULL },
+    [TRACE_USART_TX_END] = { "USART_TX", EVENT_END, NULL },
+    [TRACE_PCINT] = { "PCINT", EVENT_INSTANT, NULL },
+    [TRACE_SLEEP_BEGIN] = { "sleep", EVENT_BEGIN, NULL },
+    [TRACE_SLEEP_END] = { "sleep", EVENT_END, NULL },
+    [TRACE_TASK_BEGIN] = { "task", EVENT_BEGIN, "callback" },
+    [TRACE_TASK_END] = { "task", EVENT_END, NULL },
+    [TRACE_RADIO_INIT_BEGIN] = { "rfm69_init", EVENT_BEGIN, NULL },
+    [TRACE_RADIO_INIT_END] = { "rfm69_init", EVENT_END, NULL },
+    [TRACE_RADIO_MODE] = { "rfm69 mode", EVENT_INSTANT, "mode" },
+};
+
+struct Dump {
+    bool active;
+    uint32_t anchor_ticks_high;
+    struct Trace_Record records[TRACE_NUM_RECORDS];
+    uint8_t num_records;
+};
+
+struct Output {
+    bool first_event;
+    unsigned dumps;
+    unsigned records;
+    unsigned dropped_ends;
+};
+
+static void print_event(struct Output* output, const char* name, char phase, double ts, const char* arg_name, unsigned arg)
+{
+    printf("%s\n    {\"name\": \"%s\", \"ph\": \"%c\", \"ts\": %.1f, \"pid\": 1, \"tid\": 1", output->first_event ? "" : ",",
+           name, phase, ts);
+    if(phase == 'i') {
+        printf(", \"s\": \"t\"");
+    }
+    if(arg_name != NULL) {
+        printf(", \"args\": {\"%s\": %u}", arg_name, arg);
+    }
+    printf("}");
+    output->first_event = false;
+}
+
+/*
+    Emits one complete dump.  Records only carry the low 16 bits of the tick count, so full timestamps are rebuilt by
+    working backwards from the tick count the TRS line says the ring froze at.  Ends whose begin was overwritten
+    before the dump are dropped, and begins still open at the end of the dump are closed at its last timestamp, so
+    every dump stands on its own in the viewer.
+*/
+static void emit_dump(struct Output* output, const struct Dump* dump)
+{
+    double timestamps[TRACE_NUM_RECORDS];
+    uint32_t ticks_high = dump->anchor_ticks_high;
+
+    for(int i = dump->num_records - 1; i >= 0; i--) {
+        ticks_high -= (uint8_t) ((uint8_t) ticks_high - dump->records[i].ticks_high);
+        timestamps[i] = TICKS_TO_US(((uint64_t) ticks_high << 8) | dump->records[i].ticks_low);
+    }
+
+    const char* open[MAX_DEPTH];
+    uint8_t depth = 0;
+
+    for(uint8_t i = 0; i < dump->num_records; i++) {
+        const struct Trace_Record* record = &dump->records[i];
+        if(record->event >= TRACE_NUM_EVENTS) {
+            continue;
+        }
+
+        const struct Event_Info* info = &EVENT_INFO[record->event];
+        switch(info->kind) {
+            case EVENT_BEGIN:
+                if(depth < MAX_DEPTH) {
+                    open[depth++] = info->name;
+                    print_event(output, info->name, 'B', timestamps[i], info->arg_name, record->arg);
+                }
+                break;
+            case EVENT_END:
+                if(depth > 0 && strcmp(open[depth - 1], info->name) == 0) {
+                    depth--;
+                    print_event(output, info->name, 'E', timestamps[i], NULL, 0);
+                } else {
+                    output->dropped_ends++;
+                }
+                break;
+            case EVENT_INSTANT:
+                print_event(output, info->name, 'i', timestamps[i], info->arg_name, record->arg);
+                break;
+        }
+    }
+
+    while(depth > 0) {
+        print_event(output, open[--depth], 'E', timestamps[dump->num_records - 1], NULL, 0);
+    }
+
+    output->dumps++;
+    output->records += dump->num_records;
+}
+
+static bool parse_hex(const char* text, uint8_t num_digits, uint32_t* value)
+{
+    *value = 0;
+    for(uint8_t i = 0; i < num_digits; i++) {
+        char c = text[i];
+        uint8_t digit;
+        if(c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if(c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            return false;
+        }
+        *value = (*value << 4) | digit;
+    }
+    return true;
+}
+
+static void handle_line(struct Output* output, struct Dump* dump, const char* line, size_t length)
+{
+    // Packet bytes can sit in front of a dump line, so look for the last "TR" rather than requiring it up front.
+    const char* start = NULL;
+    for(size_t i = 0; i + 2 < length; i++) {
+        if(line[i] == 'T' && line[i + 1] == 'R' && (line[i + 2] == 'S' || line[i + 2] == 'C' || line[i + 2] == 'E')) {
+            start = &line[i];
+        }
+    }
+    if(start == NULL) {
+        return;
+    }
+    length -= start - line;
+
+    uint32_t value;
+    if(start[2] == 'S') {
+        if(length >= 12 && start[3] == ' ' && parse_hex(&start[4], 8, &value)) {
+            *dump = (struct Dump) { .active = true, .anchor_ticks_high = value };
+        }
+    } else if(start[2] == 'C') {
+        if(!dump->active || length < 4 || start[3] != ' ') {
+            return;
+        }
+        for(size_t i = 4; i + 8 <= length && dump->num_records < TRACE_NUM_RECORDS; i += 8) {
+            if(!parse_hex(&start[i], 8, &value)) {
+                // A corrupted line - the timeline would come out wrong, so forget this dump entirely.
+                dump->active = false;
+                return;
+            }
+            dump->records[dump->num_records++] = (struct Trace_Record) { .event = value >> 24, .arg = value >> 16,
+                                                                         .ticks_high = value >> 8, .ticks_low = value };
+        }
+    } else if(dump->active && dump->num_records > 0) {
+        emit_dump(output, dump);
+        dump->active = false;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    FILE* input = stdin;
+    if(argc > 1 && (input = fopen(argv[1], "rb")) == NULL) {
+        fprintf(stderr, "usage: %s [capture.bin] > trace.json\n", argv[0]);
+        return 1;
+    }
+
+    struct Output output = { .first_event = true };
+    struct Dump dump = { .active = false };
+    char line[MAX_LINE_LENGTH];
+    size_t length = 0;
+    int c;
+
+    printf("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+    printf("\n    {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"ATmega328P\"}}");
+    output.first_event = false;
+
+    while((c = fgetc(input)) != EOF) {
+        if(c == '\n') {
+            handle_line(&output, &dump, line, length);
+            length = 0;
+        } else if(length < MAX_LINE_LENGTH) {
+            line[length++] = (char) c;
+        } else {
+            // Too long to be a dump line - keep only the tail, where one could still start.
+            memmove(line, &line[MAX_LINE_LENGTH / 2], MAX_LINE_LENGTH / 2);
+            length = MAX_LINE_LENGTH / 2;
+            line[length++] = (char) c;
+        }
+    }
+    printf("\n]}\n");
+
+    fprintf(stderr, "%u dumps, %u records, %u unmatched ends dropped\n", output.dumps, output.records, output.dropped_ends);
+    if(input != stdin) {
+        fclose(input);
+    }
+    return 0;
+}
@@ -7,15 +7,70 @@
 
 #define F_CPU (uint32_t) 4000000
 
-#define TIMER2_PRESCALER (uint16_t) 256
-
-/* Example calculation: ((EIGHT_BIT_TIMER_MAX [255] * TIMER2_PRESCALER [256] ) / (float) F_CPU [4,000,000])) == .01632
-   Multiply by the number of milliseconds in a second (1000) to get an overflow time of 16.32ms */
-#define EIGHT_BIT_TIMER_MAX 255
-#define TIMER2_TIME_TO_OVERFLOW (float) ((EIGHT_BIT_TIMER_MAX * TIMER2_PRESCALER) / (float) F_CPU)
-
-#define MS_IN_SEC 1000
-#define TIMER2_MS_TO_OVERFLOW (float) (TIMER2_TIME_TO_OVERFLOW * MS_IN_SEC)
+/* Timer2 drives the scheduler - see util/scheduler.h.  Durations are converted to its ticks by util/timing.h, using
+   the tick rate below as a fraction, which it checks against TIMER2_CLOCK_HZ and TIMER2_PRESCALER at compile time.
+
+   Define TIMER2_ASYNC to clock Timer2 from a 32.768kHz watch crystal on TOSC1/TOSC2 rather than the system clock.  It
+   then keeps counting in power-save, so the MCU can sleep between frames (see util/power.h) rather than idling.  The
+   crystal takes over the XTAL pins, so the CPU has to run from the internal 8MHz RC oscillator (CKSEL fuses 0010),
+   which power_init() divides down to F_CPU.  The RC oscillator's factory calibration is only good to a few percent,
+   so check the baud rate on the bench - or calibrate OSCCAL - before relying on the USART. */
+#ifdef TIMER2_ASYNC
+#define TIMER2_CLOCK_HZ (uint32_t) 32768
+#define TIMER2_PRESCALER (uint16_t) 8
+#define TIMER2_CLOCK_SELECT (1 << CS21)
+#define TIMER2_TICKS_PER_MS_NUM (uint32_t) 512       // 4.096 ticks per ms, 244.14us each
+#define TIMER2_TICKS_PER_MS_DEN (uint32_t) 125
+#else
+#define TIMER2_CLOCK_HZ F_CPU
+#define TIMER2_PRESCALER (uint16_t) 1024
+#define TIMER2_CLOCK_SELECT ((1 << CS22) | (1 << CS21) | (1 << CS20))
+#define TIMER2_TICKS_PER_MS_NUM (uint32_t) 125       // 3.90625 ticks per ms, 256us each
+#define TIMER2_TICKS_PER_MS_DEN (uint32_t) 32
+#endif
+
+/* Packets sent per second.  Each one is 7 bytes, 29.2ms of airtime at 2400 baud, so this can't go above 34 - the
+   packet period is rounded up to a whole number of input sample periods, so the real rate comes out a little lower
+   (30.5 packets per second for 31 with the system clock). */
+#define PACKET_RATE_HZ (uint16_t) 31
+
+/* Activity governor thresholds - see util/governor.h.  After GOVERNOR_IDLE_AFTER_MS without any input the packet rate
+   drops to a GOVERNOR_IDLE_PACKET_RATE_HZ heartbeat, and after GOVERNOR_SLEEP_AFTER_SECONDS the MCU powers down until
+   a pin changes.  The analog stick only counts as input once it moves more than GOVERNOR_STICK_DEADBAND ADC counts
+   from where it last did, so a noisy or resting stick can't hold the transmitter at full rate. */
+#define GOVERNOR_IDLE_AFTER_MS (uint16_t) 3000
+#define GOVERNOR_SLEEP_AFTER_SECONDS (uint16_t) 900
+#define GOVERNOR_IDLE_PACKET_RATE_HZ (uint16_t) 4
+#define GOVERNOR_STICK_DEADBAND (uint16_t) 8
+
+/* The RFM69W's channel plan - channels spaced evenly up from a base frequency (see lib/rfm69/rfm69_frequency.h).  The
+   spacing leaves room for twice the widest receiver bandwidth of the ready made profiles up to 55.5kbps.  Transmitters
+   sharing a site can each be given a channel of their own, or with RFM69_HOPPING defined, hop through the first
+   RFM69_HOP_CHANNELS of them in an order keyed on the network ID (see lib/rfm69/rfm69_hop.h). */
+#define RFM69W_BASE_FREQUENCY_HZ (uint32_t) 433000000
+#define RFM69W_CHANNEL_SPACING_HZ (uint32_t) 200000
+#define RFM69W_CHANNEL 0
+#define RFM69W_FREQUENCY_HZ (RFM69W_BASE_FREQUENCY_HZ + RFM69W_CHANNEL * RFM69W_CHANNEL_SPACING_HZ)
+
+/* The (completely arbitrary) network ID set for our RFM69 nodes - the second byte of the sync word. */
+#define RFM69W_NETWORK_ID (uint8_t) 24
+
+/* Node addresses on that network, which RFM69_ACK (see util/radio_power.h) puts in each packet's header - this
+   transmitter's, which its radio filters incoming packets on, and the receiver's, which its packets go to and ACKs
+   come back from.  The RFM69's DIO0 has to be wired to INT0 (PD2) for ACKs. */
+#define RFM69W_NODE_ADDRESS (uint8_t) 2
+#define RFM69W_GATEWAY_ADDRESS (uint8_t) 1
+
+/* With RFM69_AES, the key the network's packets are encrypted with, as the EEPROM image the build produces stores it
+   (see util/radio_key.h).  Every node on the network needs the same one, and this one's in the source for anyone to
+   read, so give a real network its own. */
+#define RFM69W_AES_KEY { 0x7A, 0x1C, 0xE4, 0x52, 0x9B, 0x03, 0xD8, 0x6F, \
+                         0x21, 0xB5, 0x4E, 0x97, 0xC0, 0x38, 0x8D, 0x66 }
+
+/* With RFM69_FRESHNESS, the key its MACs are worked out with, kept in EEPROM alongside the AES key - likewise one to
+   replace. */
+#define RFM69W_MAC_KEY { 0x3E, 0x91, 0x0B, 0xC7, 0x5D, 0xF2, 0x64, 0xA8, \
+                         0x17, 0x8C, 0xE9, 0x42, 0xB3, 0x2F, 0x76, 0xDA }
 
 #define ANALOG_STICK_X ADC0_PIN
 #define ANALOG_STICK_Y ADC1_PIN
@@ -1,8 +1,15 @@
 #include "rfm69.h"
+#include "../../util/telemetry.h"
 
 volatile enum Rfm69_Mode rfm69_current_mode;
 volatile bool is_rfm69hw = false;
-volatile uint8_t rfm69_power_level = 31;
+volatile int8_t rfm69_power_dbm = RFM69W_MAX_POWER_DBM;
+
+/* Whether the RFM69HW's high power settings go on in TX - only above RFM69HW_MAX_NORMAL_POWER_DBM. */
+static bool high_power = false;
+
+/* The profile last applied with rfm69_set_profile(). */
+struct Rfm69_Profile rfm69_profile;
 
 void rfm69_disable_high_power_regs()
 {
@@ -16,25 +23,24 @@ void rfm69_enable_high_power_regs()
     rfm69_write_reg(REG_TESTPA2, 0x7C);
 }
 
-void rfm69_init(uint16_t module_freq, uint8_t network_id)
+/**
+ * Checks the RFM69 is there and configures it, leaving it in standby with the initial profile.
+ *
+ * @param frf - Carrier frequency in synthesizer steps - RFM69_FRF() of it in Hz, or RFM69_CHANNEL_FRF() of a channel
+ * @param network_id - Second byte of the sync word, which receivers have to match
+ */
+void rfm69_init(uint32_t frf, uint8_t network_id)
 {
     const uint8_t CONFIG[][2] =
     {
         /* The sequencer wakes up each sub block in a predefined and optimized sequence automatically when switching from one mode to another.  Let's use it. */
         /* 0x01 */ { REG_OPMODE, RF_OPMODE_SEQUENCER_ON | RF_OPMODE_LISTEN_OFF | RF_OPMODE_STANDBY },
-        /* 0x02 */ { REG_DATAMODUL, RF_DATAMODUL_DATAMODE_PACKET | RF_DATAMODUL_MODULATIONTYPE_FSK | RF_DATAMODUL_MODULATIONSHAPING_00 }, // no shaping
-        /* 0x03 */ { REG_BITRATEMSB, RF_BITRATEMSB_4800},
-        /* 0x04 */ { REG_BITRATELSB, RF_BITRATELSB_4800},
-        /* 0x05 */ { REG_FDEVMSB, RF_FDEVMSB_50000},
-        /* 0x06 */ { REG_FDEVLSB, RF_FDEVLSB_50000},
-
-        //* 0x07 */ { REG_FRFMSB, RF_FRFMSB_433},
-        //* 0x08 */ { REG_FRFMID, RF_FRFMID_433},
-        //* 0x09 */ { REG_FRFLSB, RF_FRFLSB_433},
-        
-        /* 0x07 */ { REG_FRFMSB, (uint8_t) (module_freq == RF_315MHZ ? RF_FRFMSB_315 : (module_freq == RF_433MHZ ? RF_FRFMSB_433 : (module_freq == RF_868MHZ ? RF_FRFMSB_868 : RF_FRFMSB_915))) },
-        /* 0x08 */ { REG_FRFMID, (uint8_t) (module_freq == RF_315MHZ ? RF_FRFMID_315 : (module_freq == RF_433MHZ ? RF_FRFMID_433 : (module_freq == RF_868MHZ ? RF_FRFMID_868 : RF_FRFMID_915))) },
-        /* 0x09 */ { REG_FRFLSB, (uint8_t) (module_freq == RF_315MHZ ? RF_FRFLSB_315 : (module_freq == RF_433MHZ ? RF_FRFLSB_433 : (module_freq == RF_868MHZ ? RF_FRFLSB_868 : RF_FRFLSB_915))) },
+        /* 0x02 */ { REG_DATAMODUL, RF_DATAMODUL_DATAMODE_PACKET | RF_DATAMODUL_MODULATIONTYPE_FSK | RF_DATAMODUL_MODULATIONSHAPING_00 }, // shaping comes from the profile
+        // 0x03 - 0x06, the bit rate and deviation, come from the profile
+
+        /* 0x07 */ { REG_FRFMSB, (uint8_t) (frf >> 16) }, // carrier frequency - see rfm69_frequency.h
+        /* 0x08 */ { REG_FRFMID, (uint8_t) (frf >> 8) },
+        /* 0x09 */ { REG_FRFLSB, (uint8_t) frf },
 
         // looks like PA1 and PA2 are not implemented on RFM69W, hence the max output power is 13dBm
         // +17dBm and +20dBm are possible on RFM69HW
@@ -44,48 +50,48 @@ void rfm69_init(uint16_t module_freq, uint8_t network_id)
         ///* 0x11 */ { REG_PALEVEL, RF_PALEVEL_PA0_ON | RF_PALEVEL_PA1_OFF | RF_PALEVEL_PA2_OFF | RF_PALEVEL_OUTPUTPOWER_11111},
         ///* 0x13 */ { REG_OCP, RF_OCP_ON | RF_OCP_TRIM_95 }, // over current protection (default is 95mA)
             
-        // 3 preamble bytes + 2 sync word bytes + 4 payload bytes + 2 crc bytes == 11 bytes.
-        // 2.4kbps == 2.4 bits/ms.  88 bits / 2.4 bits per ms == 36.67 ms per packet
-        // 4.8kbps == 4.8 bits/ms.  88 bits / 4.8 bits per ms == 18.33 ms per packet
-        
-        // 2 preamble bytes + 1 sync word byte + 4 payload bytes + 2 crc bytes == 9 bytes
-        // 2.4kbps == 2.4 bits/ms.  72 bits / 2.4 bits per ms == 30 ms per packet
-        // 4.8kbps == 4.8 bits/ms.  72 bits / 4.8 bits per ms == 15 ms per packet
+        // 3 preamble bytes + 2 sync word bytes + 4 payload bytes (7 with RFM69_ACK's header, 2 more with RFM69_MESSAGES'
+        // length and type bytes) + 2 crc bytes == 11 bytes - see rfm69_profile_airtime_us() for how long that takes with
+        // each profile.
 
         /* 0x18 */ /* { REG_LNA, RF_LNA_ZIN_50 } */ // Impedance - test 50 ohms and 200 ohms to see which gives better results
-        // RXBW defaults are { REG_RXBW, RF_RXBW_DCCFREQ_010 | RF_RXBW_MANT_24 | RF_RXBW_EXP_5} (RxBw: 10.4KHz)
-        /* 0x19 */ { REG_RXBW, RF_RXBW_DCCFREQ_010 | RF_RXBW_MANT_16 | RF_RXBW_EXP_2 }, // (BitRate must be < 2 * RxBw).  These settings give 125khz in FSK and 62.5k in OOK
-        //for BR-19200: /* 0x19 */ { REG_RXBW, RF_RXBW_DCCFREQ_010 | RF_RXBW_MANT_24 | RF_RXBW_EXP_3 },
+        // 0x19, the receiver bandwidth, comes from the profile
         /* 0x25 */ { REG_DIOMAPPING1, RF_DIOMAPPING1_DIO0_01 }, // DIO0 is the only IRQ we're using
         /* 0x26 */ { REG_DIOMAPPING2, RF_DIOMAPPING2_CLKOUT_OFF }, // DIO5 ClkOut disable for power saving
         /* 0x28 */ { REG_IRQFLAGS2, RF_IRQFLAGS2_FIFOOVERRUN }, // writing to this bit ensures that the FIFO & status flags are reset
-        /* 0x29 */ { REG_RSSITHRESH, 220 }, // must be set to dBm = (-Sensitivity / 2), default is 0xE4 = 228 so -114dBm
+        /* 0x29 */ { REG_RSSITHRESH, RFM69_RSSI_THRESHOLD }, // must be set to dBm = (-Sensitivity / 2), default is 0xE4 = 228 so -114dBm
         // /* 0x2D */ { REG_PREAMBLELSB, RF_PREAMBLESIZE_LSB_VALUE } // default 3 preamble bytes 0xAAAAAA
         /* 0x2E */ { REG_SYNCCONFIG, RF_SYNC_ON | RF_SYNC_FIFOFILL_AUTO | RF_SYNC_SIZE_2 | RF_SYNC_TOL_0 },
         /* 0x2F */ { REG_SYNCVALUE1, 0x3D },
         /* 0x30 */ { REG_SYNCVALUE2, network_id },
-        /* 0x37 */ { REG_PACKETCONFIG1, RF_PACKET1_FORMAT_FIXED | RF_PACKET1_DCFREE_OFF | RF_PACKET1_CRC_ON | RF_PACKET1_CRCAUTOCLEAR_ON | RF_PACKET1_ADRSFILTERING_OFF },
-        /* 0x38 */ { REG_PAYLOADLENGTH, 4 },
-        ///* 0x39 */ { REG_NODEADRS, node_id }, // turned off because we're not using address filtering
+        /* 0x37 */ { REG_PACKETCONFIG1, RFM69_PACKET_FORMAT | RF_PACKET1_DCFREE_OFF | RF_PACKET1_CRC_ON | RF_PACKET1_CRCAUTOCLEAR_ON | RFM69_ADDRESS_FILTERING },
+        /* 0x38 */ { REG_PAYLOADLENGTH, RFM69_PAYLOAD_LENGTH_REG },
+        /* 0x39 */ { REG_NODEADRS, RFM69W_NODE_ADDRESS }, // only checked with RFM69_ACK, which turns address filtering on
+        /* 0x3A */ { REG_BROADCASTADRS, RFM69_BROADCAST_ADDRESS }, // and this one only with RFM69_TDMA, for beacons
         /* 0x3C */ { REG_FIFOTHRESH, RF_FIFOTHRESH_TXSTART_FIFONOTEMPTY | RF_FIFOTHRESH_VALUE }, // TX on FIFO not empty
-        /* 0x3D */ { REG_PACKETCONFIG2, RF_PACKET2_RXRESTARTDELAY_2BITS | RF_PACKET2_AUTORXRESTART_ON | RF_PACKET2_AES_OFF }, // RXRESTARTDELAY must match transmitter PA ramp-down time (bitrate dependent) TODO:  Calculate proper value here
+        /* 0x3D */ { REG_PACKETCONFIG2, RF_PACKET2_AUTORXRESTART_ON | RF_PACKET2_AES_OFF }, // RXRESTARTDELAY comes from the profile
         /* 0x6F */ { REG_TESTDAGC, RF_DAGC_IMPROVED_LOWBETA0 }, // run DAGC continuously in RX mode for Fading Margin Improvement, recommended default for AfcLowBetaOn=0?
         {255, 0}
     };
     
+    struct Timeout timeout;
+    struct Rfm69_Profile profile;
+
+    trace_event(TRACE_RADIO_INIT_BEGIN, 0);
+
     master_spi_init();
     
     select_slave(SS_PORT, SS_PIN);
     
     // Let's make sure we're talking to a live RFM69 module by writing some test sync values.
-    start_timer2_timeout(TIMER2_OVERFLOWS_BEFORE_RFM_INIT_TIMEOUT);
-    while (rfm69_read_reg(REG_SYNCVALUE1) != 0xAA && !timer2_timeout_complete())
+    start_timeout(&timeout, RFM69_INIT_TIMEOUT_TICKS);
+    while (rfm69_read_reg(REG_SYNCVALUE1) != 0xAA && !timeout_complete(&timeout))
     {
         rfm69_write_reg(REG_SYNCVALUE1, 0xAA);
     }
     
-    start_timer2_timeout(TIMER2_OVERFLOWS_BEFORE_RFM_INIT_TIMEOUT);
-    while (rfm69_read_reg(REG_SYNCVALUE1) != 0x55 && !timer2_timeout_complete())
+    start_timeout(&timeout, RFM69_INIT_TIMEOUT_TICKS);
+    while (rfm69_read_reg(REG_SYNCVALUE1) != 0x55 && !timeout_complete(&timeout))
     {
         rfm69_write_reg(REG_SYNCVALUE1, 0x55);
     }
@@ -95,6 +101,8 @@ void rfm69_init(uint16_t module_freq, uint8_t network_id)
     {
         rfm69_write_reg(CONFIG[i][0], CONFIG[i][1]);
     }
+    rfm69_profile_get(RFM69_INIT_PROFILE, &profile);
+    rfm69_set_profile(&profile);
     
     // Encryption is persistent between resets and can trip you up during debugging.
     // Disable it during initialization so we always start from a known state.
@@ -103,45 +111,118 @@ void rfm69_init(uint16_t module_freq, uint8_t network_id)
     rfm69_set_mode(RFM69_MODE_STANDBY);
     
     // Wait for our mode change to be ready
-    start_timer2_timeout(TIMER2_OVERFLOWS_BEFORE_RFM_INIT_TIMEOUT);
-    while (((rfm69_read_reg(REG_IRQFLAGS1) & RF_IRQFLAGS1_MODEREADY) == 0x00) && !timer2_timeout_complete());
+    start_timeout(&timeout, RFM69_INIT_TIMEOUT_TICKS);
+    while (((rfm69_read_reg(REG_IRQFLAGS1) & RF_IRQFLAGS1_MODEREADY) == 0x00) && !timeout_complete(&timeout));
+
+    trace_event(TRACE_RADIO_INIT_END, 0);
 }
 
 /**
- * Initializes high power capabilities for RFM69HW.  Do not pass true in to this method if you are not
- * using an RFM69HW - transmission will not work if you do so.
+ * Picks the power amplifiers for the module fitted, and starts it transmitting at full power.  Do not pass true in to
+ * this method if you are not using an RFM69HW - transmission will not work if you do so.
  *
- * @param is_rfm69hw - should be true if we are using an RFM69HW module - should be false otherwise
+ * @param hw - should be true if we are using an RFM69HW module - should be false otherwise
  */
-void rfm69_init_high_power(bool is_rfm69hw)
+void rfm69_init_high_power(bool hw)
 {
-    rfm69_write_reg(REG_OCP, is_rfm69hw ? RF_OCP_OFF : RF_OCP_ON);
-    if(is_rfm69hw) {
-        rfm69_write_reg(REG_PALEVEL, (rfm69_read_reg(REG_PALEVEL) & 0x1F) | RF_PALEVEL_PA1_ON | RF_PALEVEL_PA2_ON); // enable P1 & P2 amplifier stages
-    } else {
-        rfm69_write_reg(REG_PALEVEL, RF_PALEVEL_PA0_ON | RF_PALEVEL_PA1_OFF | RF_PALEVEL_PA2_OFF | rfm69_power_level); // enable P0 only
+    is_rfm69hw = hw;
+    rfm69_set_power_dbm(hw ? RFM69HW_MAX_POWER_DBM : RFM69W_MAX_POWER_DBM);
+}
+
+/**
+ * @return bool - true while AutoModes has the radio in its intermediate mode, rather than the one last set with
+ *                rfm69_start_mode() or rfm69_set_mode()
+ */
+bool rfm69_auto_mode_active()
+{
+    return (rfm69_read_reg(REG_IRQFLAGS1) & RF_IRQFLAGS1_AUTOMODE) != 0x00;
+}
+
+/**
+ * @return bool - true once the mode last set with rfm69_start_mode() or rfm69_set_mode() is up and running
+ */
+bool rfm69_mode_ready()
+{
+    return (rfm69_read_reg(REG_IRQFLAGS1) & RF_IRQFLAGS1_MODEREADY) != 0x00;
+}
+
+/**
+ * @return bool - true once the packet being transmitted has gone out in full.  Cleared by leaving TX mode.
+ */
+bool rfm69_packet_sent()
+{
+    return (rfm69_read_reg(REG_IRQFLAGS2) & RF_IRQFLAGS2_PACKETSENT) != 0x00;
+}
+
+/**
+ * @return bool - true once a packet that passed its CRC and address checks is waiting in the FIFO.  Cleared by reading
+ *                the FIFO empty.
+ */
+bool rfm69_payload_ready()
+{
+    return (rfm69_read_reg(REG_IRQFLAGS2) & RF_IRQFLAGS2_PAYLOADREADY) != 0x00;
+}
+
+/**
+ * Measures the signal strength on the channel the radio is tuned to.  The radio has to be in RX mode, with ModeReady
+ * up.
+ *
+ * @return uint8_t - RSSI as -2 * dBm, so bigger is weaker - 0xFF if the measurement didn't finish in time
+ */
+uint8_t rfm69_read_rssi()
+{
+    struct Timeout timeout;
+
+    rfm69_write_reg(REG_RSSICONFIG, RF_RSSI_START);
+    start_timeout(&timeout, RFM69_RSSI_TIMEOUT_TICKS);
+    while((rfm69_read_reg(REG_RSSICONFIG) & RF_RSSI_DONE) == 0x00) {
+        if(timeout_complete(&timeout)) {
+            return 0xFF;
+        }
     }
+    return rfm69_read_reg(REG_RSSIVALUE);
 }
 
-void rfm69_set_encryption(const char* key)
+/**
+ * @param rssi - A measurement from rfm69_read_rssi()
+ * @return bool - true if it's weaker than RegRssiThresh, so nobody else is transmitting nearby
+ */
+bool rfm69_channel_clear(uint8_t rssi)
+{
+    return rssi > RFM69_RSSI_THRESHOLD;
+}
+
+/**
+ * Turns the radio's AES-128 encryption on with a key, or off.  Leaves the radio in standby.
+ *
+ * @param key - RFM69_AES_KEY_LENGTH bytes of key, or RFM69_NO_ENCRYPTION_VAL to send and receive in the clear
+ */
+void rfm69_set_encryption(const uint8_t* key)
 {
     rfm69_set_mode(RFM69_MODE_STANDBY);
     
     if (key != RFM69_NO_ENCRYPTION_VAL) {
+        // The key registers follow on from each other, so the whole key goes in one burst.
         select_slave(SS_PORT, SS_PIN);
-        // Let the RFM69 know we want to write to this register with this bitmask
-        spi_transceieve(REG_AESKEY1 | RFM69_REG_READ_WRITE_BIT_LOCATION);
-        for (uint8_t i = 0; i < 16; i++) {
+        spi_transceieve(REG_AESKEY1 | (1 << RFM69_REG_READ_WRITE_BIT_LOCATION));
+        for (uint8_t i = 0; i < RFM69_AES_KEY_LENGTH; i++) {
             spi_transceieve(key[i]);
         }
         unselect_slave(SS_PORT, SS_PIN);
-    } else {
-        // The LSB bit in REG_PACKETCONFIG2 toggles encryption - 1 for on, 0 for off.  Let's turn it off without modifying any other part of the register.
-        rfm69_write_reg(REG_PACKETCONFIG2, (rfm69_read_reg(REG_PACKETCONFIG2) & 0xFE) | 0x00);
     }
+
+    // The LSB of REG_PACKETCONFIG2 toggles encryption - 1 for on, 0 for off.  Leave the rest of the register alone.
+    uint8_t aes = (key != RFM69_NO_ENCRYPTION_VAL ? RF_PACKET2_AES_ON : RF_PACKET2_AES_OFF);
+    rfm69_write_reg(REG_PACKETCONFIG2, (rfm69_read_reg(REG_PACKETCONFIG2) & ~RF_PACKET2_AES_ON) | aes);
 }
 
-void rfm69_set_mode(enum Rfm69_Mode new_mode)
+/**
+ * Starts the radio switching to a new mode and returns straight away - poll rfm69_mode_ready() before relying on it,
+ * for instance before writing the FIFO after leaving sleep.
+ *
+ * @param new_mode - the mode to switch to
+ */
+void rfm69_start_mode(enum Rfm69_Mode new_mode)
 {
     if (new_mode == rfm69_current_mode)
     return;
@@ -150,12 +231,12 @@ void rfm69_set_mode(enum Rfm69_Mode new_mode)
     {
         case RFM69_MODE_TX:
         rfm69_write_reg(REG_OPMODE, (rfm69_read_reg(REG_OPMODE) & 0xE3) | RF_OPMODE_TRANSMITTER);
-        if (is_rfm69hw) rfm69_enable_high_power_regs();
+        if (high_power) rfm69_enable_high_power_regs();
         break;
         
         case RFM69_MODE_RX:
         rfm69_write_reg(REG_OPMODE, (rfm69_read_reg(REG_OPMODE) & 0xE3) | RF_OPMODE_RECEIVER);
-        if (is_rfm69hw) rfm69_disable_high_power_regs();      
+        if (high_power) rfm69_disable_high_power_regs();
         break;
         
         case RFM69_MODE_SYNTH:
@@ -174,24 +255,148 @@ void rfm69_set_mode(enum Rfm69_Mode new_mode)
         return;
     }
     
+    rfm69_current_mode = new_mode;  
+    trace_event(TRACE_RADIO_MODE, new_mode);
+    telemetry_radio_mode(new_mode);
+}
+
+/**
+ * Sets up the sequencer to switch modes on its own - into an intermediate mode when the enter condition comes up, and
+ * back to the mode last set once the exit condition does.  rfm69_current_mode always holds the mode last set.
+ *
+ * @param auto_modes - RF_AUTOMODES_ENTER_x | RF_AUTOMODES_EXIT_x | RF_AUTOMODES_INTERMEDIATE_x, or
+ *                     RF_AUTOMODES_ENTER_OFF to turn AutoModes off
+ */
+void rfm69_set_auto_modes(uint8_t auto_modes)
+{
+    rfm69_write_reg(REG_AUTOMODES, auto_modes);
+}
+
+void rfm69_set_mode(enum Rfm69_Mode new_mode)
+{
+    bool waking = (rfm69_current_mode == RFM69_MODE_SLEEP);
+
+    rfm69_start_mode(new_mode);
+
     // we are using packet mode, so this check is not really needed
     // but waiting for mode ready is necessary when going from sleep because the FIFO may not be immediately available from previous mode
-    while (rfm69_current_mode == RFM69_MODE_SLEEP && (rfm69_read_reg(REG_IRQFLAGS1) & RF_IRQFLAGS1_MODEREADY) == 0x00); // wait for ModeReady
-    rfm69_current_mode = new_mode;  
+    while (waking && !rfm69_mode_ready()); // wait for ModeReady
 }
 
 /**
-* Sets the power level for the RFM69 where 0 is the minimum (least powerful transmission) and
-* 31 is the maximum power.  Any value over 31 will be treated as 31.  Power level is halved if
-* the module is an RFM69HW.
-*
-* @param power_level - power level to set the RFM69 module to
-*/
-void rfm69_set_power_level(uint8_t power_level)
+ * Sets the output power, picking the power amplifiers that reach it - see rfm69_power.h.  Call between packets.
+ *
+ * @param dbm - Output power, kept within the range of the module fitted
+ * @return int8_t - The output power set
+ */
+int8_t rfm69_set_power_dbm(int8_t dbm)
 {
-    rfm69_power_level = (power_level > 31 ? 31 : power_level);
-    if(is_rfm69hw) power_level /= 2;
-    rfm69_write_reg(REG_PALEVEL, (rfm69_read_reg(REG_PALEVEL) & 0xE0) | rfm69_power_level);
+    int8_t min_dbm = (is_rfm69hw ? RFM69HW_MIN_POWER_DBM : RFM69W_MIN_POWER_DBM);
+    int8_t max_dbm = (is_rfm69hw ? RFM69HW_MAX_POWER_DBM : RFM69W_MAX_POWER_DBM);
+    uint8_t pa_level;
+
+    dbm = (dbm < min_dbm ? min_dbm : dbm > max_dbm ? max_dbm : dbm);
+
+    // OutputPower steps 1dB at a time up from -18dBm, -14dBm with PA2 as well, or -11dBm with the high power settings.
+    if(!is_rfm69hw) {
+        pa_level = RF_PALEVEL_PA0_ON | RF_PALEVEL_PA1_OFF | RF_PALEVEL_PA2_OFF | (uint8_t) (dbm + 18);
+    } else if(dbm <= RFM69W_MAX_POWER_DBM) {
+        pa_level = RF_PALEVEL_PA0_OFF | RF_PALEVEL_PA1_ON | RF_PALEVEL_PA2_OFF | (uint8_t) (dbm + 18);
+    } else if(dbm <= RFM69HW_MAX_NORMAL_POWER_DBM) {
+        pa_level = RF_PALEVEL_PA0_OFF | RF_PALEVEL_PA1_ON | RF_PALEVEL_PA2_ON | (uint8_t) (dbm + 14);
+    } else {
+        pa_level = RF_PALEVEL_PA0_OFF | RF_PALEVEL_PA1_ON | RF_PALEVEL_PA2_ON | (uint8_t) (dbm + 11);
+    }
+
+    bool was_high_power = high_power;
+    high_power = (is_rfm69hw && dbm > RFM69HW_MAX_NORMAL_POWER_DBM);
+    if(was_high_power && !high_power) {
+        rfm69_disable_high_power_regs();
+    }
+
+    // Over current protection would cut the high power settings short of their 130mA.
+    rfm69_write_reg(REG_OCP, high_power ? RF_OCP_OFF : RF_OCP_ON);
+    rfm69_write_reg(REG_PALEVEL, pa_level);
+    rfm69_power_dbm = dbm;
+    return dbm;
+}
+
+/**
+ * Switches the radio to a new bit rate, deviation, pulse shaping and receiver bandwidth.  Takes effect straight away,
+ * so a packet on air at the time is lost.
+ *
+ * @param profile - Register values from rfm69_profile_compute() or rfm69_profile_get()
+ */
+void rfm69_set_profile(const struct Rfm69_Profile* profile)
+{
+    rfm69_write_reg(REG_DATAMODUL, (rfm69_read_reg(REG_DATAMODUL) & 0xFC) | profile->shaping);
+    rfm69_write_reg(REG_BITRATEMSB, (uint8_t) (profile->bitrate_divider >> 8));
+    rfm69_write_reg(REG_BITRATELSB, (uint8_t) profile->bitrate_divider);
+    rfm69_write_reg(REG_FDEVMSB, (uint8_t) (profile->fdev_steps >> 8));
+    rfm69_write_reg(REG_FDEVLSB, (uint8_t) profile->fdev_steps);
+    rfm69_write_reg(REG_RXBW, profile->rxbw);
+    rfm69_write_reg(REG_PACKETCONFIG2, (rfm69_read_reg(REG_PACKETCONFIG2) & 0x0F) | profile->rx_restart_delay);
+    rfm69_profile = *profile;
+}
+
+/**
+ * Retunes the radio with a single burst write of RegFrf, which moves the synthesizer once its last byte is written.
+ * In TX or synthesizer mode that happens straight away and takes the synthesizer's lock time; a receiver needs
+ * restarting afterwards, and a radio in sleep or standby simply comes up on the new frequency.
+ *
+ * @param frf - Carrier frequency in synthesizer steps - work it out at compile time with RFM69_FRF() or
+ *              RFM69_CHANNEL_FRF() where possible, since at run time they cost three 32-bit divisions
+ */
+void rfm69_set_frf(uint32_t frf)
+{
+    select_slave(SS_PORT, SS_PIN);
+
+    // Burst accesses move on to the next register after each byte - RegFrfMsb, RegFrfMid, then RegFrfLsb.
+    spi_transceieve(REG_FRFMSB | (1 << RFM69_REG_READ_WRITE_BIT_LOCATION));
+    spi_transceieve((uint8_t) (frf >> 16));
+    spi_transceieve((uint8_t) (frf >> 8));
+    spi_transceieve((uint8_t) frf);
+
+    unselect_slave(SS_PORT, SS_PIN);
+}
+
+/**
+ * Loads bytes into the FIFO in a single burst.  The FIFO can't be used until ModeReady comes up after a mode change,
+ * even in sleep.
+ *
+ * @param data - Bytes to load
+ * @param length - Number of bytes - the FIFO holds 66
+ */
+void rfm69_write_fifo(const uint8_t* data, uint8_t length)
+{
+    select_slave(SS_PORT, SS_PIN);
+
+    // Burst accesses to the FIFO keep writing to it rather than moving on to the next register.
+    spi_transceieve(REG_FIFO | (1 << RFM69_REG_READ_WRITE_BIT_LOCATION));
+    for(uint8_t i = 0; i < length; i++) {
+        spi_transceieve(data[i]);
+    }
+
+    unselect_slave(SS_PORT, SS_PIN);
+}
+
+/**
+ * Reads bytes out of the FIFO in a single burst - a received packet, once rfm69_payload_ready() says it's there.
+ *
+ * @param data - Filled in with the bytes read
+ * @param length - Number of bytes to read
+ */
+void rfm69_read_fifo(uint8_t* data, uint8_t length)
+{
+    select_slave(SS_PORT, SS_PIN);
+
+    // Burst reads of the FIFO keep reading from it, like burst writes.  Its address already has the read/write bit clear.
+    spi_transceieve(REG_FIFO);
+    for(uint8_t i = 0; i < length; i++) {
+        data[i] = spi_transceieve(0);
+    }
+
+    unselect_slave(SS_PORT, SS_PIN);
 }
 
 void rfm69_write_reg(uint8_t reg_addr, uint8_t value)
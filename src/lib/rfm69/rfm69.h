@@ -1,10 +1,18 @@
 #ifndef RFM69_H_
 #define RFM69_H_
 
+#include "rfm69_frequency.h"
+#include "rfm69_freshness.h"
+#include "rfm69_hop.h"
+#include "rfm69_power.h"
+#include "rfm69_profile.h"
 #include "rfm69_registers.h"
+#include "rfm69_tdma.h"
 #include "../../avr_config.h"
 #include "../../util/avr_spi.h"
 #include "../../util/timeout.h"
+#include "../../util/timing.h"
+#include "../../util/trace.h"
 
 #include <stdint.h>
 #include <stdbool.h>
@@ -16,19 +24,168 @@
 // Approximate milliseconds to wait before triggering a timeout during RFM69 init procedures
 #define RFM69_INIT_TIMEOUT_MS 50
 
-/* Number of times Timer 2 needs to overflow to timeout during RFM69 init operations.  Add .99 at the end to 
-   almost always round up to the next overflow, so we never wait less than the specified ms timeout (and usually more, but this shouldn't be as big of a deal). */
-#define TIMER2_OVERFLOWS_BEFORE_RFM_INIT_TIMEOUT (uint8_t) ((RFM69_INIT_TIMEOUT_MS / TIMER2_MS_TO_OVERFLOW) + .99)
+// Scheduler ticks to wait before triggering a timeout during RFM69 init procedures - rounded up, so never less than the ms above
+#define RFM69_INIT_TIMEOUT_TICKS TIMER2_MS_TO_TICKS(RFM69_INIT_TIMEOUT_MS)
 
-// RFM69 won't send data if it detects activity on the current RF channel - this is how long to wait before giving up on the transmission.
-#define RFM69_COLLISION_AVOIDANCE_LIMIT_MS 1000
+// With RFM69_CSMA, a packet waits for the channel to clear for no longer than this before it's dropped as stale - long
+// enough for a couple of backoffs, short enough that it never holds up the packet after it.
+#define RFM69_COLLISION_AVOIDANCE_LIMIT_MS 5
+
+// RSSI, as -2 * dBm, the receiver counts a signal from - RegRssiThresh.  220 is -110dBm.  Listen-before-talk treats the
+// channel as busy while it hears anything this strong.
+#define RFM69_RSSI_THRESHOLD 220
+
+// Ticks (3ms) to wait for an RSSI measurement before giving up on it.
+#define RFM69_RSSI_TIMEOUT_TICKS (uint16_t) TIMER2_MS_TO_TICKS(3)
 
 // Value used in rfm69_set_encryption() to indicate we don't want any encryption.
 #define RFM69_NO_ENCRYPTION_VAL 0
 
-/* Number of times Timer 2 needs to overflow to timeout during RFM69 collision avoidance in transmission operations.  Add .99 at the end to 
-   almost always round up to the next overflow, so we never wait less than the specified ms timeout (and usually more, but this shouldn't be as big of a deal). */
-#define TIMER2_OVERFLOWS_BEFORE_COLLISION_AVOIDANCE_TIMEOUT (uint8_t) ((RFM69_COLLISION_AVOIDANCE_LIMIT_MS / TIMER2_MS_TO_OVERFLOW) + .99)
+// Scheduler ticks to wait during RFM69 collision avoidance in transmission operations - rounded up, like the init timeout
+#define RFM69_COLLISION_AVOIDANCE_TIMEOUT_TICKS TIMER2_MS_TO_TICKS(RFM69_COLLISION_AVOIDANCE_LIMIT_MS)
+
+_Static_assert(RFM69_COLLISION_AVOIDANCE_LIMIT_MS <= TIMER2_MAX_MS, "collision avoidance limit is too long to convert to ticks");
+
+// Profile rfm69_init() starts the radio with, and its bit rate - see rfm69_profile.h.  With RFM69_ACK a packet, its ACK
+// and a retransmission all have to fit in before the next packet's due, which takes a faster one - and with RFM69_TDMA
+// a slot for each of RFM69_TDMA_SLOTS transmitters and a beacon, which takes faster still.  RFM69_MESSAGES takes the
+// faster one too, so that its longest message fits in a packet period, and so does RFM69_AES, whose padding leaves a
+// packet too long for the slower one - every receiver has to change for either anyway.  RFM69_AES with RFM69_ACK
+// takes the faster one again, to fit two padded packets and their ACKs in.
+#if defined(RFM69_TDMA) || (defined(RFM69_ACK) && defined(RFM69_AES))
+#define RFM69_INIT_PROFILE RFM69_PROFILE_55555
+#define RFM69_BITRATE_BPS (uint32_t) 55555
+#elif defined(RFM69_ACK) || defined(RFM69_MESSAGES) || defined(RFM69_AES)
+#define RFM69_INIT_PROFILE RFM69_PROFILE_19200
+#define RFM69_BITRATE_BPS (uint32_t) 19200
+#else
+#define RFM69_INIT_PROFILE RFM69_PROFILE_4800
+#define RFM69_BITRATE_BPS (uint32_t) 4800
+#endif
+
+// Payload bytes in each controller packet.
+#define RFM69_PAYLOAD_LENGTH 4
+
+// Bytes the FIFO holds - the longest packet that can be sent or received without refilling or draining it on the fly.
+#define RFM69_FIFO_LENGTH 66
+
+// With RFM69_MESSAGES packets are variable length, each carrying one of the messages in types/message.h - a length
+// byte counting the rest of the packet, the header if there is one, a message type byte, and the message's body.
+// Otherwise every packet is RFM69_FRAME_LENGTH bytes, and the payload is always a controller packet's data bytes.
+#ifdef RFM69_MESSAGES
+#define RFM69_PACKET_FORMAT RF_PACKET1_FORMAT_VARIABLE
+#define RFM69_LENGTH_BYTES 1
+#define RFM69_TYPE_BYTES 1
+#else
+#define RFM69_PACKET_FORMAT RF_PACKET1_FORMAT_FIXED
+#define RFM69_LENGTH_BYTES 0
+#define RFM69_TYPE_BYTES 0
+#endif
+
+// With RFM69_ACK or RFM69_TDMA each packet starts with a header ahead of the payload - the destination address, which
+// the radio filters incoming packets on, the source address, and a control byte.  RFM69_TDMA's beacons go to
+// RFM69_BROADCAST_ADDRESS.
+#if defined(RFM69_ACK)
+#define RFM69_HEADER_LENGTH 3
+#define RFM69_ADDRESS_FILTERING RF_PACKET1_ADRSFILTERING_NODE
+#elif defined(RFM69_TDMA)
+#define RFM69_HEADER_LENGTH 3
+#define RFM69_ADDRESS_FILTERING RF_PACKET1_ADRSFILTERING_NODEBROADCAST
+#else
+#define RFM69_HEADER_LENGTH 0
+#define RFM69_ADDRESS_FILTERING RF_PACKET1_ADRSFILTERING_OFF
+#endif
+
+// Destination address of packets for every node - RegBroadcastAdrs.
+#define RFM69_BROADCAST_ADDRESS 0xFF
+
+// Position of each header byte.
+#define RFM69_HEADER_DESTINATION (RFM69_LENGTH_BYTES + 0)
+#define RFM69_HEADER_SOURCE (RFM69_LENGTH_BYTES + 1)
+#define RFM69_HEADER_CONTROL (RFM69_LENGTH_BYTES + 2)
+
+// Position of the message type byte, with RFM69_MESSAGES.
+#define RFM69_MESSAGE_TYPE (RFM69_LENGTH_BYTES + RFM69_HEADER_LENGTH)
+
+// Bits of the control byte - whether the sender wants an ACK, whether the packet is one, and a sequence number that
+// retransmissions repeat and ACKs echo back.
+#define RFM69_CONTROL_ACK_REQUEST 0x80
+#define RFM69_CONTROL_ACK 0x40
+#define RFM69_CONTROL_SEQUENCE_MASK 0x3F
+
+// Where an ACK's payload carries the signal strength its sender heard the packet at - as RegRssiValue, -2 * dBm.
+#define RFM69_ACK_RSSI (RFM69_LENGTH_BYTES + RFM69_HEADER_LENGTH)
+
+// With RFM69_FRESHNESS each packet ends with a counter and a MAC, after the payload (see rfm69_freshness.h).
+#ifdef RFM69_FRESHNESS
+#define RFM69_TRAILER_LENGTH RFM69_FRESHNESS_LENGTH
+#else
+#define RFM69_TRAILER_LENGTH 0
+#endif
+
+// Position of the payload.
+#define RFM69_PAYLOAD_START (RFM69_LENGTH_BYTES + RFM69_HEADER_LENGTH + RFM69_TYPE_BYTES)
+
+// Bytes in a packet with the given payload, everything that goes in the FIFO included.
+#define RFM69_FRAME_BYTES(payload_length) (RFM69_PAYLOAD_START + (payload_length) + RFM69_TRAILER_LENGTH)
+
+// Bytes in each controller packet and beacon - in every packet, without RFM69_MESSAGES.
+#define RFM69_FRAME_LENGTH RFM69_FRAME_BYTES(RFM69_PAYLOAD_LENGTH)
+
+// Bytes in each ACK - with RFM69_MESSAGES only as far as RFM69_ACK_RSSI, which keeps its window short, and otherwise
+// padded out to a fixed length packet.
+#ifdef RFM69_MESSAGES
+#define RFM69_ACK_LENGTH (RFM69_ACK_RSSI + 1)
+#else
+#define RFM69_ACK_LENGTH RFM69_FRAME_LENGTH
+#endif
+
+// With RFM69_AES the radio encrypts each packet with AES-128, in RFM69_AES_BLOCK_LENGTH byte blocks, padding the last
+// one out - everything but the length byte and, with address filtering, the destination address, which receivers
+// need in the clear.  So a packet can take longer on air than its length says, and what's encrypted can't be longer
+// than RFM69_AES_MAX_MESSAGE.  Each block takes the radio about RFM69_AES_BLOCK_US to encrypt before the packet goes
+// out, or to decrypt once it's in - a few tens of us at most, well inside the tick every timeout is rounded up by.
+#define RFM69_AES_KEY_LENGTH 16
+#define RFM69_AES_BLOCK_LENGTH 16
+#define RFM69_AES_MAX_MESSAGE 64
+#define RFM69_AES_BLOCK_US 7
+#define RFM69_AES_CLEAR_BYTES (RFM69_LENGTH_BYTES + (RFM69_HEADER_LENGTH > 0 ? 1 : 0))
+
+// Bytes a packet that puts the given number in the FIFO takes on air, between the sync word and the CRC.
+#ifdef RFM69_AES
+#define RFM69_AIR_BYTES(frame_length) (RFM69_AES_CLEAR_BYTES + \
+    ((frame_length) - RFM69_AES_CLEAR_BYTES + RFM69_AES_BLOCK_LENGTH - 1) / RFM69_AES_BLOCK_LENGTH * \
+    RFM69_AES_BLOCK_LENGTH)
+#else
+#define RFM69_AIR_BYTES(frame_length) (frame_length)
+#endif
+
+_Static_assert(RFM69_FRAME_LENGTH - RFM69_AES_CLEAR_BYTES <= RFM69_AES_MAX_MESSAGE,
+               "packets are too long for the radio to encrypt");
+
+// RegPayloadLength - the packet length with fixed length packets, and the longest the receiver takes, after the length
+// byte, with variable length ones.
+#ifdef RFM69_MESSAGES
+#define RFM69_PAYLOAD_LENGTH_REG (RFM69_FIFO_LENGTH - RFM69_LENGTH_BYTES)
+#else
+#define RFM69_PAYLOAD_LENGTH_REG RFM69_FRAME_LENGTH
+#endif
+
+// Microseconds each controller packet takes to send with the initial profile, from the first preamble bit to the last
+// CRC bit - 18.3ms, 5.8ms with RFM69_ACK, or 2.0ms with RFM69_TDMA, a byte or two's worth more with RFM69_MESSAGES,
+// and more again for RFM69_AES' padding.  rfm69_profile_airtime_us() of RFM69_AIR_BYTES() gives it for whichever
+// profile is in use.
+#define RFM69_PACKET_AIRTIME_US RFM69_AIRTIME_US(RFM69_BITRATE_BPS, RFM69_AIR_BYTES(RFM69_FRAME_LENGTH))
+
+// Microseconds a receiver takes to answer a packet with an ACK - from PayloadReady, through reading the packet,
+// loading the ACK and switching to TX, to the ACK's first preamble bit.
+#define RFM69_ACK_TURNAROUND_US 500
+
+// Microseconds it takes the radio to get from sleep to transmitting - the crystal oscillator (250us) and synthesizer
+// (80us) starting up, then the transmitter (5us plus the default 40us PA ramp, times 1.25).  From the SX1231 datasheet.
+#define RFM69_OSC_WAKE_US 250
+#define RFM69_SYNTH_WAKE_US 80
+#define RFM69_TX_WAKE_US 55
 
 enum Rfm69_Mode {
     RFM69_MODE_LISTEN,
@@ -37,20 +194,32 @@ enum Rfm69_Mode {
     RFM69_MODE_SYNTH,
     RFM69_MODE_RX,
     RFM69_MODE_TX
-} Rfm69_Mode;
+};
 
 extern volatile enum Rfm69_Mode rfm69_current_mode;
 extern volatile bool is_rfm69hw;
-extern volatile uint8_t rfm69_power_level;
+extern volatile int8_t rfm69_power_dbm;
+extern struct Rfm69_Profile rfm69_profile;
 
 void rfm69_disable_high_power_regs();
 void rfm69_enable_high_power_regs();
-void rfm69_init(uint16_t module_freq, uint8_t network_id);
-void rfm69_init_high_power(bool is_rfm69hw);
-// Must be 16 bytes - e.g. rfm69_set_encryption("ABCDEFGHIJKLMNOP");
-void rfm69_set_encryption(const char* key);
+void rfm69_init(uint32_t frf, uint8_t network_id);
+void rfm69_init_high_power(bool hw);
+bool rfm69_auto_mode_active();
+bool rfm69_mode_ready();
+bool rfm69_packet_sent();
+bool rfm69_payload_ready();
+uint8_t rfm69_read_rssi();
+bool rfm69_channel_clear(uint8_t rssi);
+void rfm69_set_encryption(const uint8_t* key);
+void rfm69_start_mode(enum Rfm69_Mode new_mode);
+void rfm69_set_auto_modes(uint8_t auto_modes);
 void rfm69_set_mode(enum Rfm69_Mode);
-void rfm69_set_power_level(uint8_t power_level);
+int8_t rfm69_set_power_dbm(int8_t dbm);
+void rfm69_set_frf(uint32_t frf);
+void rfm69_set_profile(const struct Rfm69_Profile* profile);
+void rfm69_write_fifo(const uint8_t* data, uint8_t length);
+void rfm69_read_fifo(uint8_t* data, uint8_t length);
 void rfm69_write_reg(uint8_t reg_addr, uint8_t value);
 uint8_t rfm69_read_reg(uint8_t reg_addr);
 
@@ -0,0 +1,36 @@
+#ifndef RFM69_FREQUENCY_H_
+#define RFM69_FREQUENCY_H_
+
+#include <stdint.h>
+
+/*
+   Carrier frequencies for the RFM69.  RegFrf holds the frequency in steps of the synthesizer's resolution, FXOSC / 2^19
+   (61.035Hz), and RFM69_FRF() works that out for any frequency in Hz.  hz / (32000000 / 2^19) is hz * 2^13 / 500000,
+   so it's done in whole 500kHz steps plus what's left over - neither part can overflow 32 bits - which keeps it to
+   integer math that folds to a constant at compile time, and to three 32-bit divisions at run time without the 64-bit
+   arithmetic avr-gcc would otherwise pull in.
+
+   RFM69_CHANNEL_FRF() does the same for a channel plan - channels spaced evenly up from a base frequency, so that
+   transmitters sharing a site can each be given their own.  Neighbouring channels need to be at least twice the
+   receiver bandwidth apart (see rfm69_profile.h) to stay out of each other's way.
+*/
+
+/* RegFrf for a carrier frequency, rounded to the nearest step. */
+#define RFM69_FRF(hz) \
+    ((uint32_t) (hz) / 500000 * 8192 + ((uint32_t) (hz) % 500000 * 8192 + 250000) / 500000)
+
+/* Carrier frequency, in Hz, for a RegFrf value - rounded down. */
+#define RFM69_FRF_TO_HZ(frf) ((uint32_t) (frf) / 8192 * 500000 + (uint32_t) (frf) % 8192 * 500000 / 8192)
+
+/* RegFrf for a channel of an evenly spaced channel plan. */
+#define RFM69_CHANNEL_FRF(base_hz, spacing_hz, channel) \
+    RFM69_FRF((uint32_t) (base_hz) + (uint32_t) (channel) * (spacing_hz))
+
+/* Whether a frequency is within the bands the SX1231's synthesizer covers - 290 to 340MHz, 424 to 510MHz and 862 to
+   1020MHz.  Which of them a module can actually transmit on depends on its matching network - the RFM69W's part
+   number says which band it was built for. */
+#define RFM69_FREQUENCY_VALID(hz) \
+    (((hz) >= 290000000UL && (hz) <= 340000000UL) || ((hz) >= 424000000UL && (hz) <= 510000000UL) || \
+     ((hz) >= 862000000UL && (hz) <= 1020000000UL))
+
+#endif /* RFM69_FREQUENCY_H_ */
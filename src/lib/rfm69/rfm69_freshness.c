@@ -0,0 +1,189 @@
+#include "rfm69_freshness.h"
+
+#include <string.h>
+
+/* Chaskey's block, and the rounds of its permutation Chaskey-12 runs. */
+#define BLOCK_LENGTH 16
+#define ROUNDS 12
+
+#define ROTL(x, n) (uint32_t) (((x) << (n)) | ((x) >> (32 - (n))))
+
+_Static_assert(RFM69_FRESHNESS_WINDOW <= 32, "the window's bitmap is 32 bits");
+
+static uint32_t read_u32(const uint8_t* bytes)
+{
+    return (uint32_t) bytes[0] | (uint32_t) bytes[1] << 8 | (uint32_t) bytes[2] << 16 | (uint32_t) bytes[3] << 24;
+}
+
+static void write_u32(uint8_t* bytes, uint32_t value)
+{
+    for(uint8_t i = 0; i < 4; i++) {
+        bytes[i] = (uint8_t) (value >> (8 * i));
+    }
+}
+
+/*
+    Multiplies a subkey by x in GF(2^128), which is how Chaskey derives each subkey from the one before.
+*/
+static void times_two(uint32_t* out, const uint32_t* in)
+{
+    out[0] = (in[0] << 1) ^ ((in[3] >> 31) ? 0x87 : 0);
+    out[1] = (in[1] << 1) | (in[0] >> 31);
+    out[2] = (in[2] << 1) | (in[1] >> 31);
+    out[3] = (in[3] << 1) | (in[2] >> 31);
+}
+
+static void permute(uint32_t* v)
+{
+    for(uint8_t round = 0; round < ROUNDS; round++) {
+        v[0] += v[1];
+        v[1] = ROTL(v[1], 5) ^ v[0];
+        v[0] = ROTL(v[0], 16);
+        v[2] += v[3];
+        v[3] = ROTL(v[3], 8) ^ v[2];
+        v[0] += v[3];
+        v[3] = ROTL(v[3], 13) ^ v[0];
+        v[2] += v[1];
+        v[1] = ROTL(v[1], 7) ^ v[2];
+        v[2] = ROTL(v[2], 16);
+    }
+}
+
+/*
+    Works out the Chaskey MAC of a message.
+
+    @param mac - Filled in with the first RFM69_FRESHNESS_MAC_LENGTH bytes of the tag
+    @param message - The message
+    @param length - Bytes in message - at least 1
+*/
+static void chaskey(const struct Rfm69_Freshness_Key* key, uint8_t* mac, const uint8_t* message, uint8_t length)
+{
+    uint32_t v[4];
+    memcpy(v, key->key, sizeof(v));
+
+    for(; length > BLOCK_LENGTH; length -= BLOCK_LENGTH, message += BLOCK_LENGTH) {
+        for(uint8_t i = 0; i < 4; i++) {
+            v[i] ^= read_u32(message + 4 * i);
+        }
+        permute(v);
+    }
+
+    // The last block is padded with a 1 bit and then 0s if it's short, and each case takes its own subkey.
+    uint8_t last[BLOCK_LENGTH] = {0};
+    memcpy(last, message, length);
+    const uint32_t* subkey = key->key1;
+    if(length < BLOCK_LENGTH) {
+        last[length] = 0x01;
+        subkey = key->key2;
+    }
+    for(uint8_t i = 0; i < 4; i++) {
+        v[i] ^= read_u32(last + 4 * i) ^ subkey[i];
+    }
+    permute(v);
+
+    write_u32(last, v[0] ^ subkey[0]);
+    memcpy(mac, last, RFM69_FRESHNESS_MAC_LENGTH);
+}
+
+/*
+    Sets up the MAC key, and the subkeys derived from it.
+
+    @param key - The key to set up
+    @param bytes - RFM69_FRESHNESS_KEY_LENGTH bytes of key
+*/
+void rfm69_freshness_key_init(struct Rfm69_Freshness_Key* key, const uint8_t* bytes)
+{
+    for(uint8_t i = 0; i < 4; i++) {
+        key->key[i] = read_u32(bytes + 4 * i);
+    }
+    times_two(key->key1, key->key);
+    times_two(key->key2, key->key1);
+}
+
+/*
+    Ends a packet with its counter and the MAC over it.
+
+    @param key - The MAC key
+    @param frame - The packet, with room for RFM69_FRESHNESS_LENGTH more bytes after the first length
+    @param length - Bytes in frame so far - everything that goes in the FIFO but the counter and MAC, which can't be
+                    more than 255 - RFM69_FRESHNESS_LENGTH
+    @param counter - The packet's counter - one the transmitter has never sent with this key before
+*/
+void rfm69_freshness_seal(const struct Rfm69_Freshness_Key* key, uint8_t* frame, uint8_t length, uint32_t counter)
+{
+    write_u32(frame + length, counter);
+    chaskey(key, frame + length + RFM69_FRESHNESS_COUNTER_LENGTH, frame, length + RFM69_FRESHNESS_COUNTER_LENGTH);
+}
+
+/*
+    Starts a receiver's window off having accepted nothing, so that whatever counter comes first is fresh.
+*/
+void rfm69_freshness_window_init(struct Rfm69_Freshness_Window* window)
+{
+    memset(window, 0, sizeof(*window));
+}
+
+/*
+    Checks a packet's MAC, and that its counter is one the receiver hasn't accepted before - accepting it if so.
+
+    @param window - The window of the transmitter the packet came from
+    @param key - The MAC key
+    @param frame - The packet, as rfm69_freshness_seal() left it
+    @param length - Bytes in frame, counter and MAC included
+    @return Rfm69_Freshness_Status - RFM69_FRESHNESS_FRESH if it's to be delivered
+*/
+enum Rfm69_Freshness_Status rfm69_freshness_check(struct Rfm69_Freshness_Window* window,
+                                                  const struct Rfm69_Freshness_Key* key, const uint8_t* frame,
+                                                  uint8_t length)
+{
+    if(length <= RFM69_FRESHNESS_LENGTH) {
+        window->stats.forged++;
+        return RFM69_FRESHNESS_FORGED;
+    }
+
+    // Old counters are turned away before the MAC's worked out - it can only make things worse for them.
+    uint32_t counter = rfm69_freshness_counter(frame, length);
+    bool ahead = !window->started || counter > window->highest;
+    uint32_t behind = window->highest - counter;
+    if(!ahead && behind != 0 && (behind >= RFM69_FRESHNESS_WINDOW || (window->seen & ((uint32_t) 1 << behind)))) {
+        window->stats.replayed++;
+        return RFM69_FRESHNESS_REPLAYED;
+    }
+
+    uint8_t mac[RFM69_FRESHNESS_MAC_LENGTH];
+    uint8_t signed_length = length - RFM69_FRESHNESS_MAC_LENGTH;
+    chaskey(key, mac, frame, signed_length);
+    uint8_t difference = 0;
+    for(uint8_t i = 0; i < RFM69_FRESHNESS_MAC_LENGTH; i++) {
+        difference |= mac[i] ^ frame[signed_length + i];
+    }
+    if(difference != 0) {
+        window->stats.forged++;
+        return RFM69_FRESHNESS_FORGED;
+    }
+
+    if(ahead) {
+        uint32_t shift = counter - window->highest;
+        window->seen = (window->started && shift < 32) ? window->seen << shift : 0;
+        window->seen |= 1;
+        window->highest = counter;
+        window->started = true;
+    } else if(behind == 0) {
+        window->stats.repeated++;
+        return RFM69_FRESHNESS_REPEATED;
+    } else {
+        window->seen |= (uint32_t) 1 << behind;
+    }
+    window->stats.fresh++;
+    return RFM69_FRESHNESS_FRESH;
+}
+
+/*
+    @param frame - A packet rfm69_freshness_seal() sealed
+    @param length - Bytes in frame, counter and MAC included - more than RFM69_FRESHNESS_LENGTH
+    @return uint32_t - The counter it carries
+*/
+uint32_t rfm69_freshness_counter(const uint8_t* frame, uint8_t length)
+{
+    return read_u32(frame + length - RFM69_FRESHNESS_LENGTH);
+}
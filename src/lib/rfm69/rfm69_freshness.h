@@ -0,0 +1,80 @@
+#ifndef RFM69_FRESHNESS_H_
+#define RFM69_FRESHNESS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+   Replay protection for packets RFM69_AES encrypts.  The radio's AES is ECB with no nonce, so on its own a recorded
+   packet replays perfectly - the receiver decrypts it to the same bytes as the first time.  So with RFM69_FRESHNESS
+   each packet ends with a counter, which goes up by one for every new packet a transmitter sends, and a MAC over the
+   whole packet, counter included:
+
+       | length | header | type | payload | counter (4) | MAC (4) |
+
+   The MAC is Chaskey-12, truncated to RFM69_FRESHNESS_MAC_LENGTH bytes, under a key of its own.  Chaskey is built from
+   32 bit adds, rotates and XORs, which an 8 bit AVR without a multiplier or AES hardware of its own should get through
+   far quicker than anything built on a block cipher, and a controller packet is short enough for a single permutation
+   - RFM69_FRESHNESS_SEAL_CYCLES is the per-packet budget it's meant to stay under, though that's yet to be measured.
+   The counter and MAC still fit in the padding AES adds to a controller packet, so they cost no airtime.
+
+   The receiver keeps a struct Rfm69_Freshness_Window for each transmitter - the highest counter it's accepted, and
+   which of the RFM69_FRESHNESS_WINDOW below it have been too - so that packets arriving out of order still get
+   through, once each.  The packet carrying the highest counter is RFM69_FRESHNESS_REPEATED if it comes again, which a
+   retransmission whose ACK was lost does, so that it can be ACKed again without being delivered twice.
+
+   Nothing here touches the radio, so the host tools share it.
+*/
+
+/* Bytes of each part of the trailer a packet ends with, and the key. */
+#define RFM69_FRESHNESS_COUNTER_LENGTH 4
+#define RFM69_FRESHNESS_MAC_LENGTH 4
+#define RFM69_FRESHNESS_LENGTH (RFM69_FRESHNESS_COUNTER_LENGTH + RFM69_FRESHNESS_MAC_LENGTH)
+#define RFM69_FRESHNESS_KEY_LENGTH 16
+
+/* Counters below the highest a receiver has accepted that it still takes, if it hasn't yet - at most 32. */
+#define RFM69_FRESHNESS_WINDOW 32
+
+/* CPU cycles rfm69_freshness_seal() may take on a controller packet - 1ms at 4MHz.  This is an unverified estimate:
+   neither it nor the 2000 or so cycles a Chaskey-12 permutation is expected to take on an AVR has been measured, on
+   hardware or in a cycle-accurate simulator.  util/radio_power.c times each seal against it with Timer1, so
+   max_seal_cycles and slow_seals in struct Radio_Power_Stats are the numbers to check it by on a real board. */
+#define RFM69_FRESHNESS_SEAL_CYCLES 4000
+
+/* Chaskey's key, and the two subkeys it derives from it for the last block of a message - all as 32 bit words. */
+struct Rfm69_Freshness_Key {
+    uint32_t key[4];
+    uint32_t key1[4];           // for a last block that's whole
+    uint32_t key2[4];           // for one that's padded
+};
+
+enum Rfm69_Freshness_Status {
+    RFM69_FRESHNESS_FRESH,      // a counter not seen before - deliver it
+    RFM69_FRESHNESS_REPEATED,   // the highest counter seen, again - ACK it, but don't deliver it
+    RFM69_FRESHNESS_REPLAYED,   // a counter seen before, or too far behind to tell
+    RFM69_FRESHNESS_FORGED      // a MAC that doesn't match, or too short to have one
+};
+
+struct Rfm69_Freshness_Stats {
+    uint32_t fresh;
+    uint32_t repeated;
+    uint32_t replayed;
+    uint32_t forged;
+};
+
+struct Rfm69_Freshness_Window {
+    bool started;               // accepted a packet yet
+    uint32_t highest;           // the highest counter accepted
+    uint32_t seen;              // bit n set if highest - n has been accepted
+    struct Rfm69_Freshness_Stats stats;
+};
+
+void rfm69_freshness_key_init(struct Rfm69_Freshness_Key* key, const uint8_t* bytes);
+void rfm69_freshness_seal(const struct Rfm69_Freshness_Key* key, uint8_t* frame, uint8_t length, uint32_t counter);
+void rfm69_freshness_window_init(struct Rfm69_Freshness_Window* window);
+enum Rfm69_Freshness_Status rfm69_freshness_check(struct Rfm69_Freshness_Window* window,
+                                                  const struct Rfm69_Freshness_Key* key, const uint8_t* frame,
+                                                  uint8_t length);
+uint32_t rfm69_freshness_counter(const uint8_t* frame, uint8_t length);
+
+#endif /* RFM69_FRESHNESS_H_ */
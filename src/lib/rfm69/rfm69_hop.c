@@ -0,0 +1,106 @@
+#include "rfm69_hop.h"
+#include "rfm69_frequency.h"
+
+/* Home position in the hop sequence - where transmitters start and lost receivers wait. */
+#define HOME_INDEX 0
+
+/*
+    Steps a 16-bit xorshift generator - small and quick on an 8-bit MCU, and all the shuffle needs.
+
+    @param state - Generator state, which must never be zero
+    @return uint16_t - The next value, also left in state
+*/
+static uint16_t xorshift16(uint16_t* state)
+{
+    *state ^= *state << 7;
+    *state ^= *state >> 9;
+    *state ^= *state << 8;
+    return *state;
+}
+
+/*
+    Shuffles the channels of an evenly spaced plan into a hop sequence, and works out each one's RegFrf.
+
+    @param plan - Filled in with the sequence
+    @param network_id - Keys the shuffle, so that every network hops through the channels in its own order
+    @param base_hz - Frequency of channel 0
+    @param spacing_hz - Distance between channels - at least twice the receiver bandwidth
+*/
+void rfm69_hop_plan_init(struct Rfm69_Hop_Plan* plan, uint8_t network_id, uint32_t base_hz, uint32_t spacing_hz)
+{
+    // The high byte keeps the seed away from zero for every network ID.
+    uint16_t state = 0xA500 | network_id;
+
+    for(uint8_t i = 0; i < RFM69_HOP_CHANNELS; i++) {
+        plan->channel[i] = i;
+    }
+
+    // Fisher-Yates - the modulo bias is too small to matter for a hop sequence.
+    for(uint8_t i = RFM69_HOP_CHANNELS - 1; i > 0; i--) {
+        uint8_t j = (uint8_t) (xorshift16(&state) % (i + 1));
+        uint8_t channel = plan->channel[i];
+        plan->channel[i] = plan->channel[j];
+        plan->channel[j] = channel;
+    }
+
+    for(uint8_t i = 0; i < RFM69_HOP_CHANNELS; i++) {
+        plan->frf[i] = RFM69_CHANNEL_FRF(base_hz, spacing_hz, plan->channel[i]);
+    }
+}
+
+/*
+    Starts a receiver off parked on the home channel, waiting for the transmitter.
+
+    @param receiver - The receiver to start
+    @param plan - The hop sequence the transmitter follows
+*/
+void rfm69_hop_rx_init(struct Rfm69_Hop_Receiver* receiver, const struct Rfm69_Hop_Plan* plan)
+{
+    receiver->plan = plan;
+    receiver->index = HOME_INDEX;
+    receiver->misses = 0;
+    receiver->locked = false;
+}
+
+/*
+    @return uint32_t - RegFrf of the channel the receiver should be listening on
+*/
+uint32_t rfm69_hop_rx_frf(const struct Rfm69_Hop_Receiver* receiver)
+{
+    return receiver->plan->frf[receiver->index];
+}
+
+/*
+    Moves a receiver on to the next channel after it hears a packet, following the transmitter from then on.  Retune
+    to rfm69_hop_rx_frf() afterwards.
+*/
+void rfm69_hop_rx_heard(struct Rfm69_Hop_Receiver* receiver)
+{
+    receiver->locked = true;
+    receiver->misses = 0;
+    receiver->index = RFM69_HOP_NEXT(receiver->index);
+}
+
+/*
+    Call once for each slot - the time from one packet to the next - that goes by without the receiver hearing one.
+    Retune to rfm69_hop_rx_frf() afterwards.
+*/
+void rfm69_hop_rx_missed(struct Rfm69_Hop_Receiver* receiver)
+{
+    receiver->misses++;
+
+    if(receiver->locked) {
+        if(receiver->misses < RFM69_HOP_MAX_MISSES) {
+            // Most likely the one packet was lost, and the transmitter has moved on regardless.
+            receiver->index = RFM69_HOP_NEXT(receiver->index);
+        } else {
+            receiver->locked = false;
+            receiver->misses = 0;
+            receiver->index = HOME_INDEX;
+        }
+    } else if(receiver->misses >= RFM69_HOP_CHANNELS) {
+        // The transmitter should have come by in a full pass through the sequence, so this channel may be jammed.
+        receiver->misses = 0;
+        receiver->index = RFM69_HOP_NEXT(receiver->index);
+    }
+}
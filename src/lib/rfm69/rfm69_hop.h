@@ -0,0 +1,57 @@
+#ifndef RFM69_HOP_H_
+#define RFM69_HOP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+   Frequency hopping - each packet goes out on the next channel of a pseudo-random sequence through
+   RFM69_HOP_CHANNELS channels, so interference on any one frequency only costs the packets that land on it.
+
+   rfm69_hop_plan_init() shuffles the channels of an evenly spaced plan into a sequence keyed on the network ID, so
+   transmitters on different networks hop differently, and works out every channel's RegFrf up front - retuning for a
+   packet is then a table lookup and a single burst write with rfm69_set_frf().  Position 0 of the sequence is the home
+   channel.  A transmitter starts from it whenever its packet rate changes, and only hops at a rate a receiver can
+   follow - a slow heartbeat stays on the home channel.
+
+   struct Rfm69_Hop_Receiver is the receiving end.  Once it has heard a packet it follows the transmitter along the
+   sequence, moving on after each packet or each slot that goes by without one - a jammed packet costs just that
+   packet.  After RFM69_HOP_MAX_MISSES slots in a row without a packet it assumes the transmitter has stopped hopping
+   or it has lost it, and parks on the home channel - where heartbeats arrive, and where the transmitter starts from
+   when it picks up its packet rate again.  A full pass through the sequence without hearing anything moves it on to
+   park on the next channel, in case the home channel is the one being jammed - it still catches the transmitter
+   within a pass once it's hopping.
+
+   Nothing here touches the radio, so the host tools share it.
+*/
+
+/* Channels in the hop sequence - a power of two, so wrapping around it is a mask. */
+#define RFM69_HOP_CHANNELS 8
+
+/* Slots in a row a receiver can go without a packet before it gives up following the transmitter. */
+#define RFM69_HOP_MAX_MISSES 3
+
+_Static_assert((RFM69_HOP_CHANNELS & (RFM69_HOP_CHANNELS - 1)) == 0, "RFM69_HOP_CHANNELS must be a power of two");
+
+/* Position after the given one in the hop sequence. */
+#define RFM69_HOP_NEXT(index) (uint8_t) (((index) + 1) & (RFM69_HOP_CHANNELS - 1))
+
+struct Rfm69_Hop_Plan {
+    uint32_t frf[RFM69_HOP_CHANNELS];       // RegFrf of each position in the sequence
+    uint8_t channel[RFM69_HOP_CHANNELS];    // channel of the plan at each position
+};
+
+struct Rfm69_Hop_Receiver {
+    const struct Rfm69_Hop_Plan* plan;
+    uint8_t index;          // position in the sequence it's listening on
+    uint8_t misses;         // slots in a row without a packet
+    bool locked;            // following the transmitter, rather than parked waiting for it
+};
+
+void rfm69_hop_plan_init(struct Rfm69_Hop_Plan* plan, uint8_t network_id, uint32_t base_hz, uint32_t spacing_hz);
+void rfm69_hop_rx_init(struct Rfm69_Hop_Receiver* receiver, const struct Rfm69_Hop_Plan* plan);
+uint32_t rfm69_hop_rx_frf(const struct Rfm69_Hop_Receiver* receiver);
+void rfm69_hop_rx_heard(struct Rfm69_Hop_Receiver* receiver);
+void rfm69_hop_rx_missed(struct Rfm69_Hop_Receiver* receiver);
+
+#endif /* RFM69_HOP_H_ */
@@ -0,0 +1,58 @@
+#include "rfm69_power.h"
+
+/* Moves the output power to the given level, kept within the module's range. */
+static bool set_dbm(struct Rfm69_Power_Control* control, int16_t dbm)
+{
+    if(dbm < control->min_dbm) {
+        dbm = control->min_dbm;
+    } else if(dbm > control->max_dbm) {
+        dbm = control->max_dbm;
+    }
+
+    bool changed = (dbm != control->dbm);
+    control->dbm = (int8_t) dbm;
+    return changed;
+}
+
+/*
+    Starts power control off at full power, until the receiver says how much of it it needs.
+
+    @param control - The controller to start
+    @param min_dbm - Lowest output power the module can transmit at
+    @param max_dbm - Highest
+*/
+void rfm69_power_control_init(struct Rfm69_Power_Control* control, int8_t min_dbm, int8_t max_dbm)
+{
+    control->min_dbm = min_dbm;
+    control->max_dbm = max_dbm;
+    control->dbm = max_dbm;
+}
+
+/*
+    Steers the output power toward the target margin, going by how strong the receiver heard a packet.
+
+    @param rssi_dbm - Signal strength the receiver heard the packet at, from its ACK
+    @return bool - true if the output power changed
+*/
+bool rfm69_power_control_heard(struct Rfm69_Power_Control* control, int16_t rssi_dbm)
+{
+    int16_t excess_db = rssi_dbm - (RFM69_POWER_SENSITIVITY_DBM + RFM69_POWER_TARGET_MARGIN_DB);
+
+    if(excess_db > RFM69_POWER_HYSTERESIS_DB) {
+        return set_dbm(control, control->dbm - excess_db / 2);
+    }
+    if(excess_db < -RFM69_POWER_HYSTERESIS_DB) {
+        return set_dbm(control, control->dbm - excess_db);
+    }
+    return false;
+}
+
+/*
+    Raises the output power after a packet's ACK didn't come back.
+
+    @return bool - true if the output power changed, false if it was already at full power
+*/
+bool rfm69_power_control_lost(struct Rfm69_Power_Control* control)
+{
+    return set_dbm(control, control->dbm + RFM69_POWER_LOSS_STEP_DB);
+}
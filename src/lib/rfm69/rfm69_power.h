@@ -0,0 +1,55 @@
+#ifndef RFM69_POWER_H_
+#define RFM69_POWER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+   Transmit power - the output power range of each module, and closed loop control of where in it to transmit.
+
+   The RFM69W transmits from PA0, from -18 to +13dBm.  The RFM69HW has PA1 on its own up to +13dBm, PA1 and PA2
+   together up to +17dBm, and the same with the high power settings in RegTestPa1 and RegTestPa2 up to +20dBm - those
+   settings cost the most, and must be off while receiving, so rfm69_set_power_dbm() only turns them on above +17dBm.
+   TX current falls with output power - 45mA at +13dBm on the RFM69W, against 20mA at 0dBm.
+
+   struct Rfm69_Power_Control steers the output power from link quality feedback.  Each ACK (see util/radio_power.h)
+   carries the signal strength the receiver heard the packet at, and the power comes down while that leaves more than
+   RFM69_POWER_TARGET_MARGIN_DB above what the receiver needs - half the excess at a time, so fading doesn't make it
+   swing - and straight back up to it when there's less.  A packet whose ACK never comes raises the power by
+   RFM69_POWER_LOSS_STEP_DB, so a link that has faded out altogether climbs back to full power in a few packets.
+
+   Nothing here touches the radio, so the host tools share it.
+*/
+
+/* Output power ranges, in dBm. */
+#define RFM69W_MIN_POWER_DBM -18
+#define RFM69W_MAX_POWER_DBM 13
+#define RFM69HW_MIN_POWER_DBM -2
+#define RFM69HW_MAX_POWER_DBM 20
+
+/* Highest output power the RFM69HW reaches without its high power settings. */
+#define RFM69HW_MAX_NORMAL_POWER_DBM 17
+
+/* Signal strength, in dBm, the receiver needs at the bit rates the firmware uses - the RFM69's sensitivity with the
+   receiver bandwidth of the 19.2kbps profile, rounded up. */
+#define RFM69_POWER_SENSITIVITY_DBM -105
+
+/* Margin, in dB, to keep above the receiver's sensitivity for fading, and how far either side of it the signal can
+   wander before the power changes. */
+#define RFM69_POWER_TARGET_MARGIN_DB 15
+#define RFM69_POWER_HYSTERESIS_DB 3
+
+/* dB to raise the power by for each packet whose ACK doesn't come back. */
+#define RFM69_POWER_LOSS_STEP_DB 4
+
+struct Rfm69_Power_Control {
+    int8_t dbm;             // output power to transmit at
+    int8_t min_dbm;
+    int8_t max_dbm;
+};
+
+void rfm69_power_control_init(struct Rfm69_Power_Control* control, int8_t min_dbm, int8_t max_dbm);
+bool rfm69_power_control_heard(struct Rfm69_Power_Control* control, int16_t rssi_dbm);
+bool rfm69_power_control_lost(struct Rfm69_Power_Control* control);
+
+#endif /* RFM69_POWER_H_ */
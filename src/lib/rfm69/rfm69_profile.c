@@ -0,0 +1,111 @@
+#include "rfm69_profile.h"
+#include "rfm69_registers.h"
+
+/* RegRxBw's mantissas, narrowest filter first - each is the divider for one exponent. */
+static const uint8_t RXBW_MANTISSAS[] = { RF_RXBW_MANT_24, RF_RXBW_MANT_20, RF_RXBW_MANT_16 };
+
+/* Largest RegRxBw exponent, for the narrowest filters. */
+#define RXBW_MAX_EXP RF_RXBW_EXP_7
+
+/* Largest RX restart delay RegPacketConfig2 can hold, as a power of two in bits. */
+#define RX_RESTART_DELAY_MAX_SHIFT 11
+
+struct Profile_Settings {
+    uint32_t bitrate_bps;
+    uint32_t fdev_hz;
+    uint8_t shaping;
+};
+
+static const struct Profile_Settings PROFILE_SETTINGS[RFM69_NUM_PROFILES] = {
+    [RFM69_PROFILE_1200] = { 1200, 5000, RF_DATAMODUL_MODULATIONSHAPING_00 },
+    [RFM69_PROFILE_4800] = { 4800, 50000, RF_DATAMODUL_MODULATIONSHAPING_00 },
+    [RFM69_PROFILE_19200] = { 19200, 20000, RF_DATAMODUL_MODULATIONSHAPING_00 },
+    [RFM69_PROFILE_55555] = { 55555, 50000, RF_DATAMODUL_MODULATIONSHAPING_00 },
+    // Gaussian filtering (BT = 1.0) keeps the faster profiles from splattering into the channels either side.
+    [RFM69_PROFILE_100000] = { 100000, 100000, RF_DATAMODUL_MODULATIONSHAPING_01 },
+    [RFM69_PROFILE_250000] = { 250000, 125000, RF_DATAMODUL_MODULATIONSHAPING_01 }
+};
+
+/*
+    @return uint8_t - The RegRxBw value for the narrowest channel filter at least the given bandwidth, with the DC
+                      canceller at its recommended 4% of it
+*/
+static uint8_t narrowest_rxbw(uint32_t min_hz)
+{
+    for(int8_t exp = RXBW_MAX_EXP; exp >= 0; exp--) {
+        for(uint8_t i = 0; i < sizeof(RXBW_MANTISSAS); i++) {
+            uint8_t rxbw = RXBW_MANTISSAS[i] | (uint8_t) exp;
+            if(RFM69_RXBW_HZ(rxbw) >= min_hz) {
+                return RF_RXBW_DCCFREQ_010 | rxbw;
+            }
+        }
+    }
+
+    // RFM69_PROFILE_VALID() keeps min_hz within the widest filter.
+    return RF_RXBW_DCCFREQ_010 | RF_RXBW_MANT_16 | RF_RXBW_EXP_0;
+}
+
+/*
+    @return uint8_t - The RF_PACKET2_RXRESTARTDELAY_x value for the shortest delay that outlasts the PA ramping down
+*/
+static uint8_t rx_restart_delay(uint32_t bitrate_bps)
+{
+    // Bits that go by while the PA ramps down, rounded up.
+    uint32_t ramp_bits = (RFM69_PA_RAMP_US * bitrate_bps + 999999) / 1000000;
+    uint8_t shift = 0;
+
+    while((1UL << shift) < ramp_bits && shift < RX_RESTART_DELAY_MAX_SHIFT) {
+        shift++;
+    }
+    return (uint8_t) (shift << 4);
+}
+
+/*
+    Works out the register values for an FSK profile.
+
+    @param bitrate_bps - Bits per second, from 1200 to 300000
+    @param fdev_hz - Frequency deviation - see RFM69_PROFILE_VALID() for what it has to be within
+    @param shaping - One of the RF_DATAMODUL_MODULATIONSHAPING_x values - 00 for none, or a Gaussian filter
+    @param profile - Filled in with the register values
+    @return bool - false, leaving profile alone, if the datasheet doesn't allow that bit rate and deviation
+*/
+bool rfm69_profile_compute(uint32_t bitrate_bps, uint32_t fdev_hz, uint8_t shaping, struct Rfm69_Profile* profile)
+{
+    if(!RFM69_PROFILE_VALID(bitrate_bps, fdev_hz)) {
+        return false;
+    }
+
+    profile->bitrate_bps = bitrate_bps;
+    profile->fdev_hz = fdev_hz;
+    profile->bitrate_divider = RFM69_BITRATE_DIVIDER(bitrate_bps);
+    profile->fdev_steps = RFM69_FDEV_STEPS(fdev_hz);
+    profile->shaping = shaping & RF_DATAMODUL_MODULATIONSHAPING_11;
+    profile->rxbw = narrowest_rxbw(fdev_hz + bitrate_bps / 2);
+    profile->rx_restart_delay = rx_restart_delay(bitrate_bps);
+    return true;
+}
+
+/*
+    @param id - Which of the ready made profiles
+    @param profile - Filled in with its register values
+    @return bool - false if id isn't a profile
+*/
+bool rfm69_profile_get(enum Rfm69_Profile_Id id, struct Rfm69_Profile* profile)
+{
+    if(id >= RFM69_NUM_PROFILES) {
+        return false;
+    }
+
+    const struct Profile_Settings* settings = &PROFILE_SETTINGS[id];
+    return rfm69_profile_compute(settings->bitrate_bps, settings->fdev_hz, settings->shaping, profile);
+}
+
+/*
+    @param profile - The profile the packet is sent with
+    @param payload_length - Bytes of payload in the packet
+    @return uint32_t - Microseconds from its first preamble bit going on air to its last CRC bit
+*/
+uint32_t rfm69_profile_airtime_us(const struct Rfm69_Profile* profile, uint8_t payload_length)
+{
+    return RFM69_AIRTIME_US(profile->bitrate_bps, payload_length);
+}
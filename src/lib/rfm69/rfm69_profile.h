@@ -0,0 +1,82 @@
+#ifndef RFM69_PROFILE_H_
+#define RFM69_PROFILE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+   Radio profiles - the bit rate, frequency deviation and pulse shaping the RFM69 modulates with, along with the
+   receiver bandwidth and RX restart delay that suit them.  Slower profiles get by with a narrower receiver, which lets
+   in less noise and so hears weaker signals - each halving of the bandwidth is worth about 3dB, or 40% more range in
+   free space - while faster ones get each packet on air sooner.
+
+   rfm69_profile_compute() works the register values out from a bit rate and deviation, within the limits the SX1231
+   datasheet sets on them, and rfm69_profile_get() does the same for the ready made profiles in enum Rfm69_Profile_Id.
+   Nothing here touches the radio, so the host tools share it - rfm69_set_profile() applies one.
+*/
+
+/* The SX1231's crystal, which the bit rate and deviation are divided down from. */
+#define RFM69_FXOSC_HZ (uint32_t) 32000000
+
+/* Limits on FSK modulation from the SX1231 datasheet. */
+#define RFM69_MIN_BITRATE_BPS (uint32_t) 1200
+#define RFM69_MAX_BITRATE_BPS (uint32_t) 300000
+#define RFM69_MIN_FDEV_HZ (uint32_t) 600
+#define RFM69_MAX_RXBW_HZ (uint32_t) 500000
+
+/* Microseconds the transmitter's PA takes to ramp down - RegPaRamp is left at its default.  The receiver has to wait
+   at least this long before restarting after a packet, or it can lock onto the tail of the one it just had. */
+#define RFM69_PA_RAMP_US (uint32_t) 40
+
+/* Packet format rfm69_init() configures, which every profile sends with. */
+#define RFM69_PREAMBLE_BYTES 3          // RegPreamble is left at its default
+#define RFM69_SYNC_BYTES 2
+#define RFM69_CRC_BYTES 2
+
+/* Microseconds a fixed length packet takes to send at a bit rate, from the first preamble bit to the last CRC bit. */
+#define RFM69_AIRTIME_US(bitrate_bps, payload_length) \
+    ((uint32_t) (RFM69_PREAMBLE_BYTES + RFM69_SYNC_BYTES + (payload_length) + RFM69_CRC_BYTES) * 8 * 1000000 \
+     / (bitrate_bps))
+
+/* RegFdev for a deviation - in 61Hz steps of FXOSC / 2^19, worked out as hz * 2^11 / 125000 so it fits 32 bits. */
+#define RFM69_FDEV_STEPS(fdev_hz) (uint16_t) (((uint32_t) (fdev_hz) * 2048 + 62500) / 125000)
+
+/* RegBitrate for a bit rate - FXOSC divided down, rounded to the nearest. */
+#define RFM69_BITRATE_DIVIDER(bitrate_bps) (uint16_t) ((RFM69_FXOSC_HZ + (bitrate_bps) / 2) / (bitrate_bps))
+
+/* Single side bandwidth of the receiver's channel filter in FSK, for a RegRxBw value. */
+#define RFM69_RXBW_HZ(rxbw) (RFM69_FXOSC_HZ / ((16 + 4 * (((rxbw) >> 3) & 0x03)) << (((rxbw) & 0x07) + 2)))
+
+/* The datasheet's rules for FSK: a modulation index 2 * Fdev / BitRate of at least 0.5, and Fdev + BitRate / 2 no
+   more than 500kHz, which the receiver's bandwidth must then cover.  It also asks for an index of no more than 10,
+   which isn't enforced - 4.8kbps with 50kHz deviation is well over, and it's what receivers already out there expect. */
+#define RFM69_PROFILE_VALID(bitrate_bps, fdev_hz) \
+    ((bitrate_bps) >= RFM69_MIN_BITRATE_BPS && (bitrate_bps) <= RFM69_MAX_BITRATE_BPS && \
+     (fdev_hz) >= RFM69_MIN_FDEV_HZ && 4 * (uint32_t) (fdev_hz) >= (bitrate_bps) && \
+     (fdev_hz) + (bitrate_bps) / 2 <= RFM69_MAX_RXBW_HZ)
+
+enum Rfm69_Profile_Id {
+    RFM69_PROFILE_1200,         // longest range - 5kHz deviation, 6.25kHz receiver
+    RFM69_PROFILE_4800,         // what rfm69_init() starts with - 50kHz deviation, 62.5kHz receiver
+    RFM69_PROFILE_19200,
+    RFM69_PROFILE_55555,
+    RFM69_PROFILE_100000,
+    RFM69_PROFILE_250000,       // lowest latency - a packet is on air in under half a millisecond
+    RFM69_NUM_PROFILES
+};
+
+struct Rfm69_Profile {
+    uint32_t bitrate_bps;
+    uint32_t fdev_hz;
+    uint16_t bitrate_divider;   // RegBitrate
+    uint16_t fdev_steps;        // RegFdev
+    uint8_t shaping;            // RF_DATAMODUL_MODULATIONSHAPING_x bits of RegDataModul
+    uint8_t rxbw;               // RegRxBw
+    uint8_t rx_restart_delay;   // RF_PACKET2_RXRESTARTDELAY_x bits of RegPacketConfig2
+};
+
+bool rfm69_profile_compute(uint32_t bitrate_bps, uint32_t fdev_hz, uint8_t shaping, struct Rfm69_Profile* profile);
+bool rfm69_profile_get(enum Rfm69_Profile_Id id, struct Rfm69_Profile* profile);
+uint32_t rfm69_profile_airtime_us(const struct Rfm69_Profile* profile, uint8_t payload_length);
+
+#endif /* RFM69_PROFILE_H_ */
@@ -0,0 +1,118 @@
+#include "rfm69_rx.h"
+
+#ifdef RFM69_RECEIVER
+
+#include "../../util/power.h"
+#include "../../util/scheduler.h"
+
+#include <stddef.h>
+#include <avr/interrupt.h>
+
+#define POOL_MASK (RFM69_RX_POOL_PACKETS - 1)
+
+volatile struct Rfm69_Rx_Stats rfm69_rx_stats = {0};
+
+/* The pool, as a ring - the ISR fills the slot at head, and the main loop takes the one at tail.  Each index is only
+   ever written by one side, and a byte's read and written in one go, so neither needs a lock. */
+static struct Rfm69_Rx_Packet pool[RFM69_RX_POOL_PACKETS];
+static volatile uint8_t head = 0;
+static volatile uint8_t tail = 0;
+
+/*
+    Starts the radio listening, and catching what it hears.  Call once rfm69_init() has set it up, with its AES key
+    in if RFM69_AES is.
+*/
+void rfm69_rx_start()
+{
+    rfm69_write_reg(REG_NODEADRS, RFM69W_GATEWAY_ADDRESS);
+    rfm69_write_reg(REG_DIOMAPPING1, RF_DIOMAPPING1_DIO0_01);
+
+    power_hold(POWER_HOLD_RADIO);
+    EICRA = (EICRA & ~((1 << ISC01) | (1 << ISC00))) | (1 << ISC01) | (1 << ISC00);
+    EIFR = (1 << INTF0);
+    EIMSK |= (1 << INT0);
+    rfm69_set_mode(RFM69_MODE_RX);
+}
+
+/*
+    Stops listening, leaving the radio in standby.  Packets already in the pool stay there to be taken.
+*/
+void rfm69_rx_stop()
+{
+    EIMSK &= ~(1 << INT0);
+    power_release(POWER_HOLD_RADIO);
+    rfm69_set_mode(RFM69_MODE_STANDBY);
+}
+
+/*
+    @return const struct Rfm69_Rx_Packet* - The packet that's been waiting longest, to be handed back with
+                                            rfm69_rx_release() once it's been dealt with - NULL if there isn't one
+*/
+const struct Rfm69_Rx_Packet* rfm69_rx_take()
+{
+    uint8_t taken = tail;
+    return taken != head ? &pool[taken & POOL_MASK] : NULL;
+}
+
+/*
+    Hands a packet from rfm69_rx_take() back to the pool, for the ISR to fill again.
+
+    @param packet - The packet - it mustn't be touched afterwards
+*/
+void rfm69_rx_release(const struct Rfm69_Rx_Packet* packet)
+{
+    (void) packet;
+    tail++;
+}
+
+/*
+    @return uint8_t - Packets waiting in the pool, the one taken included
+*/
+uint8_t rfm69_rx_queued()
+{
+    return (uint8_t) (head - tail);
+}
+
+/*
+    DIO0 goes high with PayloadReady - a packet that passed its CRC and address checks is in the FIFO.
+*/
+ISR(INT0_vect)
+{
+    // An edge from before rfm69_rx_start() mapped DIO0 to PayloadReady can still be pending - there's no packet then.
+    if(!rfm69_payload_ready()) {
+        return;
+    }
+
+    uint8_t queued = (uint8_t) (head - tail);
+    if(queued == RFM69_RX_POOL_PACKETS) {
+        // Writing FifoOverrun clears the FIFO, and the radio starts listening again.
+        rfm69_write_reg(REG_IRQFLAGS2, RF_IRQFLAGS2_FIFOOVERRUN);
+        rfm69_rx_stats.dropped++;
+        return;
+    }
+
+    struct Rfm69_Rx_Packet* packet = &pool[head & POOL_MASK];
+    packet->tick = scheduler_now();
+    packet->rssi = rfm69_read_reg(REG_RSSIVALUE);
+#ifdef RFM69_MESSAGES
+    // RegPayloadLength keeps the length byte from counting past the end of the FIFO, but it's cheap to make sure.
+    rfm69_read_fifo(packet->data, RFM69_LENGTH_BYTES);
+    uint8_t rest = packet->data[0];
+    if(rest > RFM69_FIFO_LENGTH - RFM69_LENGTH_BYTES) {
+        rest = RFM69_FIFO_LENGTH - RFM69_LENGTH_BYTES;
+    }
+    rfm69_read_fifo(packet->data + RFM69_LENGTH_BYTES, rest);
+    packet->length = RFM69_LENGTH_BYTES + rest;
+#else
+    rfm69_read_fifo(packet->data, RFM69_FRAME_LENGTH);
+    packet->length = RFM69_FRAME_LENGTH;
+#endif
+
+    head++;
+    rfm69_rx_stats.received++;
+    if(queued + 1 > rfm69_rx_stats.max_queued) {
+        rfm69_rx_stats.max_queued = queued + 1;
+    }
+}
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef RFM69_RX_H_
+#define RFM69_RX_H_
+
+#include "rfm69.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+   Receiving with the RFM69, for building a receiver or gateway from this codebase rather than a transmitter.  Build
+   with RFM69_RECEIVER defined, and this file's .c added to the build, to use it - along with whichever of
+   RFM69_MESSAGES, RFM69_ACK, RFM69_TDMA, RFM69_AES and RFM69_FRESHNESS the transmitters are built with, since they
+   set the packet format, but without RFM69_LINK, whose util/radio_power.c drives the radio and INT0 for a transmitter.
+
+   rfm69_rx_start() leaves the radio in RX mode with DIO0 mapped to PayloadReady, and INT0 catching its rising edge -
+   answering to RFM69W_GATEWAY_ADDRESS, which transmitters send to when their packets have a header.  The ISR reads
+   the packet out of the FIFO in a burst - two with RFM69_MESSAGES, the length byte saying how long the second is -
+   straight into the next free struct Rfm69_Rx_Packet of a pool of RFM69_RX_POOL_PACKETS, along with RegRssiValue,
+   which the radio measured as the packet came in, and the tick it came in on.  The radio goes back to listening by
+   itself once the FIFO's empty (AutoRxRestartOn), so the only time spent away from the air is the burst, about 5us
+   a byte at 4MHz.
+
+   The main loop takes packets with rfm69_rx_take(), in the order they came in, and works on them where they are in
+   the pool - no copies - before handing each back with rfm69_rx_release().  Only one is taken at a time.  When the
+   main loop falls behind and the pool's full, the ISR still clears the FIFO, so the radio keeps listening, and only
+   counts the packet as dropped.
+
+   The radio belongs to the ISR from rfm69_rx_start() to rfm69_rx_stop() - anything else that talks to it over SPI in
+   between, like rfm69_read_rssi(), has to do it with INT0 masked.  INT0 only catches DIO0's edge while the I/O clock
+   runs, so rfm69_rx_start() takes POWER_HOLD_RADIO (see util/power.h) to keep scheduler_idle() out of power-save.
+*/
+
+#if defined(RFM69_RECEIVER) && defined(RFM69_LINK)
+#error "RFM69_RECEIVER can't be built with RFM69_LINK - both want the radio and INT0, one to receive and one to send"
+#endif
+
+/* Packets the pool holds - a power of two, so the ring indices wrap for free. */
+#define RFM69_RX_POOL_PACKETS 4
+
+_Static_assert((RFM69_RX_POOL_PACKETS & (RFM69_RX_POOL_PACKETS - 1)) == 0, "the pool must be a power of two");
+
+struct Rfm69_Rx_Packet {
+    uint32_t tick;                      // scheduler_now() as PayloadReady came up
+    uint8_t rssi;                       // RegRssiValue it was heard at - -2 * dBm
+    uint8_t length;                     // bytes in data
+    uint8_t data[RFM69_FIFO_LENGTH];    // what came out of the FIFO - length byte and header included, if there are any
+};
+
+struct Rfm69_Rx_Stats {
+    uint32_t received;                  // put in the pool
+    uint32_t dropped;                   // cleared from the FIFO with the pool full
+    uint8_t max_queued;                 // most packets ever waiting in the pool at once
+};
+
+extern volatile struct Rfm69_Rx_Stats rfm69_rx_stats;
+
+void rfm69_rx_start();
+void rfm69_rx_stop();
+const struct Rfm69_Rx_Packet* rfm69_rx_take();
+void rfm69_rx_release(const struct Rfm69_Rx_Packet* packet);
+uint8_t rfm69_rx_queued();
+
+#endif /* RFM69_RX_H_ */
@@ -0,0 +1,99 @@
+#include "rfm69_tdma.h"
+
+/* Furthest the measured superframe can get from the nominal one - 1/256th of it, or about 3900ppm, far more than any
+   crystal is out by.  A beacon heard on the wrong superframe can't drag it further than that. */
+#define MAX_DRIFT_Q8(nominal_q8) ((nominal_q8) >> 8)
+
+/*
+    Starts out of sync, with the superframe as long as the packet period until beacons say otherwise.
+
+    @param sync - The sync to start
+    @param period_ticks - Ticks in a superframe, going by the transmitter's clock
+*/
+void rfm69_tdma_init(struct Rfm69_Tdma_Sync* sync, uint16_t period_ticks)
+{
+    sync->locked = false;
+    sync->misses = 0;
+    sync->superframe_tick = 0;
+    sync->nominal_q8 = (uint32_t) period_ticks << 8;
+    sync->period_q8 = sync->nominal_q8;
+}
+
+/*
+    Lines the superframes up with a beacon that's just been heard, and - if it's the one they were expected to bring -
+    corrects the measured superframe by how far off it was.
+
+    @param tick - Tick the beacon's last bit was heard on
+    @param superframes - Superframes since the last beacon heard, or 0 if it wasn't in sync
+*/
+void rfm69_tdma_heard(struct Rfm69_Tdma_Sync* sync, uint32_t tick, uint16_t superframes)
+{
+    if(sync->locked && superframes > 0) {
+        int32_t error = (int32_t) (tick - rfm69_tdma_superframe_tick(sync, superframes));
+        int32_t nominal_q8 = (int32_t) sync->nominal_q8;
+        int32_t period_q8 = (int32_t) sync->period_q8 + error * 256 / superframes / (1 << RFM69_TDMA_DRIFT_SHIFT);
+        int32_t max_drift = MAX_DRIFT_Q8(nominal_q8);
+
+        if(period_q8 > nominal_q8 + max_drift) {
+            period_q8 = nominal_q8 + max_drift;
+        } else if(period_q8 < nominal_q8 - max_drift) {
+            period_q8 = nominal_q8 - max_drift;
+        }
+        sync->period_q8 = (uint32_t) period_q8;
+    }
+
+    sync->locked = true;
+    sync->misses = 0;
+    sync->superframe_tick = tick;
+}
+
+/*
+    Notes a beacon that didn't come when it was due.
+
+    @return bool - false once that's RFM69_TDMA_MAX_MISSES in a row, and it's out of sync
+*/
+bool rfm69_tdma_missed(struct Rfm69_Tdma_Sync* sync)
+{
+    if(++sync->misses >= RFM69_TDMA_MAX_MISSES) {
+        sync->locked = false;
+    }
+    return sync->locked;
+}
+
+/*
+    @param superframes - Superframes on from the last beacon heard
+    @return uint32_t - Tick that superframe starts on, to the nearest tick
+*/
+uint32_t rfm69_tdma_superframe_tick(const struct Rfm69_Tdma_Sync* sync, uint16_t superframes)
+{
+    // Whole ticks and the fraction multiplied out separately, so neither product can overflow 32 bits whatever the
+    // superframe's length.
+    return sync->superframe_tick + (uint32_t) superframes * (sync->period_q8 >> 8) +
+           (((uint32_t) superframes * (sync->period_q8 & 0xFF) + 128) >> 8);
+}
+
+/*
+    Finds the first superframe in which a point a fixed offset into it - a slot, or the time to start listening for
+    the beacon that ends it - is still to come.
+
+    @param tick - Earliest tick the point can fall on
+    @param offset - Ticks from the start of the superframe to the point, which can be negative
+    @return uint16_t - Superframes on from the last beacon heard
+*/
+uint16_t rfm69_tdma_next_superframe(const struct Rfm69_Tdma_Sync* sync, uint32_t tick, int16_t offset)
+{
+    int32_t elapsed = (int32_t) (tick - offset - sync->superframe_tick);
+    if(elapsed <= 0) {
+        return 0;
+    }
+
+    // The division gets it to within one either way of rounding to the nearest tick.
+    uint16_t superframes = (uint16_t) (((uint32_t) elapsed << 8) / sync->period_q8);
+    while(superframes > 0 && (int32_t) (rfm69_tdma_superframe_tick(sync, superframes - 1) + offset - tick) >= 0) {
+        superframes--;
+    }
+    while((int32_t) (rfm69_tdma_superframe_tick(sync, superframes) + offset - tick) < 0) {
+        superframes++;
+    }
+    return superframes;
+}
@@ -0,0 +1,62 @@
+#ifndef RFM69_TDMA_H_
+#define RFM69_TDMA_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+   Time division for transmitters sharing a channel.  The receiver sends a beacon once a superframe - as long as the
+   packet period - and the superframe starts as the beacon's last bit goes out.  It's split into RFM69_TDMA_SLOTS
+   slots, one per transmitter, each taking the slot its node address picks, with the beacon at the end:
+
+       | slot 0 | slot 1 | ... | slot 7 | (spare) | beacon |
+       ^ superframe start                                  ^ next superframe start
+
+   so as long as no two transmitters at a site have the same address modulo RFM69_TDMA_SLOTS, none of them ever
+   collide, and each packet waits the same time for its slot every superframe.
+
+   struct Rfm69_Tdma_Sync follows the receiver's superframes on a transmitter's own clock, in ticks.  A transmitter
+   only listens for one beacon in RFM69_TDMA_BEACON_INTERVAL, and works out where the superframes in between start
+   from how long its clock makes one - nominally the packet period, but measured against each beacon it hears, in
+   1/256ths of a tick, so that a crystal a few tens of ppm out doesn't walk its packets into a neighbour's slot between
+   beacons.  After RFM69_TDMA_MAX_MISSES beacons in a row go missing it counts itself out of sync, and has to find the
+   receiver again.
+
+   Nothing here touches the radio, so the host tools share it.
+*/
+
+/* Slots in each superframe - transmitters a channel can carry. */
+#define RFM69_TDMA_SLOTS 8
+
+/* Slot a transmitter takes, by its node address. */
+#define RFM69_TDMA_SLOT(address) (uint8_t) ((address) % RFM69_TDMA_SLOTS)
+
+/* Superframes between the beacons a transmitter listens for once it's in sync. */
+#define RFM69_TDMA_BEACON_INTERVAL 32
+
+/* Beacons a transmitter can miss in a row before it's out of sync. */
+#define RFM69_TDMA_MAX_MISSES 3
+
+/* Ticks to leave either side of each packet for the timing error of the transmitters in neighbouring slots - a
+   beacon's end is only known to the tick it was heard on. */
+#define RFM69_TDMA_GUARD_TICKS 1
+
+/* Each beacon moves the measured superframe 1/2^n of the way to what it makes it, so that one heard a tick late or
+   early doesn't throw it. */
+#define RFM69_TDMA_DRIFT_SHIFT 2
+
+struct Rfm69_Tdma_Sync {
+    bool locked;                // following the receiver's superframes
+    uint8_t misses;             // beacons missed in a row
+    uint32_t superframe_tick;   // tick the last beacon heard ended on
+    uint32_t nominal_q8;        // superframe, in 1/256ths of a tick - the packet period
+    uint32_t period_q8;         // and as measured against the beacons
+};
+
+void rfm69_tdma_init(struct Rfm69_Tdma_Sync* sync, uint16_t period_ticks);
+void rfm69_tdma_heard(struct Rfm69_Tdma_Sync* sync, uint32_t tick, uint16_t superframes);
+bool rfm69_tdma_missed(struct Rfm69_Tdma_Sync* sync);
+uint32_t rfm69_tdma_superframe_tick(const struct Rfm69_Tdma_Sync* sync, uint16_t superframes);
+uint16_t rfm69_tdma_next_superframe(const struct Rfm69_Tdma_Sync* sync, uint32_t tick, int16_t offset);
+
+#endif /* RFM69_TDMA_H_ */
@@ -0,0 +1,546 @@
+#include "transmitter.h"
+#include "avr_config.h"
+
+#include "types/general_types.h"
+#include "types/message.h"
+#include "types/packet.h"
+#include "types/ring_buffer.h"
+
+#include "util/avr_adc.h"
+#include "util/avr_spi.h"
+#include "util/avr_usart.h"
+#include "util/avr_util.h"
+#include "util/general_util.h"
+#include "util/governor.h"
+#include "util/latency_probe.h"
+#include "util/power.h"
+#include "util/radio_power.h"
+#include "util/scheduler.h"
+#include "util/telemetry.h"
+#include "util/timeout.h"
+#include "util/timing.h"
+#include "util/trace.h"
+
+#include "lib/rfm69/rfm69.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+/* Since the ADC in AVRs output 10 bits, and the center of our joystick is represented by 524,
+   these 8 bits on their own are equivalent to 12 in decimal.  To save space versus transmitting
+   a full 16 bits for this value (6 wasted bits), the other two MSB bits are packed in a different byte 
+   and will need to properly initialized separately. */
+#define DEFAULT_ANALOG_X_Y_BYTE_VAL 0b00001100
+
+/* The misc byte is a mashup of bits that didn't fit into other bytes.  Currently, it contains the 
+   bits detailing the pressed status of three of our buttons, and the two MSB bits for each the x and y
+   axes of our analog stick (AVR's ADC has 10-bit resolution).  See the byte position variables for more clarity. 
+   If you change the misc_byte position variables, *this #define must change, too.* */
+#define DEFAULT_MISC_BYTE 0b01010000
+
+/* The misc byte bits that are buttons rather than analog stick bits. */
+#define MISC_BUTTON_BITS ((1 << LEFT_SHOULDER_BTN_BYTE_POS) | (1 << RIGHT_SHOULDER_BTN_BYTE_POS) | \
+                          (1 << ANALOG_STICK_BTN_BYTE_POS))
+
+/* Scheduler ticks between each debounced sample of the buttons, and between each analog stick conversion (which
+   alternate between the x and y axes) - half a packet period, rounded up.  64 ticks (16.38ms) at 4MHz. */
+#define INPUT_SAMPLE_PERIOD_TICKS (uint16_t) TIMER2_US_TO_TICKS(US_IN_SEC / (2 * PACKET_RATE_HZ))
+
+/* Scheduler ticks between each packet - every other input sample, so each packet carries fresh x and y readings. */
+#define PACKET_PERIOD_TICKS (uint16_t) (2 * INPUT_SAMPLE_PERIOD_TICKS)
+
+/* Input sample period in the governor's idle tier, where packets drop to a GOVERNOR_IDLE_PACKET_RATE_HZ heartbeat.
+   489 ticks (125.2ms) at 4MHz. */
+#define IDLE_INPUT_SAMPLE_PERIOD_TICKS (uint16_t) TIMER2_US_TO_TICKS(US_IN_SEC / (2 * GOVERNOR_IDLE_PACKET_RATE_HZ))
+
+/* Scheduler ticks (4ms) each task may be held up by others before it counts as a missed deadline. */
+#define TASK_DEADLINE_TICKS (uint16_t) TIMER2_MS_TO_TICKS(4)
+
+_Static_assert(PACKET_PERIOD_TICKS % INPUT_SAMPLE_PERIOD_TICKS == 0, "packets must line up with input samples");
+_Static_assert(GOVERNOR_IDLE_PACKET_RATE_HZ < PACKET_RATE_HZ, "the idle heartbeat must be slower than the full packet rate");
+_Static_assert(2 * (uint32_t) IDLE_INPUT_SAMPLE_PERIOD_TICKS <= UINT16_MAX, "GOVERNOR_IDLE_PACKET_RATE_HZ is too low for a 16-bit timer period");
+
+/* Ticks the packet timer runs behind the input timers, so a packet always goes out after the sample it carries. */
+#define PACKET_PHASE_TICKS (uint16_t) 1
+
+static struct Scheduler_Timer sample_inputs_timer;
+static struct Scheduler_Timer start_adc_timer;
+static struct Scheduler_Timer send_packet_timer;
+
+_Static_assert(RFM69_FREQUENCY_VALID(RFM69W_FREQUENCY_HZ), "RFM69W channel is outside the synthesizer's bands");
+#ifdef RFM69_HOPPING
+_Static_assert(RFM69_FREQUENCY_VALID(RFM69W_BASE_FREQUENCY_HZ + (RFM69_HOP_CHANNELS - 1) * RFM69W_CHANNEL_SPACING_HZ),
+               "RFM69W hop channels run outside the synthesizer's bands");
+_Static_assert(2 * (uint32_t) IDLE_INPUT_SAMPLE_PERIOD_TICKS <
+               (RFM69_HOP_MAX_MISSES + RFM69_HOP_CHANNELS) * (uint32_t) PACKET_PERIOD_TICKS,
+               "heartbeats must come often enough to keep a parked hop receiver on the home channel");
+
+/* The channels the radio hops through. */
+static struct Rfm69_Hop_Plan hop_plan;
+#endif
+
+#ifdef RFM69_LINK
+_Static_assert(RADIO_POWER_PACKET_TICKS(RFM69_PACKET_AIRTIME_US) < PACKET_PERIOD_TICKS,
+               "PACKET_RATE_HZ is too high - each radio packet must be on air before the next one is sent");
+#endif
+#if defined(RFM69_LINK) && !defined(RFM69_AUTOMODES) && !defined(RFM69_TDMA)
+static struct Scheduler_Timer prewarm_radio_timer;
+#endif
+
+/* Use UU for our preamble, or training chars.  I selected these characters because the binary value of
+   the 'U' char is 01010101, which supposedly gives the receivers data slicer a nice square wave to sync up with */
+const char TRAINING_CHARS[] = "U";
+
+/* Number of training chars being used - must match the length of the above variable. */
+const uint8_t NUM_TRAINING_CHARS = 1;
+
+/* Bytes in each packet - the training chars, then the start char through the checksum. */
+#define PACKET_LENGTH (sizeof(TRAINING_CHARS) - 1 + PACKET_FRAME_LENGTH)
+
+_Static_assert(PACKET_LENGTH * 10 * US_IN_SEC / BAUD_RATE < TIMER2_TICKS_TO_US(PACKET_PERIOD_TICKS),
+               "PACKET_RATE_HZ is too high - each packet must be on air before the next one is queued");
+
+/* This is the char we'll use to tell the receiver that any bytes that follow are actual data bytes. */
+const char START_CHAR = PACKET_START_CHAR;
+
+/* Number of data chars being sent in the packet.  This should NOT include the checksum char.
+   Currently, we have 'misc_byte', 'button_byte', 'lsb_analog_stick_x_byte', and 'lsb_analog_stick_y_byte' */
+#define NUM_DATA_CHARS PACKET_NUM_DATA_CHARS
+
+#ifdef RFM69_LINK
+_Static_assert(NUM_DATA_CHARS == RFM69_PAYLOAD_LENGTH, "the RFM69 sends each packet's data chars as its payload");
+#endif
+
+/* The part of the data packet indicating whether a button is pressed or unpressed.  See types/packet.h for bit positions. */
+volatile uint8_t button_byte = 0;
+
+/* The part of the data packet containing miscellaneous information that either didn't fit into other bytes or is 
+    a one-off indicator that doesn't fit into other byte groups. */
+volatile uint8_t misc_byte = DEFAULT_MISC_BYTE;
+
+/* The 8 least significant bits of the analog stick x-axis value. */
+volatile uint8_t lsb_analog_stick_x_byte = DEFAULT_ANALOG_X_Y_BYTE_VAL;
+
+/* The 8 least significant bits of the analog stick y-axis value. */
+volatile uint8_t lsb_analog_stick_y_byte = DEFAULT_ANALOG_X_Y_BYTE_VAL;
+
+/* The governor tier the frame rate is currently set for. */
+static enum Governor_Tier frame_tier = GOVERNOR_ACTIVE;
+
+/* Set when a pin change interrupt wakes us from the idle tier, so the main loop can get back to full rate. */
+static volatile bool pin_woken = false;
+
+/* Where each analog stick axis was the last time it moved by more than GOVERNOR_STICK_DEADBAND, and whether it has
+   since the last packet. */
+static volatile uint16_t stick_x_reference = 0;
+static volatile uint16_t stick_y_reference = 0;
+static volatile bool stick_moved = false;
+
+/* The circular buffer that will store our packets while they wait to be sent over USART. */
+struct Ring_Buffer packet_buffer;
+
+/* The ADC channel selected by the AVR's internal ADC multiplexer, determined by a set of registers. */
+volatile enum Adc_Channel selected_adc_channel = NONE;
+
+volatile struct Digital_Input_Status digital_input_status = {.analog_stick_btn_pressed = false, .purple1_btn_pressed = false, .purple2_btn_pressed = false,
+                                                             .purple3_btn_pressed = false, .brown1_btn_pressed = false, .brown2_btn_pressed = false,
+                                                             .brown3_btn_pressed = false, .blue1_btn_pressed = false, .blue2_btn_pressed = false,
+                                                             .left_shoulder_btn_pressed = false, .right_shoulder_btn_pressed = false};
+
+/* The data bytes of the packet currently being built - kept around between packets so we can tell when the user's input changes. */
+static char packet_data[NUM_DATA_CHARS];
+
+/* TODO: Experiment with 50 ohm LNA setting vs. 200 ohm LNA setting */
+
+static void sample_inputs();
+static void start_next_adc_conversion();
+static void send_packet();
+
+#ifdef RFM69_MESSAGES
+
+_Static_assert(PACKET_RATE_HZ <= UINT8_MAX, "PACKET_RATE_HZ has to fit the config message's byte");
+
+/*
+    Posts a message telling the receiver the governor has moved to another tier.
+*/
+static void post_tier_event(enum Governor_Tier tier)
+{
+    uint8_t body[MESSAGE_EVENT_LENGTH];
+
+    body[MESSAGE_EVENT_CODE_INDEX] = MESSAGE_EVENT_TIER;
+    body[MESSAGE_EVENT_ARGUMENT_INDEX] = tier;
+    radio_power_post_message(MESSAGE_EVENT, body);
+}
+
+/*
+    Posts a message telling the receiver how the transmitter is set up.
+*/
+static void post_config()
+{
+    uint8_t body[MESSAGE_CONFIG_LENGTH];
+
+    body[MESSAGE_CONFIG_VERSION_INDEX] = MESSAGE_SET_VERSION;
+    body[MESSAGE_CONFIG_PACKET_RATE_INDEX] = PACKET_RATE_HZ;
+    message_write_u32(&body[MESSAGE_CONFIG_BITRATE_INDEX], rfm69_profile.bitrate_bps);
+    body[MESSAGE_CONFIG_POWER_INDEX] = (uint8_t) rfm69_power_dbm;
+    radio_power_post_message(MESSAGE_CONFIG, body);
+}
+
+#else
+#define post_tier_event(tier)
+#define post_config()
+#endif
+
+/*
+    (Re)starts the input sample, ADC and packet timers at the given sample period, with a packet every other sample.
+
+    @param sample_period - Scheduler ticks between input samples
+*/
+static void start_frames(uint16_t sample_period)
+{
+    uint16_t packet_period = 2 * sample_period;
+
+    scheduler_start_timer(&sample_inputs_timer, sample_inputs, sample_period, sample_period, TASK_DEADLINE_TICKS);
+    scheduler_start_timer(&start_adc_timer, start_next_adc_conversion, sample_period, sample_period, TASK_DEADLINE_TICKS);
+    scheduler_start_timer(&send_packet_timer, send_packet, packet_period + PACKET_PHASE_TICKS, packet_period, TASK_DEADLINE_TICKS);
+#ifdef RFM69_HOPPING
+    // Only the full packet rate hops - slower heartbeats stay on the home channel, where a receiver with nothing to
+    // follow waits, so it finds us again as soon as the rate changes.
+    radio_power_hop(&hop_plan, sample_period == INPUT_SAMPLE_PERIOD_TICKS);
+#endif
+#if defined(RFM69_LINK) && !defined(RFM69_AUTOMODES) && !defined(RFM69_TDMA)
+    scheduler_start_timer(&prewarm_radio_timer, radio_power_prewarm, packet_period + PACKET_PHASE_TICKS - RADIO_POWER_PREWARM_TICKS,
+                          packet_period, TASK_DEADLINE_TICKS);
+#endif
+}
+
+/*
+    Sets the frame rate for a governor tier, if it isn't already.  The idle tier listens for pin changes so a button
+    press gets us straight back to full rate, and the deep sleep tier powers down until one comes - returning to the
+    active tier once it does.
+*/
+static void set_tier(enum Governor_Tier tier)
+{
+    if(tier == frame_tier) {
+        return;
+    }
+    frame_tier = tier;
+
+    switch(tier) {
+        case GOVERNOR_ACTIVE:
+            disable_pcint(ALL_GROUPS);
+            start_frames(INPUT_SAMPLE_PERIOD_TICKS);
+            post_tier_event(tier);
+            break;
+
+        case GOVERNOR_IDLE:
+            start_frames(IDLE_INPUT_SAMPLE_PERIOD_TICKS);
+            pin_woken = false;
+            enable_pcint(ALL_GROUPS);
+            post_tier_event(tier);
+            break;
+
+        // No event for this one - the radio's asleep before it could go out, so the receiver hears about the return
+        // to the active tier instead.
+        case GOVERNOR_DEEP_SLEEP:
+            radio_power_suspend();
+            enter_sleep();
+            radio_power_resume();
+            governor_note_activity();
+            set_tier(GOVERNOR_ACTIVE);
+            break;
+    }
+}
+
+/*
+    Scheduler task - debounces the buttons into button_byte and misc_byte, and moves to whichever tier the governor
+    says the quiet spell has earned.
+*/
+static void sample_inputs()
+{
+    // If the button pressed status is the same as it was in the last sample, we know (almost certainly) that
+    // the value we're seeing is not a button bounce.  Let's set it in our data bytes.
+    if(digital_input_status.analog_stick_btn_pressed == BIT_IS_SET(ANALOG_STICK_BTN_PIN_REG, ANALOG_STICK_BTN_PIN)) {
+        set_or_clear(BIT_IS_SET(ANALOG_STICK_BTN_PIN_REG, ANALOG_STICK_BTN_PIN), &misc_byte, ANALOG_STICK_BTN_BYTE_POS);
+    }
+    
+    if(digital_input_status.left_shoulder_btn_pressed == !BIT_IS_SET(LEFT_SHOULDER_BTN_PIN_REG, LEFT_SHOULDER_BTN_PIN)) {
+        set_or_clear(!BIT_IS_SET(LEFT_SHOULDER_BTN_PIN_REG, LEFT_SHOULDER_BTN_PIN), &misc_byte, LEFT_SHOULDER_BTN_BYTE_POS);
+    }
+    
+    if(digital_input_status.right_shoulder_btn_pressed == !BIT_IS_SET(RIGHT_SHOULDER_BTN_PIN_REG, RIGHT_SHOULDER_BTN_PIN)) {
+        set_or_clear(!BIT_IS_SET(RIGHT_SHOULDER_BTN_PIN_REG, RIGHT_SHOULDER_BTN_PIN), &misc_byte, RIGHT_SHOULDER_BTN_BYTE_POS);
+    }
+    
+    if(digital_input_status.purple1_btn_pressed == !BIT_IS_SET(PURPLE1_BTN_PIN_REG, PURPLE1_BTN_PIN)) {
+        set_or_clear(!BIT_IS_SET(PURPLE1_BTN_PIN_REG, PURPLE1_BTN_PIN), &button_byte, PURPLE1_BTN_BYTE_POS);
+    }
+    
+    if(digital_input_status.purple2_btn_pressed == !BIT_IS_SET(PURPLE2_BTN_PIN_REG, PURPLE2_BTN_PIN)) {
+        set_or_clear(!BIT_IS_SET(PURPLE2_BTN_PIN_REG, PURPLE2_BTN_PIN), &button_byte, PURPLE2_BTN_BYTE_POS);
+    }
+
+    if(digital_input_status.purple3_btn_pressed == !BIT_IS_SET(PURPLE3_BTN_PIN_REG, PURPLE3_BTN_PIN)) {
+        set_or_clear(!BIT_IS_SET(PURPLE3_BTN_PIN_REG, PURPLE3_BTN_PIN), &button_byte, PURPLE3_BTN_BYTE_POS);
+    }
+
+    if(digital_input_status.brown1_btn_pressed == !BIT_IS_SET(BROWN1_BTN_PIN_REG, BROWN1_BTN_PIN)) {
+        set_or_clear(!BIT_IS_SET(BROWN1_BTN_PIN_REG, BROWN1_BTN_PIN), &button_byte, BROWN1_BTN_BYTE_POS);
+    }
+
+    if(digital_input_status.brown2_btn_pressed == !BIT_IS_SET(BROWN2_BTN_PIN_REG, BROWN2_BTN_PIN)) {
+        set_or_clear(!BIT_IS_SET(BROWN2_BTN_PIN_REG, BROWN2_BTN_PIN), &button_byte, BROWN2_BTN_BYTE_POS);
+    }
+
+    if(digital_input_status.brown3_btn_pressed == !BIT_IS_SET(BROWN3_BTN_PIN_REG, BROWN3_BTN_PIN)) {
+        set_or_clear(!BIT_IS_SET(BROWN3_BTN_PIN_REG, BROWN3_BTN_PIN), &button_byte, BROWN3_BTN_BYTE_POS);
+    }
+
+    if(digital_input_status.blue1_btn_pressed == !BIT_IS_SET(BLUE1_BTN_PIN_REG, BLUE1_BTN_PIN)) {
+        set_or_clear(!BIT_IS_SET(BLUE1_BTN_PIN_REG, BLUE1_BTN_PIN), &button_byte, BLUE1_BTN_BYTE_POS);
+    }
+
+    if(digital_input_status.blue2_btn_pressed == !BIT_IS_SET(BLUE2_BTN_PIN_REG, BLUE2_BTN_PIN)) {
+        set_or_clear(!BIT_IS_SET(BLUE2_BTN_PIN_REG, BLUE2_BTN_PIN), &button_byte, BLUE2_BTN_BYTE_POS);
+    }
+
+    digital_input_status.purple1_btn_pressed = !BIT_IS_SET(PURPLE1_BTN_PIN_REG, PURPLE1_BTN_PIN);
+    digital_input_status.purple2_btn_pressed = !BIT_IS_SET(PURPLE2_BTN_PIN_REG, PURPLE2_BTN_PIN);
+    digital_input_status.purple3_btn_pressed = !BIT_IS_SET(PURPLE3_BTN_PIN_REG, PURPLE3_BTN_PIN);
+    
+    digital_input_status.brown1_btn_pressed = !BIT_IS_SET(BROWN1_BTN_PIN_REG, BROWN1_BTN_PIN);
+    digital_input_status.brown2_btn_pressed = !BIT_IS_SET(BROWN2_BTN_PIN_REG, BROWN2_BTN_PIN);
+    digital_input_status.brown3_btn_pressed = !BIT_IS_SET(BROWN3_BTN_PIN_REG, BROWN3_BTN_PIN);
+    
+    digital_input_status.blue1_btn_pressed = !BIT_IS_SET(BLUE1_BTN_PIN_REG, BLUE1_BTN_PIN);
+    digital_input_status.blue2_btn_pressed = !BIT_IS_SET(BLUE2_BTN_PIN_REG, BLUE2_BTN_PIN);
+    
+    digital_input_status.left_shoulder_btn_pressed = !BIT_IS_SET(LEFT_SHOULDER_BTN_PIN_REG, LEFT_SHOULDER_BTN_PIN);
+    digital_input_status.right_shoulder_btn_pressed = !BIT_IS_SET(RIGHT_SHOULDER_BTN_PIN_REG, RIGHT_SHOULDER_BTN_PIN);
+    
+    // All of our buttons are active low except for this one.  No inverse operator (!) needed here.
+    digital_input_status.analog_stick_btn_pressed = BIT_IS_SET(ANALOG_STICK_BTN_PIN_REG, ANALOG_STICK_BTN_PIN);
+    
+    set_tier(governor_update());
+}
+
+/*
+    Scheduler task - starts a conversion for one analog stick axis, alternating between the two, or of the bandgap when
+    telemetry wants the supply voltage.  ISR(ADC_vect) picks up the result.
+*/
+static void start_next_adc_conversion()
+{
+    if(telemetry_vcc_due()) {
+        selected_adc_channel = INTERNAL_BANDGAP;
+    } else {
+        selected_adc_channel = (selected_adc_channel == ANALOG_STICK_Y ? ANALOG_STICK_X : ANALOG_STICK_Y);
+    }
+    power_hold(POWER_HOLD_ADC);
+    start_adc(selected_adc_channel);
+}
+
+/*
+    Scheduler task - builds a packet from the latest input data and queues it to be sent.
+*/
+static void send_packet()
+{
+    bool input_changed = false;
+    bool buttons_changed = false;
+
+    // Check to see if our packet data has changed this the last packet was sent.  If so, let the governor know, since the user has interacted with button(s) and/or the analog stick.
+    if(packet_data[PACKET_BUTTON_BYTE_INDEX] != button_byte) {
+        packet_data[PACKET_BUTTON_BYTE_INDEX] = button_byte;
+        input_changed = true;
+        buttons_changed = true;
+    }
+    
+    if(packet_data[PACKET_MISC_BYTE_INDEX] != misc_byte) {
+        buttons_changed |= ((packet_data[PACKET_MISC_BYTE_INDEX] ^ misc_byte) & MISC_BUTTON_BITS) != 0;
+        packet_data[PACKET_MISC_BYTE_INDEX] = misc_byte;
+        input_changed = true;
+    }
+
+    if(input_changed || stick_moved) {
+        stick_moved = false;
+        governor_note_activity();
+        set_tier(GOVERNOR_ACTIVE);
+    }
+
+    packet_data[PACKET_LSB_ANALOG_STICK_X_BYTE_INDEX] = lsb_analog_stick_x_byte;
+    packet_data[PACKET_LSB_ANALOG_STICK_Y_BYTE_INDEX] = lsb_analog_stick_y_byte;
+    
+    construct_and_store_packet(&packet_buffer, TRAINING_CHARS, START_CHAR, NUM_TRAINING_CHARS, packet_data, NUM_DATA_CHARS, false);
+    latency_probe_packet_queued(input_changed, NUM_TRAINING_CHARS + 1 + NUM_DATA_CHARS + 1);
+
+    // A button edge the receiver misses stays missed, so it's worth an ACK - stick data is stale by the next packet.
+    if(buttons_changed) {
+        radio_power_transmit_acked((const uint8_t*) packet_data);
+    } else {
+        radio_power_transmit((const uint8_t*) packet_data);
+    }
+}
+
+
+/*
+    Configures every peripheral the transmitter uses, enables interrupts, and starts Timer2 ticking.  Must be called
+    once before transmitter_poll().
+*/
+void transmitter_init()
+{
+    /*
+        Gets the system clock up to F_CPU before anything that depends on it is configured.
+    */
+    power_init();
+
+    /*
+        Turn on internal pull-up resistors for all of our non-analog stick digital inputs.
+        The push button on the analog stick is active high, so (unfortunately) an external 
+        pull-down resistor is necessary.  Pull-ups are also enabled for the (currently) two
+        unused pins, PIND2 and PIND3, to reduce power consumption in sleep modes and eliminate floating inputs.
+        
+        If you change the pin a button is plugged in to, you may need to update these pull-ups, 
+        and will definitely need to update avr_config.h.
+    */
+    PORTB |= (1 << PINB0) | (1 << PINB1) | (1 << PINB2);
+    PORTC |= (1 << PINC2) | (1 << PINC3) | (1 << PINC4) | (1 << PINC5);
+    PORTD |= (1 << PIND2) | (1 << PIND3) | (1 << PIND5) | (1 << PIND6) | (1 << PIND7);
+    
+    /*
+       Set these bits to enable pin change interrupts for our inputs, including the two pins used for our analog 
+       stick x and y values.  As with the previous group, these will likely need to be changed if you change the 
+       pin that an input is plugged in to.
+    */
+    PCMSK0 = (1 << PCINT0) | (1 << PCINT1) | (1 << PCINT2);
+    PCMSK1 = (1 << PCINT8) | (1 << PCINT9) | (1 << PCINT10) | (1 << PCINT11) | (1 << PCINT12) | (1 << PCINT13);
+    PCMSK2 = (1 << PCINT20) | (1 << PCINT21) | (1 << PCINT22) | (1 << PCINT23);
+    
+    /*
+        Timer2 has to be running before rfm69_init(), since its timeouts are measured with it.
+    */
+    scheduler_init();
+    
+    adc_init();
+    master_spi_init();
+    usart_init();
+    rfm69_init(RFM69_CHANNEL_FRF(RFM69W_BASE_FREQUENCY_HZ, RFM69W_CHANNEL_SPACING_HZ, RFM69W_CHANNEL),
+               RFM69W_NETWORK_ID);
+    radio_power_init();
+#ifdef RFM69_HOPPING
+    rfm69_hop_plan_init(&hop_plan, RFM69W_NETWORK_ID, RFM69W_BASE_FREQUENCY_HZ, RFM69W_CHANNEL_SPACING_HZ);
+#endif
+#ifdef RFM69_TDMA
+    // The receiver's beacon comes once a packet period, and packets go out in this transmitter's slot of it.
+    radio_power_tdma_start(PACKET_PERIOD_TICKS);
+#endif
+    
+    governor_init();
+    start_frames(INPUT_SAMPLE_PERIOD_TICKS);
+    post_config();
+    
+    sei();
+}
+
+/*
+    One pass of the main loop - runs whichever scheduler tasks have come due, kicks off a USART transmission if the
+    USART is idle and there is something waiting to be sent, and then sleeps until the next interrupt.
+*/
+void transmitter_poll()
+{
+    uint8_t temp_byte;
+    
+    scheduler_run_ready();
+
+    if(pin_woken) {
+        pin_woken = false;
+        governor_note_activity();
+        set_tier(GOVERNOR_ACTIVE);
+    }
+
+    radio_power_service();
+    latency_probe_service(&packet_buffer);
+    trace_service(&packet_buffer);
+    telemetry_service(&packet_buffer);
+    
+    if(usart_transmission_buffer_empty() && ring_buffer_read(&packet_buffer, &temp_byte) == BUFFER_OK) {
+        UDR0 = temp_byte;
+        // Taken after the write, so a TX complete interrupt for an earlier byte can't release it with this one queued.
+        power_hold(POWER_HOLD_USART);
+        latency_probe_byte_written();
+        telemetry_byte_written();
+    }
+
+    scheduler_idle();
+}
+
+
+// Notes stick movement for the governor, once an axis has moved more than GOVERNOR_STICK_DEADBAND since it last did.
+static void track_stick(uint16_t reading, volatile uint16_t* reference)
+{
+    if(abs((int16_t) (reading - *reference)) > GOVERNOR_STICK_DEADBAND) {
+        *reference = reading;
+        stick_moved = true;
+    }
+}
+
+// Interrupt fired upon completion of an analog-to-digital conversion.
+ISR(ADC_vect)
+{
+    trace_event(TRACE_ADC_BEGIN, selected_adc_channel);
+
+    bool converting = false;
+
+    if(selected_adc_channel == ANALOG_STICK_Y) {
+        lsb_analog_stick_y_byte = ADC & 0xFF;
+        check_set_or_clear(ADC, 8, &misc_byte, ANALOG_STICK_Y_BIT_8_POS);
+        check_set_or_clear(ADC, 9, &misc_byte, ANALOG_STICK_Y_BIT_9_POS);
+        track_stick(ADC, &stick_y_reference);
+    } else if (selected_adc_channel == ANALOG_STICK_X) {
+        lsb_analog_stick_x_byte = ADC & 0xFF;
+        check_set_or_clear(ADC, 8, &misc_byte, ANALOG_STICK_X_BIT_8_POS);
+        check_set_or_clear(ADC, 9, &misc_byte, ANALOG_STICK_X_BIT_9_POS);
+        track_stick(ADC, &stick_x_reference);
+    } else if (selected_adc_channel == INTERNAL_BANDGAP) {
+        converting = telemetry_bandgap_reading(ADC);
+        if(converting) {
+            start_adc(INTERNAL_BANDGAP);
+        }
+    }
+
+    if(!converting) {
+        power_release(POWER_HOLD_ADC);
+    }
+
+    trace_event(TRACE_ADC_END, 0);
+}
+
+ISR(PCINT0_vect, ISR_ALIASOF(PCINT2_vect));
+ISR(PCINT1_vect, ISR_ALIASOF(PCINT2_vect));
+
+// Interrupt fired whenever any of the pins configured by PCMSK change levels.
+ISR(PCINT2_vect)
+{
+    trace_event(TRACE_PCINT, 0);
+    latency_probe_pin_change();
+    exit_sleep();
+    pin_woken = true;
+}
+
+// Interrupt fired once and automatically cleared by hardware upon completion of a USART transmission.
+ISR(USART_TX_vect)
+{
+    uint8_t byte;
+
+    trace_event(TRACE_USART_TX_BEGIN, 0);
+    latency_probe_tx_complete();
+    if(usart_transmission_buffer_empty() && ring_buffer_read(&packet_buffer, &byte) == BUFFER_OK) {
+        UDR0 = byte;
+        latency_probe_byte_written();
+        telemetry_byte_written();
+    } else {
+        // The USART has nothing left to send, so it no longer needs the I/O clock.
+        power_release(POWER_HOLD_USART);
+    }
+    trace_event(TRACE_USART_TX_END, 0);
+}
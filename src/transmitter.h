@@ -0,0 +1,10 @@
+#ifndef TRANSMITTER_H_
+#define TRANSMITTER_H_
+
+// Sets up pins, interrupts and peripherals, and starts Timer2.  Call once at start up.
+void transmitter_init();
+
+// Runs a single iteration of the main loop.  Call continuously after transmitter_init().
+void transmitter_poll();
+
+#endif /* TRANSMITTER_H_ */
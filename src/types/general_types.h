@@ -12,8 +12,9 @@ enum Adc_Channel {
     ADC4_PIN,
     ADC5_PIN,
     INTERAL_TEMP_SENSOR,
+    INTERNAL_BANDGAP,   // the 1.1V bandgap reference, for measuring AVCC
     NONE
-} Adc_Channel;
+};
 
 /* 
    Type definition for PCINT pin groups.  PCINT_0_7 corresponds to the
@@ -24,7 +25,7 @@ enum Pcint_Group {
     PCINT_8_14,
     PCINT_16_23,
     ALL_GROUPS
-} Pcint_Group;
+};
 
 struct Digital_Input_Status {
     bool analog_stick_btn_pressed;
@@ -0,0 +1,47 @@
+#include "message.h"
+
+/*
+    @param type - An enum Message_Type
+    @return uint8_t - Bytes in that type's body, or 0 if it isn't one this build knows
+*/
+uint8_t message_length(uint8_t type)
+{
+    switch(type) {
+        case MESSAGE_INPUT_STATE:
+            return MESSAGE_INPUT_STATE_LENGTH;
+        case MESSAGE_EVENT:
+            return MESSAGE_EVENT_LENGTH;
+        case MESSAGE_TELEMETRY:
+            return MESSAGE_TELEMETRY_LENGTH;
+        case MESSAGE_CONFIG:
+            return MESSAGE_CONFIG_LENGTH;
+        default:
+            return 0;
+    }
+}
+
+/*
+    Writes a 32 bit field of a message body, least significant byte first.
+
+    @param bytes - Where the field goes
+    @param value - The field
+*/
+void message_write_u32(uint8_t* bytes, uint32_t value)
+{
+    for(uint8_t i = 0; i < 4; i++) {
+        bytes[i] = (uint8_t) (value >> (8 * i));
+    }
+}
+
+/*
+    @param bytes - A 32 bit field of a message body
+    @return uint32_t - The field
+*/
+uint32_t message_read_u32(const uint8_t* bytes)
+{
+    uint32_t value = 0;
+    for(uint8_t i = 0; i < 4; i++) {
+        value |= (uint32_t) bytes[i] << (8 * i);
+    }
+    return value;
+}
@@ -0,0 +1,63 @@
+#ifndef MESSAGE_H_
+#define MESSAGE_H_
+
+#include "packet.h"
+
+#include <stdint.h>
+
+/*
+   The messages an RFM69_MESSAGES link carries (see lib/rfm69/rfm69.h) - one per packet, as a type byte and then a body
+   whose layout the type sets.  This header is shared between the firmware and the host-side tools in host/, so it
+   must not pull in any AVR-specific headers.
+
+   MESSAGE_INPUT_STATE     every packet period - the packet's data bytes, laid out as in packet.h
+   MESSAGE_EVENT           something the transmitter did - an enum Message_Event_Code, then an argument byte
+   MESSAGE_TELEMETRY       every TELEMETRY_PERIOD_SECONDS with TELEMETRY - util/telemetry.h's counters in the order of
+                           enum Telemetry_Counter, 32 bits each
+   MESSAGE_CONFIG          at start up - how the transmitter is set up, laid out by the MESSAGE_CONFIG_x indexes below
+
+   Multi-byte fields are little endian.  New types and event codes go on the end, and new fields on the end of a body,
+   so a receiver can skip a type it doesn't know - the packet's length byte says where it ends - and read the fields
+   it does know from a longer body than it expects.  MESSAGE_SET_VERSION goes up with each such change.
+*/
+
+#define MESSAGE_SET_VERSION 1
+
+enum Message_Type {
+    MESSAGE_INPUT_STATE,
+    MESSAGE_EVENT,
+    MESSAGE_TELEMETRY,
+    MESSAGE_CONFIG,
+    MESSAGE_NUM_TYPES
+};
+
+enum Message_Event_Code {
+    MESSAGE_EVENT_TIER          // the governor moved to another tier - the argument is the enum Governor_Tier
+};
+
+/* Body bytes of each message type. */
+#define MESSAGE_INPUT_STATE_LENGTH PACKET_NUM_DATA_CHARS
+#define MESSAGE_EVENT_LENGTH 2
+#define MESSAGE_TELEMETRY_COUNTERS 11
+#define MESSAGE_TELEMETRY_LENGTH (4 * MESSAGE_TELEMETRY_COUNTERS)
+#define MESSAGE_CONFIG_LENGTH 7
+
+/* The longest body of any type. */
+#define MESSAGE_MAX_LENGTH MESSAGE_TELEMETRY_LENGTH
+
+/* Position of each field of an event's body. */
+#define MESSAGE_EVENT_CODE_INDEX 0
+#define MESSAGE_EVENT_ARGUMENT_INDEX 1
+
+/* Position of each field of a config message's body - MESSAGE_SET_VERSION, the full packet rate in Hz, the radio's
+   bit rate in bps (32 bits), and its output power in dBm (signed). */
+#define MESSAGE_CONFIG_VERSION_INDEX 0
+#define MESSAGE_CONFIG_PACKET_RATE_INDEX 1
+#define MESSAGE_CONFIG_BITRATE_INDEX 2
+#define MESSAGE_CONFIG_POWER_INDEX 6
+
+uint8_t message_length(uint8_t type);
+void message_write_u32(uint8_t* bytes, uint32_t value);
+uint32_t message_read_u32(const uint8_t* bytes);
+
+#endif /* MESSAGE_H_ */
@@ -0,0 +1,49 @@
+#include "packet.h"
+
+/*
+    Constructs a RF packet with the necessary preamble training bytes, data byte(s), and checksum byte, and then stores that byte-by-byte
+    in the buffer that you pass in.
+    
+    - The preamble, or training, bytes are used to sync up the sender and receiver, training the receiver
+    to more accurately accept the actual data.
+    - The data byte(s) is the actual payload of your packet.
+    - The checksum byte adds up the data bytes, discarding any carryover, so that the receiver can do the same
+    and determine if the packet was valid.
+    
+    An example packet might look like this, where '_' are the training bytes, 'A', 'B', 'C', and 'D' are the data bytes, and 'X' is the checksum byte.
+    
+    _ _ _ > A B C D X
+    
+    @param buffer - The buffer to fill as you construct the packet.
+    @param training_chars - The chars used for training the receiver to sync up with this transmitter before we start sending actual data.
+    @param num_training_chars - The number of training chars being passed in.
+    @param start_char - The char used to indicate the start of the data portion of the packet
+    @param data - The chars representing the data portion of the packet.
+    @param num_data_chars - The number of data chars being passed in.
+    @param null_terminated - Whether or not to null terminate this packet.
+    @return Buffer_Status - Returns the Buffer_Status returned by the most recent write, which allows the caller to handle buffer-related issues, such as an attempted write to a full buffer.
+*/
+enum Buffer_Status construct_and_store_packet(struct Ring_Buffer* buffer, const char* training_chars, const uint8_t start_char, const uint8_t num_training_chars, const char* data, const uint8_t num_data_chars, bool null_terminate)
+{
+    enum Buffer_Status status;
+    
+    for(uint8_t i = 0; i < num_training_chars; i++) {
+        status = ring_buffer_write(buffer, training_chars[i]);
+    }
+    
+    status = ring_buffer_write(buffer, start_char);
+    
+    uint8_t checksum = 0;
+    for(uint8_t j = 0; j < num_data_chars; j++) {
+        status = ring_buffer_write(buffer, data[j]);
+        checksum += data[j];
+    }
+
+    status = ring_buffer_write(buffer, checksum);
+    
+    if(null_terminate) {
+        status = ring_buffer_write(buffer, '\0');
+    }
+    
+    return status;
+}
@@ -0,0 +1,58 @@
+#ifndef PACKET_H_
+#define PACKET_H_
+
+#include "ring_buffer.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+   Layout of the packets sent by this transmitter.  This header is shared between the firmware and the host-side
+   tools in host/, so it must not pull in any AVR-specific headers.
+
+   U > B M X Y C
+
+   'U' is the training char, '>' is the start char, 'B', 'M', 'X' and 'Y' are the button, misc, and analog stick
+   x/y LSB data bytes, and 'C' is the checksum of the data bytes.  See the README for more detail.
+*/
+
+/* The binary value of 'U' is 01010101, which gives the receiver's data slicer a nice square wave to sync up with. */
+#define PACKET_TRAINING_CHAR 'U'
+
+/* The char telling the receiver that any bytes that follow are actual data bytes. */
+#define PACKET_START_CHAR 0b10101010
+
+/* Number of data chars in a packet, NOT including the checksum char. */
+#define PACKET_NUM_DATA_CHARS 4
+
+/* Number of bytes from the start char through the checksum char, inclusive. */
+#define PACKET_FRAME_LENGTH (PACKET_NUM_DATA_CHARS + 2)
+
+/* Index of each data byte within the data portion of the packet. */
+#define PACKET_BUTTON_BYTE_INDEX 0
+#define PACKET_MISC_BYTE_INDEX 1
+#define PACKET_LSB_ANALOG_STICK_X_BYTE_INDEX 2
+#define PACKET_LSB_ANALOG_STICK_Y_BYTE_INDEX 3
+
+/* The positions in the button_byte for each button. */
+#define BLUE1_BTN_BYTE_POS 0
+#define BLUE2_BTN_BYTE_POS 1
+#define PURPLE1_BTN_BYTE_POS 2
+#define PURPLE2_BTN_BYTE_POS 3
+#define PURPLE3_BTN_BYTE_POS 4
+#define BROWN1_BTN_BYTE_POS 5
+#define BROWN2_BTN_BYTE_POS 6
+#define BROWN3_BTN_BYTE_POS 7
+
+/* Below list the byte positions for each part of the misc_byte. */
+#define LEFT_SHOULDER_BTN_BYTE_POS 0
+#define RIGHT_SHOULDER_BTN_BYTE_POS 1
+#define ANALOG_STICK_BTN_BYTE_POS 2
+#define ANALOG_STICK_X_BIT_8_POS 3 // zero indexing in these names here - the analog stick value has a 10 bit resolution
+#define ANALOG_STICK_X_BIT_9_POS 4
+#define ANALOG_STICK_Y_BIT_8_POS 5
+#define ANALOG_STICK_Y_BIT_9_POS 6
+
+enum Buffer_Status construct_and_store_packet(struct Ring_Buffer* buffer, const char* training_chars, const uint8_t start_char, const uint8_t num_training_chars, const char* data, const uint8_t num_data_chars, bool null_terminate);
+
+#endif /* PACKET_H_ */
@@ -1,8 +1,6 @@
 #ifndef RING_BUFFER_H
 #define RING_BUFFER_H
 
-#include "../util/avr_util.h"
-
 #include <stdint.h>
 
 /* Use a power of two for your buffer size so when we % it later, the compiler can optimize to something that isn't division. */
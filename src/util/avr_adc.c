@@ -83,6 +83,14 @@ void select_adc_channel(volatile enum Adc_Channel channel)
         BIT_CLEAR(ADMUX, MUX2);
         break;
         
+        case INTERNAL_BANDGAP:
+        BIT_SET(ADMUX, MUX1);
+        BIT_SET(ADMUX, MUX2);
+        BIT_SET(ADMUX, MUX3);
+        
+        BIT_CLEAR(ADMUX, MUX0);
+        break;
+        
         case NONE:
         /* This actually sets the input channel to 0V (GND).  */
         BIT_SET(ADMUX, MUX0);
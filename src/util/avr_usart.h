@@ -2,13 +2,18 @@
 #define AVR_USART_H_
 
 #include "../avr_config.h"
+#include "timing.h"
 
 #include <stdint.h>
 #include <stdbool.h>
 #include <avr/io.h>
 
-#define BAUD_RATE 2400
-#define CALCULATED_UBBR ((F_CPU / 16 / BAUD_RATE) - 1)
+#define BAUD_RATE (uint32_t) 2400
+#define CALCULATED_UBBR USART_UBRR(BAUD_RATE)
+
+_Static_assert(CALCULATED_UBBR <= 0x0FFF, "BAUD_RATE is too slow for F_CPU - UBRR0 only has 12 bits");
+_Static_assert(USART_BAUD_ERROR_PERMILLE(BAUD_RATE, CALCULATED_UBBR) <= USART_MAX_BAUD_ERROR_PERMILLE,
+               "no UBRR0 value gets close enough to BAUD_RATE at this F_CPU");
 
 void usart_init();
 bool usart_transmission_buffer_empty();
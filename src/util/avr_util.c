@@ -1,4 +1,5 @@
 #include "avr_util.h"
+#include "telemetry.h"
 
 void disable_pcint(enum Pcint_Group group)
 {
@@ -47,13 +48,16 @@ void enter_sleep()
     enable_pcint(ALL_GROUPS);
     power_adc_disable();
     set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+    telemetry_power_down();
     /* 
       The sleep_mode() function enables sleep mode and then executes a SLEEP instruction.  When the uC wakes
       up (likely due to an interrupt), the code in the interrupt will be run, and then the sleep_mode() function 
       will finish off by disabling sleep mode (clearing the SE, sleep enable, bit in the SMCR register).  Then control 
       continues as normal to the rest of this (enter_sleep()) function.
     */
+    trace_event(TRACE_SLEEP_BEGIN, 0);
     sleep_mode();
+    trace_event(TRACE_SLEEP_END, 0);
     disable_pcint(ALL_GROUPS);
 }
 
@@ -2,6 +2,7 @@
 #define AVR_UTIL_H_
 
 #include "general_util.h"
+#include "trace.h"
 #include "../avr_config.h"
 #include "../types/general_types.h"
 
@@ -1,8 +1,6 @@
 #ifndef GENERAL_UTIL_H_
 #define GENERAL_UTIL_H_
 
-#include "avr_util.h"
-
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -0,0 +1,47 @@
+#include "governor.h"
+
+struct Governor_Stats governor_stats = {0};
+
+/* Scheduler tick input was last seen on. */
+static uint32_t last_activity;
+
+static enum Governor_Tier tier = GOVERNOR_ACTIVE;
+
+/*
+    Starts the transmitter off in the active tier.  Must be called after scheduler_init().
+*/
+void governor_init()
+{
+    last_activity = scheduler_now();
+    tier = GOVERNOR_ACTIVE;
+}
+
+/*
+    Records that the user just did something, which puts the transmitter back in the active tier.
+*/
+void governor_note_activity()
+{
+    last_activity = scheduler_now();
+    tier = GOVERNOR_ACTIVE;
+}
+
+/*
+    Drops a tier if the quiet spell since the last input has gone on long enough.  Never climbs - only
+    governor_note_activity() does that.
+
+    @return enum Governor_Tier - The tier the transmitter should be in now
+*/
+enum Governor_Tier governor_update()
+{
+    uint32_t quiet = scheduler_now() - last_activity;
+
+    if(tier == GOVERNOR_ACTIVE && quiet >= GOVERNOR_IDLE_TICKS) {
+        tier = GOVERNOR_IDLE;
+        governor_stats.idle_entries++;
+    }
+    if(tier == GOVERNOR_IDLE && quiet >= GOVERNOR_SLEEP_TICKS) {
+        tier = GOVERNOR_DEEP_SLEEP;
+        governor_stats.sleep_entries++;
+    }
+    return tier;
+}
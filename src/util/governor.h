@@ -0,0 +1,44 @@
+#ifndef GOVERNOR_H_
+#define GOVERNOR_H_
+
+#include "../avr_config.h"
+#include "scheduler.h"
+#include "timing.h"
+
+#include <stdint.h>
+
+/*
+   Steps the transmitter down through power tiers as input activity dies off, and straight back up to full rate as
+   soon as there's any - dropping a tier takes a sustained quiet spell (the thresholds in avr_config.h), while a single
+   button press or stick movement is enough to climb back, so a pause in play saves power without a touch ever being
+   met with a slow response.  The governor only keeps the books - the transmitter reports input with
+   governor_note_activity(), asks governor_update() which tier it should be in, and sets its frame rate to match.
+
+   Quiet time is measured in scheduler ticks, so time spent powered down doesn't count towards it.
+*/
+
+/* Scheduler ticks without input before dropping to each tier. */
+#define GOVERNOR_IDLE_TICKS TIMER2_MS_TO_TICKS(GOVERNOR_IDLE_AFTER_MS)
+#define GOVERNOR_SLEEP_TICKS TIMER2_SECONDS_TO_TICKS(GOVERNOR_SLEEP_AFTER_SECONDS)
+
+_Static_assert(GOVERNOR_SLEEP_AFTER_SECONDS <= TIMER2_MAX_MS / 1000, "GOVERNOR_SLEEP_AFTER_SECONDS is too long to convert to ticks");
+_Static_assert(GOVERNOR_IDLE_TICKS < GOVERNOR_SLEEP_TICKS, "the idle tier must come before deep sleep");
+
+enum Governor_Tier {
+    GOVERNOR_ACTIVE,        // full packet rate
+    GOVERNOR_IDLE,          // GOVERNOR_IDLE_PACKET_RATE_HZ heartbeat, woken back up by pin changes
+    GOVERNOR_DEEP_SLEEP     // powered down until a pin changes
+};
+
+struct Governor_Stats {
+    uint16_t idle_entries;
+    uint16_t sleep_entries;
+};
+
+extern struct Governor_Stats governor_stats;
+
+void governor_init();
+void governor_note_activity();
+enum Governor_Tier governor_update();
+
+#endif /* GOVERNOR_H_ */
@@ -0,0 +1,215 @@
+#include "latency_probe.h"
+
+#ifdef LATENCY_PROBE
+
+#include "avr_util.h"
+#include "scheduler.h"
+
+#include <util/atomic.h>
+
+volatile uint16_t latency_probe_histograms[LATENCY_NUM_STAGES][LATENCY_PROBE_NUM_BUCKETS];
+
+/* The oldest pin change that hasn't made it into a packet yet. */
+static volatile bool input_pending = false;
+static volatile uint32_t input_time;
+
+/* The packet currently being followed through the ring buffer and USART, identified by the positions of its first and
+   last bytes in the stream of every byte ever queued. */
+static volatile bool tracking = false;
+static volatile bool first_byte_seen;
+static volatile uint16_t first_byte_pos;
+static volatile uint16_t last_byte_pos;
+static volatile uint32_t tracked_input_time;
+static volatile uint32_t construct_time;
+static volatile uint32_t first_byte_time;
+
+/* Running totals of bytes put into the ring buffer and bytes written to UDR0.  These wrap, so only compare differences. */
+static volatile uint16_t bytes_queued = 0;
+static volatile uint16_t bytes_written = 0;
+
+static volatile uint8_t samples_since_dump = 0;
+
+/* The stage whose histogram is being dumped next, or LATENCY_NUM_STAGES if no dump is in progress. */
+static uint8_t dump_stage = LATENCY_NUM_STAGES;
+
+/* Stream position just past the last byte of histogram text queued so far. */
+static volatile uint16_t dump_end_pos = 0;
+
+static void record(enum Latency_Probe_Stage stage, uint32_t ticks)
+{
+    uint32_t bucket = ticks >> LATENCY_PROBE_BUCKET_SHIFT;
+    if(bucket >= LATENCY_PROBE_NUM_BUCKETS) {
+        bucket = LATENCY_PROBE_NUM_BUCKETS - 1;
+    }
+
+    if(latency_probe_histograms[stage][bucket] != UINT16_MAX) {
+        latency_probe_histograms[stage][bucket]++;
+    }
+}
+
+// Finishes off the tracked packet once every byte up to and including its last one has left the USART.
+static void check_tx_done(uint16_t bytes_done)
+{
+    if(!tracking || !first_byte_seen || (int16_t) (bytes_done - (last_byte_pos + 1)) < 0) {
+        return;
+    }
+
+    uint32_t done_time = scheduler_now();
+    record(LATENCY_STAGE_INPUT_TO_PACKET, construct_time - tracked_input_time);
+    record(LATENCY_STAGE_PACKET_TO_FIRST_BYTE, first_byte_time - construct_time);
+    record(LATENCY_STAGE_FIRST_BYTE_TO_TX_DONE, done_time - first_byte_time);
+    record(LATENCY_STAGE_END_TO_END, done_time - tracked_input_time);
+
+    tracking = false;
+    samples_since_dump++;
+}
+
+static uint8_t write_decimal(struct Ring_Buffer* buffer, uint16_t value)
+{
+    char digits[5];
+    uint8_t num_digits = 0;
+
+    do {
+        digits[num_digits++] = '0' + (value % 10);
+        value /= 10;
+    } while(value != 0);
+
+    for(uint8_t i = num_digits; i > 0; i--) {
+        ring_buffer_write(buffer, digits[i - 1]);
+    }
+    return num_digits;
+}
+
+/*
+    Queues one line of text for a stage's histogram - "LAT<stage> <bucket 0 count>,<bucket 1 count>,...\r\n",
+    stopping at the last non-empty bucket.  Text never contains the start char, so receivers just skip over it.
+
+    @return uint8_t - The number of bytes queued
+*/
+static uint8_t queue_histogram(struct Ring_Buffer* buffer, uint8_t stage)
+{
+    uint8_t length = 0;
+    uint8_t last_bucket = 0;
+
+    for(uint8_t i = 0; i < LATENCY_PROBE_NUM_BUCKETS; i++) {
+        if(latency_probe_histograms[stage][i] != 0) {
+            last_bucket = i;
+        }
+    }
+
+    ring_buffer_write(buffer, 'L');
+    ring_buffer_write(buffer, 'A');
+    ring_buffer_write(buffer, 'T');
+    ring_buffer_write(buffer, '0' + stage);
+    ring_buffer_write(buffer, ' ');
+    length += 5;
+
+    for(uint8_t i = 0; i <= last_bucket; i++) {
+        if(i != 0) {
+            ring_buffer_write(buffer, ',');
+            length++;
+        }
+        length += write_decimal(buffer, latency_probe_histograms[stage][i]);
+    }
+
+    ring_buffer_write(buffer, '\r');
+    ring_buffer_write(buffer, '\n');
+    return length + 2;
+}
+
+// Call from the pin change ISR.
+void latency_probe_pin_change()
+{
+    if(!input_pending) {
+        input_pending = true;
+        input_time = scheduler_now();
+    }
+}
+
+/*
+    Call after every construct_and_store_packet().
+
+    @param input_changed - Whether the button/misc data in this packet differs from the previous packet
+    @param packet_length - Number of bytes the packet took up in the ring buffer
+*/
+void latency_probe_packet_queued(bool input_changed, uint8_t packet_length)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint32_t time = scheduler_now();
+
+        if(input_pending && time - input_time > LATENCY_PROBE_STALE_TICKS) {
+            input_pending = false;
+        }
+
+        if(input_changed && input_pending && (tracking || dump_stage != LATENCY_NUM_STAGES || (int16_t) (bytes_written - dump_end_pos) < 0)) {
+            // Already busy following an earlier press, or this packet is stuck behind a histogram dump - either way
+            // it isn't a fair sample, and leaving the input pending would only blame its latency on a later packet.
+            input_pending = false;
+        } else if(input_changed && input_pending) {
+            tracking = true;
+            first_byte_seen = false;
+            first_byte_pos = bytes_queued;
+            last_byte_pos = bytes_queued + packet_length - 1;
+            tracked_input_time = input_time;
+            construct_time = time;
+            input_pending = false;
+        }
+
+        bytes_queued += packet_length;
+    }
+}
+
+/*
+    Call right after every write to UDR0 of a byte taken from the ring buffer.  The USART holds one byte in UDR0 and
+    one in its shift register, so a byte being written here means the one two before it has finished sending.
+*/
+void latency_probe_byte_written()
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if(tracking && bytes_written == first_byte_pos) {
+            first_byte_seen = true;
+            first_byte_time = scheduler_now();
+        }
+        bytes_written++;
+        check_tx_done(bytes_written - 2);
+    }
+}
+
+// Call at the top of ISR(USART_TX_vect) - TXC only fires once every byte written so far has gone out.
+void latency_probe_tx_complete()
+{
+    check_tx_done(bytes_written);
+}
+
+/*
+    Call from the main loop.  Once enough samples have built up, queues the histograms as text behind whatever packets
+    are already waiting, one stage per call, whenever the ring buffer has drained.
+
+    @param buffer - The ring buffer packets are sent from
+*/
+void latency_probe_service(struct Ring_Buffer* buffer)
+{
+    // Pin change interrupts are normally only turned on to wake us from sleep, but we want to timestamp every press.
+    enable_pcint(ALL_GROUPS);
+
+    if(dump_stage == LATENCY_NUM_STAGES) {
+        if(samples_since_dump < LATENCY_PROBE_DUMP_EVERY) {
+            return;
+        }
+        samples_since_dump = 0;
+        dump_stage = 0;
+    }
+
+    if(buffer->newest_index != buffer->oldest_index) {
+        return;
+    }
+
+    uint8_t length = queue_histogram(buffer, dump_stage);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        bytes_queued += length;
+        dump_end_pos = bytes_queued;
+    }
+    dump_stage++;
+}
+
+#endif /* LATENCY_PROBE */
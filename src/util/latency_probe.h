@@ -0,0 +1,60 @@
+#ifndef LATENCY_PROBE_H_
+#define LATENCY_PROBE_H_
+
+#include "timing.h"
+#include "../types/ring_buffer.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+   Optional instrumentation measuring how long a button press takes to make it on air.  Build with LATENCY_PROBE
+   defined to turn it on - otherwise every hook below compiles away to nothing.
+
+   Timestamps are scheduler ticks, which are 256us apiece with Timer2's 1024 prescaler at 4MHz (244.14us with
+   TIMER2_ASYNC).
+   Only one press is followed through the pipeline at a time, and only presses that actually change the packet data.
+*/
+
+/* Each histogram bucket covers 2^LATENCY_PROBE_BUCKET_SHIFT ticks - 16 ticks is 4.096ms at 4MHz. */
+#define LATENCY_PROBE_BUCKET_SHIFT 4
+#define LATENCY_PROBE_NUM_BUCKETS 32
+
+/* Pin changes that haven't shown up in a packet after this many ticks (250ms) were bounces or were undone
+   before the debounce logic accepted them, so they are forgotten rather than blamed on a later packet. */
+#define LATENCY_PROBE_STALE_TICKS TIMER2_MS_TO_TICKS(250)
+
+/* Number of completed samples between each dump of the histograms over the USART.  A full dump is a few hundred
+   milliseconds of airtime, and with only ~4ms of slack per packet at 2400 baud the backlog it leaves takes a few
+   seconds to drain - presses during that time show up in the tail of LATENCY_STAGE_PACKET_TO_FIRST_BYTE. */
+#define LATENCY_PROBE_DUMP_EVERY 32
+
+enum Latency_Probe_Stage {
+    LATENCY_STAGE_INPUT_TO_PACKET,          // pin change until the packet carrying it is constructed (debounce + packet cadence)
+    LATENCY_STAGE_PACKET_TO_FIRST_BYTE,     // packet constructed until its first byte goes into UDR0 (ring buffer backlog)
+    LATENCY_STAGE_FIRST_BYTE_TO_TX_DONE,    // first byte into UDR0 until the last byte has left the USART (airtime)
+    LATENCY_STAGE_END_TO_END,               // pin change until the last byte has left the USART
+    LATENCY_NUM_STAGES
+};
+
+#ifdef LATENCY_PROBE
+
+extern volatile uint16_t latency_probe_histograms[LATENCY_NUM_STAGES][LATENCY_PROBE_NUM_BUCKETS];
+
+void latency_probe_pin_change();
+void latency_probe_packet_queued(bool input_changed, uint8_t packet_length);
+void latency_probe_byte_written();
+void latency_probe_tx_complete();
+void latency_probe_service(struct Ring_Buffer* buffer);
+
+#else
+
+#define latency_probe_pin_change()
+#define latency_probe_packet_queued(input_changed, packet_length) ((void) (input_changed))
+#define latency_probe_byte_written()
+#define latency_probe_tx_complete()
+#define latency_probe_service(buffer)
+
+#endif /* LATENCY_PROBE */
+
+#endif /* LATENCY_PROBE_H_ */
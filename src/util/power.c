@@ -0,0 +1,47 @@
+#include "power.h"
+
+#ifdef TIMER2_ASYNC
+
+#include <avr/power.h>
+#include <util/atomic.h>
+
+/* POWER_HOLD_x bits of every peripheral that's currently busy. */
+static volatile uint8_t holds = 0;
+
+/*
+    Brings the system clock up to F_CPU.  The internal RC oscillator runs at 8MHz, and the CKDIV8 fuse (programmed on
+    new parts) divides it down to 1MHz at reset, so set the divider explicitly whichever way the fuse is set.  Must
+    be called before anything that depends on F_CPU, like the USART's baud rate divisor.
+*/
+void power_init()
+{
+    clock_prescale_set(clock_div_2);
+}
+
+/*
+    Keeps scheduler_idle() out of power-save until the hold is released.  Safe to call from ISRs, and to call again
+    for a hold that's already taken.
+*/
+void power_hold(enum Power_Hold hold)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        holds |= hold;
+    }
+}
+
+void power_release(enum Power_Hold hold)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        holds &= ~hold;
+    }
+}
+
+/*
+    @return uint8_t - SLEEP_MODE_PWR_SAVE if no peripheral needs the I/O clock, otherwise SLEEP_MODE_IDLE
+*/
+uint8_t power_idle_sleep_mode()
+{
+    return (holds == 0 ? SLEEP_MODE_PWR_SAVE : SLEEP_MODE_IDLE);
+}
+
+#endif /* TIMER2_ASYNC */
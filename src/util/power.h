@@ -0,0 +1,46 @@
+#ifndef POWER_H_
+#define POWER_H_
+
+#include "../avr_config.h"
+
+#include <stdint.h>
+#include <avr/sleep.h>
+
+/*
+   Picks the sleep mode scheduler_idle() uses between tasks.  With Timer2 clocked from the 32.768kHz crystal
+   (TIMER2_ASYNC in avr_config.h) the scheduler keeps time in power-save, which stops the main oscillator and draws
+   around a microamp instead of the few hundred of idle - so the MCU drops into power-save between every frame, as
+   long as nothing running from the I/O clock is partway through something.
+
+   Drivers take a hold on their peripheral before starting it and release it once it's finished (usually from its
+   ISR).  While any hold is taken scheduler_idle() only idles, which keeps the I/O clock running to finish the job.
+   Without TIMER2_ASYNC Timer2 stops in power-save too, so idle is as deep as it goes, and all of this compiles away.
+*/
+
+enum Power_Hold {
+    POWER_HOLD_ADC = (1 << 0),      // a conversion is in progress
+    POWER_HOLD_USART = (1 << 1),    // a byte is being shifted out, or is waiting in UDR0 to be
+    POWER_HOLD_RADIO = (1 << 2)     // the RFM69 is sending a packet that wants an ACK, or listening for it - INT0 only
+                                    // sees DIO0's edges while the I/O clock runs
+};
+
+#ifdef TIMER2_ASYNC
+
+/* How long the 32.768kHz crystal may take to start oscillating steadily after power on, per the datasheet. */
+#define POWER_CRYSTAL_STARTUP_MS 1000
+
+void power_init();
+void power_hold(enum Power_Hold hold);
+void power_release(enum Power_Hold hold);
+uint8_t power_idle_sleep_mode();
+
+#else
+
+#define power_init()
+#define power_hold(hold)
+#define power_release(hold)
+#define power_idle_sleep_mode() SLEEP_MODE_IDLE
+
+#endif /* TIMER2_ASYNC */
+
+#endif /* POWER_H_ */
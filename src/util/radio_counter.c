@@ -0,0 +1,127 @@
+#include "radio_counter.h"
+
+#ifdef RFM69_FRESHNESS
+
+#include <avr/eeprom.h>
+
+/* The highest a reservation goes - one below what an erased slot's reservation reads as. */
+#define LAST_RESERVATION (UINT32_MAX - 1)
+
+/*
+    A reservation, and its complement as a check.  The check is written after the reservation, so a slot whose write a
+    reset cut short - even one that was erased before, which no ordering of the reservation's own bytes could protect -
+    doesn't check out, and the reservation before it, still intact in its own slot, wins.  An erased slot doesn't check
+    out either.
+*/
+struct Reservation_Slot {
+    uint32_t reservation;
+    uint32_t check;
+};
+
+#define SLOT_BYTES (uint8_t) sizeof(struct Reservation_Slot)
+
+/* With no slot that checks out, the counter starts from 0 - as it does from the build's EEPROM image, or an erased
+   EEPROM. */
+static struct Reservation_Slot EEMEM reservations[RADIO_COUNTER_SLOTS];
+
+struct Radio_Counter_Stats radio_counter_stats = {0};
+
+/* The next counter to hand out, and the reservation that covers the counters below it. */
+static uint32_t next_counter;
+static uint32_t reserved;
+
+/* The slot holding the newest reservation - or being written with it, while one's pending. */
+static uint8_t slot;
+
+/* The next reservation while it's being written, and how many of its slot's bytes haven't been started yet. */
+static bool pending = false;
+static uint32_t pending_reservation;
+static uint8_t pending_bytes;
+
+/*
+    @param from - A reservation
+    @return uint32_t - The one after it - from itself once they've run out
+*/
+static uint32_t next_reservation(uint32_t from)
+{
+    return from <= LAST_RESERVATION - RADIO_COUNTER_CHUNK ? from + RADIO_COUNTER_CHUNK : from;
+}
+
+/*
+    Moves the pending reservation on by a byte, if the EEPROM's free - and once the last byte has finished writing,
+    lets counters run up to it.
+*/
+static void write_pending()
+{
+    if(!pending || !eeprom_is_ready()) {
+        return;
+    }
+    if(pending_bytes == 0) {
+        reserved = pending_reservation;
+        pending = false;
+        radio_counter_stats.reservations++;
+        return;
+    }
+
+    // The reservation's bytes, then its check's, both least significant byte first.
+    uint8_t byte = SLOT_BYTES - pending_bytes--;
+    uint32_t word = (byte < sizeof(uint32_t) ? pending_reservation : ~pending_reservation);
+    eeprom_update_byte((uint8_t*) &reservations[slot] + byte, (uint8_t) (word >> (8 * (byte % sizeof(uint32_t)))));
+}
+
+/*
+    Picks up from the newest reservation in EEPROM, and reserves the chunk after it - blocking on the EEPROM writes, so
+    call it at start up.
+*/
+void radio_counter_init()
+{
+    uint32_t newest = 0;
+    slot = RADIO_COUNTER_SLOTS - 1;
+    for(uint8_t i = 0; i < RADIO_COUNTER_SLOTS; i++) {
+        uint32_t reservation = eeprom_read_dword(&reservations[i].reservation);
+        uint32_t check = eeprom_read_dword(&reservations[i].check);
+        if(check == ~reservation && reservation >= newest) {
+            newest = reservation;
+            slot = i;
+        }
+    }
+
+    next_counter = newest;
+    reserved = newest;
+    radio_counter_stats.first = newest;
+
+    slot = (slot + 1) % RADIO_COUNTER_SLOTS;
+    pending_reservation = next_reservation(newest);
+    eeprom_update_dword(&reservations[slot].reservation, pending_reservation);
+    eeprom_update_dword(&reservations[slot].check, ~pending_reservation);
+    eeprom_busy_wait();
+    reserved = pending_reservation;
+    radio_counter_stats.reservations++;
+}
+
+/*
+    Hands out the next counter, unless there isn't one reserved yet.  Takes a few dozen cycles at most - it only ever
+    starts an EEPROM write, never waits for one.
+
+    @param counter - Filled in with the counter
+    @return bool - false if the counters reserved have all been handed out, and the next reservation isn't written
+                   yet - or they've run out altogether
+*/
+bool radio_counter_next(uint32_t* counter)
+{
+    write_pending();
+    if(!pending && reserved - next_counter <= RADIO_COUNTER_LEAD && next_reservation(reserved) != reserved) {
+        slot = (slot + 1) % RADIO_COUNTER_SLOTS;
+        pending_reservation = next_reservation(reserved);
+        pending_bytes = SLOT_BYTES;
+        pending = true;
+    }
+
+    if(next_counter >= reserved) {
+        return false;
+    }
+    *counter = next_counter++;
+    return true;
+}
+
+#endif /* RFM69_FRESHNESS */
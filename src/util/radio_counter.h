@@ -0,0 +1,37 @@
+#ifndef RADIO_COUNTER_H_
+#define RADIO_COUNTER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+   Hands out the counters RFM69_FRESHNESS ends each packet with (see lib/rfm69/rfm69_freshness.h) - never the same one
+   twice with the same key, resets included.  Build with RFM69_FRESHNESS defined, and this file's .c added to the
+   build, to use it.
+
+   Writing the counter to EEPROM for every packet would wear it out in weeks - each byte is good for 100,000 writes -
+   and hold up every packet for the 3.3ms each byte takes.  So EEPROM only holds a reservation: the counter the next
+   reset starts from.  Counters run up to it, and the next reservation, RADIO_COUNTER_CHUNK further on, is written as
+   they come within RADIO_COUNTER_LEAD of it - a byte each time a counter's handed out and the EEPROM isn't busy, so
+   nothing ever waits on it.  A reset skips whatever's left of the chunk.  Reservations go round RADIO_COUNTER_SLOTS
+   slots, so at the full packet rate each slot is written once an hour or so, and lasts over ten years.  The newest is
+   the highest whose check passes - a reset partway through writing one leaves it failing, and the one before it is
+   used.  The counter itself runs out sooner, after 2^32 packets - four years at the full packet rate -
+   after which the node needs a new key and its reservations clearing.
+*/
+
+#define RADIO_COUNTER_CHUNK (uint32_t) 4096
+#define RADIO_COUNTER_SLOTS 32
+#define RADIO_COUNTER_LEAD 64
+
+struct Radio_Counter_Stats {
+    uint32_t first;             // the counter handed out first since reset
+    uint16_t reservations;      // written to EEPROM since reset
+};
+
+extern struct Radio_Counter_Stats radio_counter_stats;
+
+void radio_counter_init();
+bool radio_counter_next(uint32_t* counter);
+
+#endif /* RADIO_COUNTER_H_ */
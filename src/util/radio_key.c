@@ -0,0 +1,76 @@
+#include "radio_key.h"
+
+#ifdef RFM69_AES
+
+#include <avr/eeprom.h>
+
+struct Radio_Key_Record {
+    uint8_t key[RFM69_AES_KEY_LENGTH];
+#ifdef RFM69_FRESHNESS
+    uint8_t mac_key[RFM69_FRESHNESS_KEY_LENGTH];
+#endif
+    uint8_t marker;                     // RADIO_KEY_MARKER once the keys are all there
+};
+
+#ifdef RFM69_FRESHNESS
+static struct Radio_Key_Record EEMEM stored_key = { .key = RFM69W_AES_KEY, .mac_key = RFM69W_MAC_KEY,
+                                                    .marker = RADIO_KEY_MARKER };
+#else
+static struct Radio_Key_Record EEMEM stored_key = { .key = RFM69W_AES_KEY, .marker = RADIO_KEY_MARKER };
+#endif
+
+/*
+    Reads the key out of EEPROM.
+
+    @param key - Filled in with RFM69_AES_KEY_LENGTH bytes of key
+    @return bool - false if there isn't one stored, in which case key is left with whatever was in EEPROM
+*/
+bool radio_key_load(uint8_t* key)
+{
+    eeprom_read_block(key, stored_key.key, RFM69_AES_KEY_LENGTH);
+    return eeprom_read_byte(&stored_key.marker) == RADIO_KEY_MARKER;
+}
+
+/*
+    Stores a new key in EEPROM, for radio_power_init() to pick up from the next reset on.  Blocks for the EEPROM
+    writes - 3.3ms for each byte that changes - so only call it outside of normal running, while provisioning.
+
+    @param key - RFM69_AES_KEY_LENGTH bytes of key
+*/
+void radio_key_store(const uint8_t* key)
+{
+    // Clear the marker first, so that a store cut short leaves no key at all rather than half of one.
+    eeprom_update_byte(&stored_key.marker, 0xFF);
+    eeprom_update_block(key, stored_key.key, RFM69_AES_KEY_LENGTH);
+    eeprom_update_byte(&stored_key.marker, RADIO_KEY_MARKER);
+}
+
+#ifdef RFM69_FRESHNESS
+
+/*
+    Reads RFM69_FRESHNESS' MAC key out of EEPROM.
+
+    @param mac_key - Filled in with RFM69_FRESHNESS_KEY_LENGTH bytes of key
+    @return bool - false if there isn't one stored, in which case mac_key is left with whatever was in EEPROM
+*/
+bool radio_key_load_mac(uint8_t* mac_key)
+{
+    eeprom_read_block(mac_key, stored_key.mac_key, RFM69_FRESHNESS_KEY_LENGTH);
+    return eeprom_read_byte(&stored_key.marker) == RADIO_KEY_MARKER;
+}
+
+/*
+    Stores a new MAC key in EEPROM, like radio_key_store() does the AES key.
+
+    @param mac_key - RFM69_FRESHNESS_KEY_LENGTH bytes of key
+*/
+void radio_key_store_mac(const uint8_t* mac_key)
+{
+    eeprom_update_byte(&stored_key.marker, 0xFF);
+    eeprom_update_block(mac_key, stored_key.mac_key, RFM69_FRESHNESS_KEY_LENGTH);
+    eeprom_update_byte(&stored_key.marker, RADIO_KEY_MARKER);
+}
+
+#endif /* RFM69_FRESHNESS */
+
+#endif /* RFM69_AES */
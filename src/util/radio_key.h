@@ -0,0 +1,30 @@
+#ifndef RADIO_KEY_H_
+#define RADIO_KEY_H_
+
+#include "../lib/rfm69/rfm69.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+   Keeps the RFM69_AES key in EEPROM, so that each network's nodes can be given their own without rebuilding the
+   firmware.  Build with RFM69_AES defined, and this file's .c added to the build, to use it.
+
+   The EEPROM image the build produces holds RFM69W_AES_KEY from avr_config.h - flash a different image to give a
+   device another key.  radio_key_store() writes a new one from the firmware itself, and it's used from the next reset
+   on.  Each key is stored with RADIO_KEY_MARKER after it, so an EEPROM that was never flashed, or that lost power
+   halfway through a store, doesn't pass for a key - erased EEPROM reads 0xFF, and the marker goes in last.
+
+   With RFM69_FRESHNESS the key its MACs are worked out with is kept alongside, in the same way - the image holds
+   RFM69W_MAC_KEY, and radio_key_store_mac() writes a new one.  The marker covers both.
+*/
+
+/* Stored after a key once it's all in EEPROM - anything but an erased byte's 0xFF. */
+#define RADIO_KEY_MARKER 0x5A
+
+bool radio_key_load(uint8_t* key);
+void radio_key_store(const uint8_t* key);
+bool radio_key_load_mac(uint8_t* mac_key);
+void radio_key_store_mac(const uint8_t* mac_key);
+
+#endif /* RADIO_KEY_H_ */
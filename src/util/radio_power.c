@@ -0,0 +1,1273 @@
+#include "radio_power.h"
+#include "power.h"
+#include "radio_counter.h"
+#include "radio_key.h"
+#include "telemetry.h"
+#include "timeout.h"
+#include "../types/message.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+#ifdef RFM69_POWER_CONTROL
+static struct Rfm69_Power_Control power_control;
+#endif
+
+/*
+    RFM69_AES encrypts every packet with the radio's AES-128 engine (see lib/rfm69/rfm69.h), using the key
+    radio_power_init() loads from EEPROM (see util/radio_key.h).  With no key stored it never turns the radio on at
+    all, rather than sending in the clear - packets only go out over the USART.  Encryption pads each packet out to
+    whole 16 byte blocks, which costs airtime - a controller packet's 4 data bytes take up a whole block - but the radio
+    does the work, so the MCU's side of each packet is the same SPI burst as before.
+
+    keyed is whether the radio has a key to encrypt with.
+*/
+#ifdef RFM69_AES
+static bool keyed = false;
+#else
+#define keyed true
+#endif
+
+#ifdef RFM69_FRESHNESS
+static struct Rfm69_Freshness_Key mac_key;
+#endif
+
+/*
+    Puts the radio to sleep - it only leaves it again to send a packet.  Must be called after rfm69_init().
+*/
+void radio_power_init()
+{
+#ifdef RFM69_AES
+    uint8_t key[RFM69_AES_KEY_LENGTH];
+    keyed = radio_key_load(key);
+    if(keyed) {
+        rfm69_set_encryption(key);
+    }
+    // The radio can't give the key back, so there's no need to keep a copy lying around in RAM.
+    memset(key, 0, sizeof(key));
+#endif
+#ifdef RFM69_FRESHNESS
+    // The MAC key has to stay, but only as the words Chaskey works on.
+    uint8_t mac_bytes[RFM69_FRESHNESS_KEY_LENGTH];
+    keyed = keyed && radio_key_load_mac(mac_bytes);
+    rfm69_freshness_key_init(&mac_key, mac_bytes);
+    memset(mac_bytes, 0, sizeof(mac_bytes));
+    if(keyed) {
+        radio_counter_init();
+    }
+#endif
+
+    rfm69_set_mode(RFM69_MODE_SLEEP);
+#ifdef RFM69_AUTOMODES
+    rfm69_set_auto_modes(RF_AUTOMODES_ENTER_FIFONOTEMPTY | RF_AUTOMODES_EXIT_PACKETSENT |
+                         RF_AUTOMODES_INTERMEDIATE_TRANSMITTER);
+#endif
+#ifdef RFM69_POWER_CONTROL
+    // rfm69_init() has already started the radio at full power.
+    rfm69_power_control_init(&power_control, is_rfm69hw ? RFM69HW_MIN_POWER_DBM : RFM69W_MIN_POWER_DBM,
+                             rfm69_power_dbm);
+#endif
+#if defined(RFM69_ACK) || defined(RFM69_TDMA)
+    // DIO0 shows PacketSent in TX, and INT0 catches its rising edge.
+    rfm69_write_reg(REG_DIOMAPPING1, RF_DIOMAPPING1_DIO0_00);
+    EICRA = (EICRA & ~((1 << ISC01) | (1 << ISC00))) | (1 << ISC01) | (1 << ISC00);
+    EIFR = (1 << INTF0);
+    EIMSK |= (1 << INT0);
+#endif
+}
+
+#ifdef RFM69_LINK
+
+volatile struct Radio_Power_Stats radio_power_stats = {0};
+
+/* Tick the packet on air should have finished by, after which it counts as a timeout. */
+static uint32_t tx_give_up_tick;
+
+/* Ticks each packet keeps the radio transmitting for with the current profile - from sleep, with AutoModes. */
+#ifdef RFM69_AUTOMODES
+static uint16_t tx_ticks = RADIO_POWER_AUTO_TX_TICKS(RFM69_PACKET_AIRTIME_US);
+#else
+static uint16_t tx_ticks = RADIO_POWER_TX_TICKS(RFM69_PACKET_AIRTIME_US);
+#endif
+
+/* Bytes in the last packet sent - only ever a controller packet's without RFM69_MESSAGES. */
+static uint8_t tx_length = RFM69_FRAME_LENGTH;
+
+#ifdef RFM69_MESSAGES
+
+/*
+    @param length - Bytes in a packet, everything that goes in the FIFO included
+    @return uint16_t - Ticks the packet keeps the radio transmitting for with the current profile - tx_ticks for a
+                       controller packet, and worked out afresh for other messages, which are rare enough for it
+*/
+static uint16_t packet_tx_ticks(uint8_t length)
+{
+    if(length == RFM69_FRAME_LENGTH) {
+        return tx_ticks;
+    }
+#ifdef RFM69_AUTOMODES
+    return RADIO_POWER_AUTO_TX_TICKS(rfm69_profile_airtime_us(&rfm69_profile, RFM69_AIR_BYTES(length)));
+#else
+    return RADIO_POWER_TX_TICKS(rfm69_profile_airtime_us(&rfm69_profile, RFM69_AIR_BYTES(length)));
+#endif
+}
+
+#else
+#define packet_tx_ticks(length) ((void) (length), tx_ticks)
+#endif
+
+#ifdef RFM69_HOPPING
+
+/*
+    RFM69_HOPPING moves each packet on to the next channel of a hop sequence (see lib/rfm69/rfm69_hop.h), started from
+    its home channel with radio_power_hop() - or keeps every packet on the home channel, for a heartbeat too slow for a
+    receiver to follow from channel to channel.  The radio is retuned while it's still asleep - ahead of the prewarm, or
+    just before the FIFO is loaded with AutoModes - so hopping costs a 4 byte SPI burst per packet and no extra time on
+    air.  A packet that's dropped still moves the sequence on, so that a receiver counting slots stays in step.
+*/
+
+/* The hop sequence packets follow, and the position in it of the next packet's channel. */
+static const struct Rfm69_Hop_Plan* hop_plan = NULL;
+static uint8_t hop_index = 0;
+
+/* Whether the radio is already tuned to the next packet's channel. */
+static bool hop_tuned = false;
+
+/* Whether each packet moves the sequence on, rather than all of them going out on the home channel. */
+static bool hop_advancing = false;
+
+/*
+    Tunes the radio to the next packet's channel, if it isn't already.  Called while the radio is still asleep, so the
+    synthesizer locks onto the new frequency as it starts up.
+*/
+static void hop_tune()
+{
+    if(hop_plan != NULL && !hop_tuned) {
+        rfm69_set_frf(hop_plan->frf[hop_index]);
+        hop_tuned = true;
+    }
+}
+
+/*
+    Moves the sequence on to the next packet's channel - whether or not the last packet made it out.
+*/
+static void hop_advance()
+{
+    if(hop_advancing) {
+        hop_index = RFM69_HOP_NEXT(hop_index);
+        hop_tuned = false;
+    }
+}
+
+/*
+    Restarts packets from a hop sequence's home channel - the next packet goes out on it.
+
+    @param plan - The hop sequence, which has to stay around while it's in use
+    @param advance - true to move each packet on to the next channel of the sequence, false to keep them all on the
+                     home channel
+*/
+void radio_power_hop(const struct Rfm69_Hop_Plan* plan, bool advance)
+{
+    hop_plan = plan;
+    hop_index = 0;
+    hop_tuned = false;
+    hop_advancing = advance;
+}
+
+#else
+#define hop_tune()
+#define hop_advance()
+#endif /* RFM69_HOPPING */
+
+#if defined(RFM69_ACK) || defined(RFM69_TDMA) || defined(RFM69_MESSAGES) || defined(RFM69_FRESHNESS)
+
+/* The last packet sent, all of it - kept for sending again, or until its slot. */
+#ifdef RFM69_MESSAGES
+static uint8_t tx_frame[RFM69_FRAME_BYTES(MESSAGE_MAX_LENGTH)];
+#else
+static uint8_t tx_frame[RFM69_FRAME_LENGTH];
+#endif
+
+#if defined(RFM69_ACK) || defined(RFM69_TDMA)
+/* The sequence number the last packet went out with. */
+static uint8_t tx_sequence = 0;
+#endif
+
+#ifdef RFM69_FRESHNESS
+
+/*
+    RFM69_FRESHNESS ends every encrypted packet with a counter and a MAC (see lib/rfm69/rfm69_freshness.h), so that a
+    receiver can turn away packets recorded and sent again - encryption alone doesn't stop that.  Counters come from
+    util/radio_counter.h, and the MAC key from EEPROM alongside the AES key, without which the radio stays off as it
+    does without that.  Both fit in the padding a controller packet gets anyway, so they cost no airtime, only the MCU's
+    time to work the MAC out.  A retransmission goes out with its first try's counter.
+*/
+
+/*
+    Ends a packet with the next counter and the MAC over it, timing how long that takes with Timer1 - stopped either
+    side, so it costs nothing the rest of the time.  With TELEMETRY, Timer1 is already counting cycles awake, so it's
+    left running and only read.
+
+    @param length - Bytes of tx_frame so far
+    @return bool - false if there wasn't a counter to give it
+*/
+static bool seal_frame(uint8_t length)
+{
+    uint32_t counter;
+    uint8_t clock_select = TCCR1B;
+
+    TCCR1A = 0;
+    TCCR1B = (1 << CS10);
+    uint16_t start = TCNT1;
+    bool sealed = radio_counter_next(&counter);
+    if(sealed) {
+        rfm69_freshness_seal(&mac_key, tx_frame, length, counter);
+    }
+    uint16_t cycles = TCNT1 - start;
+    TCCR1B = clock_select;
+
+    if(cycles > radio_power_stats.max_seal_cycles) {
+        radio_power_stats.max_seal_cycles = cycles;
+    }
+    if(cycles > RFM69_FRESHNESS_SEAL_CYCLES) {
+        radio_power_stats.slow_seals++;
+    }
+    if(!sealed) {
+        radio_power_stats.counter_drops++;
+    }
+    return sealed;
+}
+
+#endif
+
+/*
+    Puts the header on a packet - and with RFM69_MESSAGES, the length byte ahead of it and the message type after it,
+    and with RFM69_FRESHNESS, the counter and MAC on the end.
+
+    @param type - With RFM69_MESSAGES, the enum Message_Type of the payload
+    @param payload - The packet's payload - RFM69_PAYLOAD_LENGTH bytes, or with RFM69_MESSAGES, message_length(type)
+    @param ack - true to ask the receiver for an ACK, with RFM69_ACK
+    @return uint8_t - Bytes of tx_frame to load into the FIFO, or 0 if it has to be dropped for want of a counter
+*/
+static uint8_t build_frame(uint8_t type, const uint8_t* payload, bool ack)
+{
+#ifdef RFM69_MESSAGES
+    uint8_t length = RFM69_FRAME_BYTES(message_length(type));
+    tx_frame[0] = length - RFM69_LENGTH_BYTES;
+    tx_frame[RFM69_MESSAGE_TYPE] = type;
+#else
+    uint8_t length = RFM69_FRAME_LENGTH;
+    (void) type;
+#endif
+
+#if defined(RFM69_ACK) || defined(RFM69_TDMA)
+    tx_sequence = (tx_sequence + 1) & RFM69_CONTROL_SEQUENCE_MASK;
+    tx_frame[RFM69_HEADER_DESTINATION] = RFM69W_GATEWAY_ADDRESS;
+    tx_frame[RFM69_HEADER_SOURCE] = RFM69W_NODE_ADDRESS;
+    tx_frame[RFM69_HEADER_CONTROL] = (ack ? RFM69_CONTROL_ACK_REQUEST : 0) | tx_sequence;
+#else
+    (void) ack;
+#endif
+
+    memcpy(tx_frame + RFM69_PAYLOAD_START, payload, length - RFM69_FRAME_BYTES(0));
+#ifdef RFM69_FRESHNESS
+    if(!seal_frame(length - RFM69_TRAILER_LENGTH)) {
+        return 0;
+    }
+#endif
+    return length;
+}
+
+#endif
+
+#ifdef RFM69_AUTOMODES
+
+/*
+    RFM69_AUTOMODES hands the sequencing to the radio's AutoModes.  It sleeps until the FIFO has something in it, goes
+    straight to TX and sends the packet, and drops back to sleep on PacketSent all by itself, so radio_power_transmit()
+    is a single FIFO burst and the MCU never wakes up to prewarm the radio or put it back to sleep.  The price is
+    latency - every packet starts up from sleep, 385us rather than 55us.
+*/
+
+/* Whether the packet on air has already been counted as a timeout. */
+static bool tx_timed_out = false;
+
+/*
+    @return bool - true if the last packet is still on air.  One that's outlived tx_give_up_tick counts as a timeout,
+                   once.
+*/
+static bool transmitting()
+{
+    if(!rfm69_auto_mode_active()) {
+        tx_timed_out = false;
+        return false;
+    }
+    if(!tx_timed_out && (int32_t) (scheduler_now() - tx_give_up_tick) >= 0) {
+        tx_timed_out = true;
+        radio_power_stats.tx_timeouts++;
+    }
+    return true;
+}
+
+/*
+    Loads a packet into the FIFO, which AutoModes sends on its own - the radio wakes up for it and goes back to sleep
+    once it's out.
+
+    @param type - With RFM69_MESSAGES, the enum Message_Type of the payload
+    @param payload - RFM69_PAYLOAD_LENGTH bytes to send, or with RFM69_MESSAGES, message_length(type)
+    @param ack - Unused - AutoModes has the radio asleep again before an ACK could come back
+    @return bool - false if the packet was dropped because the last one is still on air
+*/
+static bool transmit(uint8_t type, const uint8_t* payload, bool ack)
+{
+    (void) ack;
+
+    if(transmitting()) {
+        // Adding to the FIFO now would tack this packet onto the one on air, so lose it instead.
+        radio_power_stats.busy_drops++;
+        hop_advance();
+        return false;
+    }
+
+#if defined(RFM69_MESSAGES) || defined(RFM69_FRESHNESS)
+    uint8_t length = build_frame(type, payload, false);
+    if(length == 0) {
+        hop_advance();
+        return false;
+    }
+    hop_tune();
+    tx_length = length;
+    rfm69_write_fifo(tx_frame, tx_length);
+#else
+    hop_tune();
+    (void) type;
+    rfm69_write_fifo(payload, RFM69_PAYLOAD_LENGTH);
+#endif
+    uint16_t ticks = packet_tx_ticks(tx_length);
+    telemetry_radio_trip(RFM69_MODE_TX, ticks);
+    radio_power_stats.packets_sent++;
+    tx_give_up_tick = scheduler_now() + ticks + RADIO_POWER_TX_GRACE_TICKS;
+    hop_advance();
+    return true;
+}
+
+/*
+    Waits out any packet that's on air ahead of the MCU powering down - AutoModes puts the radio back to sleep after it.
+*/
+void radio_power_suspend()
+{
+    struct Timeout timeout;
+
+    start_timeout(&timeout, packet_tx_ticks(tx_length) + RADIO_POWER_TX_GRACE_TICKS);
+    while(transmitting() && !timeout_complete(&timeout));
+}
+
+#else
+
+static struct Scheduler_Timer tx_done_timer;
+
+/* Mode the radio was in when radio_power_suspend() put it to sleep. */
+static enum Rfm69_Mode suspended_mode = RFM69_MODE_SLEEP;
+
+static void wait_mode_ready()
+{
+    struct Timeout timeout;
+
+    start_timeout(&timeout, RADIO_POWER_WAKE_TIMEOUT_TICKS);
+    while(!rfm69_mode_ready() && !timeout_complete(&timeout));
+}
+
+#if defined(RFM69_ACK) || defined(RFM69_TDMA)
+
+/* Set by INT0 when DIO0 goes high - PacketSent in TX, PayloadReady in RX. */
+static volatile bool dio0_raised = false;
+
+#endif
+
+#ifdef RFM69_ACK
+
+/*
+    RFM69_ACK puts an addressed header on each packet (see lib/rfm69/rfm69.h), and packets sent with
+    radio_power_transmit_acked() ask the receiver to ACK them.  The RFM69's DIO0 interrupts INT0 on PacketSent, and
+    radio_power_service() switches straight to RX for up to RADIO_POWER_ACK_TICKS - the receiver's turnaround and the
+    ACK's airtime - with DIO0 remapped to PayloadReady.  A packet whose ACK doesn't come back is sent again, up to
+    RADIO_POWER_ACK_ATTEMPTS times in all, so a lost button press costs a few milliseconds rather than waiting for the
+    next packet.  Every packet carries a sequence number that retransmissions repeat, so the receiver can drop
+    duplicates.  Stick data goes out with radio_power_transmit() as before - a fresher reading is on its way anyway.
+*/
+
+/* Ticks to listen for an ACK after each packet with the current profile. */
+static uint16_t ack_ticks = RADIO_POWER_ACK_TICKS(RFM69_PACKET_AIRTIME_US);
+
+/* Whether the next packet to go out is sent again if its ACK doesn't come back - probes for power control aren't. */
+static bool tx_retry = false;
+
+/* Whether the packet on air wants an ACK, whether the radio's listening for it, and how many more times the packet can
+   be sent if it doesn't come. */
+static bool ack_wanted = false;
+static bool ack_listening = false;
+static uint8_t ack_retries_left;
+
+static void listen_for_ack();
+static void ack_missed();
+
+/*
+    Stops waiting on the last packet's ACK, counting whether it came.
+*/
+static void end_ack_wait(bool acked)
+{
+    if(acked) {
+        radio_power_stats.acks_received++;
+    } else {
+        radio_power_stats.ack_failures++;
+    }
+    ack_wanted = false;
+    power_release(POWER_HOLD_RADIO);
+}
+
+#ifdef RFM69_POWER_CONTROL
+
+/*
+    RFM69_POWER_CONTROL turns the transmit power down as far as the link allows (see lib/rfm69/rfm69_power.h).  Each
+    ACK says how strong the receiver heard the packet, and each missing one raises the power.  Button presses can be
+    far apart, so every RADIO_POWER_PROBE_PACKETS'th packet asks for an ACK too - one try only, since it's stick data.
+*/
+
+/* Packets sent since the last one that asked for an ACK. */
+static uint8_t packets_since_ack = 0;
+
+/*
+    Applies the output power control has settled on, if it's moved.
+*/
+static void apply_power(bool changed)
+{
+    if(changed) {
+        rfm69_set_power_dbm(power_control.dbm);
+        radio_power_stats.power_changes++;
+    }
+}
+
+#endif /* RFM69_POWER_CONTROL */
+
+/*
+    Closes the ACK window - the radio is left in RX until it's switched to something else.
+*/
+static void stop_listening()
+{
+    scheduler_stop_timer(&tx_done_timer);
+    ack_listening = false;
+    rfm69_write_reg(REG_DIOMAPPING1, RF_DIOMAPPING1_DIO0_00);   // back to PacketSent for the next packet
+}
+
+#endif /* RFM69_ACK */
+
+static void end_transmission(bool sent)
+{
+    if(sent) {
+        radio_power_stats.packets_sent++;
+    } else {
+        radio_power_stats.tx_timeouts++;
+    }
+
+#ifdef RFM69_ACK
+    if(ack_wanted) {
+        if(sent) {
+            listen_for_ack();
+            return;
+        }
+        end_ack_wait(false);
+    }
+#endif
+
+    rfm69_start_mode(RFM69_MODE_SLEEP);
+}
+
+/*
+    Scheduler task - puts the radio back to sleep once the packet has gone out, checking again every tick until it
+    has or RADIO_POWER_TX_GRACE_TICKS have gone by.
+*/
+static void finish_transmission()
+{
+    if(rfm69_packet_sent()) {
+        end_transmission(true);
+    } else if((int32_t) (scheduler_now() - tx_give_up_tick) >= 0) {
+        end_transmission(false);
+    } else {
+        scheduler_start_timer(&tx_done_timer, finish_transmission, 1, 0, RADIO_POWER_TX_GRACE_TICKS);
+    }
+}
+
+/*
+    Starts the radio's oscillator and synthesizer ahead of a packet, without waiting for them.  Does nothing if the
+    radio is already awake.
+*/
+void radio_power_prewarm()
+{
+    if(keyed && rfm69_current_mode == RFM69_MODE_SLEEP) {
+        hop_tune();
+        rfm69_start_mode(RFM69_MODE_SYNTH);
+    }
+}
+
+/*
+    Loads a packet into the FIFO and switches to TX, scheduling putting the radio back to sleep once it's out.
+
+    @param frame - The packet to send
+    @param length - Bytes in frame
+*/
+static void start_tx(const uint8_t* frame, uint8_t length)
+{
+    uint16_t ticks = packet_tx_ticks(length);
+
+    // The FIFO can't be written until the radio is out of sleep.
+    wait_mode_ready();
+    rfm69_write_fifo(frame, length);
+    rfm69_start_mode(RFM69_MODE_TX);
+
+    tx_length = length;
+    tx_give_up_tick = scheduler_now() + ticks + RADIO_POWER_TX_GRACE_TICKS;
+    scheduler_start_timer(&tx_done_timer, finish_transmission, ticks, 0, RADIO_POWER_TX_GRACE_TICKS);
+}
+
+/*
+    Sends a packet for the first time, moving the hop sequence on past it.
+
+    @param frame - The packet to send
+    @param length - Bytes in frame
+*/
+static void send(const uint8_t* frame, uint8_t length)
+{
+#ifdef RFM69_ACK
+    ack_wanted = (frame[RFM69_HEADER_CONTROL] & RFM69_CONTROL_ACK_REQUEST) != 0;
+    if(ack_wanted) {
+        ack_retries_left = (tx_retry ? RADIO_POWER_ACK_ATTEMPTS - 1 : 0);
+        power_hold(POWER_HOLD_RADIO);
+    }
+#endif
+
+    start_tx(frame, length);
+    hop_advance();
+}
+
+#ifdef RFM69_ACK
+
+/*
+    Scheduler task - the ACK window closed without one, so sends the packet again if it has any tries left.
+*/
+static void ack_missed()
+{
+    stop_listening();
+
+#ifdef RFM69_POWER_CONTROL
+    // Louder for the retry, if there is one.
+    apply_power(rfm69_power_control_lost(&power_control));
+#endif
+
+    if(ack_retries_left > 0) {
+        ack_retries_left--;
+        radio_power_stats.ack_retries++;
+        // FS is on the way from RX to TX anyway - the FIFO's ready as soon as it's been switched to.
+        rfm69_start_mode(RFM69_MODE_SYNTH);
+        start_tx(tx_frame, tx_length);
+    } else {
+        end_ack_wait(false);
+        rfm69_start_mode(RFM69_MODE_SLEEP);
+    }
+}
+
+/*
+    Switches to RX once a packet that wants an ACK is out - the receiver answers on the same channel.
+*/
+static void listen_for_ack()
+{
+    rfm69_write_reg(REG_DIOMAPPING1, RF_DIOMAPPING1_DIO0_01);   // PayloadReady
+    rfm69_start_mode(RFM69_MODE_RX);
+    ack_listening = true;
+    scheduler_start_timer(&tx_done_timer, ack_missed, ack_ticks, 0, RADIO_POWER_TX_GRACE_TICKS);
+}
+
+/*
+    Reads the packet heard in the ACK window, and puts the radio back to sleep if it's the ACK - with
+    RFM69_POWER_CONTROL, passing on how strong it says the packet was heard.  Anything else is ignored - the receiver
+    restarts on its own and the window stays open.
+*/
+static void check_ack()
+{
+    uint8_t frame[RFM69_ACK_LENGTH];
+
+    // The radio's address filtering has already checked it's for us.
+    rfm69_read_fifo(frame, RFM69_ACK_LENGTH);
+    if(frame[RFM69_HEADER_SOURCE] != RFM69W_GATEWAY_ADDRESS ||
+       frame[RFM69_HEADER_CONTROL] != (RFM69_CONTROL_ACK | tx_sequence)) {
+        return;
+    }
+
+    stop_listening();
+    end_ack_wait(true);
+    rfm69_start_mode(RFM69_MODE_SLEEP);
+
+#ifdef RFM69_POWER_CONTROL
+    apply_power(rfm69_power_control_heard(&power_control, -(int16_t) frame[RFM69_ACK_RSSI] / 2));
+#endif
+}
+
+#endif /* RFM69_ACK */
+
+#ifdef RFM69_TDMA
+
+/*
+    RFM69_TDMA shares the channel with other transmitters by time rather than by listening (see
+    lib/rfm69/rfm69_tdma.h).  radio_power_tdma_start() listens for the receiver's beacon, and once it's heard
+    radio_power_transmit() holds each packet for this transmitter's slot, RFM69_TDMA_SLOT(RFM69W_NODE_ADDRESS) -
+    prewarming the radio for it itself, so the packet timer's prewarm isn't used.  The radio then only listens for one
+    beacon in RFM69_TDMA_BEACON_INTERVAL, just long enough either side of when it's due to catch it, with DIO0 on INT0
+    marking when it ended to the tick.  Out of sync - before the first beacon, after too many missed, or after
+    radio_power_suspend(), since Timer2 stops in power-down - packets are dropped rather than sent into someone else's
+    slot, and the radio listens for RADIO_POWER_TDMA_ACQUIRE_SUPERFRAMES in every RADIO_POWER_TDMA_RETRY_SUPERFRAMES
+    until it finds the beacon again.
+*/
+
+static struct Scheduler_Timer tdma_slot_timer;
+static struct Scheduler_Timer tdma_beacon_timer;
+
+/* Where the receiver's superframes fall on our clock, and how many ticks long it's nominally one. */
+static struct Rfm69_Tdma_Sync tdma;
+static uint16_t superframe_ticks;
+
+/* Ticks from the start of a superframe to this transmitter switching to TX in its slot. */
+#define SLOT_OFFSET_TICKS (int16_t) (RFM69_TDMA_SLOT(RFM69W_NODE_ADDRESS) * \
+                                     RADIO_POWER_TDMA_SLOT_TICKS(RFM69_PACKET_AIRTIME_US) + RFM69_TDMA_GUARD_TICKS)
+
+/* Ticks ahead of the start of a superframe to start listening for the beacon that marks it, before any are missed. */
+#define BEACON_LEAD_TICKS (int16_t) (RADIO_POWER_TDMA_BEACON_TICKS(RFM69_PACKET_AIRTIME_US) - RFM69_TDMA_GUARD_TICKS)
+
+/* Whether the packet in tx_frame is waiting for its slot, and the tick the slot starts on. */
+static bool tdma_pending = false;
+static uint32_t tdma_slot_tick;
+
+/* Whether the radio's listening for a beacon, and the superframe - on from the last beacon heard - it's due to end. */
+static bool tdma_listening = false;
+static uint16_t tdma_listen_superframe;
+
+static void beacon_missed();
+
+/*
+    Starts the radio listening for a beacon, for up to the given ticks.
+*/
+static void open_beacon_window(uint16_t ticks)
+{
+    rfm69_write_reg(REG_DIOMAPPING1, RF_DIOMAPPING1_DIO0_01);   // PayloadReady
+    rfm69_start_mode(RFM69_MODE_RX);
+    tdma_listening = true;
+    // INT0 only catches DIO0's edge while the I/O clock is running.
+    power_hold(POWER_HOLD_RADIO);
+    scheduler_start_timer(&tdma_beacon_timer, beacon_missed, ticks, 0, RADIO_POWER_TX_GRACE_TICKS);
+}
+
+/*
+    Stops listening for a beacon, and puts the radio back to sleep.
+*/
+static void close_beacon_window()
+{
+    scheduler_stop_timer(&tdma_beacon_timer);
+    tdma_listening = false;
+    rfm69_write_reg(REG_DIOMAPPING1, RF_DIOMAPPING1_DIO0_00);   // back to PacketSent for the next packet
+    rfm69_start_mode(RFM69_MODE_SLEEP);
+    power_release(POWER_HOLD_RADIO);
+}
+
+/*
+    Scheduler task - listens for a beacon out of sync, for as long as it takes a couple of them to come round.
+*/
+static void acquire()
+{
+    open_beacon_window(RADIO_POWER_TDMA_ACQUIRE_SUPERFRAMES * superframe_ticks);
+}
+
+/*
+    Scheduler task - listens for the beacon that's due, until a guard after the end of the tick it should end in.  The
+    guard widens by a tick for each beacon missed, since there's been longer for the clocks to drift apart.
+*/
+static void listen_for_beacon()
+{
+    uint32_t close_tick = rfm69_tdma_superframe_tick(&tdma, tdma_listen_superframe) + 1 + RFM69_TDMA_GUARD_TICKS +
+                          tdma.misses;
+    open_beacon_window((uint16_t) (close_tick - scheduler_now()));
+}
+
+/*
+    Schedules listening for the beacon at the start of a superframe.
+
+    @param superframes - Superframes on from the last beacon heard
+*/
+static void schedule_beacon(uint16_t superframes)
+{
+    tdma_listen_superframe = superframes;
+    uint32_t open_tick = rfm69_tdma_superframe_tick(&tdma, superframes) - BEACON_LEAD_TICKS - tdma.misses;
+    scheduler_start_timer(&tdma_beacon_timer, listen_for_beacon, open_tick - scheduler_now(), 0,
+                          RADIO_POWER_TX_GRACE_TICKS);
+}
+
+/*
+    Scheduler task - the beacon window closed without one.  Out of sync, tries again later - in sync, listens for the
+    next one due, unless that's too many missed, when the packet waiting for its slot is dropped and it looks for the
+    beacon again straight away.
+*/
+static void beacon_missed()
+{
+    close_beacon_window();
+
+    if(!tdma.locked) {
+        scheduler_start_timer(&tdma_beacon_timer, acquire, RADIO_POWER_TDMA_RETRY_SUPERFRAMES * superframe_ticks, 0,
+                              RADIO_POWER_TX_GRACE_TICKS);
+        return;
+    }
+
+    radio_power_stats.beacons_missed++;
+    if(rfm69_tdma_missed(&tdma)) {
+        schedule_beacon(tdma_listen_superframe + RFM69_TDMA_BEACON_INTERVAL);
+        return;
+    }
+
+    if(tdma_pending) {
+        scheduler_stop_timer(&tdma_slot_timer);
+        tdma_pending = false;
+        radio_power_stats.unsynced_drops++;
+    }
+    acquire();
+}
+
+/*
+    Reads the packet heard in the beacon window, lining the superframes up with it if it's the beacon - it ended on the
+    tick DIO0 went high, give or take the main loop's latency.  Anything else is ignored, and the window stays open.
+*/
+static void check_beacon()
+{
+    uint8_t frame[RFM69_FRAME_LENGTH];
+
+    // Straight after waking scheduler_now() can read a tick behind, which would put every slot a tick early - by the
+    // time the FIFO's been read it's caught up.
+    rfm69_read_fifo(frame, RFM69_FRAME_LENGTH);
+    uint32_t now = scheduler_now();
+    if(frame[RFM69_HEADER_DESTINATION] != RFM69_BROADCAST_ADDRESS ||
+       frame[RFM69_HEADER_SOURCE] != RFM69W_GATEWAY_ADDRESS) {
+        return;
+    }
+
+    close_beacon_window();
+    radio_power_stats.beacons_heard++;
+    if(!tdma.locked) {
+        radio_power_stats.syncs++;
+    }
+    rfm69_tdma_heard(&tdma, now, tdma.locked ? tdma_listen_superframe : 0);
+    schedule_beacon(RFM69_TDMA_BEACON_INTERVAL);
+}
+
+/*
+    Scheduler task - this transmitter's slot has started, so sends the packet waiting for it.
+*/
+static void send_in_slot()
+{
+    tdma_pending = false;
+    send(tx_frame, RFM69_FRAME_LENGTH);
+}
+
+/*
+    Scheduler task - starts the radio up ahead of this transmitter's slot.
+*/
+static void prewarm_for_slot()
+{
+    radio_power_prewarm();
+    scheduler_start_timer(&tdma_slot_timer, send_in_slot, tdma_slot_tick - scheduler_now(), 0,
+                          RADIO_POWER_TX_GRACE_TICKS);
+}
+
+/*
+    Holds a packet for this transmitter's next slot that there's still time to start the radio up for.  A packet
+    already waiting is replaced by the fresher one, and out of sync the packet's dropped.
+
+    @param payload - RFM69_PAYLOAD_LENGTH bytes to send
+*/
+static void queue_for_slot(const uint8_t* payload)
+{
+    if(!tdma.locked) {
+        radio_power_stats.unsynced_drops++;
+        return;
+    }
+
+    build_frame(MESSAGE_INPUT_STATE, payload, false);
+    if(tdma_pending) {
+        radio_power_stats.busy_drops++;
+        return;
+    }
+
+    uint32_t earliest = scheduler_now() + RADIO_POWER_PREWARM_TICKS + 1;
+    uint16_t superframes = rfm69_tdma_next_superframe(&tdma, earliest, SLOT_OFFSET_TICKS);
+    tdma_slot_tick = rfm69_tdma_superframe_tick(&tdma, superframes) + SLOT_OFFSET_TICKS;
+    tdma_pending = true;
+    scheduler_start_timer(&tdma_slot_timer, prewarm_for_slot,
+                          tdma_slot_tick - RADIO_POWER_PREWARM_TICKS - scheduler_now(), 0, RADIO_POWER_TX_GRACE_TICKS);
+}
+
+/*
+    Starts following the receiver's superframes, listening for its beacon - packets are dropped until it's heard.
+    Must be called after radio_power_init().
+
+    @param superframe - Ticks between beacons - the packet period, which the receiver shares
+*/
+void radio_power_tdma_start(uint16_t superframe)
+{
+    superframe_ticks = superframe;
+    rfm69_tdma_init(&tdma, superframe_ticks);
+    if(keyed) {
+        acquire();
+    }
+}
+
+#endif /* RFM69_TDMA */
+
+#if defined(RFM69_ACK) || defined(RFM69_TDMA)
+
+ISR(INT0_vect)
+{
+    dio0_raised = true;
+}
+
+/*
+    Call from the main loop - picks up where DIO0's interrupt left off, putting the radio to sleep or into RX as soon as
+    a packet's out rather than on the next tick, and checking what's heard while listening for an ACK or a beacon.
+*/
+void radio_power_service()
+{
+    if(!dio0_raised) {
+        return;
+    }
+    dio0_raised = false;
+
+    if(rfm69_current_mode == RFM69_MODE_TX && rfm69_packet_sent()) {
+        scheduler_stop_timer(&tx_done_timer);
+        end_transmission(true);
+        return;
+    }
+#ifdef RFM69_ACK
+    if(ack_listening && rfm69_payload_ready()) {
+        check_ack();
+    }
+#endif
+#ifdef RFM69_TDMA
+    if(tdma_listening && rfm69_payload_ready()) {
+        check_beacon();
+    }
+#endif
+}
+
+#endif
+
+#ifdef RFM69_CSMA
+
+/*
+    RFM69_CSMA listens before each packet - the radio goes to RX and measures the signal strength on the channel,
+    sending only if it's below RegRssiThresh.  A busy channel backs off for a random number of ticks, from a window
+    that doubles with each try, with the radio idling in FS mode ready to listen again.  A packet that still hasn't
+    found a clear channel RFM69_COLLISION_AVOIDANCE_LIMIT_MS after it was due is dropped as stale rather than sent late,
+    so the latency of the packets that do get out stays bounded.
+*/
+
+static struct Scheduler_Timer csma_timer;
+
+/* The packet waiting for a clear channel, and the tick it goes stale on. */
+#ifdef RFM69_MESSAGES
+static uint8_t csma_frame[RFM69_FRAME_BYTES(MESSAGE_MAX_LENGTH)];
+#else
+static uint8_t csma_frame[RFM69_FRAME_LENGTH];
+#endif
+static uint8_t csma_length;
+static uint32_t csma_give_up_tick;
+static bool csma_pending = false;
+
+/* The next backoff is drawn from 1 to 2^csma_exponent ticks. */
+static uint8_t csma_exponent;
+
+static uint16_t csma_random = 0xACE1;
+
+/*
+    Steps a 16-bit xorshift generator, stirring in the last RSSI reading first - its low bits are noise that differs
+    from one transmitter to the next, so neighbours that found the channel busy at the same moment don't back off in
+    step.
+
+    @param rssi - The reading that found the channel busy
+    @return uint16_t - The next pseudo-random value
+*/
+static uint16_t csma_next_random(uint8_t rssi)
+{
+    csma_random ^= rssi;
+    if(csma_random == 0) {
+        csma_random = 1;
+    }
+    csma_random ^= csma_random << 7;
+    csma_random ^= csma_random >> 9;
+    csma_random ^= csma_random << 8;
+    return csma_random;
+}
+
+/*
+    Gives up on the packet waiting for a clear channel - sending it now would only deliver it late.
+*/
+static void drop_stale()
+{
+    csma_pending = false;
+    radio_power_stats.stale_drops++;
+    hop_advance();
+    rfm69_start_mode(RFM69_MODE_SLEEP);
+}
+
+/*
+    Scheduler task - listens on the channel, and sends the waiting packet if it's clear.  Otherwise backs off for a
+    random number of ticks before trying again, or drops the packet if that would take it past its bound.
+*/
+static void listen_before_talk()
+{
+    rfm69_start_mode(RFM69_MODE_RX);
+    wait_mode_ready();
+    uint8_t rssi = rfm69_read_rssi();
+
+    // FS keeps the synthesizer locked for the next listen or the FIFO load, at a little over half RX's current.
+    rfm69_start_mode(RFM69_MODE_SYNTH);
+
+    if(rfm69_channel_clear(rssi)) {
+        csma_pending = false;
+        send(csma_frame, csma_length);
+        return;
+    }
+
+    radio_power_stats.busy_channels++;
+    uint16_t backoff = 1 + csma_next_random(rssi) % (1u << csma_exponent);
+    if(csma_exponent < RADIO_POWER_CSMA_MAX_EXPONENT) {
+        csma_exponent++;
+    }
+
+    if((int32_t) (scheduler_now() + backoff - csma_give_up_tick) > 0) {
+        drop_stale();
+    } else {
+        scheduler_start_timer(&csma_timer, listen_before_talk, backoff, 0, RADIO_POWER_TX_GRACE_TICKS);
+    }
+}
+
+#endif /* RFM69_CSMA */
+
+/*
+    Sends a packet over the RFM69 and schedules putting it back to sleep afterwards - with RFM69_CSMA, once the
+    channel is clear.
+
+    @param type - With RFM69_MESSAGES, the enum Message_Type of the payload
+    @param payload - RFM69_PAYLOAD_LENGTH bytes to send, or with RFM69_MESSAGES, message_length(type)
+    @param ack - true to ask the receiver for an ACK, with RFM69_ACK
+    @return bool - false if the packet was dropped because the last one is still on air
+*/
+static bool transmit(uint8_t type, const uint8_t* payload, bool ack)
+{
+#ifdef RFM69_TDMA
+    // Held for this transmitter's slot, which starts the radio up itself.
+    (void) type;
+    (void) ack;
+    queue_for_slot(payload);
+    return true;
+#endif
+
+    if(rfm69_current_mode == RFM69_MODE_TX) {
+        // Cutting the last packet off would lose it too, so lose this one instead.
+        radio_power_stats.busy_drops++;
+        hop_advance();
+        return false;
+    }
+
+#ifdef RFM69_CSMA
+    // The last packet should have gone stale well before now - RADIO_POWER_PACKET_TICKS allows for it.
+    if(csma_pending) {
+        scheduler_stop_timer(&csma_timer);
+        drop_stale();
+    }
+#endif
+
+#ifdef RFM69_ACK
+    // Likewise the last packet's ACK window - RX to FS is immediate.
+    if(ack_listening) {
+        stop_listening();
+        end_ack_wait(false);
+        rfm69_start_mode(RFM69_MODE_SYNTH);
+    }
+
+    tx_retry = ack;
+#ifdef RFM69_POWER_CONTROL
+    // Every so often a packet that doesn't need an ACK asks for one anyway, to keep power control fed.
+    if(++packets_since_ack >= RADIO_POWER_PROBE_PACKETS) {
+        ack = true;
+    }
+    if(ack) {
+        packets_since_ack = 0;
+    }
+#endif
+#endif
+
+#if defined(RFM69_ACK) || defined(RFM69_MESSAGES) || defined(RFM69_FRESHNESS)
+    uint8_t length = build_frame(type, payload, ack);
+    const uint8_t* frame = tx_frame;
+    if(length == 0) {
+        hop_advance();
+        return false;
+    }
+#else
+    (void) type;
+    (void) ack;
+    uint8_t length = RFM69_FRAME_LENGTH;
+    const uint8_t* frame = payload;
+#endif
+
+    if(rfm69_current_mode != RFM69_MODE_SYNTH) {
+        radio_power_stats.cold_starts++;
+        hop_tune();
+        rfm69_start_mode(RFM69_MODE_STANDBY);
+    }
+
+    // Only needed if the sequence restarted after the prewarm - the synthesizer then has to lock again.
+    hop_tune();
+
+#ifdef RFM69_CSMA
+    memcpy(csma_frame, frame, length);
+    csma_length = length;
+    csma_give_up_tick = scheduler_now() + RADIO_POWER_CSMA_TICKS;
+    csma_exponent = 1;
+    csma_pending = true;
+    listen_before_talk();
+#else
+    send(frame, length);
+#endif
+    return true;
+}
+
+#ifdef RFM69_ACK
+
+/*
+    Sends a packet like radio_power_transmit(), asking the receiver for an ACK and sending it again if one doesn't
+    come back.  With RFM69_MESSAGES it's sent even if a posted message is waiting.
+
+    @param payload - RFM69_PAYLOAD_LENGTH bytes to send
+*/
+void radio_power_transmit_acked(const uint8_t* payload)
+{
+    if(!keyed) {
+        radio_power_stats.unkeyed_drops++;
+        return;
+    }
+    transmit(MESSAGE_INPUT_STATE, payload, true);
+}
+
+#endif
+
+/*
+    Puts the radio to sleep ahead of the MCU powering down, waiting out any packet that's on air first - one still
+    waiting for a clear channel or its slot is dropped, and so is waiting for an ACK.  With RFM69_TDMA it's out of sync
+    afterwards, since Timer2 stops in power-down.
+*/
+void radio_power_suspend()
+{
+#ifdef RFM69_TDMA
+    if(tdma_pending) {
+        scheduler_stop_timer(&tdma_slot_timer);
+        tdma_pending = false;
+        radio_power_stats.unsynced_drops++;
+    }
+    if(tdma_listening) {
+        close_beacon_window();
+    }
+    scheduler_stop_timer(&tdma_beacon_timer);
+    rfm69_tdma_init(&tdma, superframe_ticks);
+#endif
+
+#ifdef RFM69_CSMA
+    if(csma_pending) {
+        scheduler_stop_timer(&csma_timer);
+        drop_stale();
+    }
+#endif
+
+#ifdef RFM69_ACK
+    // Nothing to pick back up in resume - the next packet starts from sleep.
+    if(ack_listening) {
+        stop_listening();
+        rfm69_start_mode(RFM69_MODE_SLEEP);
+    }
+    if(ack_wanted) {
+        end_ack_wait(false);
+    }
+#endif
+
+    if(rfm69_current_mode == RFM69_MODE_TX) {
+        struct Timeout timeout;
+
+        start_timeout(&timeout, packet_tx_ticks(tx_length) + RADIO_POWER_TX_GRACE_TICKS);
+        while(!rfm69_packet_sent() && !timeout_complete(&timeout));
+        scheduler_stop_timer(&tx_done_timer);
+        end_transmission(rfm69_packet_sent());
+    }
+
+    suspended_mode = rfm69_current_mode;
+    rfm69_start_mode(RFM69_MODE_SLEEP);
+}
+
+/*
+    Puts the radio back into whichever mode radio_power_suspend() found it in - with RFM69_TDMA, listening for the
+    beacon again.
+*/
+void radio_power_resume()
+{
+    rfm69_start_mode(suspended_mode);
+#ifdef RFM69_TDMA
+    if(keyed) {
+        acquire();
+    }
+#endif
+}
+
+#endif /* RFM69_AUTOMODES */
+
+#ifdef RFM69_MESSAGES
+
+/*
+    RFM69_MESSAGES switches to variable length packets, each carrying one of the messages in types/message.h -
+    radio_power_transmit() and radio_power_transmit_acked() send MESSAGE_INPUT_STATE, and the rest are posted with
+    radio_power_post_message(), to go out in place of the next packet radio_power_transmit() is asked to send.  Stick
+    data is stale by the packet after anyway, so a message that's waiting only ever costs one stick update, and never a
+    button edge - controller packets stay as short as they were, give or take the length and type bytes.  Only the
+    latest message of each type waits, so a telemetry report can't stack up behind a busy link.  A message longer than a
+    controller packet keeps the radio busy for longer, and can cost the packet after it too.
+*/
+
+_Static_assert(RFM69_FRAME_BYTES(MESSAGE_MAX_LENGTH) <= RFM69_FIFO_LENGTH, "every message must fit in the FIFO");
+#ifdef RFM69_AES
+_Static_assert(RFM69_FRAME_BYTES(MESSAGE_MAX_LENGTH) - RFM69_AES_CLEAR_BYTES <= RFM69_AES_MAX_MESSAGE,
+               "every message must be short enough for the radio to encrypt");
+#endif
+_Static_assert(MESSAGE_NUM_TYPES == MESSAGE_CONFIG + 1, "the outbox needs room for every message type");
+
+/* The latest message of each type posted and not yet sent - their bodies back to back, in type order, from the first
+   type after MESSAGE_INPUT_STATE - and a bit for each type that's waiting. */
+static uint8_t outbox[MESSAGE_EVENT_LENGTH + MESSAGE_TELEMETRY_LENGTH + MESSAGE_CONFIG_LENGTH];
+static uint8_t outbox_waiting = 0;
+
+/*
+    @param type - An enum Message_Type after MESSAGE_INPUT_STATE
+    @return uint8_t* - Where in the outbox a message of that type waits
+*/
+static uint8_t* outbox_body(uint8_t type)
+{
+    uint8_t* body = outbox;
+    for(uint8_t earlier = MESSAGE_INPUT_STATE + 1; earlier < type; earlier++) {
+        body += message_length(earlier);
+    }
+    return body;
+}
+
+/*
+    Posts a message to go out in place of the next packet radio_power_transmit() is asked to send, replacing any of the
+    same type that's still waiting.
+
+    @param type - The enum Message_Type of the message - anything but MESSAGE_INPUT_STATE, which goes out with
+                  radio_power_transmit()
+    @param body - message_length(type) bytes
+*/
+void radio_power_post_message(uint8_t type, const uint8_t* body)
+{
+    if(type == MESSAGE_INPUT_STATE || type >= MESSAGE_NUM_TYPES) {
+        return;
+    }
+
+    if(outbox_waiting & (1 << type)) {
+        radio_power_stats.messages_replaced++;
+    }
+    memcpy(outbox_body(type), body, message_length(type));
+    outbox_waiting |= (1 << type);
+}
+
+/*
+    Sends the first message waiting in the outbox, by type.
+
+    @return bool - false if there wasn't one
+*/
+static bool send_posted()
+{
+    for(uint8_t type = MESSAGE_INPUT_STATE + 1; type < MESSAGE_NUM_TYPES; type++) {
+        if(outbox_waiting & (1 << type)) {
+            // A busy radio drops it like any other packet, but it stays waiting for the next try.
+            if(transmit(type, outbox_body(type), false)) {
+                outbox_waiting &= ~(1 << type);
+                radio_power_stats.messages_sent++;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+#else
+#define send_posted() false
+#endif /* RFM69_MESSAGES */
+
+/*
+    Sends a packet over the RFM69 - with AutoModes, waking the radio for it, and otherwise scheduling putting it back
+    to sleep afterwards, and with RFM69_CSMA, once the channel is clear.  With RFM69_MESSAGES a posted message that's
+    waiting goes out instead.
+
+    @param payload - RFM69_PAYLOAD_LENGTH bytes to send
+*/
+void radio_power_transmit(const uint8_t* payload)
+{
+    if(!keyed) {
+        radio_power_stats.unkeyed_drops++;
+        return;
+    }
+    if(!send_posted()) {
+        transmit(MESSAGE_INPUT_STATE, payload, false);
+    }
+}
+
+/*
+    Switches the radio to a new profile, once any packet on air has gone out.
+
+    @param profile - Register values from rfm69_profile_get() or rfm69_profile_compute()
+    @param packet_period - Scheduler ticks between packets
+    @return bool - false, leaving the radio as it was, if packets would take longer than packet_period to send
+*/
+bool radio_power_set_profile(const struct Rfm69_Profile* profile, uint16_t packet_period)
+{
+    uint32_t airtime_us = rfm69_profile_airtime_us(profile, RFM69_AIR_BYTES(RFM69_FRAME_LENGTH));
+
+    if(RADIO_POWER_PACKET_TICKS(airtime_us) >= packet_period) {
+        return false;
+    }
+#ifdef RFM69_TDMA
+    // The slots are laid out for the initial profile's packets - the receiver and the other transmitters share it.
+    if(RADIO_POWER_TX_TICKS(airtime_us) > RADIO_POWER_TX_TICKS(RFM69_PACKET_AIRTIME_US)) {
+        return false;
+    }
+#endif
+
+    radio_power_suspend();
+    rfm69_set_profile(profile);
+    radio_power_resume();
+
+#ifdef RFM69_AUTOMODES
+    tx_ticks = RADIO_POWER_AUTO_TX_TICKS(airtime_us);
+#else
+    tx_ticks = RADIO_POWER_TX_TICKS(airtime_us);
+#endif
+#ifdef RFM69_ACK
+    ack_ticks = RADIO_POWER_ACK_TICKS(airtime_us);
+#endif
+    return true;
+}
+
+#endif /* RFM69_LINK */
@@ -0,0 +1,238 @@
+#ifndef RADIO_POWER_H_
+#define RADIO_POWER_H_
+
+#include "scheduler.h"
+#include "timing.h"
+#include "../lib/rfm69/rfm69.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+   Keeps the RFM69 in the lowest power mode it can be in.  Standby alone draws 1.25mA - more than the rest of the
+   transmitter put together - where sleep draws 0.1uA.
+
+   Without RFM69_LINK defined nothing is ever sent over the RFM69 (the USART carries the packets), so
+   radio_power_init() puts it to sleep for good and the rest of the hooks below compile away.
+
+   With RFM69_LINK defined each packet's data bytes also go out over the RFM69, as a fixed length packet with a
+   hardware CRC, and the radio sleeps in between.  radio_power_prewarm() runs RADIO_POWER_PREWARM_TICKS ahead of each
+   packet and starts the crystal oscillator and synthesizer (FS mode) without waiting on them, so that
+   radio_power_transmit() only has to load the FIFO and switch to TX - 55us rather than the 385us it takes from sleep.
+   A scheduler timer puts the radio back to sleep once the packet has gone out.  radio_power_suspend() and
+   radio_power_resume() bracket the MCU's own power-down sleep, letting any packet on air finish first.
+
+   The other RFM69_* flags build on RFM69_LINK, and the #error checks below say which of them go together.  Each is
+   described alongside its code in radio_power.c:
+
+       RFM69_AUTOMODES       the radio wakes itself for each packet and goes back to sleep after it
+       RFM69_HOPPING         each packet on the next channel of a hop sequence (lib/rfm69/rfm69_hop.h)
+       RFM69_CSMA            listen before each packet, and back off while the channel's busy
+       RFM69_ACK             packets with button edges are ACKed, and sent again if the ACK doesn't come back
+       RFM69_POWER_CONTROL   transmit power turned down as far as the ACKs say it can be (lib/rfm69/rfm69_power.h)
+       RFM69_TDMA            each packet in its own slot of the receiver's superframe (lib/rfm69/rfm69_tdma.h)
+       RFM69_MESSAGES        variable length packets carrying the messages in types/message.h
+       RFM69_AES             packets encrypted by the radio, with a key from EEPROM (util/radio_key.h)
+       RFM69_FRESHNESS       a counter and a MAC on each encrypted packet (lib/rfm69/rfm69_freshness.h)
+
+   The radio starts out with RFM69_INIT_PROFILE, and radio_power_set_profile() switches it to another (see
+   lib/rfm69/rfm69_profile.h) between packets - trading range for latency, as long as each packet still gets on air
+   before the next one is due.
+*/
+
+/* Ticks ahead of a packet to start the radio up - long enough for the oscillator and synthesizer to settle. */
+#define RADIO_POWER_PREWARM_TICKS (uint16_t) TIMER2_US_TO_TICKS(RFM69_OSC_WAKE_US + RFM69_SYNTH_WAKE_US)
+
+/* Ticks from switching to TX until a packet with the given airtime should have gone out. */
+#define RADIO_POWER_TX_TICKS(airtime_us) (uint16_t) (TIMER2_US_TO_TICKS(RFM69_TX_WAKE_US + (airtime_us)) + 1)
+
+/* Ticks (5ms) past RADIO_POWER_TX_TICKS to keep checking for PacketSent before giving up and sleeping anyway. */
+#define RADIO_POWER_TX_GRACE_TICKS (uint16_t) TIMER2_MS_TO_TICKS(5)
+
+/* Ticks (2ms) to wait for the radio to leave sleep before loading the FIFO regardless. */
+#define RADIO_POWER_WAKE_TIMEOUT_TICKS (uint16_t) TIMER2_MS_TO_TICKS(2)
+
+/* Ticks AutoModes keeps the radio out of sleep for a packet with the given airtime, starting up from sleep and
+   sending it. */
+#define RADIO_POWER_AUTO_TX_TICKS(airtime_us) (uint16_t) \
+    (TIMER2_US_TO_TICKS(RFM69_OSC_WAKE_US + RFM69_SYNTH_WAKE_US + RFM69_TX_WAKE_US + (airtime_us)) + 1)
+
+/* Ticks a packet can wait for a clear channel with RFM69_CSMA - none without it. */
+#ifdef RFM69_CSMA
+#define RADIO_POWER_CSMA_TICKS (uint16_t) RFM69_COLLISION_AVOIDANCE_TIMEOUT_TICKS
+#else
+#define RADIO_POWER_CSMA_TICKS (uint16_t) 0
+#endif
+
+/* Largest exponent of the random backoff window - 2^n ticks. */
+#define RADIO_POWER_CSMA_MAX_EXPONENT 4
+
+/* Microseconds an ACK takes to send, at the bit rate a controller packet with the given airtime went out at. */
+#define RADIO_POWER_ACK_AIRTIME_US(airtime_us) \
+    ((uint32_t) (airtime_us) * \
+     (RFM69_PREAMBLE_BYTES + RFM69_SYNC_BYTES + RFM69_AIR_BYTES(RFM69_ACK_LENGTH) + RFM69_CRC_BYTES) / \
+     (RFM69_PREAMBLE_BYTES + RFM69_SYNC_BYTES + RFM69_AIR_BYTES(RFM69_FRAME_LENGTH) + RFM69_CRC_BYTES))
+
+/* Times a packet can be sent with RFM69_ACK before giving up on its ACK, and ticks to listen for the ACK after each,
+   given the packet's airtime - from the radio switching to RX, through the receiver's turnaround, to the ACK's last
+   bit.  Without RFM69_ACK each packet goes out once, with no listening afterwards. */
+#ifdef RFM69_ACK
+#define RADIO_POWER_ACK_ATTEMPTS 2
+#define RADIO_POWER_ACK_TICKS(airtime_us) (uint16_t) \
+    (TIMER2_US_TO_TICKS(RFM69_TX_WAKE_US + RFM69_ACK_TURNAROUND_US + RADIO_POWER_ACK_AIRTIME_US(airtime_us)) + 1)
+#else
+#define RADIO_POWER_ACK_ATTEMPTS 1
+#define RADIO_POWER_ACK_TICKS(airtime_us) (uint16_t) 0
+#endif
+
+/* With RFM69_POWER_CONTROL, packets between the ones that ask for an ACK just to keep the power control loop fed -
+   0.8s at the full packet rate. */
+#define RADIO_POWER_PROBE_PACKETS 32
+
+/* Ticks in each RFM69_TDMA slot for packets with the given airtime - one packet, with RFM69_TDMA_GUARD_TICKS either
+   side. */
+#define RADIO_POWER_TDMA_SLOT_TICKS(airtime_us) (RADIO_POWER_TX_TICKS(airtime_us) + 2 * RFM69_TDMA_GUARD_TICKS)
+
+/* Ticks at the end of each superframe to listen for the beacon in, as long as none have been missed - from starting
+   the radio up, through the beacon, to a guard after it. */
+#define RADIO_POWER_TDMA_BEACON_TICKS(airtime_us) \
+    (RADIO_POWER_PREWARM_TICKS + TIMER2_US_TO_TICKS(RFM69_TX_WAKE_US + (airtime_us)) + 2 * RFM69_TDMA_GUARD_TICKS)
+
+/* With RFM69_TDMA, superframes to listen for a beacon for when out of sync, and to wait between tries. */
+#define RADIO_POWER_TDMA_ACQUIRE_SUPERFRAMES 2
+#define RADIO_POWER_TDMA_RETRY_SUPERFRAMES 32
+
+/* Ticks a packet with the given airtime can keep the radio busy for, from being prewarmed to giving up on PacketSent -
+   or on its last ACK.  With RFM69_TDMA, every transmitter's packet and the beacon share the packet period, so it's
+   all of their slots, and room for the beacon window to widen after missed beacons. */
+#if defined(RFM69_TDMA)
+#define RADIO_POWER_PACKET_TICKS(airtime_us) \
+    (RFM69_TDMA_SLOTS * RADIO_POWER_TDMA_SLOT_TICKS(airtime_us) + RADIO_POWER_TDMA_BEACON_TICKS(airtime_us) + \
+     RFM69_TDMA_MAX_MISSES - 1)
+#elif defined(RFM69_AUTOMODES)
+#define RADIO_POWER_PACKET_TICKS(airtime_us) (RADIO_POWER_AUTO_TX_TICKS(airtime_us) + RADIO_POWER_TX_GRACE_TICKS)
+#else
+#define RADIO_POWER_PACKET_TICKS(airtime_us) \
+    (RADIO_POWER_PREWARM_TICKS + RADIO_POWER_CSMA_TICKS + \
+     RADIO_POWER_ACK_ATTEMPTS * (RADIO_POWER_TX_TICKS(airtime_us) + RADIO_POWER_ACK_TICKS(airtime_us)) + \
+     RADIO_POWER_TX_GRACE_TICKS)
+#endif
+
+#if defined(RFM69_AUTOMODES) && !defined(RFM69_LINK)
+#error "RFM69_AUTOMODES only makes sense with RFM69_LINK"
+#endif
+
+#if defined(RFM69_HOPPING) && !defined(RFM69_LINK)
+#error "RFM69_HOPPING only makes sense with RFM69_LINK"
+#endif
+
+#if defined(RFM69_CSMA) && (!defined(RFM69_LINK) || defined(RFM69_AUTOMODES))
+#error "RFM69_CSMA needs RFM69_LINK without RFM69_AUTOMODES, which goes straight to TX with no chance to listen"
+#endif
+
+#if defined(RFM69_ACK) && (!defined(RFM69_LINK) || defined(RFM69_AUTOMODES))
+#error "RFM69_ACK needs RFM69_LINK without RFM69_AUTOMODES, which puts the radio back to sleep as soon as a packet's out"
+#endif
+
+#if defined(RFM69_TDMA) && (!defined(RFM69_LINK) || defined(RFM69_AUTOMODES) || defined(RFM69_HOPPING) || \
+                            defined(RFM69_CSMA) || defined(RFM69_ACK))
+#error "RFM69_TDMA needs RFM69_LINK on its own - the beacon's on one channel, and slots have no room for CSMA or ACKs"
+#endif
+
+#if defined(RFM69_MESSAGES) && (!defined(RFM69_LINK) || defined(RFM69_TDMA))
+#error "RFM69_MESSAGES needs RFM69_LINK without RFM69_TDMA, whose slots only have room for controller packets"
+#endif
+
+#if defined(RFM69_AES) && (!defined(RFM69_LINK) || defined(RFM69_TDMA))
+#error "RFM69_AES needs RFM69_LINK without RFM69_TDMA, whose slots have no room for the padding it adds"
+#endif
+
+#if defined(RFM69_FRESHNESS) && !defined(RFM69_AES)
+#error "RFM69_FRESHNESS needs RFM69_AES, whose EEPROM record (see util/radio_key.h) keeps its MAC key"
+#endif
+
+#if defined(RFM69_POWER_CONTROL) && !defined(RFM69_ACK)
+#error "RFM69_POWER_CONTROL needs RFM69_ACK, whose ACKs carry the link quality it works from"
+#endif
+
+#ifdef RFM69_LINK
+
+struct Radio_Power_Stats {
+    uint16_t packets_sent;      // with RFM69_AUTOMODES, packets loaded into the FIFO - the radio sends them itself
+    uint16_t cold_starts;       // packets the radio wasn't prewarmed for, so had to be started up from sleep
+    uint16_t busy_drops;        // packets dropped because the one before was still on air
+    uint16_t tx_timeouts;       // packets PacketSent never came up for
+    uint16_t busy_channels;     // with RFM69_CSMA, times the channel was busy when a packet listened before sending
+    uint16_t stale_drops;       // with RFM69_CSMA, packets dropped for waiting too long for a clear channel
+    uint16_t acks_received;     // with RFM69_ACK, packets that wanted an ACK and got one
+    uint16_t ack_retries;       // with RFM69_ACK, packets sent again after their ACK didn't come back
+    uint16_t ack_failures;      // with RFM69_ACK, packets given up on without an ACK
+    uint16_t power_changes;     // with RFM69_POWER_CONTROL, times the transmit power was moved
+    uint16_t beacons_heard;     // with RFM69_TDMA
+    uint16_t beacons_missed;    // with RFM69_TDMA, not heard in the window they were due in while in sync
+    uint16_t syncs;             // with RFM69_TDMA, times it found the beacon while out of sync
+    uint16_t unsynced_drops;    // with RFM69_TDMA, packets dropped while out of sync
+    uint16_t messages_sent;     // with RFM69_MESSAGES, posted messages sent in place of a packet
+    uint16_t messages_replaced; // with RFM69_MESSAGES, posted messages replaced by a later one before they went out
+    uint16_t unkeyed_drops;     // with RFM69_AES, packets dropped because there was no key in EEPROM
+    uint16_t counter_drops;     // with RFM69_FRESHNESS, packets dropped for want of a counter reserved in EEPROM
+    uint16_t max_seal_cycles;   // with RFM69_FRESHNESS, the most CPU cycles a packet's counter and MAC took
+    uint16_t slow_seals;        // with RFM69_FRESHNESS, packets whose counter and MAC went over the budget
+};
+
+extern volatile struct Radio_Power_Stats radio_power_stats;
+
+void radio_power_init();
+void radio_power_transmit(const uint8_t* payload);
+void radio_power_suspend();
+bool radio_power_set_profile(const struct Rfm69_Profile* profile, uint16_t packet_period);
+
+#ifdef RFM69_HOPPING
+void radio_power_hop(const struct Rfm69_Hop_Plan* plan, bool advance);
+#endif
+
+#ifdef RFM69_TDMA
+void radio_power_tdma_start(uint16_t superframe_ticks);
+#endif
+
+#ifdef RFM69_MESSAGES
+void radio_power_post_message(uint8_t type, const uint8_t* body);
+#else
+#define radio_power_post_message(type, body) ((void) (type), (void) (body))
+#endif
+
+#ifdef RFM69_ACK
+void radio_power_transmit_acked(const uint8_t* payload);
+#else
+#define radio_power_transmit_acked(payload) radio_power_transmit(payload)
+#endif
+
+#if defined(RFM69_ACK) || defined(RFM69_TDMA)
+void radio_power_service();
+#else
+#define radio_power_service()
+#endif
+
+#ifdef RFM69_AUTOMODES
+#define radio_power_prewarm()
+#define radio_power_resume()
+#else
+void radio_power_prewarm();
+void radio_power_resume();
+#endif
+
+#else
+
+void radio_power_init();
+#define radio_power_set_profile(profile, packet_period) ((void) (profile), (void) (packet_period), false)
+#define radio_power_prewarm()
+#define radio_power_transmit(payload) ((void) (payload))
+#define radio_power_transmit_acked(payload) ((void) (payload))
+#define radio_power_post_message(type, body) ((void) (type), (void) (body))
+#define radio_power_service()
+#define radio_power_suspend()
+#define radio_power_resume()
+
+#endif /* RFM69_LINK */
+
+#endif /* RADIO_POWER_H_ */
@@ -0,0 +1,517 @@
+#include "scheduler.h"
+#include "power.h"
+#include "telemetry.h"
+#include "trace.h"
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/sleep.h>
+#include <stddef.h>
+#include <util/atomic.h>
+
+#ifdef TIMER2_ASYNC
+#include <util/delay.h>
+
+/* ASSR flags that are set while a write to the matching Timer2 register is still crossing into the crystal's clock
+   domain. */
+#define TIMER2_UPDATE_BUSY ((1 << TCN2UB) | (1 << OCR2AUB) | (1 << OCR2BUB) | (1 << TCR2AUB) | (1 << TCR2BUB))
+#endif
+
+#define SLOT_MASK (SCHEDULER_WHEEL_SLOTS - 1)
+#define SLOT_SHIFT 5
+
+_Static_assert(SCHEDULER_WHEEL_SLOTS == (1 << SLOT_SHIFT), "slot occupancy is tracked in a uint32_t bitmap");
+_Static_assert(SCHEDULER_MAX_COMPARE_TICKS < 256, "TCNT2 must not lap the tick count between compare matches");
+_Static_assert(SCHEDULER_MIN_COMPARE_TICKS < SCHEDULER_MAX_COMPARE_TICKS, "compare match window is empty");
+
+/* The distant list is refiled on the last tick of every DISTANT_CHECK_TICKS.  A distant timer is at least
+   SCHEDULER_WHEEL_SLOTS - 1 coarse slots (993 ticks) out when it's started, so at half a lap of the coarse wheel a
+   check can never come too late to file it. */
+#define DISTANT_CHECK_TICKS 512
+
+/* Returned by next_event() when no timer is running. */
+#define NO_EVENT_TICKS (SCHEDULER_MAX_COMPARE_TICKS + 1)
+
+volatile struct Scheduler_Stats scheduler_stats;
+
+/*
+    near_slots[t & SLOT_MASK] holds the timers due on tick t, for the SCHEDULER_WHEEL_SLOTS ticks after wheel_ticks.
+    coarse_slots[(t >> SLOT_SHIFT) & SLOT_MASK] holds the timers due in the block of SCHEDULER_WHEEL_SLOTS ticks
+    starting at t, for blocks 1 to SCHEDULER_WHEEL_SLOTS - 1 ahead of the one wheel_ticks is in.  Each list is circular
+    with the slot pointing at its oldest timer, so timers due on the same tick expire in the order they were started.
+*/
+static struct Scheduler_Timer* near_slots[SCHEDULER_WHEEL_SLOTS];
+static struct Scheduler_Timer* coarse_slots[SCHEDULER_WHEEL_SLOTS];
+static struct Scheduler_Timer* distant_timers = NULL;
+static uint32_t near_occupied = 0;
+static uint32_t coarse_occupied = 0;
+
+/* Every timer due on or before this tick has been expired. */
+static uint32_t wheel_ticks = 0;
+
+/* Expired timers waiting for scheduler_run_ready(), oldest first. */
+static struct Scheduler_Timer* volatile ready_head = NULL;
+static struct Scheduler_Timer* ready_tail = NULL;
+
+/* The tick count as of the last time it was brought up to date, and the TCNT2 value it was brought up to date from. */
+static volatile uint32_t ticks = 0;
+static volatile uint8_t last_count = 0;
+
+/*
+    Must be called with interrupts disabled.  Straight after a wake up from power-save, an asynchronous TCNT2 can
+    still read as the count from before the sleep for one crystal cycle - that only makes us a tick behind, which
+    update_compare() copes with by expiring whatever is due that close anyway.
+*/
+static uint32_t sync_ticks()
+{
+    uint8_t count = TCNT2;
+    ticks += (uint8_t) (count - last_count);
+    last_count = count;
+    return ticks;
+}
+
+/*
+    @param bits - Slot occupancy bitmap
+    @param start - Slot to start looking from
+    @return uint8_t - How many slots past start the first occupied one is, or SCHEDULER_WHEEL_SLOTS if none are
+*/
+static uint8_t slots_to_next_occupied(uint32_t bits, uint8_t start)
+{
+    if(bits == 0) {
+        return SCHEDULER_WHEEL_SLOTS;
+    }
+
+    bits = (bits >> start) | (bits << ((SCHEDULER_WHEEL_SLOTS - start) & SLOT_MASK));
+    uint8_t distance = 0;
+    while(!(bits & 1)) {
+        bits >>= 1;
+        distance++;
+    }
+    return distance;
+}
+
+static void list_append(struct Scheduler_Timer** list, struct Scheduler_Timer* timer)
+{
+    struct Scheduler_Timer* head = *list;
+    if(head == NULL) {
+        timer->next = timer;
+        timer->prev = timer;
+        *list = timer;
+    } else {
+        timer->next = head;
+        timer->prev = head->prev;
+        head->prev->next = timer;
+        head->prev = timer;
+    }
+}
+
+/* @return bool - true if the list is empty afterwards */
+static bool list_remove(struct Scheduler_Timer** list, struct Scheduler_Timer* timer)
+{
+    if(timer->next == timer) {
+        *list = NULL;
+        return true;
+    }
+
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    if(*list == timer) {
+        *list = timer->next;
+    }
+    return false;
+}
+
+/*
+    Files a timer into the level of the wheel its expiry falls in.  Timers that are already due go in the slot for the
+    next tick.  Must be called with interrupts disabled.
+*/
+static void wheel_insert(struct Scheduler_Timer* timer)
+{
+    int32_t delta = timer->expires - wheel_ticks;
+    // Measured from the start of wheel_ticks' block rather than by subtracting block numbers, which lose the top
+    // SLOT_SHIFT bits of the tick count and so don't wrap along with it.
+    uint32_t blocks_ahead = (timer->expires - (wheel_ticks & ~(uint32_t) SLOT_MASK)) >> SLOT_SHIFT;
+
+    if(delta <= SCHEDULER_WHEEL_SLOTS) {
+        timer->level = TIMER_NEAR;
+        timer->slot = (delta > 0 ? timer->expires : wheel_ticks + 1) & SLOT_MASK;
+        list_append(&near_slots[timer->slot], timer);
+        near_occupied |= (uint32_t) 1 << timer->slot;
+    } else if(blocks_ahead < SCHEDULER_WHEEL_SLOTS) {
+        timer->level = TIMER_COARSE;
+        timer->slot = (timer->expires >> SLOT_SHIFT) & SLOT_MASK;
+        list_append(&coarse_slots[timer->slot], timer);
+        coarse_occupied |= (uint32_t) 1 << timer->slot;
+    } else {
+        timer->level = TIMER_DISTANT;
+        list_append(&distant_timers, timer);
+    }
+}
+
+// Must be called with interrupts disabled.
+static void wheel_remove(struct Scheduler_Timer* timer)
+{
+    switch(timer->level) {
+        case TIMER_NEAR:
+            if(list_remove(&near_slots[timer->slot], timer)) {
+                near_occupied &= ~((uint32_t) 1 << timer->slot);
+            }
+            break;
+        case TIMER_COARSE:
+            if(list_remove(&coarse_slots[timer->slot], timer)) {
+                coarse_occupied &= ~((uint32_t) 1 << timer->slot);
+            }
+            break;
+        case TIMER_DISTANT:
+            list_remove(&distant_timers, timer);
+            break;
+        case TIMER_STOPPED:
+            break;
+    }
+    timer->level = TIMER_STOPPED;
+}
+
+/*
+    Moves a whole list back through wheel_insert(), which puts each timer in the level it now belongs in.  Used to drop
+    a coarse slot into the near wheel as its block comes up, and to pull distant timers into the wheel.
+*/
+static void wheel_refile(struct Scheduler_Timer** list)
+{
+    struct Scheduler_Timer* timer = *list;
+    if(timer == NULL) {
+        return;
+    }
+
+    // Detach the list first - timers may land straight back on it.
+    timer->prev->next = NULL;
+    *list = NULL;
+    while(timer != NULL) {
+        struct Scheduler_Timer* next = timer->next;
+        wheel_insert(timer);
+        timer = next;
+    }
+}
+
+static void ready_push(struct Scheduler_Timer* timer)
+{
+    if(timer->ready) {
+        scheduler_stats.overruns++;
+    }
+    timer->ready = true;
+    timer->release = timer->expires;
+
+    if(!timer->queued) {
+        timer->queued = true;
+        timer->ready_next = NULL;
+        if(ready_head == NULL) {
+            ready_head = timer;
+        } else {
+            ready_tail->ready_next = timer;
+        }
+        ready_tail = timer;
+    }
+}
+
+/* Expires every timer in the near slot for wheel_ticks, restarting the periodic ones. */
+static void expire_slot()
+{
+    uint8_t slot = wheel_ticks & SLOT_MASK;
+    struct Scheduler_Timer* timer = near_slots[slot];
+    if(timer == NULL) {
+        return;
+    }
+
+    timer->prev->next = NULL;
+    near_slots[slot] = NULL;
+    near_occupied &= ~((uint32_t) 1 << slot);
+
+    while(timer != NULL) {
+        struct Scheduler_Timer* next = timer->next;
+        timer->level = TIMER_STOPPED;
+        ready_push(timer);
+
+        if(timer->period != 0) {
+            timer->expires += timer->period;
+            // Fallen a whole period or more behind - skip the expiries we missed rather than firing them back to back.
+            if((int32_t) (timer->expires - wheel_ticks) <= 0) {
+                timer->expires = wheel_ticks + timer->period;
+            }
+            wheel_insert(timer);
+        }
+        timer = next;
+    }
+}
+
+/*
+    Works out the next tick the wheel has something to do on - a near slot to expire, a coarse slot to drop into the
+    near wheel, or a tick to look at the distant timers on - as ticks after wheel_ticks.  Must be called with
+    interrupts disabled.
+
+    @param wake - Set to how far ahead the CPU actually needs waking, which for a coarse slot is its first timer's expiry
+                  rather than the tick it gets refiled on, so refiling never costs a wake up of its own
+    @return uint32_t - Ticks from wheel_ticks to the next event, or NO_EVENT_TICKS if no timer is running
+*/
+static uint32_t next_event(uint32_t* wake)
+{
+    uint32_t next = NO_EVENT_TICKS;
+    *wake = NO_EVENT_TICKS;
+
+    uint8_t near_distance = slots_to_next_occupied(near_occupied, (wheel_ticks + 1) & SLOT_MASK);
+    if(near_distance < SCHEDULER_WHEEL_SLOTS) {
+        next = near_distance + 1;
+        *wake = next;
+    }
+
+    uint8_t block = wheel_ticks >> SLOT_SHIFT;
+    uint8_t coarse_distance = slots_to_next_occupied(coarse_occupied, (block + 1) & SLOT_MASK);
+    if(coarse_distance < SCHEDULER_WHEEL_SLOTS) {
+        // Refiled on the last tick before its block, which leaves every timer in it within reach of the near wheel.
+        uint32_t refile = ((((wheel_ticks >> SLOT_SHIFT) + coarse_distance + 1) << SLOT_SHIFT) - 1) - wheel_ticks;
+        if(refile < next) {
+            next = refile;
+        }
+
+        const struct Scheduler_Timer* first = coarse_slots[(block + coarse_distance + 1) & SLOT_MASK];
+        const struct Scheduler_Timer* timer = first;
+        do {
+            uint32_t expires = timer->expires - wheel_ticks;
+            if(expires < *wake) {
+                *wake = expires;
+            }
+            timer = timer->next;
+        } while(timer != first);
+    }
+
+    if(distant_timers != NULL) {
+        uint32_t check = (wheel_ticks | (DISTANT_CHECK_TICKS - 1)) - wheel_ticks;
+        if(check == 0) {
+            check = DISTANT_CHECK_TICKS;
+        }
+        if(check < next) {
+            next = check;
+        }
+        if(check < *wake) {
+            *wake = check;
+        }
+    }
+
+    return next;
+}
+
+/*
+    Brings the wheel up to now, expiring everything that has come due on the way, and works out when the next compare
+    match is needed.  Must be called with interrupts disabled.
+
+    @param now - The current tick count
+    @return uint32_t - The tick the next compare match should happen on
+*/
+static uint32_t advance_wheel(uint32_t now)
+{
+    uint32_t wake;
+
+    // update_compare() can leave the wheel a tick or two ahead, when it pulls in timers due too soon to wait for.
+    if((int32_t) (now - wheel_ticks) < 0) {
+        now = wheel_ticks;
+    }
+
+    for(;;) {
+        uint32_t next = next_event(&wake);
+        if(next > now - wheel_ticks) {
+            break;
+        }
+
+        // Nothing happens on the ticks in between, so jump straight to the event.  This tick's slot is expired before
+        // anything is refiled, since a timer due SCHEDULER_WHEEL_SLOTS ticks from now hashes to the same slot.
+        wheel_ticks += next;
+        expire_slot();
+        if((wheel_ticks & (DISTANT_CHECK_TICKS - 1)) == DISTANT_CHECK_TICKS - 1) {
+            wheel_refile(&distant_timers);
+        }
+        if((wheel_ticks & SLOT_MASK) == SLOT_MASK) {
+            // Everything in the next block is now within reach of the near wheel, so the slot always ends up empty.
+            uint8_t slot = ((wheel_ticks >> SLOT_SHIFT) + 1) & SLOT_MASK;
+            wheel_refile(&coarse_slots[slot]);
+            coarse_occupied &= ~((uint32_t) 1 << slot);
+        }
+    }
+
+    // Nothing is due before the next event, so every timer is still in the right level for a wheel at now.
+    wake -= now - wheel_ticks;
+    wheel_ticks = now;
+    return now + (wake < SCHEDULER_MAX_COMPARE_TICKS ? wake : SCHEDULER_MAX_COMPARE_TICKS);
+}
+
+// Must be called with interrupts disabled.
+static void update_compare()
+{
+    uint32_t now = sync_ticks();
+    uint32_t next = advance_wheel(now);
+
+    while((int32_t) (next - now) < SCHEDULER_MIN_COMPARE_TICKS) {
+        next = advance_wheel(next);
+        now = sync_ticks();
+    }
+
+#ifdef TIMER2_ASYNC
+    // A write to OCR2A while the last one is still being synchronized to the crystal's clock would be lost.
+    while(ASSR & (1 << OCR2AUB));
+#endif
+    // The tick count and TCNT2 are both counted from zero, so the low byte of a tick count is the TCNT2 value for it.
+    OCR2A = (uint8_t) next;
+}
+
+/*
+    Starts Timer2 free running with TIMER2_PRESCALER and enables the compare match A interrupt that drives the
+    scheduler.  scheduler_now() works as soon as this has been called, even before interrupts are enabled.
+
+    With TIMER2_ASYNC this switches Timer2 over to the 32.768kHz crystal, following the sequence in the datasheet, and
+    first waits out the crystal's start up time - so it blocks for POWER_CRYSTAL_STARTUP_MS.
+*/
+void scheduler_init()
+{
+    TIMSK2 = 0;
+#ifdef TIMER2_ASYNC
+    ASSR = (1 << AS2);
+    _delay_ms(POWER_CRYSTAL_STARTUP_MS);
+#endif
+    TCCR2A = 0;
+    TCNT2 = 0;
+    OCR2A = SCHEDULER_MAX_COMPARE_TICKS;
+    TCCR2B = TIMER2_CLOCK_SELECT;
+#ifdef TIMER2_ASYNC
+    while(ASSR & TIMER2_UPDATE_BUSY);
+#endif
+    TIFR2 = (1 << OCF2A) | (1 << OCF2B) | (1 << TOV2);
+    TIMSK2 = (1 << OCIE2A);
+}
+
+/*
+    Starts a timer, or restarts it if it's already running.  Its callback is run from scheduler_run_ready() each time
+    it expires.  Any expiry of it that hasn't run yet is dropped.
+
+    @param timer - The timer, zeroed before its first use, which must stay allocated until it has been stopped or, for
+                   one shot timers, has run
+    @param callback - Called from the main loop when the timer expires
+    @param delay - Ticks from now until it first expires
+    @param period - Ticks between expiries after that, or 0 for a one shot timer
+    @param deadline - Ticks after expiring its callback is expected to have started by, for scheduler_stats
+*/
+void scheduler_start_timer(struct Scheduler_Timer* timer, Scheduler_Callback callback, uint32_t delay, uint16_t period, uint16_t deadline)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        wheel_remove(timer);
+        // Bring the wheel up to now first, so the new timer is filed against the right tick.
+        uint32_t now = sync_ticks();
+        advance_wheel(now);
+        timer->callback = callback;
+        timer->expires = now + delay;
+        timer->period = period;
+        timer->deadline = deadline;
+        timer->ready = false;
+        wheel_insert(timer);
+        update_compare();
+    }
+}
+
+/*
+    Stops a timer.  If it has expired but its callback hasn't run yet, it won't.  Does nothing if it isn't running.
+*/
+void scheduler_stop_timer(struct Scheduler_Timer* timer)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        wheel_remove(timer);
+        timer->ready = false;
+    }
+}
+
+/*
+    @return uint32_t - Ticks since scheduler_init(), not counting time spent in sleep modes that stop Timer2
+*/
+uint32_t scheduler_now()
+{
+    uint32_t now;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        now = sync_ticks();
+    }
+    return now;
+}
+
+/*
+    Runs the callback of every timer that has expired, in the order they expired.  Call from the main loop.
+
+    @return bool - true if any callback ran
+*/
+bool scheduler_run_ready()
+{
+    bool ran = false;
+
+    for(;;) {
+        struct Scheduler_Timer* timer;
+        bool ready;
+        int32_t late;
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            timer = ready_head;
+            if(timer != NULL) {
+                ready_head = timer->ready_next;
+                timer->queued = false;
+                ready = timer->ready;
+                timer->ready = false;
+                late = sync_ticks() - timer->release;
+            }
+        }
+
+        if(timer == NULL) {
+            return ran;
+        }
+
+        if(ready) {
+            // Negative if update_compare() expired the timer a tick or two early.
+            if(late > (int32_t) timer->deadline) {
+                scheduler_stats.missed_deadlines++;
+            }
+            trace_event(TRACE_TASK_BEGIN, (uintptr_t) timer->callback);
+            timer->callback();
+            trace_event(TRACE_TASK_END, 0);
+            ran = true;
+        }
+    }
+}
+
+/*
+    Puts the CPU to sleep until the next interrupt, unless a timer's callback is already waiting to run.  The sleep mode
+    comes from power_idle_sleep_mode() - idle, where Timer2, the ADC and the USART all keep running so any of them can
+    wake us, or with TIMER2_ASYNC and nothing holding the I/O clock, power-save, where only Timer2 and pin changes can.
+*/
+void scheduler_idle()
+{
+    uint8_t mode = power_idle_sleep_mode();
+    set_sleep_mode(mode);
+
+    cli();
+    if(ready_head == NULL) {
+#ifdef TIMER2_ASYNC
+        // The compare match only wakes us from power-save once the OCR2A write has reached the crystal's clock domain.
+        // The compare ISR always writes OCR2A, so waiting for that also makes sure a crystal cycle has gone by since
+        // Timer2 last woke us - going back to sleep any sooner can wake us again straight away.
+        if(mode == SLEEP_MODE_PWR_SAVE) {
+            while(ASSR & (1 << OCR2AUB));
+        }
+#endif
+        // The instruction after sei() always runs before any pending interrupt, so nothing can slip in between here.
+        telemetry_sleep_begin();
+        sleep_enable();
+        sei();
+        sleep_cpu();
+        sleep_disable();
+        telemetry_sleep_end(mode);
+    }
+    sei();
+}
+
+ISR(TIMER2_COMPA_vect)
+{
+    trace_event(TRACE_SCHEDULER_BEGIN, 0);
+    update_compare();
+    trace_event(TRACE_SCHEDULER_END, ready_head != NULL);
+}
@@ -0,0 +1,79 @@
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include "../avr_config.h"
+#include "timing.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+   A small cooperative scheduler built on Timer2.  Timer2 free runs - off the system clock with a prescaler of 1024
+   (256us ticks at 4MHz), or with TIMER2_ASYNC off the 32.768kHz crystal with a prescaler of 8 (244.14us ticks) - and
+   its compare match A interrupt is programmed for whichever timer is due next.  The ISR only moves expired timers onto
+   a ready queue - their callbacks run from the main loop via scheduler_run_ready(), and scheduler_idle() puts the CPU
+   to sleep until the next interrupt whenever there's nothing left to do, as deeply as util/power.h allows.
+
+   Timers live in a two level hashed timing wheel, so starting, stopping and expiring a timer are all constant time
+   no matter how many are running: timers due within SCHEDULER_WHEEL_SLOTS ticks sit in a slot per tick, timers due
+   within SCHEDULER_WHEEL_SLOTS^2 ticks sit in a slot per SCHEDULER_WHEEL_SLOTS ticks and drop down into the first
+   level as their time approaches, and anything further out waits on a list that is looked at every 512 ticks (131ms
+   at 4MHz).
+
+   Time is kept as a 32-bit tick count that is brought up to date from TCNT2 whenever it's read, so it stays correct
+   as long as it's read at least once every 256 ticks.  The compare ISR makes sure of that by never letting more than
+   SCHEDULER_MAX_COMPARE_TICKS go by between matches.  Timers with periods shorter than that never cause extra wake ups.
+*/
+
+/* Scheduler ticks are Timer2 ticks - use the TIMER2_*_TO_TICKS macros in timing.h to convert durations. */
+
+/* Slots in each level of the timing wheel.  Must be 32 - slot occupancy is tracked in a uint32_t bitmap. */
+#define SCHEDULER_WHEEL_SLOTS 32
+
+/* Longest gap between compare matches (49ms at 4MHz) - comfortably short of the 256 ticks it takes TCNT2 to lap us. */
+#define SCHEDULER_MAX_COMPARE_TICKS 192
+
+/* Compare matches closer than this to the current count could be missed while OCR2A is being written, so deadlines
+   that close are treated as already due. */
+#define SCHEDULER_MIN_COMPARE_TICKS 2
+
+typedef void (*Scheduler_Callback)();
+
+enum Scheduler_Timer_Level {
+    TIMER_STOPPED,
+    TIMER_NEAR,             // in a one tick slot
+    TIMER_COARSE,           // in a SCHEDULER_WHEEL_SLOTS tick slot
+    TIMER_DISTANT           // on the list of timers too far out for the wheel
+};
+
+/* Owned by whoever starts it - the scheduler only links it into its lists.  Treat the members as private. */
+struct Scheduler_Timer {
+    struct Scheduler_Timer* next;           // circular, doubly linked slot list
+    struct Scheduler_Timer* prev;
+    struct Scheduler_Timer* ready_next;     // ready queue
+    Scheduler_Callback callback;
+    uint32_t expires;
+    uint32_t release;                       // tick it last expired on
+    uint16_t period;
+    uint16_t deadline;
+    enum Scheduler_Timer_Level level;
+    uint8_t slot;
+    bool ready;                             // expired, and its callback hasn't run yet
+    bool queued;                            // on the ready queue - may be true after ready is cleared by a stop
+};
+
+struct Scheduler_Stats {
+    uint16_t missed_deadlines;  // callbacks that ran later than their timer's deadline
+    uint16_t overruns;          // timers that expired again before their previous expiry had run - that run is lost
+};
+
+extern volatile struct Scheduler_Stats scheduler_stats;
+
+void scheduler_init();
+void scheduler_start_timer(struct Scheduler_Timer* timer, Scheduler_Callback callback, uint32_t delay, uint16_t period, uint16_t deadline);
+void scheduler_stop_timer(struct Scheduler_Timer* timer);
+uint32_t scheduler_now();
+bool scheduler_run_ready();
+void scheduler_idle();
+
+#endif /* SCHEDULER_H_ */
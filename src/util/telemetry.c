@@ -0,0 +1,282 @@
+#include "telemetry.h"
+
+#ifdef TELEMETRY
+
+#include "radio_power.h"
+#include "scheduler.h"
+#include "../lib/rfm69/rfm69.h"
+#include "../types/message.h"
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+
+_Static_assert(TELEMETRY_NUM_COUNTERS == MESSAGE_TELEMETRY_COUNTERS, "telemetry messages carry every counter");
+
+/* CPU cycles in TIMER2_TICKS_PER_MS_NUM scheduler ticks. */
+#define CYCLES_PER_NUM_TICKS (TIMER2_TICKS_PER_MS_DEN * (F_CPU / 1000))
+
+_Static_assert(F_CPU % 1000 == 0, "F_CPU must be a whole number of kHz to turn cycles awake into ticks");
+
+volatile uint32_t telemetry_counters[TELEMETRY_NUM_COUNTERS];
+
+/*
+    Sleeps are timed from one wake up to the next, less the time awake in between - which is counted in CPU cycles on
+    Timer1, run only while the CPU is awake, since most of it is over within the tick it woke up on.
+*/
+
+/* Scheduler tick the CPU last woke up on. */
+static uint32_t last_wake = 0;
+
+/* Timer1 overflows - it runs from each wake up until the CPU goes back to sleep, and carries on from where it left off
+   the next time, so along with TCNT1 this counts every cycle awake. */
+static volatile uint16_t awake_overflows = 0;
+
+/* awake_cycles() at the last wake up. */
+static uint32_t wake_cycles = 0;
+
+/* Ticks awake since the last wake up, and cycles awake left over from making them into whole ticks - multiplied by
+   TIMER2_TICKS_PER_MS_NUM. */
+static uint32_t awake_ticks = 0;
+static uint32_t awake_remainder = 0;
+
+/* Counter the radio's current mode is being totted up in, and the tick it was entered on. */
+static enum Telemetry_Counter radio_counter = TELEMETRY_RADIO_STANDBY_TICKS;
+static uint32_t radio_since = 0;
+
+/* Tick the next report is due on. */
+static uint32_t next_report = TELEMETRY_PERIOD_TICKS;
+
+/* Where the supply voltage measurement for the next report has got to. */
+static volatile enum {
+    VCC_WAITING,        // not due yet
+    VCC_SETTLING,       // first conversion, while the bandgap settles after being switched in
+    VCC_MEASURING,
+    VCC_MEASURED
+} vcc_state = VCC_WAITING;
+
+static void write_decimal(struct Ring_Buffer* buffer, uint32_t value)
+{
+    char digits[10];
+    uint8_t num_digits = 0;
+
+    do {
+        digits[num_digits++] = '0' + (value % 10);
+        value /= 10;
+    } while(value != 0);
+
+    for(uint8_t i = num_digits; i > 0; i--) {
+        ring_buffer_write(buffer, digits[i - 1]);
+    }
+}
+
+// Brings the radio mode currently being timed up to date - unless it's still paying back a telemetry_radio_trip().
+static void update_radio_counter(uint32_t now)
+{
+    if((int32_t) (now - radio_since) > 0) {
+        telemetry_counters[radio_counter] += now - radio_since;
+        radio_since = now;
+    }
+}
+
+static enum Telemetry_Counter radio_mode_counter(uint8_t mode)
+{
+    switch(mode) {
+        case RFM69_MODE_SLEEP:
+            return TELEMETRY_RADIO_SLEEP_TICKS;
+        case RFM69_MODE_SYNTH:
+            return TELEMETRY_RADIO_SYNTH_TICKS;
+        case RFM69_MODE_RX:
+            return TELEMETRY_RADIO_RX_TICKS;
+        case RFM69_MODE_TX:
+            return TELEMETRY_RADIO_TX_TICKS;
+        default:
+            return TELEMETRY_RADIO_STANDBY_TICKS;
+    }
+}
+
+// Cycles counted on Timer1 so far - call with interrupts disabled.
+static uint32_t awake_cycles()
+{
+    uint16_t count = TCNT1;
+    uint16_t overflows = awake_overflows;
+
+    // An overflow whose ISR hasn't run yet has already taken TCNT1 round past 0.
+    if((TIFR1 & (1 << TOV1)) && count < 0x8000) {
+        overflows++;
+    }
+    return ((uint32_t) overflows << 16) | count;
+}
+
+// Call with interrupts disabled, right before going to sleep in scheduler_idle().
+void telemetry_sleep_begin()
+{
+    TCCR1B = 0;
+
+    // Before Timer1 first starts, the CPU has been awake since reset.
+    if(!(TIMSK1 & (1 << TOIE1))) {
+        awake_ticks = scheduler_now();
+        return;
+    }
+
+    // A stretch awake of over about 2 seconds (at 4MHz) would overflow this - only waits before power-down come close.
+    // Usually it's under a tick, so subtracting beats a 32-bit division.
+    awake_remainder += (awake_cycles() - wake_cycles) * TIMER2_TICKS_PER_MS_NUM;
+    awake_ticks = 0;
+    while(awake_remainder >= CYCLES_PER_NUM_TICKS) {
+        awake_remainder -= CYCLES_PER_NUM_TICKS;
+        awake_ticks++;
+    }
+}
+
+/*
+    Call right after waking up in scheduler_idle().  The interrupt that woke the CPU has already run by now, and goes
+    down as part of the sleep.
+
+    @param sleep_mode - The SLEEP_MODE_x slept in
+*/
+void telemetry_sleep_end(uint8_t sleep_mode)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint32_t now = scheduler_now();
+
+        // Can come out a tick below 0 when the cycles awake have made up a tick the tick count hasn't reached yet - the
+        // counters wrap anyway, and the next sleep makes it up.
+        uint32_t slept = now - last_wake - awake_ticks;
+        if(sleep_mode == SLEEP_MODE_PWR_SAVE) {
+            telemetry_counters[TELEMETRY_POWER_SAVE_TICKS] += slept;
+        } else {
+            telemetry_counters[TELEMETRY_IDLE_TICKS] += slept;
+        }
+        last_wake = now;
+
+        wake_cycles = awake_cycles();
+        TCCR1A = 0;
+        TIMSK1 = (1 << TOIE1);
+        TCCR1B = (1 << CS10);
+    }
+}
+
+ISR(TIMER1_OVF_vect)
+{
+    awake_overflows++;
+}
+
+// Call before every power-down sleep.
+void telemetry_power_down()
+{
+    telemetry_counters[TELEMETRY_POWER_DOWNS]++;
+}
+
+// Call whenever the RFM69 is switched to a new mode - new_mode is an enum Rfm69_Mode.
+void telemetry_radio_mode(uint8_t new_mode)
+{
+    update_radio_counter(scheduler_now());
+    radio_counter = radio_mode_counter(new_mode);
+}
+
+/*
+    Call when the RFM69 is about to visit a mode on its own, through AutoModes, and come back to the one it's in.  The
+    firmware never sees it happen, so the visit is counted up front and taken out of the current mode's time.
+
+    @param mode - The enum Rfm69_Mode it visits
+    @param ticks - About how long it stays there
+*/
+void telemetry_radio_trip(uint8_t mode, uint16_t ticks)
+{
+    update_radio_counter(scheduler_now());
+    telemetry_counters[radio_mode_counter(mode)] += ticks;
+    radio_since += ticks;
+}
+
+// Call right after every write to UDR0.
+void telemetry_byte_written()
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        telemetry_counters[TELEMETRY_USART_BYTES]++;
+    }
+}
+
+/*
+    Call before starting each analog stick conversion.
+
+    @return bool - true if the supply voltage should be measured instead - start a conversion of INTERNAL_BANDGAP,
+                   and pass the result to telemetry_bandgap_reading()
+*/
+bool telemetry_vcc_due()
+{
+    if(vcc_state != VCC_WAITING || (int32_t) (scheduler_now() - next_report) < 0) {
+        return false;
+    }
+    vcc_state = VCC_SETTLING;
+    return true;
+}
+
+/*
+    Call from the ADC ISR with each conversion of INTERNAL_BANDGAP.
+
+    @param reading - The bandgap voltage as a fraction of AVCC, out of 1024
+    @return bool - true if another conversion of INTERNAL_BANDGAP should be started straight away
+*/
+bool telemetry_bandgap_reading(uint16_t reading)
+{
+    if(vcc_state == VCC_SETTLING) {
+        vcc_state = VCC_MEASURING;
+        return true;
+    }
+
+    telemetry_counters[TELEMETRY_VCC_MV] = (reading == 0 ? 0 : TELEMETRY_BANDGAP_MV * 1024 / reading);
+    vcc_state = VCC_MEASURED;
+    return false;
+}
+
+/*
+    Call from the main loop.  Once a report is due and the supply voltage has been measured, queues the counters as a
+    line of text behind whatever packets are already waiting, as soon as the ring buffer has drained.
+
+    @param buffer - The ring buffer packets are sent from
+*/
+void telemetry_service(struct Ring_Buffer* buffer)
+{
+    uint32_t counters[TELEMETRY_NUM_COUNTERS];
+
+    if(vcc_state != VCC_MEASURED || buffer->newest_index != buffer->oldest_index) {
+        return;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint32_t now = scheduler_now();
+        update_radio_counter(now);
+        telemetry_counters[TELEMETRY_TICKS] = now;
+        for(uint8_t i = 0; i < TELEMETRY_NUM_COUNTERS; i++) {
+            counters[i] = telemetry_counters[i];
+        }
+    }
+
+    ring_buffer_write(buffer, 'T');
+    ring_buffer_write(buffer, 'E');
+    ring_buffer_write(buffer, 'L');
+    ring_buffer_write(buffer, ' ');
+    for(uint8_t i = 0; i < TELEMETRY_NUM_COUNTERS; i++) {
+        if(i != 0) {
+            ring_buffer_write(buffer, ',');
+        }
+        write_decimal(buffer, counters[i]);
+    }
+    ring_buffer_write(buffer, '\r');
+    ring_buffer_write(buffer, '\n');
+
+#ifdef RFM69_MESSAGES
+    uint8_t body[MESSAGE_TELEMETRY_LENGTH];
+    for(uint8_t i = 0; i < TELEMETRY_NUM_COUNTERS; i++) {
+        message_write_u32(&body[4 * i], counters[i]);
+    }
+    radio_power_post_message(MESSAGE_TELEMETRY, body);
+#endif
+
+    next_report += TELEMETRY_PERIOD_TICKS;
+    vcc_state = VCC_WAITING;
+}
+
+#endif /* TELEMETRY */
@@ -0,0 +1,84 @@
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include "timing.h"
+#include "../types/ring_buffer.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+   Optional energy accounting and supply voltage telemetry, for working out battery life from real use.  Build with
+   TELEMETRY defined to turn it on - otherwise every hook below compiles away to nothing.
+
+   Running totals are kept of where the time goes, in scheduler ticks: asleep in idle and in power-save (the rest of
+   the scheduler's time is time awake), and with the RFM69 in each of its modes.  Most wake ups are over well inside a
+   tick, so time awake is counted in CPU cycles on Timer1, which runs only while the CPU is awake - telemetry takes it
+   over, along with TIMER1_OVF_vect.  Timer2 stops in power-down, so
+   power-down sleeps are only counted, and none of the tick totals include them.  Bytes sent over the USART are
+   counted too, which gives the 433MHz transmitter's on air time.
+
+   Every TELEMETRY_PERIOD_SECONDS the supply voltage is measured against the internal 1.1V bandgap (in place of one
+   analog stick sample) and a line of text is queued once the ring buffer drains:
+       TEL <vcc mV>,<ticks>,<idle ticks>,<power-save ticks>,<power-downs>,<radio sleep ticks>,<radio standby ticks>,
+           <radio synth ticks>,<radio rx ticks>,<radio tx ticks>,<usart bytes>\r\n
+   all on one line, in decimal, in the order of enum Telemetry_Counter.  The counters are 32 bits and wrap, so only
+   compare differences between lines.  It never contains the packet start char, so receivers skip it, and
+   host/battery/battery_life turns a capture of them into a battery life projection.  With RFM69_MESSAGES the same
+   counters go out over the RFM69 too, as a MESSAGE_TELEMETRY (see types/message.h).
+*/
+
+#define TELEMETRY_PERIOD_SECONDS (uint16_t) 60
+#define TELEMETRY_PERIOD_TICKS TIMER2_SECONDS_TO_TICKS(TELEMETRY_PERIOD_SECONDS)
+
+/* The bandgap's nominal voltage.  It's only good to +-10% from part to part - calibrate against a meter for better. */
+#define TELEMETRY_BANDGAP_MV (uint32_t) 1100
+
+enum Telemetry_Counter {
+    TELEMETRY_VCC_MV,
+    TELEMETRY_TICKS,
+    TELEMETRY_IDLE_TICKS,
+    TELEMETRY_POWER_SAVE_TICKS,
+    TELEMETRY_POWER_DOWNS,
+    TELEMETRY_RADIO_SLEEP_TICKS,
+    TELEMETRY_RADIO_STANDBY_TICKS,
+    TELEMETRY_RADIO_SYNTH_TICKS,
+    TELEMETRY_RADIO_RX_TICKS,
+    TELEMETRY_RADIO_TX_TICKS,
+    TELEMETRY_USART_BYTES,
+    TELEMETRY_NUM_COUNTERS
+};
+
+#ifdef TELEMETRY
+
+#ifdef LATENCY_PROBE
+#error "TELEMETRY lines would throw off LATENCY_PROBE's count of the packet stream - enable one at a time"
+#endif
+
+extern volatile uint32_t telemetry_counters[TELEMETRY_NUM_COUNTERS];
+
+void telemetry_sleep_begin();
+void telemetry_sleep_end(uint8_t sleep_mode);
+void telemetry_power_down();
+void telemetry_radio_mode(uint8_t new_mode);
+void telemetry_radio_trip(uint8_t mode, uint16_t ticks);
+void telemetry_byte_written();
+bool telemetry_vcc_due();
+bool telemetry_bandgap_reading(uint16_t reading);
+void telemetry_service(struct Ring_Buffer* buffer);
+
+#else
+
+#define telemetry_sleep_begin()
+#define telemetry_sleep_end(sleep_mode)
+#define telemetry_power_down()
+#define telemetry_radio_mode(new_mode)
+#define telemetry_radio_trip(mode, ticks)
+#define telemetry_byte_written()
+#define telemetry_vcc_due() false
+#define telemetry_bandgap_reading(reading) false
+#define telemetry_service(buffer)
+
+#endif /* TELEMETRY */
+
+#endif /* TELEMETRY_H_ */
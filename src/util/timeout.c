@@ -1,35 +1,24 @@
 #include "timeout.h"
 
-volatile bool timer2_timeout_active = false;
-volatile uint8_t timer2_overflows_before_timeout = 0;
-volatile uint8_t timer2_timeout_ovf_counter = 0;
-
 /**
- * Performs basic set up to initiate a timeout using the Timer2 peripheral using the input number of overflows.
+ * Starts a timeout lasting the input number of scheduler ticks.  Time is read from the scheduler, so scheduler_init()
+ * must have been called first - interrupts don't need to be enabled.
  *
- * @param num_overflows Number of Timer2 overflows before a timeout is considered to be complete.
+ * @param timeout The timeout to start.  Restarting one that is already running is fine.
+ * @param num_ticks Number of scheduler ticks before the timeout is considered to be complete.
  */
-void start_timer2_timeout(uint8_t num_overflows)
+void start_timeout(struct Timeout* timeout, uint32_t num_ticks)
 {
-    timer2_timeout_active = true;
-    timer2_timeout_ovf_counter = 0;
-    timer2_overflows_before_timeout = num_overflows;
+    timeout->expires = scheduler_now() + num_ticks;
 }
 
 /**
- * Determines if the timeout configured for Timer2 has completed.  Should always be preceded by a call to
- * start_timer2_timeout(num_overflows).
- *
- * The Timer2 overflow ISR should be incrementing our timer2_timeout_ovf_counter - otherwise this will never
- * return true.
+ * Determines if a timeout has completed.  Should always be preceded by a call to start_timeout().
  *
- * @return true if timeout is complete, false otherwise
+ * @param timeout The timeout to check.
+ * @return true if the timeout is complete, false otherwise
  */
-bool timer2_timeout_complete()
+bool timeout_complete(const struct Timeout* timeout)
 {
-    if(!timer2_timeout_active) {
-        return true;
-    }
-    
-    return timer2_timeout_ovf_counter >= timer2_overflows_before_timeout;
-}
\ No newline at end of file
+    return (int32_t) (scheduler_now() - timeout->expires) >= 0;
+}
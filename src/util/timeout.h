@@ -1,22 +1,24 @@
 #ifndef TIMEOUT_H_
 #define TIMEOUT_H_
 
+#include "scheduler.h"
+
 #include <stdbool.h>
 #include <stdint.h>
 
-/* Flag indicating whether or not we should be counting up time towards some timeout value for Timer2. */
-extern volatile bool timer2_timeout_active;
-
-/* Number of Timer2 overflows before timeout is considered complete. */
-extern volatile uint8_t timer2_overflows_before_timeout;
-
-/* Timer2 overflow counter used to track time before a timeout occurs. */
-extern volatile uint8_t timer2_timeout_ovf_counter;
+/*
+   A timeout that is polled rather than called back - for busy waits like the ones in rfm69_init().  Each one is
+   independent, so any number can run at once.  Anything that should happen when a timeout ends without being polled
+   for belongs in a Scheduler_Timer instead.  Lengths are in scheduler ticks - see TIMER2_MS_TO_TICKS() in timing.h.
+*/
+struct Timeout {
+    uint32_t expires;   // scheduler tick the timeout is complete on
+};
 
-// Performs set up necessary to start a timeout using the Timer2 peripheral.
-void start_timer2_timeout(uint8_t num_overflows);
+// Starts a timeout lasting the given number of scheduler ticks, measured with the scheduler's clock.
+void start_timeout(struct Timeout* timeout, uint32_t num_ticks);
 
-// Determines if a started timeout is complete.  Should always be preceded by a call to start_timer2_timeout().
-bool timer2_timeout_complete();
+// Determines if a started timeout is complete.
+bool timeout_complete(const struct Timeout* timeout);
 
-#endif /* TIMEOUT_H_ */
\ No newline at end of file
+#endif /* TIMEOUT_H_ */
@@ -0,0 +1,60 @@
+#ifndef TIMING_H_
+#define TIMING_H_
+
+#include "../avr_config.h"
+
+#include <stdint.h>
+
+/*
+   Compile time timing math.  Every duration the firmware waits for is turned into Timer2 ticks or a baud rate divisor
+   here, using integer arithmetic only, so none of it costs anything at run time or drags the soft float library into
+   flash.  Timer2's tick rate is kept as an exact fraction (see avr_config.h), since ticks from the 32.768kHz crystal
+   aren't a whole number of microseconds.  The static assertions below (and next to each constant that uses these
+   macros) fail the build if a change to a clock or prescaler would make the results wrong or overflow, rather than
+   quietly skewing the timing.
+*/
+
+#define US_IN_SEC (uint32_t) 1000000
+#define US_IN_MS (uint32_t) 1000
+
+_Static_assert((uint64_t) TIMER2_TICKS_PER_MS_NUM * US_IN_MS * TIMER2_PRESCALER
+               == (uint64_t) TIMER2_TICKS_PER_MS_DEN * TIMER2_CLOCK_HZ,
+               "TIMER2_TICKS_PER_MS_NUM / TIMER2_TICKS_PER_MS_DEN doesn't match Timer2's clock and prescaler");
+
+/* Longest duration the macros below can convert without overflowing a uint32_t - a little over 9 hours with the
+   system clock, 2 hours 19 minutes from the 32.768kHz crystal. */
+#define TIMER2_MAX_MS ((UINT32_MAX - TIMER2_TICKS_PER_MS_DEN) / TIMER2_TICKS_PER_MS_NUM)
+
+/* Longest duration TIMER2_US_TO_TICKS() can convert - a little over 8 seconds from the crystal. */
+#define TIMER2_MAX_US ((UINT32_MAX - TIMER2_TICKS_PER_MS_DEN * US_IN_MS) / TIMER2_TICKS_PER_MS_NUM)
+
+/* Timer2 ticks in the given number of microseconds, rounded up so a wait never ends early.  us must be at most
+   TIMER2_MAX_US. */
+#define TIMER2_US_TO_TICKS(us) \
+    (((uint32_t) (us) * TIMER2_TICKS_PER_MS_NUM + TIMER2_TICKS_PER_MS_DEN * US_IN_MS - 1) \
+     / (TIMER2_TICKS_PER_MS_DEN * US_IN_MS))
+
+/* Timer2 ticks in the given number of milliseconds, rounded up.  ms must be at most TIMER2_MAX_MS. */
+#define TIMER2_MS_TO_TICKS(ms) \
+    (((uint32_t) (ms) * TIMER2_TICKS_PER_MS_NUM + TIMER2_TICKS_PER_MS_DEN - 1) / TIMER2_TICKS_PER_MS_DEN)
+
+/* Timer2 ticks in the given number of seconds, rounded up.  seconds must be at most TIMER2_MAX_MS / 1000. */
+#define TIMER2_SECONDS_TO_TICKS(seconds) TIMER2_MS_TO_TICKS((uint32_t) (seconds) * 1000)
+
+/* Timer2 ticks converted back to microseconds, rounded down - exact with the system clock, which gives 256us ticks at
+   4MHz.  ticks must be at most UINT32_MAX / (TIMER2_TICKS_PER_MS_DEN * US_IN_MS). */
+#define TIMER2_TICKS_TO_US(ticks) ((uint32_t) (ticks) * TIMER2_TICKS_PER_MS_DEN * US_IN_MS / TIMER2_TICKS_PER_MS_NUM)
+
+/* USART baud rate divisor for normal (16x) speed mode, rounded to the nearest value rather than down. */
+#define USART_UBRR(baud) (uint16_t) ((F_CPU + 8 * (uint32_t) (baud)) / (16 * (uint32_t) (baud)) - 1)
+
+/* Baud rate error, in tenths of a percent, of the given divisor against the rate it was computed for. */
+#define USART_BAUD_ERROR_PERMILLE(baud, ubrr) \
+    ((F_CPU > 16 * ((uint32_t) (ubrr) + 1) * (baud) ? F_CPU - 16 * ((uint32_t) (ubrr) + 1) * (baud) \
+                                                    : 16 * ((uint32_t) (ubrr) + 1) * (baud) - F_CPU) \
+     * 1000 / (16 * ((uint32_t) (ubrr) + 1) * (baud)))
+
+/* The most baud rate error the link tolerates - the ATmega328P datasheet recommends staying within 2% for 8N1. */
+#define USART_MAX_BAUD_ERROR_PERMILLE 20
+
+#endif /* TIMING_H_ */
@@ -0,0 +1,85 @@
+#include "trace.h"
+
+#ifdef TRACE
+
+struct Trace_Record trace_records[TRACE_NUM_RECORDS];
+volatile uint8_t trace_next_index = 0;
+volatile uint8_t trace_fresh_records = 0;
+volatile bool trace_frozen = false;
+
+/* Where the dump in progress has got to - how many records have been sent, or -1 before the TRS line has gone out. */
+static int8_t dump_position = -1;
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+static void write_hex_byte(struct Ring_Buffer* buffer, uint8_t value)
+{
+    ring_buffer_write(buffer, HEX_DIGITS[value >> 4]);
+    ring_buffer_write(buffer, HEX_DIGITS[value & 0x0F]);
+}
+
+static void write_line_start(struct Ring_Buffer* buffer, char type)
+{
+    ring_buffer_write(buffer, 'T');
+    ring_buffer_write(buffer, 'R');
+    ring_buffer_write(buffer, type);
+}
+
+static void write_line_end(struct Ring_Buffer* buffer)
+{
+    ring_buffer_write(buffer, '\r');
+    ring_buffer_write(buffer, '\n');
+}
+
+/*
+    Call from the main loop.  Once the ring is full of records that haven't been sent yet, freezes it and queues it as
+    text, one line per call, whenever the ring buffer has drained so packets are never held up mid-dump.  Events that
+    happen while a dump is in progress are not recorded.
+
+    @param buffer - The ring buffer packets are sent from
+*/
+void trace_service(struct Ring_Buffer* buffer)
+{
+    if(!trace_frozen) {
+        if(trace_fresh_records < TRACE_NUM_RECORDS) {
+            return;
+        }
+        trace_frozen = true;
+    }
+
+    if(buffer->newest_index != buffer->oldest_index) {
+        return;
+    }
+
+    if(dump_position < 0) {
+        uint32_t ticks_high = scheduler_now() >> 8;
+
+        write_line_start(buffer, 'S');
+        ring_buffer_write(buffer, ' ');
+        for(int8_t shift = 24; shift >= 0; shift -= 8) {
+            write_hex_byte(buffer, ticks_high >> shift);
+        }
+        write_line_end(buffer);
+        dump_position = 0;
+    } else if(dump_position < TRACE_NUM_RECORDS) {
+        write_line_start(buffer, 'C');
+        ring_buffer_write(buffer, ' ');
+        for(uint8_t i = 0; i < TRACE_RECORDS_PER_LINE && dump_position < TRACE_NUM_RECORDS; i++, dump_position++) {
+            // trace_next_index points at the oldest record once the ring is full.
+            const struct Trace_Record* record = &trace_records[(trace_next_index + dump_position) & (TRACE_NUM_RECORDS - 1)];
+            write_hex_byte(buffer, record->event);
+            write_hex_byte(buffer, record->arg);
+            write_hex_byte(buffer, record->ticks_high);
+            write_hex_byte(buffer, record->ticks_low);
+        }
+        write_line_end(buffer);
+    } else {
+        write_line_start(buffer, 'E');
+        write_line_end(buffer);
+        dump_position = -1;
+        trace_fresh_records = 0;
+        trace_frozen = false;
+    }
+}
+
+#endif /* TRACE */
@@ -0,0 +1,119 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include "../types/ring_buffer.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+   Optional flight recorder for ISR and main loop timing.  Build with TRACE defined to turn it on - otherwise every
+   hook below compiles away to nothing.
+
+   Each hook writes one four byte record (event, argument, scheduler tick count) into a small ring in RAM,
+   which costs a couple dozen cycles.  Once the ring has filled with fresh records, trace_service() freezes it and sends
+   it over the USART as hex text, which host/trace/trace_json turns into a Chrome trace / Perfetto timeline.
+
+   A dump looks like:
+       TRS <scheduler ticks / 256 when the ring froze, 8 hex digits>\r\n
+       TRC <record><record>...\r\n      (up to TRACE_RECORDS_PER_LINE records of 8 hex digits each, oldest first)
+       ...
+       TRE\r\n
+   None of it can contain the packet start char, so receivers skip it.
+
+   Dump lines only go out when the ring buffer is empty, and at 2400 baud packets leave just a few milliseconds of
+   idle time each, so a dump takes several seconds to get through - expect one window of TRACE_NUM_RECORDS events
+   every ten seconds or so rather than a continuous timeline.
+*/
+
+/* Must be a power of two. */
+#define TRACE_NUM_RECORDS 32
+
+#define TRACE_RECORDS_PER_LINE 8
+
+enum Trace_Event {
+    TRACE_SCHEDULER_BEGIN,      // scheduler compare match ISR
+    TRACE_SCHEDULER_END,        // arg: 1 if a timer callback is waiting to run
+    TRACE_ADC_BEGIN,            // arg: selected ADC channel
+    TRACE_ADC_END,
+    TRACE_USART_TX_BEGIN,
+    TRACE_USART_TX_END,
+    TRACE_PCINT,
+    TRACE_SLEEP_BEGIN,
+    TRACE_SLEEP_END,
+    TRACE_TASK_BEGIN,           // arg: low byte of the timer callback's address
+    TRACE_TASK_END,
+    TRACE_RADIO_INIT_BEGIN,
+    TRACE_RADIO_INIT_END,
+    TRACE_RADIO_MODE,           // arg: new Rfm69_Mode
+    TRACE_NUM_EVENTS
+};
+
+struct Trace_Record {
+    uint8_t event;
+    uint8_t arg;
+    uint8_t ticks_high;     // bits 8-15 of the scheduler tick count
+    uint8_t ticks_low;      // bits 0-7
+};
+
+#ifdef TRACE
+
+#include "scheduler.h"
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+#ifdef LATENCY_PROBE
+#error "TRACE and LATENCY_PROBE both send text behind the packet stream - enable one at a time"
+#endif
+
+extern struct Trace_Record trace_records[TRACE_NUM_RECORDS];
+
+/* Index the next record will be written to. */
+extern volatile uint8_t trace_next_index;
+
+/* Records written since the last dump - saturates at TRACE_NUM_RECORDS. */
+extern volatile uint8_t trace_fresh_records;
+
+/* Set while a dump is reading the ring out, so it isn't overwritten underneath it. */
+extern volatile bool trace_frozen;
+
+/*
+    Appends a record to the trace ring.  Inlined so ISRs don't pay for a call and the registers it clobbers.
+
+    @param event - What happened
+    @param arg - Event specific detail, 0 if unused
+*/
+static inline void trace_event(enum Trace_Event event, uint8_t arg)
+{
+    uint8_t sreg = SREG;
+    cli();
+
+    if(!trace_frozen) {
+        uint16_t ticks = (uint16_t) scheduler_now();
+
+        struct Trace_Record* record = &trace_records[trace_next_index];
+        record->event = event;
+        record->arg = arg;
+        record->ticks_high = ticks >> 8;
+        record->ticks_low = (uint8_t) ticks;
+
+        trace_next_index = (trace_next_index + 1) & (TRACE_NUM_RECORDS - 1);
+        if(trace_fresh_records < TRACE_NUM_RECORDS) {
+            trace_fresh_records++;
+        }
+    }
+
+    SREG = sreg;
+}
+
+void trace_service(struct Ring_Buffer* buffer);
+
+#else
+
+#define trace_event(event, arg)
+#define trace_service(buffer)
+
+#endif /* TRACE */
+
+#endif /* TRACE_H_ */
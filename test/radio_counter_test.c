@@ -0,0 +1,119 @@
+/*
+    Unit tests for the reservations util/radio_counter.h keeps in EEPROM, run on the host against the EEPROM stand-in in
+    host/sim/include.  radio_counter.c is built in here rather than linked, so that each test can set the EEPROM up the
+    way it wants and reset the counter as a real reset would.
+
+    cc -O2 -DRFM69_FRESHNESS -I../host/sim/include -o radio_counter_test radio_counter_test.c
+    ./radio_counter_test
+
+    Prints each test that fails, and exits non-zero if any did.
+*/
+#include "../src/util/radio_counter.c"
+
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_ASSERT(condition) \
+    do { \
+        if(!(condition)) { \
+            fprintf(stderr, "%s:%d: %s: assertion failed: %s\n", __FILE__, __LINE__, __func__, #condition); \
+            failures++; \
+            return; \
+        } \
+    } while(0)
+
+static unsigned failures = 0;
+
+/* Loses everything but the EEPROM, as a reset does, and starts the counter up again. */
+static void reset()
+{
+    pending = false;
+    memset(&radio_counter_stats, 0, sizeof(radio_counter_stats));
+    radio_counter_init();
+}
+
+/* Takes counters until the next reservation has its first byte written. */
+static void take_until_pending()
+{
+    uint32_t counter;
+    while(!pending) {
+        radio_counter_next(&counter);
+    }
+}
+
+/*
+    A node whose EEPROM was never flashed starts from 0 and carries on through reservation after reservation.
+*/
+static void test_erased_eeprom()
+{
+    memset(reservations, 0xFF, sizeof(reservations));
+    reset();
+    TEST_ASSERT(radio_counter_stats.first == 0);
+
+    uint32_t counter;
+    for(uint32_t expected = 0; expected < 3 * RADIO_COUNTER_SLOTS * RADIO_COUNTER_CHUNK; expected++) {
+        TEST_ASSERT(radio_counter_next(&counter) && counter == expected);
+    }
+}
+
+/*
+    A reset partway through writing a reservation - into a slot that was erased, or that held an older one - never
+    hands out a counter again, and never stops the node getting more.
+
+    @param erased - Whether the EEPROM starts out erased, rather than from the build's image
+*/
+static void check_cut_off_writes(bool erased)
+{
+    for(uint8_t written = 1; written < SLOT_BYTES; written++) {
+        memset(reservations, erased ? 0xFF : 0, sizeof(reservations));
+        reset();
+
+        // Once round the slots first, so that every one holds an older reservation unless they started out erased.
+        uint32_t counter = 0;
+        uint32_t highest = 0;
+        uint8_t laps = (erased ? 0 : RADIO_COUNTER_SLOTS);
+        for(uint8_t lap = 0; lap <= laps; lap++) {
+            take_until_pending();
+            while(pending && radio_counter_next(&counter)) {
+                highest = counter;
+            }
+            while(pending) {
+                radio_counter_next(&counter);
+            }
+        }
+
+        take_until_pending();
+        for(uint8_t byte = 0; byte < written; byte++) {
+            TEST_ASSERT(radio_counter_next(&counter));
+            highest = counter;
+        }
+        TEST_ASSERT(pending);
+
+        reset();
+        TEST_ASSERT(radio_counter_stats.first > highest);
+        for(uint32_t i = 0; i < 2 * RADIO_COUNTER_CHUNK; i++) {
+            TEST_ASSERT(radio_counter_next(&counter) && counter > highest);
+            highest = counter;
+        }
+    }
+}
+
+static void test_cut_off_into_erased_slot()
+{
+    check_cut_off_writes(true);
+}
+
+static void test_cut_off_over_older_reservation()
+{
+    check_cut_off_writes(false);
+}
+
+int main(void)
+{
+    test_erased_eeprom();
+    test_cut_off_into_erased_slot();
+    test_cut_off_over_older_reservation();
+
+    printf("%s: %u failed\n", failures == 0 ? "passed" : "FAILED", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,301 @@
+/*
+    Unit tests for the scheduler's timing wheel and the timeouts built on it, run on the host against the simulated
+    Timer2 in host/sim/avr_sim.c.  scheduler.c is built in here rather than linked, so that each test can start from a
+    clean wheel, and the wraparound test can wind the tick count forward to just short of 2^32.
+
+    cc -O2 -I../host/sim/include -o scheduler_test scheduler_test.c ../host/sim/avr_sim.c
+    ./scheduler_test
+
+    Add -DTIMER2_ASYNC and ../src/util/power.c to run the same tests with Timer2 clocked from the 32.768kHz crystal.
+    Prints each test that fails, and exits non-zero if any did.
+*/
+#include "../src/util/scheduler.c"
+#include "../src/util/timeout.c"
+#include "../host/sim/avr_sim.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* Simulated cycles run between looks at the tick count - well under a tick with either Timer2 clock. */
+#define STEP_CYCLES 64
+
+/* A tick count 256 ticks short of wrapping, whose low byte matches TCNT2 straight after scheduler_init(). */
+#define WRAP_START_TICKS (UINT32_MAX - 255)
+
+#define TEST_ASSERT(condition) \
+    do { \
+        if(!(condition)) { \
+            fprintf(stderr, "%s:%d: %s: assertion failed: %s\n", __FILE__, __LINE__, __func__, #condition); \
+            failures++; \
+            return; \
+        } \
+    } while(0)
+
+/* What happened to one timer - filled in by its callback. */
+struct Expiry_Log {
+    unsigned runs;
+    uint32_t last_tick;     // scheduler_now() when the callback last ran
+};
+
+static struct Expiry_Log near_log, coarse_log, distant_log;
+static unsigned failures = 0;
+
+static void near_expired()
+{
+    near_log.runs++;
+    near_log.last_tick = scheduler_now();
+}
+
+static void coarse_expired()
+{
+    coarse_log.runs++;
+    coarse_log.last_tick = scheduler_now();
+}
+
+static void distant_expired()
+{
+    distant_log.runs++;
+    distant_log.last_tick = scheduler_now();
+}
+
+/*
+    The firmware's main loop, cut down to the scheduler and without scheduler_idle() - asleep, the simulation only
+    comes back at the next compare match, and the tests need to stop it on any tick they like.
+*/
+static void main_loop()
+{
+    scheduler_run_ready();
+}
+
+/*
+    Puts the scheduler and the simulated MCU back to how they were at power on, then starts the scheduler with the
+    tick count at start_ticks.
+
+    @param start_ticks - Must have the low byte 0, since TCNT2 starts from 0
+*/
+static void reset(uint32_t start_ticks)
+{
+    memset(near_slots, 0, sizeof(near_slots));
+    memset(coarse_slots, 0, sizeof(coarse_slots));
+    distant_timers = NULL;
+    near_occupied = 0;
+    coarse_occupied = 0;
+    ready_head = NULL;
+    ready_tail = NULL;
+    memset((void*) &scheduler_stats, 0, sizeof(scheduler_stats));
+
+    memset(&near_log, 0, sizeof(near_log));
+    memset(&coarse_log, 0, sizeof(coarse_log));
+    memset(&distant_log, 0, sizeof(distant_log));
+
+    sim_reset();
+    sim_set_main_loop(main_loop);
+    scheduler_init();
+
+    // The tick count only ever moves by however far TCNT2 has, so it can be started anywhere with a matching low byte.
+    last_count = TCNT2;
+    ticks = start_ticks + last_count;
+    wheel_ticks = ticks;
+    sei();
+}
+
+/*
+    Runs the simulation until the tick count reaches the given tick, so any timer due on it has already run.
+*/
+static void run_until_tick(uint32_t tick)
+{
+    while((int32_t) (scheduler_now() - tick) < 0) {
+        sim_run_until(sim_cycles() + STEP_CYCLES);
+    }
+}
+
+static void run_for_ticks(uint32_t count)
+{
+    run_until_tick(scheduler_now() + count);
+}
+
+/*
+    A timer in each level of the wheel - a near one, a coarse one that has to drop down into the near wheel, and a
+    distant one that has to be pulled in through both - each expires once, on the tick it was due.
+*/
+static void test_wheel_levels()
+{
+    reset(0);
+    struct Scheduler_Timer near = { 0 }, coarse = { 0 }, distant = { 0 };
+    uint32_t start = scheduler_now();
+
+    scheduler_start_timer(&near, near_expired, 5, 0, 0);
+    scheduler_start_timer(&coarse, coarse_expired, 300, 0, 0);
+    scheduler_start_timer(&distant, distant_expired, 5000, 0, 0);
+    TEST_ASSERT(near.level == TIMER_NEAR);
+    TEST_ASSERT(coarse.level == TIMER_COARSE);
+    TEST_ASSERT(distant.level == TIMER_DISTANT);
+
+    run_for_ticks(6000);
+    TEST_ASSERT(near_log.runs == 1 && near_log.last_tick == start + 5);
+    TEST_ASSERT(coarse_log.runs == 1 && coarse_log.last_tick == start + 300);
+    TEST_ASSERT(distant_log.runs == 1 && distant_log.last_tick == start + 5000);
+    TEST_ASSERT(near.level == TIMER_STOPPED && coarse.level == TIMER_STOPPED && distant.level == TIMER_STOPPED);
+    TEST_ASSERT(scheduler_stats.missed_deadlines == 0 && scheduler_stats.overruns == 0);
+}
+
+/*
+    A stopped timer never runs, whether it was still waiting in the wheel or had already expired onto the ready queue,
+    and starting one that's already running moves it rather than adding a second expiry.
+*/
+static void test_stop_and_restart()
+{
+    reset(0);
+    struct Scheduler_Timer timer = { 0 };
+    uint32_t start = scheduler_now();
+
+    scheduler_start_timer(&timer, near_expired, 100, 0, 0);
+    run_for_ticks(50);
+    scheduler_stop_timer(&timer);
+    TEST_ASSERT(timer.level == TIMER_STOPPED);
+    run_until_tick(start + 200);
+    TEST_ASSERT(near_log.runs == 0);
+
+    // Restarted while it's still waiting, it runs only on the later expiry.
+    start = scheduler_now();
+    scheduler_start_timer(&timer, near_expired, 10, 0, 0);
+    run_for_ticks(5);
+    scheduler_start_timer(&timer, near_expired, 40, 0, 0);
+    run_until_tick(start + 100);
+    TEST_ASSERT(near_log.runs == 1 && near_log.last_tick == start + 45);
+
+    // Expired, but with the main loop not yet round to its callback.
+    sim_set_main_loop(NULL);
+    scheduler_start_timer(&timer, near_expired, 10, 0, 0);
+    run_for_ticks(20);
+    TEST_ASSERT(timer.ready);
+    scheduler_stop_timer(&timer);
+    TEST_ASSERT(!scheduler_run_ready());
+    TEST_ASSERT(near_log.runs == 1);
+}
+
+/*
+    A periodic timer whose expiries can't be handled for a while - its compare match held off with interrupts
+    disabled, or the main loop busy elsewhere - runs its callback once when they can be, counts the expiries it lost as
+    overruns, and carries on from its original schedule rather than firing the missed ones back to back.
+*/
+static void test_periodic_catch_up()
+{
+    reset(0);
+    struct Scheduler_Timer timer = { 0 };
+    uint32_t start = scheduler_now();
+
+    scheduler_start_timer(&timer, near_expired, 10, 10, 2);
+    run_until_tick(start + 30);
+    TEST_ASSERT(near_log.runs == 3 && near_log.last_tick == start + 30);
+
+    // Expiries at 40, 50, 60 and 70 all come due inside the one compare ISR.
+    cli();
+    run_until_tick(start + 75);
+    sei();
+    sim_run_until(sim_cycles());
+    TEST_ASSERT(near_log.runs == 4);
+    TEST_ASSERT(scheduler_stats.overruns == 3);
+    TEST_ASSERT(scheduler_stats.missed_deadlines == 1);
+
+    run_until_tick(start + 80);
+    TEST_ASSERT(near_log.runs == 5 && near_log.last_tick == start + 80);
+
+    // The ISR keeps up, but nothing runs the callbacks for a while.
+    sim_set_main_loop(NULL);
+    run_until_tick(start + 125);
+    sim_set_main_loop(main_loop);
+    sim_run_until(sim_cycles());
+    TEST_ASSERT(near_log.runs == 6);
+    TEST_ASSERT(scheduler_stats.overruns == 6);
+
+    run_until_tick(start + 130);
+    TEST_ASSERT(near_log.runs == 7 && near_log.last_tick == start + 130);
+    TEST_ASSERT(timer.level == TIMER_NEAR);
+}
+
+/*
+    Timers in every level, and a periodic one, keep expiring on the right tick as the 32-bit tick count wraps to 0 -
+    including one started just short of the wrap that's due just after it, which has to go in the coarse wheel rather
+    than wait for the next look at the distant list.
+*/
+static void test_tick_wraparound()
+{
+    reset(WRAP_START_TICKS);
+    struct Scheduler_Timer near = { 0 }, coarse = { 0 }, late_coarse = { 0 }, distant = { 0 };
+    uint32_t start = scheduler_now();
+
+    scheduler_start_timer(&near, near_expired, 100, 100, 0);
+    scheduler_start_timer(&coarse, coarse_expired, 600, 0, 0);
+    scheduler_start_timer(&distant, distant_expired, 3000, 0, 0);
+    TEST_ASSERT(coarse.level == TIMER_COARSE);
+    TEST_ASSERT(distant.level == TIMER_DISTANT);
+
+    run_until_tick(start + 250);
+    TEST_ASSERT(near_log.runs == 2 && near_log.last_tick == start + 200);
+    scheduler_start_timer(&late_coarse, coarse_expired, 100, 0, 0);
+    TEST_ASSERT(late_coarse.level == TIMER_COARSE);
+
+    run_until_tick(start + 360);
+    TEST_ASSERT(scheduler_now() < start);
+    TEST_ASSERT(near_log.runs == 3 && near_log.last_tick == start + 300);
+    TEST_ASSERT(coarse_log.runs == 1 && coarse_log.last_tick == start + 350);
+
+    run_until_tick(start + 3500);
+    TEST_ASSERT(near_log.runs == 35 && near_log.last_tick == start + 3500);
+    TEST_ASSERT(coarse_log.runs == 2 && coarse_log.last_tick == start + 600);
+    TEST_ASSERT(distant_log.runs == 1 && distant_log.last_tick == start + 3000);
+    TEST_ASSERT(scheduler_stats.missed_deadlines == 0 && scheduler_stats.overruns == 0);
+}
+
+/*
+    A timeout is complete from the tick it was started for onwards, not before - across the tick count wrapping too -
+    and any number of them run independently.
+*/
+static void test_timeouts()
+{
+    reset(0);
+    struct Timeout short_timeout, long_timeout, zero_timeout;
+
+    start_timeout(&zero_timeout, 0);
+    TEST_ASSERT(timeout_complete(&zero_timeout));
+
+    start_timeout(&short_timeout, 20);
+    start_timeout(&long_timeout, 50);
+    run_for_ticks(19);
+    TEST_ASSERT(!timeout_complete(&short_timeout) && !timeout_complete(&long_timeout));
+    run_for_ticks(1);
+    TEST_ASSERT(timeout_complete(&short_timeout) && !timeout_complete(&long_timeout));
+
+    // Restarting one that's running starts it again from now.
+    start_timeout(&long_timeout, 50);
+    run_for_ticks(49);
+    TEST_ASSERT(!timeout_complete(&long_timeout));
+    run_for_ticks(1);
+    TEST_ASSERT(timeout_complete(&long_timeout));
+
+    reset(WRAP_START_TICKS);
+    start_timeout(&short_timeout, 300);
+    start_timeout(&long_timeout, 400);
+    run_for_ticks(299);
+    TEST_ASSERT(scheduler_now() < WRAP_START_TICKS);
+    TEST_ASSERT(!timeout_complete(&short_timeout) && !timeout_complete(&long_timeout));
+    run_for_ticks(1);
+    TEST_ASSERT(timeout_complete(&short_timeout) && !timeout_complete(&long_timeout));
+    run_for_ticks(99);
+    TEST_ASSERT(!timeout_complete(&long_timeout));
+    run_for_ticks(1);
+    TEST_ASSERT(timeout_complete(&long_timeout) && timeout_complete(&short_timeout));
+}
+
+int main(void)
+{
+    test_wheel_levels();
+    test_stop_and_restart();
+    test_periodic_catch_up();
+    test_tick_wraparound();
+    test_timeouts();
+
+    printf("%s: %u failed\n", failures == 0 ? "passed" : "FAILED", failures);
+    return failures == 0 ? 0 : 1;
+}